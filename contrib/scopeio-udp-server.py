@@ -0,0 +1,147 @@
+#!/usr/bin/env python3
+##
+## This file is part of the libsigrok project.
+##
+## This program is free software: you can redistribute it and/or modify
+## it under the terms of the GNU General Public License as published by
+## the Free Software Foundation, either version 3 of the License, or
+## (at your option) any later version.
+##
+## This program is distributed in the hope that it will be useful,
+## but WITHOUT ANY WARRANTY; without even the implied warranty of
+## MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+## GNU General Public License for more details.
+##
+## You should have received a copy of the GNU General Public License
+## along with this program.  If not, see <http://www.gnu.org/licenses/>.
+##
+
+"""
+Stand-in for a ScopeIO device, for testing the scopeio driver without
+hardware. Serves block read requests from a sample memory image which
+holds eight interleaved channels of 13 bit samples (sine waves of
+different frequencies). Replies can get split into several datagrams,
+which then get dropped, duplicated, or held back and sent after those
+of later requests, to exercise the driver's reassembly and
+retransmission logic.
+
+  $ contrib/scopeio-udp-server.py --split 0.5 --loss 0.05 --reorder 0.1 &
+  $ sigrok-cli -d scopeio --frames 10 -l 4
+"""
+
+import argparse
+import math
+import random
+import socket
+import struct
+
+CHANNELS = 8
+SAMPLE_WIDTH = 13
+MEMORY_SIZE = 64 * 1024
+
+
+def memory_image(size):
+    """Pack interleaved samples MSB first into a bit stream."""
+    out = bytearray()
+    acc, bits, n = 0, 0, 0
+    while len(out) < size:
+        ch = n % CHANNELS
+        t = n // CHANNELS
+        value = 2048 + 1800 * math.sin(2 * math.pi * t * (ch + 1) / 256)
+        acc = (acc << SAMPLE_WIDTH) | (int(value) & 0x1fff)
+        bits += SAMPLE_WIDTH
+        while bits >= 8:
+            bits -= 8
+            out.append((acc >> bits) & 0xff)
+        acc &= (1 << bits) - 1
+        n += 1
+    return bytes(out[:size])
+
+
+def parse_request(data):
+    """Return (tag, address, length) of a block read request, or None."""
+    if len(data) < 2:
+        return None
+    data = data[2:]
+    tag, addr, length = None, None, None
+    while len(data) >= 2:
+        rid, rlen = data[0], data[1] + 1
+        payload = data[2:2 + rlen]
+        if rid == 0x17 and len(payload) >= 3:
+            length = payload[1] * 256 + payload[2] + 1
+        elif rid == 0x16 and len(payload) >= 4:
+            addr = struct.unpack('>I', payload[:4])[0]
+        elif rid == 0x19 and len(payload) >= 2:
+            tag = struct.unpack('>H', payload[:2])[0]
+        data = data[2 + rlen:]
+    if tag is None or addr is None or length is None:
+        return None
+    return tag, addr, length
+
+
+def reply(memory, tag, addr, length, rng, split):
+    """
+    Return the datagrams of a reply. Each one starts with the request's
+    tag, and the address of the data records which follow.
+    """
+    offset = (addr & 0x7fffffff) % len(memory)
+    chunk = (memory + memory)[offset:offset + length]
+    out = []
+    pos = 0
+    while pos < len(chunk):
+        size = len(chunk) - pos
+        if rng.random() < split:
+            size = rng.randint(1, size)
+        dgram = bytearray([0x19, 0x01]) + struct.pack('>H', tag)
+        dgram += bytes([0x16, 0x03]) + struct.pack('>I', addr + pos)
+        for start in range(pos, pos + size, 256):
+            part = chunk[start:min(start + 256, pos + size)]
+            dgram += bytes([0x18, len(part) - 1]) + part
+        out.append(bytes(dgram))
+        pos += size
+    return out
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split('\n\n')[0])
+    parser.add_argument('--bind', default='127.0.0.1')
+    parser.add_argument('--port', type=int, default=8080)
+    parser.add_argument('--split', type=float, default=0.0,
+                        help='probability of splitting a reply datagram')
+    parser.add_argument('--loss', type=float, default=0.0,
+                        help='probability of dropping a datagram')
+    parser.add_argument('--duplicate', type=float, default=0.0,
+                        help='probability of sending a datagram twice')
+    parser.add_argument('--reorder', type=float, default=0.0,
+                        help='probability of holding back a datagram')
+    parser.add_argument('--seed', type=int, default=None)
+    args = parser.parse_args()
+
+    rng = random.Random(args.seed)
+    memory = memory_image(MEMORY_SIZE)
+    sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    sock.bind((args.bind, args.port))
+    held = []
+    while True:
+        data, peer = sock.recvfrom(2048)
+        req = parse_request(data)
+        if req is None:
+            continue
+        # Datagrams which were held back go out after the next reply's.
+        late, held = held, []
+        for dgram in reply(memory, *req, rng, args.split):
+            if rng.random() < args.loss:
+                continue
+            if rng.random() < args.reorder:
+                held.append(dgram)
+                continue
+            sock.sendto(dgram, peer)
+            if rng.random() < args.duplicate:
+                sock.sendto(dgram, peer)
+        rng.shuffle(late)
+        for dgram in late:
+            sock.sendto(dgram, peer)
+
+
+if __name__ == '__main__':
+    main()
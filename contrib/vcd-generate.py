@@ -0,0 +1,118 @@
+#!/usr/bin/env python3
+##
+## This file is part of the libsigrok project.
+##
+## This program is free software: you can redistribute it and/or modify
+## it under the terms of the GNU General Public License as published by
+## the Free Software Foundation, either version 3 of the License, or
+## (at your option) any later version.
+##
+## This program is distributed in the hope that it will be useful,
+## but WITHOUT ANY WARRANTY; without even the implied warranty of
+## MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+## GNU General Public License for more details.
+##
+## You should have received a copy of the GNU General Public License
+## along with this program.  If not, see <http://www.gnu.org/licenses/>.
+##
+
+"""
+Generate a VCD file of a given size, resembling an HDL simulator's dump:
+many single-bit wires, some vectors, a few real and integer signals, and
+a string signal (which the VCD input module ignores). Value changes are
+random but reproducible for a given seed. Serves as a benchmark input
+for the VCD input module:
+
+  $ contrib/vcd-generate.py --size 1G > big.vcd
+  $ time sigrok-cli -I vcd -i big.vcd -O null -o /dev/null
+"""
+
+import argparse
+import random
+import sys
+
+SUFFIXES = {'k': 1 << 10, 'm': 1 << 20, 'g': 1 << 30}
+
+
+def parse_size(text):
+    text = text.strip().lower()
+    if text and text[-1] in SUFFIXES:
+        return int(text[:-1]) * SUFFIXES[text[-1]]
+    return int(text)
+
+
+def identifier(n):
+    """Identifier codes the way simulators assign them: !, ", ..., !!, ..."""
+    text = ''
+    n += 1
+    while n:
+        n -= 1
+        text = chr(33 + n % 94) + text
+        n //= 94
+    return text
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split('\n\n')[0])
+    parser.add_argument('--size', type=parse_size, default=parse_size('1G'),
+                        help='approximate output size (suffixes k, M, G)')
+    parser.add_argument('--wires', type=int, default=160)
+    parser.add_argument('--vectors', type=int, default=24)
+    parser.add_argument('--reals', type=int, default=4)
+    parser.add_argument('--integers', type=int, default=4)
+    parser.add_argument('--seed', type=int, default=1)
+    args = parser.parse_args()
+
+    rng = random.Random(args.seed)
+    out = sys.stdout
+    signals = []
+
+    def declare(kind, vtype, width, name):
+        ident = identifier(len(signals))
+        out.write('$var %s %d %s %s $end\n' % (vtype, width, ident, name))
+        signals.append((kind, ident, width))
+
+    out.write('$timescale 1ns $end\n$scope module top $end\n')
+    for i in range(args.wires):
+        declare('bit', 'wire', 1, 'w%d' % i)
+    for i in range(args.vectors):
+        width = rng.choice([4, 8, 16, 32])
+        declare('vec', 'reg', width, 'v%d [%d:0]' % (i, width - 1))
+    for i in range(args.reals):
+        declare('real', 'real', 64, 'r%d' % i)
+    for i in range(args.integers):
+        declare('vec', 'integer', 32, 'n%d' % i)
+    declare('str', 'string', 1, 's0')
+    out.write('$upscope $end\n$enddefinitions $end\n$dumpvars\n')
+    for kind, ident, width in signals:
+        if kind == 'bit':
+            out.write('0%s\n' % ident)
+        elif kind == 'vec':
+            out.write('b0 %s\n' % ident)
+        elif kind == 'real':
+            out.write('r0 %s\n' % ident)
+    out.write('$end\n')
+
+    timestamp = 0
+    written = 0
+    while written < args.size:
+        timestamp += rng.choice([1, 1, 1, 2, 5, 100])
+        lines = ['#%d' % timestamp]
+        for _ in range(rng.randint(1, 12)):
+            kind, ident, width = rng.choice(signals)
+            if kind == 'bit':
+                lines.append('%s%s' % (rng.choice('01xz'), ident))
+            elif kind == 'vec':
+                value = bin(rng.getrandbits(width))[2:]
+                lines.append('b%s %s' % (value, ident))
+            elif kind == 'real':
+                lines.append('r%.6g %s' % (rng.uniform(-5, 5), ident))
+            else:
+                lines.append('sidle %s' % ident)
+        text = '\n'.join(lines) + '\n'
+        written += len(text)
+        out.write(text)
+
+
+if __name__ == '__main__':
+    main()
@@ -176,10 +176,35 @@ enum sr_packettype {
 	SR_DF_FRAME_END,
 	/** Payload is struct sr_datafeed_analog. */
 	SR_DF_ANALOG,
+	/** Payload is struct sr_datafeed_logic_rle. */
+	SR_DF_LOGIC_RLE,
 
 	/* Update datafeed_dump() (session.c) upon changes! */
 };
 
+/** Flags for datafeed callbacks, see sr_session_datafeed_callback_add_flags(). */
+enum sr_datafeed_callback_flag {
+	/**
+	 * The callback accepts SR_DF_LOGIC_RLE packets. Callbacks without
+	 * this flag receive the equivalent SR_DF_LOGIC packets instead.
+	 */
+	SR_DATAFEED_CB_LOGIC_RLE = 0x01,
+};
+
+/**
+ * What sr_session_send() does when a datafeed callback's queue is full,
+ * see sr_session_datafeed_threads_set().
+ */
+enum sr_datafeed_queue_policy {
+	/** Wait until the callback's thread made room in the queue. */
+	SR_DATAFEED_QUEUE_BLOCK,
+	/**
+	 * Discard the sample data packet (SR_DF_LOGIC, SR_DF_LOGIC_RLE,
+	 * SR_DF_ANALOG). Other packet types are never dropped.
+	 */
+	SR_DATAFEED_QUEUE_DROP,
+};
+
 /** Measured quantity, sr_analog_meaning.mq. */
 enum sr_mq {
 	SR_MQ_VOLTAGE = 10000,
@@ -483,6 +508,23 @@ struct sr_context;
  */
 struct sr_session;
 
+/**
+ * @struct sr_session_file
+ * Opaque structure representing a session file opened for random access.
+ *
+ * @see sr_session_file_open(), sr_session_file_close().
+ */
+struct sr_session_file;
+
+/**
+ * @struct sr_overview
+ * Opaque structure representing a multi-resolution overview of sample
+ * data.
+ *
+ * @see sr_session_overview_get(), sr_session_file_get_overview().
+ */
+struct sr_overview;
+
 struct sr_rational {
 	/** Numerator of the rational number. */
 	int64_t p;
@@ -514,6 +556,64 @@ struct sr_datafeed_logic {
 	void *data;
 };
 
+/**
+ * Run-length encoded logic datafeed payload for type SR_DF_LOGIC_RLE.
+ *
+ * Holds num_runs sample values of unitsize bytes each in the layout of
+ * SR_DF_LOGIC data. The value at index i repeats lengths[i] times.
+ * Adjacent runs may carry identical values, runs may be empty.
+ */
+struct sr_datafeed_logic_rle {
+	uint64_t num_runs;
+	uint16_t unitsize;
+	void *values;
+	uint64_t *lengths;
+};
+
+/** Statistics of a threaded datafeed callback's packet queue. */
+struct sr_datafeed_queue_stats {
+	/** Number of packets passed to the callback. */
+	uint64_t packets;
+	/** Number of packets dropped because the queue was full. */
+	uint64_t dropped;
+	/** Number of packets currently waiting in the queue. */
+	uint64_t depth;
+	/** Maximum number of packets which were waiting in the queue. */
+	uint64_t max_depth;
+	/** Average time from queueing to callback return, microseconds. */
+	uint64_t latency_avg_us;
+	/** Maximum time from queueing to callback return, microseconds. */
+	uint64_t latency_max_us;
+};
+
+/** Number of bins of the USB transfer latency histogram. */
+#define SR_USB_LATENCY_BINS 16
+
+/** Statistics of a device's USB transfers, see sr_session_usb_stats_get(). */
+struct sr_usb_stream_stats {
+	/** Number of transfers which received data. */
+	uint64_t transfers;
+	/** Number of bytes which were received. */
+	uint64_t bytes;
+	/** Number of transfers whose data was dropped, since all buffers
+	 *  were waiting for the session thread. */
+	uint64_t overflows;
+	/** Number of times that no transfer was pending on the device.
+	 *  Includes the end of the acquisition, when the last transfers
+	 *  complete. */
+	uint64_t underruns;
+	/** Maximum number of buffers waiting for the session thread. */
+	uint64_t max_depth;
+	/** Final size of a transfer in bytes. */
+	uint64_t transfer_size;
+	/** Final number of transfers in flight. */
+	uint64_t transfer_depth;
+	/** Latency from submission to completion of transfers. Bin 0
+	 *  counts latencies below 1 ms, bin n those below 2^n ms, the
+	 *  last bin all longer ones. */
+	uint64_t latency_hist[SR_USB_LATENCY_BINS];
+};
+
 /** Analog datafeed payload for type SR_DF_ANALOG. */
 struct sr_datafeed_analog {
 	void *data;
@@ -618,9 +718,12 @@ struct sr_resource {
 enum sr_output_flag {
 	/** If set, this output module writes the output itself. */
 	SR_OUTPUT_INTERNAL_IO_HANDLING = 0x01,
+	/** If set, this output module accepts SR_DF_LOGIC_RLE packets. */
+	SR_OUTPUT_LOGIC_RLE = 0x02,
 };
 
 struct sr_input;
+struct sr_input_file;
 struct sr_input_module;
 struct sr_output;
 struct sr_output_module;
@@ -1195,6 +1298,20 @@ enum sr_configkey {
 	/** Number of powerline cycles for ADC integration time. */
 	SR_CONF_ADC_POWERLINE_CYCLES,
 
+	/**
+	 * Maximum size of a USB transfer in bytes, for devices which
+	 * stream their data. Zero selects the driver's default.
+	 * @arg type: uint64_t
+	 */
+	SR_CONF_USB_TRANSFER_SIZE,
+
+	/**
+	 * Maximum number of USB transfers in flight, for devices which
+	 * stream their data. Zero selects the driver's default.
+	 * @arg type: uint64_t
+	 */
+	SR_CONF_USB_TRANSFER_DEPTH,
+
 	/* Update sr_key_info_config[] (hwdriver.c) upon changes! */
 
 	/*--- Acquisition modes, sample limiting ----------------------------*/
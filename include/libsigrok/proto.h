@@ -30,6 +30,8 @@
 
 SR_API int sr_analog_to_float(const struct sr_datafeed_analog *analog,
 		float *buf);
+SR_API int sr_analog_to_double(const struct sr_datafeed_analog *analog,
+		double *buf);
 SR_API const char *sr_analog_si_prefix(float *value, int *digits);
 SR_API gboolean sr_analog_si_prefix_friendly(enum sr_unit unit);
 SR_API int sr_analog_unit_to_string(const struct sr_datafeed_analog *analog,
@@ -57,6 +59,13 @@ SR_API int sr_a2l_threshold(const struct sr_datafeed_analog *analog,
 SR_API int sr_a2l_schmitt_trigger(const struct sr_datafeed_analog *analog,
 		float lo_thr, float hi_thr, uint8_t *state, uint8_t *output,
 		uint64_t count);
+SR_API int sr_a2l_threshold_logic(const struct sr_datafeed_analog *analog,
+		float threshold, struct sr_datafeed_logic *logic,
+		unsigned int channel, uint64_t count);
+SR_API int sr_a2l_schmitt_trigger_logic(const struct sr_datafeed_analog *analog,
+		float lo_thr, float hi_thr, uint8_t *state,
+		struct sr_datafeed_logic *logic, unsigned int channel,
+		uint64_t count);
 
 /*--- log.c -----------------------------------------------------------------*/
 
@@ -141,10 +150,45 @@ SR_API int sr_session_dev_remove(struct sr_session *session,
 SR_API int sr_session_dev_list(struct sr_session *session, GSList **devlist);
 SR_API int sr_session_trigger_set(struct sr_session *session, struct sr_trigger *trig);
 
+/* Session file random access */
+SR_API int sr_session_file_open(const char *filename,
+		struct sr_session_file **file);
+SR_API void sr_session_file_close(struct sr_session_file *file);
+SR_API int sr_session_file_get_info(const struct sr_session_file *file,
+		uint64_t *samplerate, unsigned int *unitsize,
+		unsigned int *num_analog);
+SR_API int sr_session_file_get_num_samples(const struct sr_session_file *file,
+		enum sr_channeltype type, unsigned int channel, uint64_t *count);
+SR_API int sr_session_file_read_logic(struct sr_session_file *file,
+		uint64_t start, uint64_t count, uint8_t *buf,
+		uint64_t *num_read);
+SR_API int sr_session_file_read_analog(struct sr_session_file *file,
+		unsigned int channel, uint64_t start, uint64_t count,
+		float *buf, uint64_t *num_read);
+SR_API int sr_session_file_logic_overview(struct sr_session_file *file,
+		uint64_t start, uint64_t count, size_t num_bins,
+		uint8_t *bits_or, uint8_t *bits_and);
+SR_API int sr_session_file_analog_overview(struct sr_session_file *file,
+		unsigned int channel, uint64_t start, uint64_t count,
+		size_t num_bins, float *min, float *max);
+SR_API int sr_session_file_get_overview(struct sr_session_file *file,
+		struct sr_overview **overview);
+
 /* Datafeed setup */
 SR_API int sr_session_datafeed_callback_remove_all(struct sr_session *session);
 SR_API int sr_session_datafeed_callback_add(struct sr_session *session,
 		sr_datafeed_callback cb, void *cb_data);
+SR_API int sr_session_datafeed_callback_add_flags(struct sr_session *session,
+		sr_datafeed_callback cb, void *cb_data, uint32_t flags);
+SR_API int sr_session_datafeed_threads_set(struct sr_session *session,
+		size_t high_water, enum sr_datafeed_queue_policy policy);
+SR_API int sr_session_datafeed_stats_get(struct sr_session *session,
+		sr_datafeed_callback cb, void *cb_data,
+		struct sr_datafeed_queue_stats *stats);
+SR_API int sr_session_usb_event_thread_set(struct sr_session *session,
+		gboolean enable);
+SR_API int sr_session_usb_stats_get(struct sr_session *session,
+		const struct sr_dev_inst *sdi, struct sr_usb_stream_stats *stats);
 
 /* Session control */
 SR_API int sr_session_start(struct sr_session *session);
@@ -158,6 +202,23 @@ SR_API int sr_packet_copy(const struct sr_datafeed_packet *packet,
 		struct sr_datafeed_packet **copy);
 SR_API void sr_packet_free(struct sr_datafeed_packet *packet);
 
+/*--- overview.c ------------------------------------------------------------*/
+
+SR_API int sr_session_overview_enable(struct sr_session *session,
+		uint64_t resolution);
+SR_API struct sr_overview *sr_session_overview_get(struct sr_session *session,
+		const struct sr_dev_inst *sdi);
+SR_API int sr_overview_get_info(struct sr_overview *ov, uint64_t *resolution,
+		unsigned int *unitsize, unsigned int *num_analog);
+SR_API int sr_overview_get_num_samples(struct sr_overview *ov,
+		enum sr_channeltype type, unsigned int channel, uint64_t *count);
+SR_API int sr_overview_logic_get(struct sr_overview *ov,
+		uint64_t start, uint64_t count, size_t num_bins,
+		uint8_t *bits_or, uint8_t *bits_and, uint8_t *bits_changed);
+SR_API int sr_overview_analog_get(struct sr_overview *ov,
+		unsigned int channel, uint64_t start, uint64_t count,
+		size_t num_bins, float *min, float *max);
+
 /*--- input/input.c ---------------------------------------------------------*/
 
 SR_API const struct sr_input_module **sr_input_list(void);
@@ -176,9 +237,16 @@ SR_API int sr_input_scan_file(const char *filename, const struct sr_input **in);
 SR_API const struct sr_input_module *sr_input_module_get(const struct sr_input *in);
 SR_API struct sr_dev_inst *sr_input_dev_inst_get(const struct sr_input *in);
 SR_API int sr_input_send(const struct sr_input *in, GString *buf);
+SR_API int sr_input_send_data(const struct sr_input *in,
+		const void *data, size_t len);
 SR_API int sr_input_end(const struct sr_input *in);
 SR_API int sr_input_reset(const struct sr_input *in);
 SR_API void sr_input_free(const struct sr_input *in);
+SR_API int sr_input_file_open(const char *filename,
+		struct sr_input_file **file);
+SR_API int sr_input_file_read(struct sr_input_file *file,
+		const void **data, size_t *len);
+SR_API void sr_input_file_close(struct sr_input_file *file);
 
 /*--- output/output.c -------------------------------------------------------*/
 
@@ -157,70 +157,309 @@ SR_PRIV int sr_analog_init(struct sr_datafeed_analog *analog,
 	return SR_OK;
 }
 
-/**
- * Convert an analog datafeed payload to an array of floats.
- *
- * The caller must provide the #outbuf space for the conversion result,
- * and is expected to free allocated space after use.
- *
- * @param[in] analog The analog payload to convert. Must not be NULL.
- *                   analog->data, analog->meaning, and analog->encoding
- *                   must not be NULL.
- * @param[out] outbuf Memory where to store the result. Must not be NULL.
- *
- * @retval SR_OK Success.
- * @retval SR_ERR Unsupported encoding.
- * @retval SR_ERR_ARG Invalid argument.
- *
- * @since 0.4.0
+/** @cond PRIVATE */
+typedef void (*analog_float_kernel)(float *out, const uint8_t *in,
+	size_t count, double scale, double offset);
+typedef void (*analog_double_kernel)(double *out, const uint8_t *in,
+	size_t count, double scale, double offset);
+
+/*
+ * Conversion kernels, one per input encoding and result type. The
+ * input value gets read inline (no function pointer per sample),
+ * scale and offset get applied in double precision before the value
+ * gets trimmed to the result type.
  */
-SR_API int sr_analog_to_float(const struct sr_datafeed_analog *analog,
-		float *outbuf)
+#define ANALOG_KERNEL(name, otype, reader, width) \
+static void name(otype *out, const uint8_t *in, size_t count, \
+	double scale, double offset) \
+{ \
+	double value; \
+	\
+	while (count--) { \
+		value = reader(in); \
+		in += width; \
+		value *= scale; \
+		value += offset; \
+		*out++ = value; \
+	} \
+}
+
+#define ANALOG_KERNELS(type, width) \
+	ANALOG_KERNEL(type ## _to_float, float, read_ ## type, width) \
+	ANALOG_KERNEL(type ## _to_double, double, read_ ## type, width)
+
+ANALOG_KERNELS(u8, 1)
+ANALOG_KERNELS(i8, 1)
+ANALOG_KERNELS(u16le, 2)
+ANALOG_KERNELS(u16be, 2)
+ANALOG_KERNELS(i16le, 2)
+ANALOG_KERNELS(i16be, 2)
+ANALOG_KERNELS(u32le, 4)
+ANALOG_KERNELS(u32be, 4)
+ANALOG_KERNELS(i32le, 4)
+ANALOG_KERNELS(i32be, 4)
+ANALOG_KERNELS(fltle, 4)
+ANALOG_KERNELS(fltbe, 4)
+ANALOG_KERNELS(dblle, 8)
+ANALOG_KERNELS(dblbe, 8)
+
+#if defined(__GNUC__) && \
+	(defined(__x86_64__) || (defined(__i386__) && defined(__SSE2__)))
+#include <immintrin.h>
+
+/*
+ * Vectorized kernels for the 8bit and 16bit little endian integer
+ * encodings which oscilloscopes typically provide. Integers convert
+ * to double without loss, and multiply and add are separate steps
+ * (no fused multiply-add), so results are identical to the scalar
+ * kernels. AVX2 gets used when the CPU supports it, SSE2 is always
+ * available on these platforms.
+ */
+
+static inline void i32x4_to_float_sse2(float *out, __m128i v,
+	__m128d scale, __m128d offset)
 {
-	size_t count;
-	gboolean host_bigendian;
-	gboolean input_float, input_signed, input_bigendian;
-	size_t input_unitsize;
-	double scale, offset, value;
-	const uint8_t *data8;
-	gboolean input_is_native;
-	char type_text[10];
+	__m128d lo, hi;
 
-	if (!analog || !analog->data || !analog->meaning || !analog->encoding)
-		return SR_ERR_ARG;
-	if (!outbuf)
-		return SR_ERR_ARG;
+	lo = _mm_cvtepi32_pd(v);
+	hi = _mm_cvtepi32_pd(_mm_shuffle_epi32(v, _MM_SHUFFLE(1, 0, 3, 2)));
+	lo = _mm_add_pd(_mm_mul_pd(lo, scale), offset);
+	hi = _mm_add_pd(_mm_mul_pd(hi, scale), offset);
+	_mm_storeu_ps(out, _mm_movelh_ps(_mm_cvtpd_ps(lo), _mm_cvtpd_ps(hi)));
+}
+
+/* Convert 8 signed 16bit values (also fits zero extended 8bit values). */
+static inline void i16x8_to_float_sse2(float *out, __m128i v,
+	__m128d scale, __m128d offset)
+{
+	i32x4_to_float_sse2(out + 0,
+		_mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16), scale, offset);
+	i32x4_to_float_sse2(out + 4,
+		_mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16), scale, offset);
+}
+
+static inline void u16x8_to_float_sse2(float *out, __m128i v,
+	__m128d scale, __m128d offset)
+{
+	__m128i zero;
+
+	zero = _mm_setzero_si128();
+	i32x4_to_float_sse2(out + 0,
+		_mm_unpacklo_epi16(v, zero), scale, offset);
+	i32x4_to_float_sse2(out + 4,
+		_mm_unpackhi_epi16(v, zero), scale, offset);
+}
+
+static void i16le_to_float_sse2(float *out, const uint8_t *in,
+	size_t count, double scale, double offset)
+{
+	__m128d vscale, voffset;
+
+	vscale = _mm_set1_pd(scale);
+	voffset = _mm_set1_pd(offset);
+	for (; count >= 8; count -= 8, in += 16, out += 8) {
+		i16x8_to_float_sse2(out,
+			_mm_loadu_si128((const __m128i *)in), vscale, voffset);
+	}
+	i16le_to_float(out, in, count, scale, offset);
+}
 
-	count = analog->num_samples * g_slist_length(analog->meaning->channels);
+static void u16le_to_float_sse2(float *out, const uint8_t *in,
+	size_t count, double scale, double offset)
+{
+	__m128d vscale, voffset;
+
+	vscale = _mm_set1_pd(scale);
+	voffset = _mm_set1_pd(offset);
+	for (; count >= 8; count -= 8, in += 16, out += 8) {
+		u16x8_to_float_sse2(out,
+			_mm_loadu_si128((const __m128i *)in), vscale, voffset);
+	}
+	u16le_to_float(out, in, count, scale, offset);
+}
+
+static void i8_to_float_sse2(float *out, const uint8_t *in,
+	size_t count, double scale, double offset)
+{
+	__m128d vscale, voffset;
+	__m128i v;
+
+	vscale = _mm_set1_pd(scale);
+	voffset = _mm_set1_pd(offset);
+	for (; count >= 16; count -= 16, in += 16, out += 16) {
+		v = _mm_loadu_si128((const __m128i *)in);
+		i16x8_to_float_sse2(out + 0,
+			_mm_srai_epi16(_mm_unpacklo_epi8(v, v), 8), vscale, voffset);
+		i16x8_to_float_sse2(out + 8,
+			_mm_srai_epi16(_mm_unpackhi_epi8(v, v), 8), vscale, voffset);
+	}
+	i8_to_float(out, in, count, scale, offset);
+}
+
+static void u8_to_float_sse2(float *out, const uint8_t *in,
+	size_t count, double scale, double offset)
+{
+	__m128d vscale, voffset;
+	__m128i v, zero;
+
+	vscale = _mm_set1_pd(scale);
+	voffset = _mm_set1_pd(offset);
+	zero = _mm_setzero_si128();
+	for (; count >= 16; count -= 16, in += 16, out += 16) {
+		v = _mm_loadu_si128((const __m128i *)in);
+		u16x8_to_float_sse2(out + 0,
+			_mm_unpacklo_epi8(v, zero), vscale, voffset);
+		u16x8_to_float_sse2(out + 8,
+			_mm_unpackhi_epi8(v, zero), vscale, voffset);
+	}
+	u8_to_float(out, in, count, scale, offset);
+}
+
+__attribute__((target("avx2")))
+static inline void i32x8_to_float_avx2(float *out, __m256i v,
+	__m256d scale, __m256d offset)
+{
+	__m256d lo, hi;
+
+	lo = _mm256_cvtepi32_pd(_mm256_castsi256_si128(v));
+	hi = _mm256_cvtepi32_pd(_mm256_extracti128_si256(v, 1));
+	lo = _mm256_add_pd(_mm256_mul_pd(lo, scale), offset);
+	hi = _mm256_add_pd(_mm256_mul_pd(hi, scale), offset);
+	_mm_storeu_ps(out + 0, _mm256_cvtpd_ps(lo));
+	_mm_storeu_ps(out + 4, _mm256_cvtpd_ps(hi));
+}
+
+/* AVX2 kernels widen 8 input values at a time to 32bit integers. */
+#define ANALOG_KERNEL_AVX2(type, width, widen, load) \
+__attribute__((target("avx2"))) \
+static void type ## _to_float_avx2(float *out, const uint8_t *in, \
+	size_t count, double scale, double offset) \
+{ \
+	__m256d vscale, voffset; \
+	\
+	vscale = _mm256_set1_pd(scale); \
+	voffset = _mm256_set1_pd(offset); \
+	for (; count >= 8; count -= 8, in += 8 * width, out += 8) { \
+		i32x8_to_float_avx2(out, \
+			widen(load((const __m128i *)in)), vscale, voffset); \
+	} \
+	type ## _to_float(out, in, count, scale, offset); \
+}
+
+ANALOG_KERNEL_AVX2(i16le, 2, _mm256_cvtepi16_epi32, _mm_loadu_si128)
+ANALOG_KERNEL_AVX2(u16le, 2, _mm256_cvtepu16_epi32, _mm_loadu_si128)
+ANALOG_KERNEL_AVX2(i8, 1, _mm256_cvtepi8_epi32, _mm_loadl_epi64)
+ANALOG_KERNEL_AVX2(u8, 1, _mm256_cvtepu8_epi32, _mm_loadl_epi64)
+
+#define ANALOG_KERNEL_SIMD(type) \
+static void type ## _to_float_simd(float *out, const uint8_t *in, \
+	size_t count, double scale, double offset) \
+{ \
+	if (__builtin_cpu_supports("avx2")) \
+		type ## _to_float_avx2(out, in, count, scale, offset); \
+	else \
+		type ## _to_float_sse2(out, in, count, scale, offset); \
+}
+
+ANALOG_KERNEL_SIMD(i16le)
+ANALOG_KERNEL_SIMD(u16le)
+ANALOG_KERNEL_SIMD(i8)
+ANALOG_KERNEL_SIMD(u8)
+
+#define SIMD_KERNEL(type) type ## _to_float_simd
+#else
+#define SIMD_KERNEL(type) type ## _to_float
+#endif
+
+static const struct analog_kernel {
+	gboolean is_float;
+	gboolean is_signed;
+	gboolean is_bigendian;
+	size_t unitsize;
+	analog_float_kernel to_float;
+	analog_double_kernel to_double;
+} analog_kernels[] = {
+	{ FALSE, FALSE, FALSE, 1, SIMD_KERNEL(u8), u8_to_double, },
+	{ FALSE, TRUE, FALSE, 1, SIMD_KERNEL(i8), i8_to_double, },
+	{ FALSE, FALSE, FALSE, 2, SIMD_KERNEL(u16le), u16le_to_double, },
+	{ FALSE, FALSE, TRUE, 2, u16be_to_float, u16be_to_double, },
+	{ FALSE, TRUE, FALSE, 2, SIMD_KERNEL(i16le), i16le_to_double, },
+	{ FALSE, TRUE, TRUE, 2, i16be_to_float, i16be_to_double, },
+	{ FALSE, FALSE, FALSE, 4, u32le_to_float, u32le_to_double, },
+	{ FALSE, FALSE, TRUE, 4, u32be_to_float, u32be_to_double, },
+	{ FALSE, TRUE, FALSE, 4, i32le_to_float, i32le_to_double, },
+	{ FALSE, TRUE, TRUE, 4, i32be_to_float, i32be_to_double, },
+	{ TRUE, FALSE, FALSE, 4, fltle_to_float, fltle_to_double, },
+	{ TRUE, FALSE, TRUE, 4, fltbe_to_float, fltbe_to_double, },
+	{ TRUE, FALSE, FALSE, 8, dblle_to_float, dblle_to_double, },
+	{ TRUE, FALSE, TRUE, 8, dblbe_to_float, dblbe_to_double, },
+};
+/** @endcond */
+
+/*
+ * Determine the conversion kernel for an analog payload's encoding,
+ * and the common scale/offset factors which apply to all values.
+ */
+static const struct analog_kernel *analog_kernel_get(
+	const struct sr_datafeed_analog *analog, size_t *count,
+	double *scale, double *offset)
+{
+	const struct sr_analog_encoding *encoding;
+	const struct analog_kernel *kernel;
+	size_t idx;
+	char type_text[10];
+
+	encoding = analog->encoding;
+	*count = analog->num_samples * g_slist_length(analog->meaning->channels);
+	*offset = encoding->offset.p;
+	*offset /= encoding->offset.q;
+	*scale = encoding->scale.p;
+	*scale /= encoding->scale.q;
 
 	/*
-	 * Determine properties of the input data's and the host's
-	 * native formats, to simplify test conditions below.
 	 * Error messages for unsupported input property combinations
 	 * will only be seen by developers and maintainers of input
 	 * formats or acquisition device drivers. Terse output is
 	 * acceptable there, users shall never see them.
 	 */
+	for (idx = 0; idx < ARRAY_SIZE(analog_kernels); idx++) {
+		kernel = &analog_kernels[idx];
+		if (kernel->unitsize != encoding->unitsize)
+			continue;
+		if (!kernel->is_float != !encoding->is_float)
+			continue;
+		if (!kernel->is_float && !kernel->is_signed != !encoding->is_signed)
+			continue;
+		if (kernel->unitsize > 1 &&
+				!kernel->is_bigendian != !encoding->is_bigendian)
+			continue;
+		return kernel;
+	}
+
+	snprintf(type_text, sizeof(type_text), "%c%u%s",
+		encoding->is_float ? 'f' : encoding->is_signed ? 'i' : 'u',
+		encoding->unitsize * 8, encoding->is_bigendian ? "be" : "le");
+	sr_err("Unsupported type for analog-to-float conversion: %s.",
+		type_text);
+
+	return NULL;
+}
+
+/*
+ * Run the float conversion kernel, or copy native float data and
+ * only apply scale/offset when the payload needs no conversion.
+ */
+static void analog_kernel_to_float(const struct analog_kernel *kernel,
+	float *outbuf, const uint8_t *in, size_t count,
+	double scale, double offset)
+{
+	gboolean host_bigendian;
+
 #ifdef WORDS_BIGENDIAN
 	host_bigendian = TRUE;
 #else
 	host_bigendian = FALSE;
 #endif
-	input_float = analog->encoding->is_float;
-	input_signed = analog->encoding->is_signed;
-	input_bigendian = analog->encoding->is_bigendian;
-	input_unitsize = analog->encoding->unitsize;
-
-	/*
-	 * Prepare the iteration over the sample data: Get the common
-	 * scale/offset factors which apply to all individual values.
-	 * Position the read pointer on the first byte of input data.
-	 */
-	offset = analog->encoding->offset.p;
-	offset /= analog->encoding->offset.q;
-	scale = analog->encoding->scale.p;
-	scale /= analog->encoding->scale.q;
-	data8 = analog->data;
 
 	/*
 	 * Immediately handle the special case where input data needs
@@ -228,11 +467,9 @@ SR_API int sr_analog_to_float(const struct sr_datafeed_analog *analog,
 	 * native format. Do apply scale/offset though when applicable
 	 * on our way out.
 	 */
-	input_is_native = input_float &&
-		input_unitsize == sizeof(outbuf[0]) &&
-		input_bigendian == host_bigendian;
-	if (input_is_native) {
-		memcpy(outbuf, data8, count * sizeof(outbuf[0]));
+	if (kernel->is_float && kernel->unitsize == sizeof(outbuf[0]) &&
+			kernel->is_bigendian == host_bigendian) {
+		memcpy(outbuf, in, count * sizeof(outbuf[0]));
 		if (scale != 1.0 || offset != 0.0) {
 			while (count--) {
 				*outbuf *= scale;
@@ -240,142 +477,136 @@ SR_API int sr_analog_to_float(const struct sr_datafeed_analog *analog,
 				outbuf++;
 			}
 		}
-		return SR_OK;
+		return;
 	}
 
 	/*
-	 * Accept sample values in different widths and data types and
-	 * endianess formats (floating point or signed or unsigned
-	 * integer, in either endianess, for a set of supported widths).
-	 * Common scale/offset factors apply to all sample values.
-	 *
-	 * Do most internal calculations on double precision values.
-	 * Only trim the result data to single precision, since that's
-	 * the routine's result data type in its public API which needs
-	 * to be kept for compatibility. It remains an option for later
-	 * to add another public routine which returns double precision
-	 * result data, call sites could migrate at their own pace.
+	 * Do internal calculations on double precision values. Only
+	 * trim the result data to single precision, since that's the
+	 * routine's result data type in its public API which needs to
+	 * be kept for compatibility. See sr_analog_to_double() for
+	 * double precision results.
 	 */
-	if (input_float && input_unitsize == sizeof(float)) {
-		float (*reader)(const uint8_t **p);
-		if (input_bigendian)
-			reader = read_fltbe_inc;
-		else
-			reader = read_fltle_inc;
-		while (count--) {
-			value = reader(&data8);
-			value *= scale;
-			value += offset;
-			*outbuf++ = value;
-		}
-		return SR_OK;
-	}
-	if (input_float && input_unitsize == sizeof(double)) {
-		double (*reader)(const uint8_t **p);
-		if (input_bigendian)
-			reader = read_dblbe_inc;
-		else
-			reader = read_dblle_inc;
-		while (count--) {
-			value = reader(&data8);
-			value *= scale;
-			value += offset;
-			*outbuf++ = value;
-		}
-		return SR_OK;
-	}
-	if (input_float) {
-		snprintf(type_text, sizeof(type_text), "%c%zu%s",
-			'f', input_unitsize * 8, input_bigendian ? "be" : "le");
-		sr_err("Unsupported type for analog-to-float conversion: %s.",
-			type_text);
+	kernel->to_float(outbuf, in, count, scale, offset);
+}
+
+/**
+ * Convert an analog datafeed payload to an array of floats.
+ *
+ * The caller must provide the #outbuf space for the conversion result,
+ * and is expected to free allocated space after use.
+ *
+ * @param[in] analog The analog payload to convert. Must not be NULL.
+ *                   analog->data, analog->meaning, and analog->encoding
+ *                   must not be NULL.
+ * @param[out] outbuf Memory where to store the result. Must not be NULL.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR Unsupported encoding.
+ * @retval SR_ERR_ARG Invalid argument.
+ *
+ * @since 0.4.0
+ */
+SR_API int sr_analog_to_float(const struct sr_datafeed_analog *analog,
+		float *outbuf)
+{
+	const struct analog_kernel *kernel;
+	size_t count;
+	double scale, offset;
+
+	if (!analog || !analog->data || !analog->meaning || !analog->encoding)
+		return SR_ERR_ARG;
+	if (!outbuf)
+		return SR_ERR_ARG;
+
+	kernel = analog_kernel_get(analog, &count, &scale, &offset);
+	if (!kernel)
 		return SR_ERR;
-	}
 
-	if (input_unitsize == sizeof(uint8_t) && input_signed) {
-		int8_t (*reader)(const uint8_t **p);
-		reader = read_i8_inc;
-		while (count--) {
-			value = reader(&data8);
-			value *= scale;
-			value += offset;
-			*outbuf++ = value;
-		}
-		return SR_OK;
-	}
-	if (input_unitsize == sizeof(uint8_t)) {
-		uint8_t (*reader)(const uint8_t **p);
-		reader = read_u8_inc;
-		while (count--) {
-			value = reader(&data8);
-			value *= scale;
-			value += offset;
-			*outbuf++ = value;
-		}
-		return SR_OK;
-	}
-	if (input_unitsize == sizeof(uint16_t) && input_signed) {
-		int16_t (*reader)(const uint8_t **p);
-		if (input_bigendian)
-			reader = read_i16be_inc;
-		else
-			reader = read_i16le_inc;
-		while (count--) {
-			value = reader(&data8);
-			value *= scale;
-			value += offset;
-			*outbuf++ = value;
-		}
-		return SR_OK;
-	}
-	if (input_unitsize == sizeof(uint16_t)) {
-		uint16_t (*reader)(const uint8_t **p);
-		if (input_bigendian)
-			reader = read_u16be_inc;
-		else
-			reader = read_u16le_inc;
-		while (count--) {
-			value = reader(&data8);
-			value *= scale;
-			value += offset;
-			*outbuf++ = value;
-		}
-		return SR_OK;
-	}
-	if (input_unitsize == sizeof(uint32_t) && input_signed) {
-		int32_t (*reader)(const uint8_t **p);
-		if (input_bigendian)
-			reader = read_i32be_inc;
-		else
-			reader = read_i32le_inc;
-		while (count--) {
-			value = reader(&data8);
-			value *= scale;
-			value += offset;
-			*outbuf++ = value;
-		}
-		return SR_OK;
-	}
-	if (input_unitsize == sizeof(uint32_t)) {
-		uint32_t (*reader)(const uint8_t **p);
-		if (input_bigendian)
-			reader = read_u32be_inc;
-		else
-			reader = read_u32le_inc;
-		while (count--) {
-			value = reader(&data8);
-			value *= scale;
-			value += offset;
-			*outbuf++ = value;
-		}
-		return SR_OK;
-	}
-	snprintf(type_text, sizeof(type_text), "%c%zu%s",
-		input_float ? 'f' : input_signed ? 'i' : 'u',
-		input_unitsize * 8, input_bigendian ? "be" : "le");
-	sr_err("Unsupported type for analog-to-float conversion: %s.",
-		type_text);
-	return SR_ERR;
+	analog_kernel_to_float(kernel, outbuf, analog->data, count,
+		scale, offset);
+
+	return SR_OK;
+}
+
+/**
+ * Convert a range of an analog datafeed payload's values to floats.
+ *
+ * Results are identical to the respective part of sr_analog_to_float()
+ * output. Allows callers to process large payloads in small blocks
+ * without allocating memory for the complete conversion result.
+ *
+ * @param[in] analog The analog payload to convert.
+ * @param[in] first Index of the first value to convert.
+ * @param[in] count Number of values to convert.
+ * @param[out] outbuf Memory where to store count results.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR Unsupported encoding.
+ * @retval SR_ERR_ARG Invalid argument.
+ */
+SR_PRIV int sr_analog_to_float_range(const struct sr_datafeed_analog *analog,
+		size_t first, size_t count, float *outbuf)
+{
+	const struct analog_kernel *kernel;
+	size_t total;
+	double scale, offset;
+	const uint8_t *in;
+
+	if (!analog || !analog->data || !analog->meaning || !analog->encoding)
+		return SR_ERR_ARG;
+	if (!outbuf)
+		return SR_ERR_ARG;
+
+	kernel = analog_kernel_get(analog, &total, &scale, &offset);
+	if (!kernel)
+		return SR_ERR;
+	if (first > total || count > total - first)
+		return SR_ERR_ARG;
+
+	in = analog->data;
+	in += first * kernel->unitsize;
+	analog_kernel_to_float(kernel, outbuf, in, count, scale, offset);
+
+	return SR_OK;
+}
+
+/**
+ * Convert an analog datafeed payload to an array of doubles.
+ *
+ * Like sr_analog_to_float(), but keeps the double precision of the
+ * internal calculation in the result.
+ *
+ * @param[in] analog The analog payload to convert. Must not be NULL.
+ *                   analog->data, analog->meaning, and analog->encoding
+ *                   must not be NULL.
+ * @param[out] outbuf Memory where to store the result. Must not be NULL.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR Unsupported encoding.
+ * @retval SR_ERR_ARG Invalid argument.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_analog_to_double(const struct sr_datafeed_analog *analog,
+		double *outbuf)
+{
+	const struct analog_kernel *kernel;
+	size_t count;
+	double scale, offset;
+
+	if (!analog || !analog->data || !analog->meaning || !analog->encoding)
+		return SR_ERR_ARG;
+	if (!outbuf)
+		return SR_ERR_ARG;
+
+	kernel = analog_kernel_get(analog, &count, &scale, &offset);
+	if (!kernel)
+		return SR_ERR;
+
+	kernel->to_double(outbuf, analog->data, count, scale, offset);
+
+	return SR_OK;
 }
 
 /**
@@ -23,6 +23,9 @@
  * Conversion helper functions.
  */
 
+#include <config.h>
+#include <math.h>
+#include <string.h>
 #include <libsigrok/libsigrok.h>
 #include "libsigrok-internal.h"
 
@@ -30,9 +33,452 @@
 #define LOG_PREFIX "conv"
 /** @endcond */
 
+/*
+ * Number of values which get converted to float at a time, for input
+ * encodings which cannot get compared in their raw form. Keeps the
+ * scratch buffer on the stack and in the CPU's L1 cache.
+ */
+#define A2L_BLOCK_SIZE	1024
+
+/*
+ * Range of raw input values which satisfy a comparison, lo > hi when
+ * no value does. Because the conversion of raw values is monotonic,
+ * the range always extends to either end of the input type's range.
+ */
+struct a2l_window {
+	int64_t lo, hi;
+};
+
+enum a2l_cmp {
+	A2L_GE,
+	A2L_GT,
+	A2L_LT,
+};
+
+typedef void (*a2l_window_kernel)(uint8_t *out, const uint8_t *in,
+	size_t count, int64_t lo, int64_t hi);
+typedef void (*a2l_schmitt_kernel)(uint8_t *out, const uint8_t *in,
+	size_t count, const struct a2l_window *low,
+	const struct a2l_window *high, uint8_t *state);
+
+#define A2L_KERNELS(type, reader, width) \
+static void type ## _window(uint8_t *out, const uint8_t *in, \
+	size_t count, int64_t lo, int64_t hi) \
+{ \
+	int64_t raw; \
+	\
+	while (count--) { \
+		raw = reader(in); \
+		in += width; \
+		*out++ = raw >= lo && raw <= hi; \
+	} \
+} \
+static void type ## _schmitt(uint8_t *out, const uint8_t *in, \
+	size_t count, const struct a2l_window *low, \
+	const struct a2l_window *high, uint8_t *state) \
+{ \
+	int64_t raw; \
+	uint8_t level; \
+	\
+	level = *state; \
+	while (count--) { \
+		raw = reader(in); \
+		in += width; \
+		if (raw >= low->lo && raw <= low->hi) \
+			level = 0; \
+		else if (raw >= high->lo && raw <= high->hi) \
+			level = 1; \
+		*out++ = level; \
+	} \
+	*state = level; \
+}
+
+A2L_KERNELS(u8, read_u8, 1)
+A2L_KERNELS(i8, read_i8, 1)
+A2L_KERNELS(u16le, read_u16le, 2)
+A2L_KERNELS(u16be, read_u16be, 2)
+A2L_KERNELS(i16le, read_i16le, 2)
+A2L_KERNELS(i16be, read_i16be, 2)
+A2L_KERNELS(u32le, read_u32le, 4)
+A2L_KERNELS(u32be, read_u32be, 4)
+A2L_KERNELS(i32le, read_i32le, 4)
+A2L_KERNELS(i32be, read_i32be, 4)
+
+#if defined(__GNUC__) && \
+	(defined(__x86_64__) || (defined(__i386__) && defined(__SSE2__)))
+#include <immintrin.h>
+
+/*
+ * Vectorized threshold compare for the 8bit and 16bit little endian
+ * encodings. Unsigned input gets biased into the signed range since
+ * SSE2 only has signed compares. The window bounds are within the
+ * type's range (or describe an empty window with values 1 and 0),
+ * and thus fit the vector elements. Returns the number of processed
+ * values, the caller handles the remainder.
+ */
+static size_t a2l_window8_sse2(uint8_t *out, const uint8_t *in,
+	size_t count, int64_t lo, int64_t hi, int bias)
+{
+	__m128i vlo, vhi, vbias, one, v, outside;
+	size_t done;
+
+	vlo = _mm_set1_epi8((char)(lo - bias));
+	vhi = _mm_set1_epi8((char)(hi - bias));
+	vbias = _mm_set1_epi8((char)bias);
+	one = _mm_set1_epi8(1);
+	for (done = 0; count - done >= 16; done += 16) {
+		v = _mm_loadu_si128((const __m128i *)&in[done]);
+		v = _mm_xor_si128(v, vbias);
+		outside = _mm_or_si128(_mm_cmplt_epi8(v, vlo),
+			_mm_cmpgt_epi8(v, vhi));
+		_mm_storeu_si128((__m128i *)&out[done],
+			_mm_andnot_si128(outside, one));
+	}
+
+	return done;
+}
+
+static size_t a2l_window16_sse2(uint8_t *out, const uint8_t *in,
+	size_t count, int64_t lo, int64_t hi, int bias)
+{
+	__m128i vlo, vhi, vbias, one, v0, v1, out0, out1;
+	size_t done;
+
+	vlo = _mm_set1_epi16((short)(lo - bias));
+	vhi = _mm_set1_epi16((short)(hi - bias));
+	vbias = _mm_set1_epi16((short)bias);
+	one = _mm_set1_epi8(1);
+	for (done = 0; count - done >= 16; done += 16) {
+		v0 = _mm_loadu_si128((const __m128i *)&in[2 * done]);
+		v1 = _mm_loadu_si128((const __m128i *)&in[2 * done + 16]);
+		v0 = _mm_xor_si128(v0, vbias);
+		v1 = _mm_xor_si128(v1, vbias);
+		out0 = _mm_or_si128(_mm_cmplt_epi16(v0, vlo),
+			_mm_cmpgt_epi16(v0, vhi));
+		out1 = _mm_or_si128(_mm_cmplt_epi16(v1, vlo),
+			_mm_cmpgt_epi16(v1, vhi));
+		_mm_storeu_si128((__m128i *)&out[done],
+			_mm_andnot_si128(_mm_packs_epi16(out0, out1), one));
+	}
+
+	return done;
+}
+
+#define A2L_WINDOW_SSE2(type, bits, width, bias) \
+static void type ## _window_sse2(uint8_t *out, const uint8_t *in, \
+	size_t count, int64_t lo, int64_t hi) \
+{ \
+	size_t done; \
+	\
+	done = a2l_window ## bits ## _sse2(out, in, count, lo, hi, bias); \
+	type ## _window(out + done, in + done * width, count - done, lo, hi); \
+}
+
+A2L_WINDOW_SSE2(u8, 8, 1, 0x80)
+A2L_WINDOW_SSE2(i8, 8, 1, 0)
+A2L_WINDOW_SSE2(u16le, 16, 2, 0x8000)
+A2L_WINDOW_SSE2(i16le, 16, 2, 0)
+
+#define WINDOW_KERNEL(type) type ## _window_sse2
+#else
+#define WINDOW_KERNEL(type) type ## _window
+#endif
+
+static const struct a2l_raw_kernel {
+	gboolean is_signed;
+	gboolean is_bigendian;
+	size_t unitsize;
+	int64_t min, max;
+	a2l_window_kernel window;
+	a2l_schmitt_kernel schmitt;
+} a2l_raw_kernels[] = {
+	{ FALSE, FALSE, 1, 0, UINT8_MAX,
+		WINDOW_KERNEL(u8), u8_schmitt, },
+	{ TRUE, FALSE, 1, INT8_MIN, INT8_MAX,
+		WINDOW_KERNEL(i8), i8_schmitt, },
+	{ FALSE, FALSE, 2, 0, UINT16_MAX,
+		WINDOW_KERNEL(u16le), u16le_schmitt, },
+	{ FALSE, TRUE, 2, 0, UINT16_MAX,
+		u16be_window, u16be_schmitt, },
+	{ TRUE, FALSE, 2, INT16_MIN, INT16_MAX,
+		WINDOW_KERNEL(i16le), i16le_schmitt, },
+	{ TRUE, TRUE, 2, INT16_MIN, INT16_MAX,
+		i16be_window, i16be_schmitt, },
+	{ FALSE, FALSE, 4, 0, UINT32_MAX,
+		u32le_window, u32le_schmitt, },
+	{ FALSE, TRUE, 4, 0, UINT32_MAX,
+		u32be_window, u32be_schmitt, },
+	{ TRUE, FALSE, 4, INT32_MIN, INT32_MAX,
+		i32le_window, i32le_schmitt, },
+	{ TRUE, TRUE, 4, INT32_MIN, INT32_MAX,
+		i32be_window, i32be_schmitt, },
+};
+
+/* Conversion setup, shared by all a2l variants. */
+struct a2l_conv {
+	const struct sr_datafeed_analog *analog;
+	gboolean is_schmitt;
+	float lo_thr, hi_thr;
+	/* Native float input, compared in place. */
+	const float *values;
+	/* Integer input, compared in raw form. */
+	const struct a2l_raw_kernel *kernel;
+	struct a2l_window low, high;
+};
+
+/*
+ * Compare a raw value's float representation against a threshold.
+ * Mirrors the float conversion in analog.c, so that raw compares
+ * yield the same results as compares of converted values.
+ */
+static gboolean a2l_raw_cmp(int64_t raw, double scale, double offset,
+	float thr, enum a2l_cmp cmp)
+{
+	double value;
+	float f;
+
+	value = raw;
+	value *= scale;
+	value += offset;
+	f = value;
+
+	switch (cmp) {
+	case A2L_GE:
+		return f >= thr;
+	case A2L_GT:
+		return f > thr;
+	case A2L_LT:
+		return f < thr;
+	}
+
+	return FALSE;
+}
+
+/*
+ * Pre-scale a threshold into the raw input's units: Determine the range
+ * of raw values which satisfy the comparison. Bisection takes at most
+ * 32 steps for the widest supported type, and is immune to rounding
+ * issues which a division by the scale factor would have.
+ */
+static void a2l_raw_window(const struct a2l_raw_kernel *kernel,
+	double scale, double offset, float thr, enum a2l_cmp cmp,
+	struct a2l_window *window)
+{
+	gboolean at_min, at_max;
+	int64_t lo, hi, mid;
+
+	at_min = a2l_raw_cmp(kernel->min, scale, offset, thr, cmp);
+	at_max = a2l_raw_cmp(kernel->max, scale, offset, thr, cmp);
+	if (at_min == at_max) {
+		window->lo = at_min ? kernel->min : 1;
+		window->hi = at_min ? kernel->max : 0;
+		return;
+	}
+
+	/* Find the first raw value with the same result as the maximum. */
+	lo = kernel->min;
+	hi = kernel->max;
+	while (hi - lo > 1) {
+		mid = lo + (hi - lo) / 2;
+		if (a2l_raw_cmp(mid, scale, offset, thr, cmp) == at_max)
+			hi = mid;
+		else
+			lo = mid;
+	}
+	if (at_max) {
+		window->lo = hi;
+		window->hi = kernel->max;
+	} else {
+		window->lo = kernel->min;
+		window->hi = lo;
+	}
+}
+
+static int a2l_conv_init(struct a2l_conv *conv,
+	const struct sr_datafeed_analog *analog, float lo_thr, float hi_thr,
+	gboolean is_schmitt, uint64_t count)
+{
+	const struct sr_analog_encoding *encoding;
+	const struct a2l_raw_kernel *kernel;
+	size_t idx;
+	gboolean host_bigendian;
+	double scale, offset;
+
+	if (!analog || !analog->data || !analog->meaning || !analog->encoding)
+		return SR_ERR_ARG;
+	encoding = analog->encoding;
+	if (count > analog->num_samples *
+			g_slist_length(analog->meaning->channels))
+		return SR_ERR_ARG;
+
+	memset(conv, 0, sizeof(*conv));
+	conv->analog = analog;
+	conv->is_schmitt = is_schmitt;
+	conv->lo_thr = lo_thr;
+	conv->hi_thr = hi_thr;
+
+#ifdef WORDS_BIGENDIAN
+	host_bigendian = TRUE;
+#else
+	host_bigendian = FALSE;
+#endif
+
+	offset = encoding->offset.p;
+	offset /= encoding->offset.q;
+	scale = encoding->scale.p;
+	scale /= encoding->scale.q;
+
+	if (encoding->is_float) {
+		if (encoding->unitsize == sizeof(float) &&
+				!encoding->is_bigendian == !host_bigendian &&
+				scale == 1.0 && offset == 0.0)
+			conv->values = analog->data;
+		return SR_OK;
+	}
+
+	if (!isfinite(scale) || !isfinite(offset))
+		return SR_OK;
+	for (idx = 0; idx < ARRAY_SIZE(a2l_raw_kernels); idx++) {
+		kernel = &a2l_raw_kernels[idx];
+		if (kernel->unitsize != encoding->unitsize)
+			continue;
+		if (!kernel->is_signed != !encoding->is_signed)
+			continue;
+		if (kernel->unitsize > 1 &&
+				!kernel->is_bigendian != !encoding->is_bigendian)
+			continue;
+		conv->kernel = kernel;
+		break;
+	}
+	if (!conv->kernel)
+		return SR_OK;
+
+	if (is_schmitt) {
+		a2l_raw_window(kernel, scale, offset, lo_thr, A2L_LT,
+			&conv->low);
+		a2l_raw_window(kernel, scale, offset, hi_thr, A2L_GT,
+			&conv->high);
+	} else {
+		a2l_raw_window(kernel, scale, offset, hi_thr, A2L_GE,
+			&conv->high);
+	}
+
+	return SR_OK;
+}
+
+static void a2l_float_levels(const struct a2l_conv *conv,
+	const float *input, uint8_t *output, size_t count, uint8_t *state)
+{
+	float lo_thr, hi_thr;
+	uint8_t level;
+
+	lo_thr = conv->lo_thr;
+	hi_thr = conv->hi_thr;
+
+	if (!conv->is_schmitt) {
+		while (count--)
+			*output++ = *input++ >= hi_thr;
+		return;
+	}
+
+	level = *state;
+	while (count--) {
+		if (*input < lo_thr)
+			level = 0;
+		else if (*input > hi_thr)
+			level = 1;
+		input++;
+		*output++ = level;
+	}
+	*state = level;
+}
+
+/* Convert a range of analog values to logic levels, one byte each. */
+static int a2l_levels(const struct a2l_conv *conv, size_t first,
+	uint8_t *output, size_t count, uint8_t *state)
+{
+	float values[A2L_BLOCK_SIZE];
+	const uint8_t *in;
+	size_t len;
+	int ret;
+
+	if (conv->kernel) {
+		in = conv->analog->data;
+		in += first * conv->kernel->unitsize;
+		if (conv->is_schmitt)
+			conv->kernel->schmitt(output, in, count,
+				&conv->low, &conv->high, state);
+		else
+			conv->kernel->window(output, in, count,
+				conv->high.lo, conv->high.hi);
+		return SR_OK;
+	}
+
+	if (conv->values) {
+		a2l_float_levels(conv, &conv->values[first], output,
+			count, state);
+		return SR_OK;
+	}
+
+	while (count) {
+		len = MIN(count, A2L_BLOCK_SIZE);
+		ret = sr_analog_to_float_range(conv->analog, first, len, values);
+		if (ret != SR_OK)
+			return ret;
+		a2l_float_levels(conv, values, output, len, state);
+		first += len;
+		output += len;
+		count -= len;
+	}
+
+	return SR_OK;
+}
+
+/*
+ * Convert analog values to logic levels, and store them in one bit
+ * of a logic packet's sample data. Other bits remain unchanged.
+ */
+static int a2l_logic(const struct a2l_conv *conv,
+	struct sr_datafeed_logic *logic, unsigned int channel,
+	uint64_t count, uint8_t *state)
+{
+	uint8_t levels[A2L_BLOCK_SIZE];
+	uint8_t *data, mask;
+	size_t first, len, idx;
+	int ret;
+
+	if (!logic || !logic->data || !logic->unitsize)
+		return SR_ERR_ARG;
+	if (channel >= logic->unitsize * 8)
+		return SR_ERR_ARG;
+	if (count > logic->length / logic->unitsize)
+		return SR_ERR_ARG;
+
+	data = logic->data;
+	data += channel / 8;
+	mask = 1 << (channel % 8);
+	first = 0;
+	while (first < count) {
+		len = MIN(count - first, A2L_BLOCK_SIZE);
+		ret = a2l_levels(conv, first, levels, len, state);
+		if (ret != SR_OK)
+			return ret;
+		for (idx = 0; idx < len; idx++) {
+			*data = (*data & ~mask) | (-levels[idx] & mask);
+			data += logic->unitsize;
+		}
+		first += len;
+	}
+
+	return SR_OK;
+}
+
 /**
  * Convert analog values to logic values by using a fixed threshold.
  *
+ * Integer encodings get compared in their raw form, against the
+ * threshold converted to raw units. No memory gets allocated.
+ *
  * @param[in] analog The analog input values.
  * @param[in] threshold The threshold to use.
  * @param[out] output The converted output values; either 0 or 1. Must provide
@@ -44,24 +490,17 @@
 SR_API int sr_a2l_threshold(const struct sr_datafeed_analog *analog,
 		float threshold, uint8_t *output, uint64_t count)
 {
-	float *input;
-
-	if (!analog->encoding->is_float) {
-		input = g_try_malloc(sizeof(float) * count);
-		if (!input)
-			return SR_ERR;
-
-		sr_analog_to_float(analog, input);
-	} else
-		input = analog->data;
+	struct a2l_conv conv;
+	int ret;
 
-	for (uint64_t i = 0; i < count; i++)
-		output[i] = (input[i] >= threshold) ? 1 : 0;
+	if (!output)
+		return SR_ERR_ARG;
 
-	if (!analog->encoding->is_float)
-		g_free(input);
+	ret = a2l_conv_init(&conv, analog, threshold, threshold, FALSE, count);
+	if (ret != SR_OK)
+		return ret;
 
-	return SR_OK;
+	return a2l_levels(&conv, 0, output, count, NULL);
 }
 
 /**
@@ -82,28 +521,199 @@ SR_API int sr_a2l_schmitt_trigger(const struct sr_datafeed_analog *analog,
 		float lo_thr, float hi_thr, uint8_t *state, uint8_t *output,
 		uint64_t count)
 {
-	float *input;
+	struct a2l_conv conv;
+	int ret;
+
+	if (!state || !output)
+		return SR_ERR_ARG;
+
+	ret = a2l_conv_init(&conv, analog, lo_thr, hi_thr, TRUE, count);
+	if (ret != SR_OK)
+		return ret;
+
+	return a2l_levels(&conv, 0, output, count, state);
+}
+
+/**
+ * Convert analog values to one channel of logic data by using a fixed
+ * threshold.
+ *
+ * Like sr_a2l_threshold(), but stores the result as a single bit per
+ * sample in the layout of a logic datafeed packet. Bits of the other
+ * channels in the logic data remain unchanged, which allows to fill
+ * several channels from several analog payloads.
+ *
+ * @param[in] analog The analog input values.
+ * @param[in] threshold The threshold to use.
+ * @param[in,out] logic The logic packet to store the result in. Must
+ *                      provide space for count samples.
+ * @param[in] channel The index of the bit within a logic sample.
+ * @param[in] count The number of samples to process.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR Unsupported encoding.
+ * @retval SR_ERR_ARG Invalid argument.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_a2l_threshold_logic(const struct sr_datafeed_analog *analog,
+		float threshold, struct sr_datafeed_logic *logic,
+		unsigned int channel, uint64_t count)
+{
+	struct a2l_conv conv;
+	int ret;
+
+	ret = a2l_conv_init(&conv, analog, threshold, threshold, FALSE, count);
+	if (ret != SR_OK)
+		return ret;
+
+	return a2l_logic(&conv, logic, channel, count, NULL);
+}
+
+/**
+ * Convert analog values to one channel of logic data by using a
+ * Schmitt-trigger algorithm.
+ *
+ * Like sr_a2l_schmitt_trigger(), but stores the result as a single bit
+ * per sample in the layout of a logic datafeed packet. Bits of the other
+ * channels in the logic data remain unchanged.
+ *
+ * @param[in] analog The analog input values.
+ * @param[in] lo_thr The low threshold - result becomes 0 below it.
+ * @param[in] hi_thr The high threshold - result becomes 1 above it.
+ * @param[in,out] state The internal converter state, see
+ *                      sr_a2l_schmitt_trigger().
+ * @param[in,out] logic The logic packet to store the result in. Must
+ *                      provide space for count samples.
+ * @param[in] channel The index of the bit within a logic sample.
+ * @param[in] count The number of samples to process.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR Unsupported encoding.
+ * @retval SR_ERR_ARG Invalid argument.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_a2l_schmitt_trigger_logic(const struct sr_datafeed_analog *analog,
+		float lo_thr, float hi_thr, uint8_t *state,
+		struct sr_datafeed_logic *logic, unsigned int channel,
+		uint64_t count)
+{
+	struct a2l_conv conv;
+	int ret;
+
+	if (!state)
+		return SR_ERR_ARG;
 
-	if (!analog->encoding->is_float) {
-		input = g_try_malloc(sizeof(float) * count);
-		if (!input)
-			return SR_ERR;
+	ret = a2l_conv_init(&conv, analog, lo_thr, hi_thr, TRUE, count);
+	if (ret != SR_OK)
+		return ret;
 
-		sr_analog_to_float(analog, input);
-	} else
-		input = analog->data;
+	return a2l_logic(&conv, logic, channel, count, state);
+}
 
-	for (uint64_t i = 0; i < count; i++) {
-		if (input[i] < lo_thr)
-			*state = 0;
-		else if (input[i] > hi_thr)
-			*state = 1;
+#if defined(__GNUC__) && \
+	(defined(__x86_64__) || (defined(__i386__) && defined(__SSE2__)))
+/*
+ * Compare 32 bytes per iteration against the bytes one sample before.
+ * Returns the offset of the first differing byte, or the offset where
+ * the remainder starts which the caller has to check.
+ */
+static size_t logic_find_change_sse2(const uint8_t *data, size_t pos,
+		size_t total, size_t unitsize)
+{
+	__m128i a0, a1, b0, b1;
+	unsigned int eq;
 
-		output[i] = *state;
+	while (total - pos >= 32) {
+		a0 = _mm_loadu_si128((const __m128i *)&data[pos]);
+		a1 = _mm_loadu_si128((const __m128i *)&data[pos + 16]);
+		b0 = _mm_loadu_si128((const __m128i *)&data[pos - unitsize]);
+		b1 = _mm_loadu_si128((const __m128i *)&data[pos + 16 - unitsize]);
+		eq = _mm_movemask_epi8(_mm_cmpeq_epi8(a0, b0));
+		eq |= (unsigned int)_mm_movemask_epi8(_mm_cmpeq_epi8(a1, b1)) << 16;
+		if (eq != 0xffffffff)
+			return pos + __builtin_ctz(~eq);
+		pos += 32;
 	}
 
-	if (!analog->encoding->is_float)
-		g_free(input);
+	return pos;
+}
+#endif
 
-	return SR_OK;
+/*
+ * Find the first byte which differs from the byte one sample before.
+ * A sample's byte can only differ when the sample differs from its
+ * predecessor, so this finds changes for any unitsize.
+ */
+static size_t logic_find_change_byte(const uint8_t *data, size_t pos,
+		size_t total, size_t unitsize)
+{
+	uint64_t a, b;
+
+#if defined(__GNUC__) && \
+	(defined(__x86_64__) || (defined(__i386__) && defined(__SSE2__)))
+	pos = logic_find_change_sse2(data, pos, total, unitsize);
+#endif
+	while (total - pos >= sizeof(a)) {
+		memcpy(&a, &data[pos], sizeof(a));
+		memcpy(&b, &data[pos - unitsize], sizeof(b));
+		if (a != b)
+			break;
+		pos += sizeof(a);
+	}
+	while (pos < total && data[pos] == data[pos - unitsize])
+		pos++;
+
+	return pos;
+}
+
+/**
+ * Find the next logic sample which differs from its predecessor.
+ *
+ * Lets text output modules skip over runs of unchanged samples, instead
+ * of checking individual samples or bits.
+ *
+ * @param[in] data The logic samples.
+ * @param[in] count The number of samples.
+ * @param[in] unitsize The size of one sample in bytes.
+ * @param[in] prev The sample before the first one. NULL when the first
+ *                 sample is to be considered changed.
+ * @param[out] xor_mask Receives the bits which changed (unitsize bytes)
+ *                      when a change was found. Can be NULL.
+ *
+ * @returns The index of the first changed sample, or count when all
+ *          samples equal their predecessor.
+ *
+ * @private
+ */
+SR_PRIV size_t sr_logic_find_change(const uint8_t *data, size_t count,
+		size_t unitsize, const uint8_t *prev, uint8_t *xor_mask)
+{
+	size_t idx, pos, i;
+
+	if (!count || !unitsize)
+		return count;
+
+	if (!prev || memcmp(data, prev, unitsize) != 0) {
+		idx = 0;
+	} else {
+		pos = logic_find_change_byte(data, unitsize,
+			count * unitsize, unitsize);
+		idx = pos / unitsize;
+		if (idx == count)
+			return count;
+	}
+
+	if (xor_mask) {
+		for (i = 0; i < unitsize; i++) {
+			xor_mask[i] = data[idx * unitsize + i];
+			if (idx)
+				xor_mask[i] ^= data[(idx - 1) * unitsize + i];
+			else if (prev)
+				xor_mask[i] ^= prev[i];
+		}
+	}
+
+	return idx;
 }
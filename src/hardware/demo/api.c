@@ -47,6 +47,12 @@ static const char *logic_pattern_str[] = {
 	"graycode",
 };
 
+/* Benchmark mode generates data as fast as the session can take it. */
+static const char *test_mode_str[] = {
+	"none",
+	"benchmark",
+};
+
 static const uint32_t scanopts[] = {
 	SR_CONF_NUM_LOGIC_CHANNELS,
 	SR_CONF_NUM_ANALOG_CHANNELS,
@@ -69,6 +75,7 @@ static const uint32_t devopts[] = {
 	SR_CONF_AVG_SAMPLES | SR_CONF_GET | SR_CONF_SET,
 	SR_CONF_TRIGGER_MATCH | SR_CONF_LIST,
 	SR_CONF_CAPTURE_RATIO | SR_CONF_GET | SR_CONF_SET,
+	SR_CONF_TEST_MODE | SR_CONF_GET | SR_CONF_SET | SR_CONF_LIST,
 };
 
 static const uint32_t devopts_cg_logic[] = {
@@ -220,6 +227,7 @@ static void clear_helper(struct dev_context *devc)
 	void *value;
 
 	demo_free_analog_pattern(devc);
+	demo_free_logic_pattern(devc);
 
 	/* Analog generators. */
 	g_hash_table_iter_init(&iter, devc->ch_ag);
@@ -262,6 +270,9 @@ static int config_get(uint32_t key, GVariant **data,
 	case SR_CONF_AVERAGING:
 		*data = g_variant_new_boolean(devc->avg);
 		break;
+	case SR_CONF_TEST_MODE:
+		*data = g_variant_new_string(test_mode_str[devc->benchmark ? 1 : 0]);
+		break;
 	case SR_CONF_AVG_SAMPLES:
 		*data = g_variant_new_uint64(devc->avg_samples);
 		break;
@@ -330,7 +341,7 @@ static int config_set(uint32_t key, GVariant *data,
 	struct sr_channel *ch;
 	GVariant *mq_tuple_child;
 	GSList *l;
-	int logic_pattern, analog_pattern;
+	int logic_pattern, analog_pattern, idx;
 
 	devc = sdi->priv;
 
@@ -353,6 +364,11 @@ static int config_set(uint32_t key, GVariant *data,
 		devc->avg = g_variant_get_boolean(data);
 		sr_dbg("%s averaging", devc->avg ? "Enabling" : "Disabling");
 		break;
+	case SR_CONF_TEST_MODE:
+		if ((idx = std_str_idx(data, ARRAY_AND_SIZE(test_mode_str))) < 0)
+			return SR_ERR_ARG;
+		devc->benchmark = idx == 1;
+		break;
 	case SR_CONF_AVG_SAMPLES:
 		devc->avg_samples = g_variant_get_uint64(data);
 		sr_dbg("Setting averaging rate to %" PRIu64, devc->avg_samples);
@@ -387,11 +403,8 @@ static int config_set(uint32_t key, GVariant *data,
 				sr_dbg("Setting logic pattern to %s",
 						logic_pattern_str[logic_pattern]);
 				devc->logic_pattern = logic_pattern;
-				/* Might as well do this now, these are static. */
-				if (logic_pattern == PATTERN_ALL_LOW)
-					memset(devc->logic_data, 0x00, LOGIC_BUFSIZE);
-				else if (logic_pattern == PATTERN_ALL_HIGH)
-					memset(devc->logic_data, 0xff, LOGIC_BUFSIZE);
+				/* Generate on the fly while acquiring. */
+				demo_free_logic_pattern(devc);
 			} else if (ch->type == SR_CHANNEL_ANALOG) {
 				if (analog_pattern == -1)
 					return SR_ERR_ARG;
@@ -451,6 +464,9 @@ static int config_list(uint32_t key, GVariant **data,
 		case SR_CONF_TRIGGER_MATCH:
 			*data = std_gvar_array_i32(ARRAY_AND_SIZE(trigger_matches));
 			break;
+		case SR_CONF_TEST_MODE:
+			*data = g_variant_new_strv(ARRAY_AND_SIZE(test_mode_str));
+			break;
 		default:
 			return SR_ERR_NA;
 		}
@@ -561,7 +577,10 @@ static int dev_acquisition_start(const struct sr_dev_inst *sdi)
 		devc->first_partial_logic_index,
 		devc->first_partial_logic_mask);
 
-	sr_session_source_add(sdi->session, -1, 0, 100,
+	demo_generate_logic_pattern((struct sr_dev_inst *)sdi);
+
+	/* Benchmark mode runs the generator in every main loop iteration. */
+	sr_session_source_add(sdi->session, -1, 0, devc->benchmark ? 0 : 100,
 			demo_prepare_data, (struct sr_dev_inst *)sdi);
 
 	std_session_send_df_header(sdi);
@@ -572,7 +591,6 @@ static int dev_acquisition_start(const struct sr_dev_inst *sdi)
 	/* We use this timestamp to decide how many more samples to send. */
 	devc->start_us = g_get_monotonic_time();
 	devc->spent_us = 0;
-	devc->step = 0;
 
 	return SR_OK;
 }
@@ -580,10 +598,20 @@ static int dev_acquisition_start(const struct sr_dev_inst *sdi)
 static int dev_acquisition_stop(struct sr_dev_inst *sdi)
 {
 	struct dev_context *devc;
+	double seconds;
 
 	sr_session_source_remove(sdi->session, -1);
 
 	devc = sdi->priv;
+	if (devc->benchmark) {
+		seconds = (g_get_monotonic_time() - devc->start_us) / 1e6;
+		sr_info("Benchmark: %" PRIu64 " samples in %.3f s, "
+			"%.0f samples/s, %.1f MB/s logic data.",
+			devc->sent_samples, seconds,
+			devc->sent_samples / seconds,
+			devc->sent_samples * devc->logic_unitsize / seconds / 1e6);
+	}
+	demo_free_logic_pattern(devc);
 	if (devc->limit_frames > 0)
 		std_session_send_df_frame_end(sdi);
 
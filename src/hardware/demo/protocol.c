@@ -266,6 +266,20 @@ static uint64_t encode_number_to_gray(uint64_t nr)
 	return nr ^ (nr >> 1);
 }
 
+/* Pseudo random numbers, xorshift64* (Vigna, 2014). */
+static uint64_t random_next(struct dev_context *devc)
+{
+	uint64_t x;
+
+	x = devc->random_state;
+	x ^= x >> 12;
+	x ^= x << 25;
+	x ^= x >> 27;
+	devc->random_state = x;
+
+	return x * 0x2545f4914f6cdd1dULL;
+}
+
 static void set_logic_data(uint64_t bits, uint8_t *data, size_t len)
 {
 	while (len--) {
@@ -274,7 +288,8 @@ static void set_logic_data(uint64_t bits, uint8_t *data, size_t len)
 	}
 }
 
-static void logic_generator(struct sr_dev_inst *sdi, uint64_t size)
+static void logic_generator(struct sr_dev_inst *sdi, uint8_t *data,
+		uint64_t size)
 {
 	struct dev_context *devc;
 	uint64_t i, j;
@@ -288,23 +303,25 @@ static void logic_generator(struct sr_dev_inst *sdi, uint64_t size)
 
 	switch (devc->logic_pattern) {
 	case PATTERN_SIGROK:
-		memset(devc->logic_data, 0x00, size);
+		memset(data, 0x00, size);
 		for (i = 0; i < size; i += devc->logic_unitsize) {
 			for (j = 0; j < devc->logic_unitsize; j++) {
 				pat = pattern_sigrok[(devc->step + j) % sizeof(pattern_sigrok)] >> 1;
-				devc->logic_data[i + j] = ~pat;
+				data[i + j] = ~pat;
 			}
 			devc->step++;
 		}
 		break;
 	case PATTERN_RANDOM:
-		for (i = 0; i < size; i++)
-			devc->logic_data[i] = (uint8_t)(rand() & 0xff);
+		for (i = 0; i + sizeof(uint64_t) <= size; i += sizeof(uint64_t))
+			write_u64le(&data[i], random_next(devc));
+		if (i < size)
+			set_logic_data(random_next(devc), &data[i], size - i);
 		break;
 	case PATTERN_INC:
-		for (i = 0; i < size; i++) {
+		for (i = 0; i < size; i += devc->logic_unitsize) {
 			for (j = 0; j < devc->logic_unitsize; j++)
-				devc->logic_data[i + j] = devc->step;
+				data[i + j] = devc->step;
 			devc->step++;
 		}
 		break;
@@ -312,7 +329,7 @@ static void logic_generator(struct sr_dev_inst *sdi, uint64_t size)
 		/* j contains the value of the highest bit */
 		j = 1 << (devc->num_logic_channels - 1);
 		for (i = 0; i < size; i++) {
-			devc->logic_data[i] = devc->step;
+			data[i] = devc->step;
 			if (devc->step == 0)
 				devc->step = 1;
 			else
@@ -327,7 +344,7 @@ static void logic_generator(struct sr_dev_inst *sdi, uint64_t size)
 		/* j contains the value of the highest bit */
 		j = 1 << (devc->num_logic_channels - 1);
 		for (i = 0; i < size; i++) {
-			devc->logic_data[i] = ~devc->step;
+			data[i] = ~devc->step;
 			if (devc->step == 0)
 				devc->step = 1;
 			else
@@ -338,15 +355,17 @@ static void logic_generator(struct sr_dev_inst *sdi, uint64_t size)
 		}
 		break;
 	case PATTERN_ALL_LOW:
+		memset(data, 0x00, size);
+		break;
 	case PATTERN_ALL_HIGH:
-		/* These were set when the pattern mode was selected. */
+		memset(data, 0xff, size);
 		break;
 	case PATTERN_SQUID:
-		memset(devc->logic_data, 0x00, size);
+		memset(data, 0x00, size);
 		col_count = ARRAY_SIZE(pattern_squid);
 		col_height = ARRAY_SIZE(pattern_squid[0]);
 		for (i = 0; i < size; i += devc->logic_unitsize) {
-			sample = &devc->logic_data[i];
+			sample = &data[i];
 			image_col = pattern_squid[devc->step];
 			for (j = 0; j < devc->logic_unitsize; j++) {
 				pat = image_col[j % col_height];
@@ -362,7 +381,7 @@ static void logic_generator(struct sr_dev_inst *sdi, uint64_t size)
 			devc->step &= devc->all_logic_channels_mask;
 			gray = encode_number_to_gray(devc->step);
 			gray &= devc->all_logic_channels_mask;
-			set_logic_data(gray, &devc->logic_data[i], devc->logic_unitsize);
+			set_logic_data(gray, &data[i], devc->logic_unitsize);
 		}
 		break;
 	default:
@@ -371,6 +390,98 @@ static void logic_generator(struct sr_dev_inst *sdi, uint64_t size)
 	}
 }
 
+/* Number of bytes after which the logic pattern repeats, or 0. */
+static size_t logic_pattern_period(struct dev_context *devc)
+{
+	switch (devc->logic_pattern) {
+	case PATTERN_SIGROK:
+		return sizeof(pattern_sigrok) * devc->logic_unitsize;
+	case PATTERN_INC:
+		return 256 * devc->logic_unitsize;
+	case PATTERN_WALKING_ONE:
+	case PATTERN_WALKING_ZERO:
+		/* These advance per byte, not per sample. */
+		if (devc->num_logic_channels >= 32)
+			return 0;
+		return devc->num_logic_channels + 1;
+	case PATTERN_ALL_LOW:
+	case PATTERN_ALL_HIGH:
+		return devc->logic_unitsize;
+	case PATTERN_SQUID:
+		return ARRAY_SIZE(pattern_squid) * devc->logic_unitsize;
+	default:
+		return 0;
+	}
+}
+
+/*
+ * Precompute one period of a repeating logic pattern, which then gets
+ * copied instead of generated. Also resets the pattern generators.
+ */
+SR_PRIV void demo_generate_logic_pattern(struct sr_dev_inst *sdi)
+{
+	struct dev_context *devc;
+	size_t size;
+
+	devc = sdi->priv;
+
+	demo_free_logic_pattern(devc);
+	devc->step = 0;
+	devc->random_state = 0x9e3779b97f4a7c15ULL;
+
+	size = logic_pattern_period(devc);
+	if (!size || size > LOGIC_TABLE_MAX_SIZE)
+		return;
+	devc->logic_table = g_malloc(size);
+	devc->logic_table_size = size;
+	logic_generator(sdi, devc->logic_table, size);
+}
+
+SR_PRIV void demo_free_logic_pattern(struct dev_context *devc)
+{
+	g_free(devc->logic_table);
+	devc->logic_table = NULL;
+	devc->logic_table_size = 0;
+	devc->logic_table_pos = 0;
+}
+
+/*
+ * Fill a buffer with logic data. Repeating patterns get copied from
+ * their precomputed period. The first copy of the period gets doubled
+ * in place until the buffer is full.
+ */
+static void logic_fill(struct sr_dev_inst *sdi, uint8_t *data, uint64_t size)
+{
+	struct dev_context *devc;
+	size_t period, pos, len, done;
+
+	devc = sdi->priv;
+
+	if (!devc->logic_table) {
+		logic_generator(sdi, data, size);
+		return;
+	}
+
+	period = devc->logic_table_size;
+	pos = devc->logic_table_pos;
+
+	/* The rest of the period, then its start. */
+	done = MIN(size, period - pos);
+	memcpy(data, &devc->logic_table[pos], done);
+	if (done < size) {
+		len = MIN(size - done, pos);
+		memcpy(&data[done], devc->logic_table, len);
+		done += len;
+	}
+	while (done < size) {
+		len = MIN(size - done, done);
+		memcpy(&data[done], data, len);
+		done += len;
+	}
+
+	devc->logic_table_pos = (pos + size) % period;
+}
+
 /*
  * Fixup a memory image of generated logic data before it gets sent to
  * the session's datafeed. Mask out content from disabled channels.
@@ -515,7 +626,7 @@ static void send_analog_packet(struct analog_gen *ag,
 			data = ag->packet.data;
 			for (i = 0; i < sending_now; i++) {
 				if (ag->pattern == PATTERN_ANALOG_RANDOM)
-					data[i] = (rand() % 1000) * amplitude + offset;
+					data[i] = (random_next(devc) % 1000) * amplitude + offset;
 				else
 					data[i] = pattern->data[ag_pattern_pos + i] * amplitude + offset;
 			}
@@ -541,7 +652,7 @@ static void send_analog_packet(struct analog_gen *ag,
 
 		for (i = 0; i < to_avg; i++) {
 			if (ag->pattern == PATTERN_ANALOG_RANDOM)
-				value = (rand() % 1000) * amplitude + offset;
+				value = (random_next(devc) % 1000) * amplitude + offset;
 			else
 				value = *(pattern->data + ag_pattern_pos + i) * amplitude + offset;
 			ag->avg_val = (ag->avg_val + value) / 2;
@@ -577,12 +688,13 @@ SR_PRIV int demo_prepare_data(int fd, int revents, void *cb_data)
 {
 	struct sr_dev_inst *sdi;
 	struct dev_context *devc;
-	struct sr_datafeed_packet packet;
-	struct sr_datafeed_logic logic;
+	struct sr_datafeed_packet packet, *pooled;
+	struct sr_datafeed_logic *logic;
 	struct analog_gen *ag;
 	GHashTableIter iter;
 	void *value;
 	uint64_t samples_todo, logic_done, analog_done, analog_sent, sending_now;
+	size_t logic_bufsize;
 	int64_t elapsed_us, limit_us, todo_us;
 	int64_t trigger_offset;
 	int pre_trigger_samples;
@@ -610,8 +722,11 @@ SR_PRIV int demo_prepare_data(int fd, int revents, void *cb_data)
 		todo_us = MAX(0, elapsed_us - devc->spent_us);
 
 	/* How many samples are outstanding since the last round? */
-	samples_todo = (todo_us * devc->cur_samplerate + G_USEC_PER_SEC - 1)
-			/ G_USEC_PER_SEC;
+	if (devc->benchmark)
+		samples_todo = BENCHMARK_SAMPLES_PER_RUN;
+	else
+		samples_todo = (todo_us * devc->cur_samplerate + G_USEC_PER_SEC - 1)
+				/ G_USEC_PER_SEC;
 
 	if (devc->limit_samples > 0) {
 		if (devc->limit_samples < devc->sent_samples)
@@ -645,16 +760,28 @@ SR_PRIV int demo_prepare_data(int fd, int revents, void *cb_data)
 	if (!devc->enabled_analog_channels)
 		analog_done = samples_todo;
 
+	logic_bufsize = devc->benchmark ? BENCHMARK_LOGIC_BUFSIZE : LOGIC_BUFSIZE;
+
 	while (logic_done < samples_todo || analog_done < samples_todo) {
 		/* Logic */
 		if (logic_done < samples_todo) {
 			sending_now = MIN(samples_todo - logic_done,
-					LOGIC_BUFSIZE / devc->logic_unitsize);
-			logic_generator(sdi, sending_now * devc->logic_unitsize);
+					logic_bufsize / devc->logic_unitsize);
+			/* Generate right into the packet's pooled buffer. */
+			pooled = sr_packet_pool_logic_new(sr_session_packet_pool(sdi),
+					sending_now * devc->logic_unitsize,
+					devc->logic_unitsize);
+			if (!pooled) {
+				sr_err("Cannot allocate logic packet.");
+				sr_dev_acquisition_stop(sdi);
+				return G_SOURCE_CONTINUE;
+			}
+			logic = (struct sr_datafeed_logic *)pooled->payload;
+			logic_fill(sdi, logic->data, logic->length);
 			/* Check for trigger and send pre-trigger data if needed */
 			if (devc->stl && (!devc->trigger_fired)) {
 				trigger_offset = soft_trigger_logic_check(devc->stl,
-						devc->logic_data, sending_now * devc->logic_unitsize,
+						logic->data, logic->length,
 						&pre_trigger_samples);
 				if (trigger_offset > -1) {
 					devc->trigger_fired = TRUE;
@@ -664,17 +791,14 @@ SR_PRIV int demo_prepare_data(int fd, int revents, void *cb_data)
 				trigger_offset = 0;
 
 			/* Send logic samples if needed */
-			packet.type = SR_DF_LOGIC;
-			packet.payload = &logic;
-			logic.unitsize = devc->logic_unitsize;
-
 			if (devc->stl) {
 				if (devc->trigger_fired && (trigger_offset < (int)sending_now)) {
 					/* Send after-trigger data */
-					logic.length = (sending_now - trigger_offset) * devc->logic_unitsize;
-					logic.data = devc->logic_data + trigger_offset * devc->logic_unitsize;
-					logic_fixup_feed(devc, &logic);
-					sr_session_send(sdi, &packet);
+					logic->length = (sending_now - trigger_offset) * devc->logic_unitsize;
+					logic->data = (uint8_t *)logic->data + trigger_offset * devc->logic_unitsize;
+					logic_fixup_feed(devc, logic);
+					sr_session_send(sdi, pooled);
+					sr_packet_unref(pooled);
 					logic_done += sending_now - trigger_offset;
 					/* End acquisition */
 					sr_dbg("Triggered, stopping acquisition.");
@@ -682,14 +806,14 @@ SR_PRIV int demo_prepare_data(int fd, int revents, void *cb_data)
 					break;
 				} else {
 					/* Send nothing */
+					sr_packet_unref(pooled);
 					logic_done += sending_now;
 				}
 			} else if (!devc->stl) {
 				/* No trigger defined, send logic samples */
-				logic.length = sending_now * devc->logic_unitsize;
-				logic.data = devc->logic_data;
-				logic_fixup_feed(devc, &logic);
-				sr_session_send(sdi, &packet);
+				logic_fixup_feed(devc, logic);
+				sr_session_send(sdi, pooled);
+				sr_packet_unref(pooled);
 				logic_done += sending_now;
 			}
 		}
@@ -711,7 +835,11 @@ SR_PRIV int demo_prepare_data(int fd, int revents, void *cb_data)
 	uint64_t min = MIN(logic_done, analog_done);
 	devc->sent_samples += min;
 	devc->sent_frame_samples += min;
-	devc->spent_us += todo_us;
+	/* Time limits refer to wall clock time in benchmark mode. */
+	if (devc->benchmark)
+		devc->spent_us = g_get_monotonic_time() - devc->start_us;
+	else
+		devc->spent_us += todo_us;
 
 	if (devc->limit_frames && devc->sent_frame_samples >= SAMPLES_PER_FRAME) {
 		std_session_send_df_frame_end(sdi);
@@ -32,6 +32,12 @@
 
 /* The size in bytes of chunks to send through the session bus. */
 #define LOGIC_BUFSIZE			4096
+/* The size in bytes of logic chunks in benchmark mode. */
+#define BENCHMARK_LOGIC_BUFSIZE		(64 * 1024)
+/* Samples to generate per main loop iteration in benchmark mode. */
+#define BENCHMARK_SAMPLES_PER_RUN	(1024 * 1024)
+/* Repeating logic patterns longer than this get generated on the fly. */
+#define LOGIC_TABLE_MAX_SIZE		(64 * 1024)
 /* Size of the analog pattern space per channel. */
 #define ANALOG_BUFSIZE			4096
 /* This is a development feature: it starts a new frame every n samples. */
@@ -121,13 +127,20 @@ struct dev_context {
 	int64_t start_us;
 	int64_t spent_us;
 	uint64_t step;
+	/* Generate as fast as possible instead of at the samplerate. */
+	gboolean benchmark;
+	/* State of the pseudo random number generator. */
+	uint64_t random_state;
 	/* Logic */
 	int32_t num_logic_channels;
 	size_t logic_unitsize;
 	uint64_t all_logic_channels_mask;
 	/* There is only ever one logic channel group, so its pattern goes here. */
 	enum logic_pattern_type logic_pattern;
-	uint8_t logic_data[LOGIC_BUFSIZE];
+	/* One period of a repeating logic pattern, and the position in it. */
+	uint8_t *logic_table;
+	size_t logic_table_size;
+	size_t logic_table_pos;
 	/* Analog */
 	struct analog_pattern *analog_patterns[ARRAY_SIZE(analog_pattern_str)];
 	int32_t num_analog_channels;
@@ -162,6 +175,8 @@ struct analog_gen {
 
 SR_PRIV void demo_generate_analog_pattern(struct dev_context *devc);
 SR_PRIV void demo_free_analog_pattern(struct dev_context *devc);
+SR_PRIV void demo_generate_logic_pattern(struct sr_dev_inst *sdi);
+SR_PRIV void demo_free_logic_pattern(struct dev_context *devc);
 SR_PRIV int demo_prepare_data(int fd, int revents, void *cb_data);
 
 #endif
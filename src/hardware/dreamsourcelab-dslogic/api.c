@@ -65,6 +65,8 @@ static const uint32_t devopts[] = {
 	SR_CONF_CAPTURE_RATIO | SR_CONF_GET | SR_CONF_SET,
 	SR_CONF_EXTERNAL_CLOCK | SR_CONF_GET | SR_CONF_SET,
 	SR_CONF_CLOCK_EDGE | SR_CONF_GET | SR_CONF_SET | SR_CONF_LIST,
+	SR_CONF_USB_TRANSFER_SIZE | SR_CONF_GET | SR_CONF_SET,
+	SR_CONF_USB_TRANSFER_DEPTH | SR_CONF_GET | SR_CONF_SET,
 };
 
 static const int32_t trigger_matches[] = {
@@ -437,6 +439,12 @@ static int config_get(uint32_t key, GVariant **data,
 	case SR_CONF_CONTINUOUS:
 		*data = g_variant_new_boolean(devc->continuous_mode);
 		break;
+	case SR_CONF_USB_TRANSFER_SIZE:
+		*data = g_variant_new_uint64(devc->usb_transfer_size);
+		break;
+	case SR_CONF_USB_TRANSFER_DEPTH:
+		*data = g_variant_new_uint64(devc->usb_transfer_depth);
+		break;
 	case SR_CONF_CLOCK_EDGE:
 		idx = devc->clock_edge;
 		if (idx >= (int)ARRAY_SIZE(signal_edges))
@@ -493,6 +501,12 @@ static int config_set(uint32_t key, GVariant *data,
 	case SR_CONF_CONTINUOUS:
 		devc->continuous_mode = g_variant_get_boolean(data);
 		break;
+	case SR_CONF_USB_TRANSFER_SIZE:
+		devc->usb_transfer_size = g_variant_get_uint64(data);
+		break;
+	case SR_CONF_USB_TRANSFER_DEPTH:
+		devc->usb_transfer_depth = g_variant_get_uint64(data);
+		break;
 	case SR_CONF_CLOCK_EDGE:
 		if ((idx = std_str_idx(data, ARRAY_AND_SIZE(signal_edges))) < 0)
 			return SR_ERR_ARG;
@@ -685,6 +685,9 @@ static void finish_acquisition(struct sr_dev_inst *sdi)
 	devc->num_transfers = 0;
 	g_free(devc->transfers);
 	g_free(devc->deinterleave_buffer);
+
+	sr_usb_tuner_free(devc->tuner, sdi);
+	devc->tuner = NULL;
 }
 
 static void free_transfer(struct libusb_transfer *transfer)
@@ -696,6 +699,7 @@ static void free_transfer(struct libusb_transfer *transfer)
 	sdi = transfer->user_data;
 	devc = sdi->priv;
 
+	sr_usb_tuner_remove(devc->tuner, transfer);
 	g_free(transfer->buffer);
 	transfer->buffer = NULL;
 	libusb_free_transfer(transfer);
@@ -712,12 +716,82 @@ static void free_transfer(struct libusb_transfer *transfer)
 		finish_acquisition(sdi);
 }
 
+static void LIBUSB_CALL receive_transfer(struct libusb_transfer *transfer);
+
+/*
+ * Allocate and submit another transfer, which can hold the tuner's
+ * maximum transfer size. Takes the slot of a transfer which was freed
+ * before, if there is one.
+ */
+static int add_transfer(const struct sr_dev_inst *sdi)
+{
+	struct dev_context *devc;
+	struct sr_usb_dev_inst *usb;
+	struct libusb_transfer *transfer;
+	unsigned char *buf;
+	unsigned int idx;
+	int ret;
+
+	devc = sdi->priv;
+	usb = sdi->conn;
+
+	for (idx = 0; idx < devc->num_transfers; idx++) {
+		if (!devc->transfers[idx])
+			break;
+	}
+	if (idx >= devc->tuner->max_depth)
+		return SR_ERR_BUG;
+
+	if (!(buf = g_try_malloc(devc->tuner->max_size))) {
+		sr_err("USB transfer buffer malloc failed.");
+		return SR_ERR_MALLOC;
+	}
+	transfer = libusb_alloc_transfer(0);
+	libusb_fill_bulk_transfer(transfer, usb->devhdl,
+			6 | LIBUSB_ENDPOINT_IN, buf, devc->tuner->size,
+			receive_transfer, (void *)sdi, 0);
+	sr_usb_tuner_submit(devc->tuner, transfer);
+	if ((ret = libusb_submit_transfer(transfer)) != 0) {
+		sr_err("Failed to submit transfer: %s.",
+		       libusb_error_name(ret));
+		sr_usb_tuner_remove(devc->tuner, transfer);
+		libusb_free_transfer(transfer);
+		g_free(buf);
+		return SR_ERR;
+	}
+	devc->transfers[idx] = transfer;
+	if (idx == devc->num_transfers)
+		devc->num_transfers++;
+	devc->submitted_transfers++;
+
+	return SR_OK;
+}
+
 static void resubmit_transfer(struct libusb_transfer *transfer)
 {
+	struct sr_dev_inst *sdi;
+	struct dev_context *devc;
 	int ret;
 
-	if ((ret = libusb_submit_transfer(transfer)) == LIBUSB_SUCCESS)
+	sdi = transfer->user_data;
+	devc = sdi->priv;
+
+	/* The tuner asks for fewer transfers in flight. */
+	if ((unsigned int)devc->submitted_transfers > devc->tuner->depth) {
+		free_transfer(transfer);
+		return;
+	}
+
+	sr_usb_tuner_submit(devc->tuner, transfer);
+	if ((ret = libusb_submit_transfer(transfer)) == LIBUSB_SUCCESS) {
+		/* Put more transfers in flight when the tuner asks for it. */
+		while ((unsigned int)devc->submitted_transfers <
+				devc->tuner->depth) {
+			if (add_transfer(sdi) != SR_OK)
+				break;
+		}
 		return;
+	}
 
 	sr_err("%s: %s", __func__, libusb_error_name(ret));
 	free_transfer(transfer);
@@ -791,6 +865,8 @@ static void LIBUSB_CALL receive_transfer(struct libusb_transfer *transfer)
 	sr_dbg("receive_transfer(): status %s received %d bytes.",
 		libusb_error_name(transfer->status), transfer->actual_length);
 
+	sr_usb_tuner_complete(devc->tuner, transfer, 0);
+
 	/* Save incoming transfer before reusing the transfer struct. */
 
 	switch (transfer->status) {
@@ -905,93 +981,63 @@ static size_t to_bytes_per_ms(const struct sr_dev_inst *sdi)
 	return 35000000 / (1000 * 10);
 }
 
-static size_t get_buffer_size(const struct sr_dev_inst *sdi)
+static struct sr_usb_tuner *new_tuner(const struct sr_dev_inst *sdi)
 {
+	const struct dev_context *const devc = sdi->priv;
+	struct sr_usb_tuner *tuner;
+
 	/*
-	 * The buffer should be large enough to hold 10ms of data and
-	 * a multiple of the size of a data atom.
+	 * Transfers should initially hold 10ms of data and a multiple of
+	 * the size of a data atom each, and all of them about 100ms of data.
 	 */
-	const size_t block_size = enabled_channel_count(sdi) * 512;
-	const size_t s = 10 * to_bytes_per_ms(sdi);
-	if (!block_size)
-		return s;
-	return ((s + block_size - 1) / block_size) * block_size;
-}
+	tuner = sr_usb_tuner_new(to_bytes_per_ms(sdi),
+		enabled_channel_count(sdi) * 512, 10, 100, NUM_SIMUL_TRANSFERS);
+	sr_usb_tuner_limit(tuner, devc->usb_transfer_size,
+		devc->usb_transfer_depth);
 
-static unsigned int get_number_of_transfers(const struct sr_dev_inst *sdi)
-{
-	/* Total buffer size should be able to hold about 100ms of data. */
-	const unsigned int s = get_buffer_size(sdi);
-	const unsigned int n = (100 * to_bytes_per_ms(sdi) + s - 1) / s;
-	return (n > NUM_SIMUL_TRANSFERS) ? NUM_SIMUL_TRANSFERS : n;
-}
-
-static unsigned int get_timeout(const struct sr_dev_inst *sdi)
-{
-	const size_t total_size = get_buffer_size(sdi) *
-		get_number_of_transfers(sdi);
-	const unsigned int timeout = total_size / to_bytes_per_ms(sdi);
-	return timeout + timeout / 4; /* Leave a headroom of 25% percent. */
+	return tuner;
 }
 
 static int start_transfers(const struct sr_dev_inst *sdi)
 {
 	const size_t channel_count = enabled_channel_count(sdi);
-	const size_t size = get_buffer_size(sdi);
-	const unsigned int num_transfers = get_number_of_transfers(sdi);
-	const unsigned int timeout = get_timeout(sdi);
 
 	struct dev_context *devc;
-	struct sr_usb_dev_inst *usb;
-	struct libusb_transfer *transfer;
 	unsigned int i;
 	int ret;
-	unsigned char *buf;
 
 	devc = sdi->priv;
-	usb = sdi->conn;
 
 	devc->sent_samples = 0;
 	devc->acq_aborted = FALSE;
 	devc->empty_transfer_count = 0;
 	devc->submitted_transfers = 0;
 
+	/* Leave room for the transfers which the tuner may add. */
 	g_free(devc->transfers);
-	devc->transfers = g_try_malloc0(sizeof(*devc->transfers) * num_transfers);
+	devc->num_transfers = 0;
+	devc->transfers = g_try_malloc0(sizeof(*devc->transfers) *
+		devc->tuner->max_depth);
 	if (!devc->transfers) {
 		sr_err("USB transfers malloc failed.");
 		return SR_ERR_MALLOC;
 	}
 
 	devc->deinterleave_buffer = g_try_malloc(DSLOGIC_ATOMIC_SAMPLES *
-		(size / (channel_count * DSLOGIC_ATOMIC_BYTES)) * sizeof(uint16_t));
+		(devc->tuner->max_size / (channel_count * DSLOGIC_ATOMIC_BYTES)) *
+		sizeof(uint16_t));
 	if (!devc->deinterleave_buffer) {
 		sr_err("Deinterleave buffer malloc failed.");
 		g_free(devc->deinterleave_buffer);
 		return SR_ERR_MALLOC;
 	}
 
-	devc->num_transfers = num_transfers;
-	for (i = 0; i < num_transfers; i++) {
-		if (!(buf = g_try_malloc(size))) {
-			sr_err("USB transfer buffer malloc failed.");
-			return SR_ERR_MALLOC;
-		}
-		transfer = libusb_alloc_transfer(0);
-		libusb_fill_bulk_transfer(transfer, usb->devhdl,
-				6 | LIBUSB_ENDPOINT_IN, buf, size,
-				receive_transfer, (void *)sdi, timeout);
+	for (i = 0; i < devc->tuner->depth; i++) {
 		sr_info("submitting transfer: %d", i);
-		if ((ret = libusb_submit_transfer(transfer)) != 0) {
-			sr_err("Failed to submit transfer: %s.",
-			       libusb_error_name(ret));
-			libusb_free_transfer(transfer);
-			g_free(buf);
+		if ((ret = add_transfer(sdi)) != SR_OK) {
 			abort_acquisition(devc);
-			return SR_ERR;
+			return ret;
 		}
-		devc->transfers[i] = transfer;
-		devc->submitted_transfers++;
 	}
 
 	std_session_send_df_header(sdi);
@@ -1014,6 +1060,8 @@ static void LIBUSB_CALL trigger_receive(struct libusb_transfer *transfer)
 		usb_source_remove(sdi->session, devc->ctx);
 		devc->num_transfers = 0;
 		g_free(devc->transfers);
+		sr_usb_tuner_free(devc->tuner, sdi);
+		devc->tuner = NULL;
 	} else if (transfer->status == LIBUSB_TRANSFER_COMPLETED
 			&& transfer->actual_length == sizeof(struct dslogic_trigger_pos)) {
 		tpos = (struct dslogic_trigger_pos *)transfer->buffer;
@@ -1028,8 +1076,6 @@ static void LIBUSB_CALL trigger_receive(struct libusb_transfer *transfer)
 
 SR_PRIV int dslogic_acquisition_start(const struct sr_dev_inst *sdi)
 {
-	const unsigned int timeout = get_timeout(sdi);
-
 	struct sr_dev_driver *di;
 	struct drv_context *drvc;
 	struct dev_context *devc;
@@ -1048,7 +1094,11 @@ SR_PRIV int dslogic_acquisition_start(const struct sr_dev_inst *sdi)
 	devc->empty_transfer_count = 0;
 	devc->acq_aborted = FALSE;
 
-	usb_source_add(sdi->session, devc->ctx, timeout, receive_data, drvc);
+	sr_usb_tuner_free(devc->tuner, NULL);
+	devc->tuner = new_tuner(sdi);
+
+	usb_source_add(sdi->session, devc->ctx,
+		sr_usb_tuner_timeout(devc->tuner), receive_data, drvc);
 
 	if ((ret = command_stop_acquisition(sdi)) != SR_OK)
 		return ret;
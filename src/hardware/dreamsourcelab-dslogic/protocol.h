@@ -131,6 +131,11 @@ struct dev_context {
 	unsigned int num_transfers;
 	struct libusb_transfer **transfers;
 	struct sr_context *ctx;
+	/* Adjusts transfer size and count while acquiring. */
+	struct sr_usb_tuner *tuner;
+	/* Limits of the tuner, zero for the defaults. */
+	uint64_t usb_transfer_size;
+	uint64_t usb_transfer_depth;
 
 	uint16_t *deinterleave_buffer;
 
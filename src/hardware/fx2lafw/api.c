@@ -132,6 +132,8 @@ static const uint32_t devopts[] = {
 	SR_CONF_SAMPLERATE | SR_CONF_GET | SR_CONF_SET | SR_CONF_LIST,
 	SR_CONF_TRIGGER_MATCH | SR_CONF_LIST,
 	SR_CONF_CAPTURE_RATIO | SR_CONF_GET | SR_CONF_SET,
+	SR_CONF_USB_TRANSFER_SIZE | SR_CONF_GET | SR_CONF_SET,
+	SR_CONF_USB_TRANSFER_DEPTH | SR_CONF_GET | SR_CONF_SET,
 };
 
 static const int32_t trigger_matches[] = {
@@ -405,6 +407,7 @@ static GSList *scan(struct sr_dev_driver *di, GSList *options)
 static void clear_helper(struct dev_context *devc)
 {
 	g_slist_free(devc->enabled_analog_channels);
+	g_mutex_clear(&devc->transfer_mutex);
 }
 
 static int dev_clear(const struct sr_dev_driver *di)
@@ -538,6 +541,12 @@ static int config_get(uint32_t key, GVariant **data,
 	case SR_CONF_CAPTURE_RATIO:
 		*data = g_variant_new_uint64(devc->capture_ratio);
 		break;
+	case SR_CONF_USB_TRANSFER_SIZE:
+		*data = g_variant_new_uint64(devc->usb_transfer_size);
+		break;
+	case SR_CONF_USB_TRANSFER_DEPTH:
+		*data = g_variant_new_uint64(devc->usb_transfer_depth);
+		break;
 	default:
 		return SR_ERR_NA;
 	}
@@ -573,6 +582,12 @@ static int config_set(uint32_t key, GVariant *data,
 	case SR_CONF_CAPTURE_RATIO:
 		devc->capture_ratio = g_variant_get_uint64(data);
 		break;
+	case SR_CONF_USB_TRANSFER_SIZE:
+		devc->usb_transfer_size = g_variant_get_uint64(data);
+		break;
+	case SR_CONF_USB_TRANSFER_DEPTH:
+		devc->usb_transfer_depth = g_variant_get_uint64(data);
+		break;
 	default:
 		return SR_ERR_NA;
 	}
@@ -264,6 +264,7 @@ SR_PRIV struct dev_context *fx2lafw_dev_new(void)
 	devc->sample_wide = FALSE;
 	devc->num_frames = 0;
 	devc->stl = NULL;
+	g_mutex_init(&devc->transfer_mutex);
 
 	return devc;
 }
@@ -272,12 +273,19 @@ SR_PRIV void fx2lafw_abort_acquisition(struct dev_context *devc)
 {
 	int i;
 
-	devc->acq_aborted = TRUE;
+	/*
+	 * With a USB event thread, transfers complete and get resubmitted
+	 * concurrently. The lock makes sure that no transfer gets submitted
+	 * after it was cancelled.
+	 */
+	g_mutex_lock(&devc->transfer_mutex);
+	g_atomic_int_set(&devc->acq_aborted, TRUE);
 
 	for (i = devc->num_transfers - 1; i >= 0; i--) {
 		if (devc->transfers[i])
 			libusb_cancel_transfer(devc->transfers[i]);
 	}
+	g_mutex_unlock(&devc->transfer_mutex);
 }
 
 static void finish_acquisition(struct sr_dev_inst *sdi)
@@ -288,11 +296,19 @@ static void finish_acquisition(struct sr_dev_inst *sdi)
 
 	std_session_send_df_end(sdi);
 
-	usb_source_remove(sdi->session, devc->ctx);
+	if (devc->stream) {
+		sr_usb_stream_free(devc->stream);
+		devc->stream = NULL;
+	} else {
+		usb_source_remove(sdi->session, devc->ctx);
+	}
 
 	devc->num_transfers = 0;
 	g_free(devc->transfers);
 
+	sr_usb_tuner_free(devc->tuner, sdi);
+	devc->tuner = NULL;
+
 	/* Free the deinterlace buffers if we had them. */
 	if (g_slist_length(devc->enabled_analog_channels) > 0) {
 		g_free(devc->logic_buffer);
@@ -310,10 +326,13 @@ static void free_transfer(struct libusb_transfer *transfer)
 	struct sr_dev_inst *sdi;
 	struct dev_context *devc;
 	unsigned int i;
+	gboolean last;
 
 	sdi = transfer->user_data;
 	devc = sdi->priv;
 
+	g_mutex_lock(&devc->transfer_mutex);
+	sr_usb_tuner_remove(devc->tuner, transfer);
 	g_free(transfer->buffer);
 	transfer->buffer = NULL;
 	libusb_free_transfer(transfer);
@@ -326,18 +345,104 @@ static void free_transfer(struct libusb_transfer *transfer)
 	}
 
 	devc->submitted_transfers--;
-	if (devc->submitted_transfers == 0)
+	last = devc->submitted_transfers == 0;
+	g_mutex_unlock(&devc->transfer_mutex);
+
+	if (!last)
+		return;
+
+	/* The session thread finishes after it has processed all data. */
+	if (devc->stream)
+		sr_usb_stream_finish(devc->stream);
+	else
 		finish_acquisition(sdi);
 }
 
+static void LIBUSB_CALL receive_transfer(struct libusb_transfer *transfer);
+
+/*
+ * Allocate and submit another transfer, which can hold the tuner's
+ * maximum transfer size. Takes the slot of a transfer which was freed
+ * before, if there is one. Must be called with the transfer mutex held.
+ */
+static int add_transfer(const struct sr_dev_inst *sdi)
+{
+	struct dev_context *devc;
+	struct sr_usb_dev_inst *usb;
+	struct libusb_transfer *transfer;
+	unsigned char *buf;
+	unsigned int idx;
+	int ret;
+
+	devc = sdi->priv;
+	usb = sdi->conn;
+
+	for (idx = 0; idx < devc->num_transfers; idx++) {
+		if (!devc->transfers[idx])
+			break;
+	}
+	if (idx >= devc->tuner->max_depth)
+		return SR_ERR_BUG;
+
+	if (!(buf = g_try_malloc(devc->tuner->max_size))) {
+		sr_err("USB transfer buffer malloc failed.");
+		return SR_ERR_MALLOC;
+	}
+	transfer = libusb_alloc_transfer(0);
+	libusb_fill_bulk_transfer(transfer, usb->devhdl,
+			2 | LIBUSB_ENDPOINT_IN, buf, devc->tuner->size,
+			receive_transfer, (void *)sdi, 0);
+	sr_usb_tuner_submit(devc->tuner, transfer);
+	if ((ret = sr_usb_stream_submit(devc->stream, transfer)) != 0) {
+		sr_err("Failed to submit transfer: %s.",
+		       libusb_error_name(ret));
+		sr_usb_tuner_remove(devc->tuner, transfer);
+		libusb_free_transfer(transfer);
+		g_free(buf);
+		return SR_ERR;
+	}
+	devc->transfers[idx] = transfer;
+	if (idx == devc->num_transfers)
+		devc->num_transfers++;
+	devc->submitted_transfers++;
+
+	return SR_OK;
+}
+
 static void resubmit_transfer(struct libusb_transfer *transfer)
 {
+	struct sr_dev_inst *sdi;
+	struct dev_context *devc;
 	int ret;
 
-	if ((ret = libusb_submit_transfer(transfer)) == LIBUSB_SUCCESS)
+	sdi = transfer->user_data;
+	devc = sdi->priv;
+
+	g_mutex_lock(&devc->transfer_mutex);
+	if (g_atomic_int_get(&devc->acq_aborted)) {
+		ret = LIBUSB_ERROR_INTERRUPTED;
+	} else if ((unsigned int)devc->submitted_transfers >
+			devc->tuner->depth) {
+		/* The tuner asks for fewer transfers in flight. */
+		ret = LIBUSB_ERROR_INTERRUPTED;
+	} else {
+		sr_usb_tuner_submit(devc->tuner, transfer);
+		ret = sr_usb_stream_submit(devc->stream, transfer);
+	}
+	/* Put more transfers in flight when the tuner asks for it. */
+	while (ret == LIBUSB_SUCCESS &&
+			(unsigned int)devc->submitted_transfers <
+			devc->tuner->depth) {
+		if (add_transfer(sdi) != SR_OK)
+			break;
+	}
+	g_mutex_unlock(&devc->transfer_mutex);
+
+	if (ret == LIBUSB_SUCCESS)
 		return;
 
-	sr_err("%s: %s", __func__, libusb_error_name(ret));
+	if (ret != LIBUSB_ERROR_INTERRUPTED)
+		sr_err("%s: %s", __func__, libusb_error_name(ret));
 	free_transfer(transfer);
 
 }
@@ -411,65 +516,24 @@ static void la_send_data_proc(struct sr_dev_inst *sdi,
 	sr_session_send(sdi, &packet);
 }
 
-static void LIBUSB_CALL receive_transfer(struct libusb_transfer *transfer)
+/*
+ * Check for the trigger and send the received data to the session bus.
+ * Returns TRUE when the acquisition is complete.
+ */
+static gboolean process_data(struct sr_dev_inst *sdi,
+	uint8_t *data, size_t length)
 {
-	struct sr_dev_inst *sdi;
 	struct dev_context *devc;
-	gboolean packet_has_error = FALSE;
 	unsigned int num_samples;
 	int trigger_offset, cur_sample_count, unitsize, processed_samples;
 	int pre_trigger_samples;
 
-	sdi = transfer->user_data;
 	devc = sdi->priv;
 
-	/*
-	 * If acquisition has already ended, just free any queued up
-	 * transfer that come in.
-	 */
-	if (devc->acq_aborted) {
-		free_transfer(transfer);
-		return;
-	}
-
-	sr_dbg("receive_transfer(): status %s received %d bytes.",
-		libusb_error_name(transfer->status), transfer->actual_length);
-
-	/* Save incoming transfer before reusing the transfer struct. */
 	unitsize = devc->sample_wide ? 2 : 1;
-	cur_sample_count = transfer->actual_length / unitsize;
+	cur_sample_count = length / unitsize;
 	processed_samples = 0;
 
-	switch (transfer->status) {
-	case LIBUSB_TRANSFER_NO_DEVICE:
-		fx2lafw_abort_acquisition(devc);
-		free_transfer(transfer);
-		return;
-	case LIBUSB_TRANSFER_COMPLETED:
-	case LIBUSB_TRANSFER_TIMED_OUT: /* We may have received some data though. */
-		break;
-	default:
-		packet_has_error = TRUE;
-		break;
-	}
-
-	if (transfer->actual_length == 0 || packet_has_error) {
-		devc->empty_transfer_count++;
-		if (devc->empty_transfer_count > MAX_EMPTY_TRANSFERS) {
-			/*
-			 * The FX2 gave up. End the acquisition, the frontend
-			 * will work out that the samplecount is short.
-			 */
-			fx2lafw_abort_acquisition(devc);
-			free_transfer(transfer);
-		} else {
-			resubmit_transfer(transfer);
-		}
-		return;
-	} else {
-		devc->empty_transfer_count = 0;
-	}
-
 check_trigger:
 	if (devc->trigger_fired) {
 		if (!devc->limit_samples || devc->sent_samples < devc->limit_samples) {
@@ -478,15 +542,15 @@ check_trigger:
 			if (devc->limit_samples && devc->sent_samples + num_samples > devc->limit_samples)
 				num_samples = devc->limit_samples - devc->sent_samples;
 
-			devc->send_data_proc(sdi, (uint8_t *)transfer->buffer + processed_samples * unitsize,
+			devc->send_data_proc(sdi, data + processed_samples * unitsize,
 				num_samples * unitsize, unitsize);
 			devc->sent_samples += num_samples;
 			processed_samples += num_samples;
 		}
 	} else {
 		trigger_offset = soft_trigger_logic_check(devc->stl,
-			transfer->buffer + processed_samples * unitsize,
-			transfer->actual_length - processed_samples * unitsize,
+			data + processed_samples * unitsize,
+			length - processed_samples * unitsize,
 			&pre_trigger_samples);
 		if (trigger_offset > -1) {
 			std_session_send_df_frame_begin(sdi);
@@ -496,7 +560,7 @@ check_trigger:
 					devc->sent_samples + num_samples > devc->limit_samples)
 				num_samples = devc->limit_samples - devc->sent_samples;
 
-			devc->send_data_proc(sdi, (uint8_t *)transfer->buffer
+			devc->send_data_proc(sdi, data
 					+ processed_samples * unitsize
 					+ trigger_offset * unitsize,
 					num_samples * unitsize, unitsize);
@@ -529,7 +593,96 @@ check_trigger:
 				goto check_trigger;
 		}
 	}
-	if (frame_ended && final_frame) {
+
+	return frame_ended && final_frame;
+}
+
+/* Data of a transfer which completed in the USB event thread. */
+static void receive_stream_data(uint8_t *data, size_t length, void *cb_data)
+{
+	struct sr_dev_inst *sdi;
+	struct dev_context *devc;
+
+	sdi = cb_data;
+	devc = sdi->priv;
+
+	if (g_atomic_int_get(&devc->acq_aborted))
+		return;
+
+	if (process_data(sdi, data, length))
+		fx2lafw_abort_acquisition(devc);
+}
+
+/* All transfers of the USB event thread have completed. */
+static void finish_stream(void *cb_data)
+{
+	finish_acquisition(cb_data);
+}
+
+static void LIBUSB_CALL receive_transfer(struct libusb_transfer *transfer)
+{
+	struct sr_dev_inst *sdi;
+	struct dev_context *devc;
+	gboolean packet_has_error = FALSE;
+
+	sdi = transfer->user_data;
+	devc = sdi->priv;
+
+	/*
+	 * If acquisition has already ended, just free any queued up
+	 * transfer that come in.
+	 */
+	if (g_atomic_int_get(&devc->acq_aborted)) {
+		free_transfer(transfer);
+		return;
+	}
+
+	sr_dbg("receive_transfer(): status %s received %d bytes.",
+		libusb_error_name(transfer->status), transfer->actual_length);
+
+	sr_usb_tuner_complete(devc->tuner, transfer,
+		sr_usb_stream_backlog(devc->stream));
+
+	/* Hand the data to the session thread, keep receiving right away. */
+	if (devc->stream)
+		sr_usb_stream_complete(devc->stream, transfer);
+
+	switch (transfer->status) {
+	case LIBUSB_TRANSFER_NO_DEVICE:
+		fx2lafw_abort_acquisition(devc);
+		free_transfer(transfer);
+		return;
+	case LIBUSB_TRANSFER_COMPLETED:
+	case LIBUSB_TRANSFER_TIMED_OUT: /* We may have received some data though. */
+		break;
+	default:
+		packet_has_error = TRUE;
+		break;
+	}
+
+	if (transfer->actual_length == 0 || packet_has_error) {
+		devc->empty_transfer_count++;
+		if (devc->empty_transfer_count > MAX_EMPTY_TRANSFERS) {
+			/*
+			 * The FX2 gave up. End the acquisition, the frontend
+			 * will work out that the samplecount is short.
+			 */
+			fx2lafw_abort_acquisition(devc);
+			free_transfer(transfer);
+		} else {
+			resubmit_transfer(transfer);
+		}
+		return;
+	} else {
+		devc->empty_transfer_count = 0;
+	}
+
+	if (devc->stream) {
+		resubmit_transfer(transfer);
+		return;
+	}
+
+	if (process_data(sdi, transfer->buffer, transfer->actual_length)) {
 		fx2lafw_abort_acquisition(devc);
 		free_transfer(transfer);
 	} else
@@ -575,41 +728,20 @@ static unsigned int to_bytes_per_ms(unsigned int samplerate)
 	return samplerate / 1000;
 }
 
-static size_t get_buffer_size(struct dev_context *devc)
+static struct sr_usb_tuner *new_tuner(struct dev_context *devc)
 {
-	size_t s;
+	struct sr_usb_tuner *tuner;
 
 	/*
-	 * The buffer should be large enough to hold 10ms of data and
-	 * a multiple of 512.
+	 * Transfers should initially hold 10ms of data and a multiple
+	 * of 512 bytes each, and all of them about 500ms of data.
 	 */
-	s = 10 * to_bytes_per_ms(devc->cur_samplerate);
-	return (s + 511) & ~511;
-}
-
-static unsigned int get_number_of_transfers(struct dev_context *devc)
-{
-	unsigned int n;
-
-	/* Total buffer size should be able to hold about 500ms of data. */
-	n = (500 * to_bytes_per_ms(devc->cur_samplerate) /
-		get_buffer_size(devc));
+	tuner = sr_usb_tuner_new(to_bytes_per_ms(devc->cur_samplerate),
+		512, 10, 500, NUM_SIMUL_TRANSFERS);
+	sr_usb_tuner_limit(tuner, devc->usb_transfer_size,
+		devc->usb_transfer_depth);
 
-	if (n > NUM_SIMUL_TRANSFERS)
-		return NUM_SIMUL_TRANSFERS;
-
-	return n;
-}
-
-static unsigned int get_timeout(struct dev_context *devc)
-{
-	size_t total_size;
-	unsigned int timeout;
-
-	total_size = get_buffer_size(devc) *
-			get_number_of_transfers(devc);
-	timeout = total_size / to_bytes_per_ms(devc->cur_samplerate);
-	return timeout + timeout / 4; /* Leave a headroom of 25% percent. */
+	return tuner;
 }
 
 static int receive_data(int fd, int revents, void *cb_data)
@@ -631,19 +763,14 @@ static int receive_data(int fd, int revents, void *cb_data)
 static int start_transfers(const struct sr_dev_inst *sdi)
 {
 	struct dev_context *devc;
-	struct sr_usb_dev_inst *usb;
 	struct sr_trigger *trigger;
-	struct libusb_transfer *transfer;
-	unsigned int i, num_transfers;
-	int timeout, ret;
-	unsigned char *buf;
-	size_t size;
+	unsigned int i;
+	int ret;
 
 	devc = sdi->priv;
-	usb = sdi->conn;
 
 	devc->sent_samples = 0;
-	devc->acq_aborted = FALSE;
+	g_atomic_int_set(&devc->acq_aborted, FALSE);
 	devc->empty_transfer_count = 0;
 
 	if ((trigger = sr_session_trigger_get(sdi->session))) {
@@ -659,39 +786,26 @@ static int start_transfers(const struct sr_dev_inst *sdi)
 		devc->trigger_fired = TRUE;
 	}
 
-	num_transfers = get_number_of_transfers(devc);
-
-	size = get_buffer_size(devc);
 	devc->submitted_transfers = 0;
+	devc->num_transfers = 0;
 
-	devc->transfers = g_try_malloc0(sizeof(*devc->transfers) * num_transfers);
+	/* Leave room for the transfers which the tuner may add. */
+	devc->transfers = g_try_malloc0(sizeof(*devc->transfers) *
+		devc->tuner->max_depth);
 	if (!devc->transfers) {
 		sr_err("USB transfers malloc failed.");
 		return SR_ERR_MALLOC;
 	}
 
-	timeout = get_timeout(devc);
-	devc->num_transfers = num_transfers;
-	for (i = 0; i < num_transfers; i++) {
-		if (!(buf = g_try_malloc(size))) {
-			sr_err("USB transfer buffer malloc failed.");
-			return SR_ERR_MALLOC;
-		}
-		transfer = libusb_alloc_transfer(0);
-		libusb_fill_bulk_transfer(transfer, usb->devhdl,
-				2 | LIBUSB_ENDPOINT_IN, buf, size,
-				receive_transfer, (void *)sdi, timeout);
+	for (i = 0; i < devc->tuner->depth; i++) {
 		sr_info("submitting transfer: %d", i);
-		if ((ret = libusb_submit_transfer(transfer)) != 0) {
-			sr_err("Failed to submit transfer: %s.",
-			       libusb_error_name(ret));
-			libusb_free_transfer(transfer);
-			g_free(buf);
+		g_mutex_lock(&devc->transfer_mutex);
+		ret = add_transfer(sdi);
+		g_mutex_unlock(&devc->transfer_mutex);
+		if (ret != SR_OK) {
 			fx2lafw_abort_acquisition(devc);
-			return SR_ERR;
+			return ret;
 		}
-		devc->transfers[i] = transfer;
-		devc->submitted_transfers++;
 	}
 
 	/*
@@ -725,17 +839,30 @@ SR_PRIV int fx2lafw_start_acquisition(const struct sr_dev_inst *sdi)
 	devc->num_frames = 0;
 	devc->sent_samples = 0;
 	devc->empty_transfer_count = 0;
-	devc->acq_aborted = FALSE;
+	g_atomic_int_set(&devc->acq_aborted, FALSE);
 
 	if (configure_channels(sdi) != SR_OK) {
 		sr_err("Failed to configure channels.");
 		return SR_ERR;
 	}
 
-	timeout = get_timeout(devc);
-	usb_source_add(sdi->session, devc->ctx, timeout, receive_data, drvc);
+	devc->tuner = new_tuner(devc);
+	size = devc->tuner->max_size;
+
+	/*
+	 * Have transfers complete in a thread of their own when the
+	 * session asks for it, with room for a few times the data which
+	 * the transfers hold, for as many transfers as the tuner may put
+	 * in flight. Else handle them in the session's thread.
+	 */
+	devc->stream = sr_usb_stream_new(sdi, devc->ctx,
+		NUM_STREAM_BUFFERS_PER_TRANSFER * devc->tuner->max_depth,
+		size, receive_stream_data, finish_stream, (void *)sdi);
+	if (!devc->stream) {
+		timeout = sr_usb_tuner_timeout(devc->tuner);
+		usb_source_add(sdi->session, devc->ctx, timeout, receive_data, drvc);
+	}
 
-	size = get_buffer_size(devc);
 	/* Prepare for analog sampling. */
 	if (g_slist_length(devc->enabled_analog_channels) > 0) {
 		/* We need a buffer half the size of a transfer. */
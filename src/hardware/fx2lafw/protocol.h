@@ -39,6 +39,9 @@
 #define NUM_SIMUL_TRANSFERS	32
 #define MAX_EMPTY_TRANSFERS	(NUM_SIMUL_TRANSFERS * 2)
 
+/* Buffers per transfer which can wait for the session thread. */
+#define NUM_STREAM_BUFFERS_PER_TRANSFER	4
+
 #define NUM_CHANNELS		16
 
 #define FX2LAFW_REQUIRED_VERSION_MAJOR	1
@@ -108,6 +111,7 @@ struct dev_context {
 	uint64_t capture_ratio;
 
 	gboolean trigger_fired;
+	/* Read by the USB event thread, use g_atomic_int_get(). */
 	gboolean acq_aborted;
 	gboolean sample_wide;
 	struct soft_trigger_logic *stl;
@@ -119,7 +123,16 @@ struct dev_context {
 
 	unsigned int num_transfers;
 	struct libusb_transfer **transfers;
+	/* Protects the transfers against concurrent cancellation. */
+	GMutex transfer_mutex;
 	struct sr_context *ctx;
+	/* Transfers complete in a USB event thread, or NULL. */
+	struct sr_usb_stream *stream;
+	/* Adjusts transfer size and count while acquiring. */
+	struct sr_usb_tuner *tuner;
+	/* Limits of the tuner, zero for the defaults. */
+	uint64_t usb_transfer_size;
+	uint64_t usb_transfer_depth;
 	void (*send_data_proc)(struct sr_dev_inst *sdi,
 		uint8_t *data, size_t length, size_t sample_width);
 	uint8_t *logic_buffer;
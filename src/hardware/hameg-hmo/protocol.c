@@ -1463,20 +1463,104 @@ SR_PRIV void hmo_cleanup_logic_data(struct dev_context *devc)
 	 */
 }
 
-SR_PRIV int hmo_receive_data(int fd, int revents, void *cb_data)
+/* Limit a block's sample count to the requested number of samples. */
+static size_t hmo_block_limit(struct dev_context *devc, size_t count)
 {
-	struct sr_channel *ch;
-	struct sr_dev_inst *sdi;
+	uint64_t left;
+
+	if (!devc->samples_limit)
+		return count;
+	if (devc->block_samples >= devc->samples_limit)
+		return 0;
+	left = devc->samples_limit - devc->block_samples;
+
+	return MIN(count, left);
+}
+
+/* Send analog data of the current channel as it gets received. */
+static int hmo_receive_analog(const uint8_t *data, size_t len, void *cb_data)
+{
+	const struct sr_dev_inst *sdi;
 	struct dev_context *devc;
 	struct scope_state *state;
+	struct sr_channel *ch;
 	struct sr_datafeed_packet packet;
-	GByteArray *data;
 	struct sr_datafeed_analog analog;
 	struct sr_analog_encoding encoding;
 	struct sr_analog_meaning meaning;
 	struct sr_analog_spec spec;
+	size_t count, sent;
+
+	sdi = cb_data;
+	devc = sdi->priv;
+	state = devc->model_state;
+	ch = devc->current_channel->data;
+
+	count = len / sizeof(float);
+	/* Truncate acquisition if a smaller number of samples has been requested. */
+	sent = hmo_block_limit(devc, count);
+	devc->block_samples += count;
+	if (!sent)
+		return count * sizeof(float);
+
+	packet.type = SR_DF_ANALOG;
+
+	/* TODO: Use proper 'digits' value for this device (and its modes). */
+	sr_analog_init(&analog, &encoding, &meaning, &spec, 2);
+	analog.data = (void *)data;
+	analog.num_samples = sent;
+	encoding.is_signed = TRUE;
+	if (state->analog_channels[ch->index].probe_unit == 'V') {
+		meaning.mq = SR_MQ_VOLTAGE;
+		meaning.unit = SR_UNIT_VOLT;
+	} else {
+		meaning.mq = SR_MQ_CURRENT;
+		meaning.unit = SR_UNIT_AMPERE;
+	}
+	meaning.channels = g_slist_append(NULL, ch);
+	packet.payload = &analog;
+	sr_session_send(sdi, &packet);
+	g_slist_free(meaning.channels);
+
+	return count * sizeof(float);
+}
+
+/* Send logic data of the first pod as it gets received. */
+static int hmo_receive_logic(const uint8_t *data, size_t len, void *cb_data)
+{
+	const struct sr_dev_inst *sdi;
+	struct dev_context *devc;
+	struct sr_datafeed_packet packet;
 	struct sr_datafeed_logic logic;
-	size_t group;
+	size_t sent;
+
+	sdi = cb_data;
+	devc = sdi->priv;
+
+	/* Truncate acquisition if a smaller number of samples has been requested. */
+	sent = hmo_block_limit(devc, len);
+	devc->block_samples += len;
+	if (!sent)
+		return len;
+
+	packet.type = SR_DF_LOGIC;
+	logic.data = (void *)data;
+	logic.length = sent;
+	logic.unitsize = 1;
+	packet.payload = &logic;
+	sr_session_send(sdi, &packet);
+
+	return len;
+}
+
+SR_PRIV int hmo_receive_data(int fd, int revents, void *cb_data)
+{
+	struct sr_channel *ch;
+	struct sr_dev_inst *sdi;
+	struct dev_context *devc;
+	GByteArray *data;
+	size_t group, datalen;
+	int ret;
 
 	(void)fd;
 	(void)revents;
@@ -1495,7 +1579,9 @@ SR_PRIV int hmo_receive_data(int fd, int revents, void *cb_data)
 	*/
 
 	ch = devc->current_channel->data;
-	state = devc->model_state;
+
+	if (!devc->block_buf)
+		devc->block_buf = g_malloc(HMO_BLOCK_BUFSIZE);
 
 	/*
 	 * Send "frame begin" packet upon reception of data for the
@@ -1509,73 +1595,51 @@ SR_PRIV int hmo_receive_data(int fd, int revents, void *cb_data)
 	 */
 	switch (ch->type) {
 	case SR_CHANNEL_ANALOG:
-		data = NULL;
-		if (sr_scpi_get_block(sdi->conn, NULL, &data) != SR_OK) {
-			if (data)
-				g_byte_array_free(data, TRUE);
-			return TRUE;
-		}
-
-		packet.type = SR_DF_ANALOG;
-
-		analog.data = data->data;
-		analog.num_samples = data->len / sizeof(float);
-		/* Truncate acquisition if a smaller number of samples has been requested. */
-		if (devc->samples_limit > 0 && analog.num_samples > devc->samples_limit)
-			analog.num_samples = devc->samples_limit;
-		/* TODO: Use proper 'digits' value for this device (and its modes). */
-		sr_analog_init(&analog, &encoding, &meaning, &spec, 2);
-		encoding.is_signed = TRUE;
-		if (state->analog_channels[ch->index].probe_unit == 'V') {
-			meaning.mq = SR_MQ_VOLTAGE;
-			meaning.unit = SR_UNIT_VOLT;
-		} else {
-			meaning.mq = SR_MQ_CURRENT;
-			meaning.unit = SR_UNIT_AMPERE;
-		}
-		meaning.channels = g_slist_append(NULL, ch);
-		packet.payload = &analog;
-		sr_session_send(sdi, &packet);
-		devc->num_samples = data->len / sizeof(float);
-		g_slist_free(meaning.channels);
-		g_byte_array_free(data, TRUE);
-		data = NULL;
+		devc->block_samples = 0;
+		ret = sr_scpi_read_block(sdi->conn, NULL, devc->block_buf,
+			HMO_BLOCK_BUFSIZE, &datalen, hmo_receive_analog, sdi);
+		/* Pass on partial data upon timeout. */
+		if (ret != SR_OK && ret != SR_ERR_TIMEOUT)
+			goto abort;
+		devc->num_samples = datalen / sizeof(float);
 		break;
 	case SR_CHANNEL_LOGIC:
+		/*
+		 * If only data from the first pod is involved in the
+		 * acquisition, then the raw input bytes can get passed
+		 * forward for performance reasons, while they are still
+		 * being received.
+		 */
+		if (devc->pod_count == 1) {
+			devc->block_samples = 0;
+			ret = sr_scpi_read_block(sdi->conn, NULL,
+				devc->block_buf, HMO_BLOCK_BUFSIZE, &datalen,
+				hmo_receive_logic, sdi);
+			if (ret != SR_OK && ret != SR_ERR_TIMEOUT)
+				goto abort;
+			devc->num_samples = datalen;
+			break;
+		}
+
 		data = NULL;
 		if (sr_scpi_get_block(sdi->conn, NULL, &data) != SR_OK) {
 			if (data)
 				g_byte_array_free(data, TRUE);
-			return TRUE;
+			goto abort;
 		}
 
 		/*
-		 * If only data from the first pod is involved in the
-		 * acquisition, then the raw input bytes can get passed
-		 * forward for performance reasons. When the second pod
-		 * is involved (either alone, or in combination with the
-		 * first pod), then the received bytes need to be put
-		 * into memory in such a layout that all channel groups
-		 * get combined, and a unitsize larger than a single byte
-		 * applies. The "queue" logic transparently copes with
-		 * any such configuration. This works around the lack
-		 * of support for "meaning" to logic data, which is used
-		 * above for analog data.
+		 * When the second pod is involved (either alone, or in
+		 * combination with the first pod), then the received bytes
+		 * need to be put into memory in such a layout that all
+		 * channel groups get combined, and a unitsize larger than
+		 * a single byte applies. The "queue" logic transparently
+		 * copes with any such configuration. This works around the
+		 * lack of support for "meaning" to logic data, which is
+		 * used above for analog data.
 		 */
-		if (devc->pod_count == 1) {
-			packet.type = SR_DF_LOGIC;
-			logic.data = data->data;
-			logic.length = data->len;
-			/* Truncate acquisition if a smaller number of samples has been requested. */
-			if (devc->samples_limit > 0 && logic.length > devc->samples_limit)
-				logic.length = devc->samples_limit;
-			logic.unitsize = 1;
-			packet.payload = &logic;
-			sr_session_send(sdi, &packet);
-		} else {
-			group = ch->index / DIGITAL_CHANNELS_PER_POD;
-			hmo_queue_logic_data(devc, group, data);
-		}
+		group = ch->index / DIGITAL_CHANNELS_PER_POD;
+		hmo_queue_logic_data(devc, group, data);
 
 		devc->num_samples = data->len / devc->pod_count;
 		g_byte_array_free(data, TRUE);
@@ -1621,5 +1685,19 @@ SR_PRIV int hmo_receive_data(int fd, int revents, void *cb_data)
 		hmo_request_data(sdi);
 	}
 
+	return TRUE;
+
+abort:
+	/*
+	 * Data of the current frame may already have been sent, at least
+	 * partially. Terminate the frame and stop the acquisition, instead
+	 * of leaving the frame open and the source waiting for data which
+	 * never gets requested.
+	 */
+	sr_err("Cannot read waveform data, stopping acquisition.");
+	hmo_cleanup_logic_data(devc);
+	std_session_send_df_frame_end(sdi);
+	sr_dev_acquisition_stop(sdi);
+
 	return TRUE;
 }
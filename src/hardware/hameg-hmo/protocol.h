@@ -36,6 +36,9 @@
 #define MAX_DIGITAL_CHANNEL_COUNT	16
 #define MAX_DIGITAL_GROUP_COUNT		2
 
+/* Receive window for waveform data, see sr_scpi_read_block(). */
+#define HMO_BLOCK_BUFSIZE		(64 * 1024)
+
 struct scope_config {
 	const char *name[MAX_INSTRUMENT_VERSIONS];
 	const uint8_t analog_channels;
@@ -131,6 +134,9 @@ struct dev_context {
 
 	size_t pod_count;
 	GByteArray *logic_data;
+
+	uint8_t *block_buf;
+	uint64_t block_samples;
 };
 
 SR_PRIV int hmo_init_device(struct sr_dev_inst *sdi);
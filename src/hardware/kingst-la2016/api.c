@@ -1041,7 +1041,9 @@ static int dev_acquisition_start(const struct sr_dev_inst *sdi)
 	struct drv_context *drvc;
 	struct sr_context *ctx;
 	struct dev_context *devc;
+	struct sr_trigger *trigger;
 	size_t unitsize, xfersize, repsize, seqsize;
+	uint64_t pre_trigger_samples;
 	double voltage;
 	int ret;
 
@@ -1075,6 +1077,40 @@ static int dev_acquisition_start(const struct sr_dev_inst *sdi)
 			sr_err("Cannot allocate buffer for session feed.");
 			return SR_ERR_MALLOC;
 		}
+		/*
+		 * Stream mode has no hardware trigger, check a soft
+		 * trigger in the session feed instead.
+		 */
+		trigger = sr_session_trigger_get(sdi->session);
+		if (devc->continuous && trigger && trigger->stages) {
+			pre_trigger_samples = 0;
+			if (devc->sw_limits.limit_samples)
+				pre_trigger_samples = devc->sw_limits.limit_samples *
+					devc->capture_ratio / 100;
+			devc->stl = soft_trigger_logic_new(sdi, trigger,
+				(int)pre_trigger_samples);
+			if (!devc->stl) {
+				feed_queue_logic_free(devc->feed_queue);
+				devc->feed_queue = NULL;
+				return SR_ERR_MALLOC;
+			}
+			feed_queue_logic_set_soft_trigger(devc->feed_queue,
+				devc->stl);
+		}
+		/*
+		 * Capture memory holds pairs of sample values and their
+		 * repetition counts. Pass these runs on without expanding
+		 * them. Streamed data is not compressed, but gets coalesced
+		 * into runs when a soft trigger checks it, which then scans
+		 * the runs instead of all samples.
+		 */
+		if (!devc->continuous || devc->stl) {
+			ret = feed_queue_logic_set_rle(devc->feed_queue, TRUE);
+			if (ret != SR_OK) {
+				la2016_feed_queue_free(sdi);
+				return ret;
+			}
+		}
 		devc->transfer_size = xfersize;
 		devc->sequence_size = seqsize;
 		devc->packets_per_chunk = xfersize;
@@ -1087,16 +1123,14 @@ static int dev_acquisition_start(const struct sr_dev_inst *sdi)
 	voltage = threshold_voltage(sdi, NULL);
 	ret = la2016_setup_acquisition(sdi, voltage);
 	if (ret != SR_OK) {
-		feed_queue_logic_free(devc->feed_queue);
-		devc->feed_queue = NULL;
+		la2016_feed_queue_free(sdi);
 		return ret;
 	}
 
 	ret = la2016_start_acquisition(sdi);
 	if (ret != SR_OK) {
 		la2016_abort_acquisition(sdi);
-		feed_queue_logic_free(devc->feed_queue);
-		devc->feed_queue = NULL;
+		la2016_feed_queue_free(sdi);
 		return ret;
 	}
 
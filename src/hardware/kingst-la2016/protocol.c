@@ -28,6 +28,7 @@
 
 #include "libsigrok-internal.h"
 #include "protocol.h"
+#include "transpose.h"
 
 /* USB PID dependent MCU firmware. Model dependent FPGA bitstream. */
 #define MCU_FWFILE_FMT	"kingst-la-%04x.fw"
@@ -581,7 +582,7 @@ static void la2016_prepare_stream(const struct sr_dev_inst *sdi)
 			continue;
 		channel_mask = 1UL << ch->index;
 		stream->enabled_mask |= channel_mask;
-		stream->channel_masks[stream->enabled_count++] = channel_mask;
+		stream->channel_rows[stream->enabled_count++] = ch->index;
 	}
 	stream->channel_index = 0;
 }
@@ -676,9 +677,8 @@ static int set_trigger_config(const struct sr_dev_inst *sdi)
 	 * Don't configure hardware trigger parameters in streaming mode
 	 * or when the device lacks local memory. Yet the above dump of
 	 * derived parameters from user specs is considered valueable.
-	 *
-	 * TODO Add support for soft triggers when hardware triggers in
-	 * the device are not used or are not available at all.
+	 * Stream mode (which memory-less devices always use) checks a
+	 * soft trigger instead.
 	 */
 	if (!devc->model->memory_bits || devc->continuous) {
 		if (!devc->model->memory_bits)
@@ -1452,11 +1452,13 @@ static void send_chunk(struct sr_dev_inst *sdi,
  * Implementor's note: This routine is inspired by convert_sample_data()
  * in the https://github.com/AlexUg/sigrok implementation. Which in turn
  * appears to have been derived from the saleae-logic16 sigrok driver.
- * The code is phrased conservatively to verify the layout as discussed
- * above, performance was not a priority. Operation was verified with an
- * LA2016 device. The LA5032 reportedly shares the 16 samples per channel
- * layout, just round-robins through a potentially larger set of enabled
- * channels before returning to the first of the channels.
+ * Operation was verified with an LA2016 device. The LA5032 reportedly
+ * shares the 16 samples per channel layout, just round-robins through
+ * a potentially larger set of enabled channels before returning to the
+ * first of the channels.
+ *
+ * The entities of all channels form a bit matrix, one row per channel,
+ * one column per sample. Transposing that matrix yields the samples.
  */
 static void stream_data(struct sr_dev_inst *sdi,
 	const uint8_t *data_buffer, size_t data_length)
@@ -1465,10 +1467,11 @@ static void stream_data(struct sr_dev_inst *sdi,
 	struct stream_state_t *stream;
 	size_t bit_count;
 	const uint8_t *rp;
-	uint32_t sample_value;
-	uint8_t sample_buff[sizeof(sample_value)];
+	uint32_t samples32[16];
+	uint16_t samples16[16];
+	uint8_t sample_buff[16 * sizeof(uint32_t)];
+	uint8_t *wp;
 	size_t bit_idx;
-	uint32_t ch_mask;
 
 	devc = sdi->priv;
 	stream = &devc->stream;
@@ -1479,24 +1482,15 @@ static void stream_data(struct sr_dev_inst *sdi,
 	sr_dbg("Stream mode, got another chunk: %p, length %zu.",
 		data_buffer, data_length);
 
-	/* TODO Add soft trigger support when in stream mode? */
-
 	/* All channels' chunks carry 16 samples for one channel. */
 	bit_count = 16;
 	data_length /= sizeof(uint16_t);
 
 	rp = data_buffer;
-	sample_value = 0;
 	while (data_length--) {
-		/* Get another entity. */
-		sample_value = read_u16le_inc(&rp);
-
-		/* Map the entity's bits to a channel's samples. */
-		ch_mask = stream->channel_masks[stream->channel_index];
-		for (bit_idx = 0; bit_idx < bit_count; bit_idx++) {
-			if (sample_value & (1UL << bit_idx))
-				stream->sample_data[bit_idx] |= ch_mask;
-		}
+		/* Get another entity, it's the channel's matrix row. */
+		stream->channel_data[stream->channel_rows[stream->channel_index]] =
+			read_u16le_inc(&rp);
 
 		/*
 		 * Advance to the next channel. Submit a block of
@@ -1505,15 +1499,27 @@ static void stream_data(struct sr_dev_inst *sdi,
 		stream->channel_index++;
 		if (stream->channel_index != stream->enabled_count)
 			continue;
-		for (bit_idx = 0; bit_idx < bit_count; bit_idx++) {
-			sample_value = stream->sample_data[bit_idx];
-			write_u32le(sample_buff, sample_value);
-			feed_queue_logic_submit_one(devc->feed_queue,
-				sample_buff, 1);
+		wp = sample_buff;
+		if (devc->model->channel_count > 16) {
+			sr_transpose_32x16(samples32, stream->channel_data);
+			for (bit_idx = 0; bit_idx < bit_count; bit_idx++)
+				write_u32le_inc(&wp, samples32[bit_idx]);
+		} else {
+			sr_transpose_16x16(samples16, stream->channel_data);
+			for (bit_idx = 0; bit_idx < bit_count; bit_idx++)
+				write_u16le_inc(&wp, samples16[bit_idx]);
 		}
-		sr_sw_limits_update_samples_read(&devc->sw_limits, bit_count);
+		feed_queue_logic_submit_many(devc->feed_queue,
+			sample_buff, bit_count);
+		/*
+		 * With a soft trigger the limit counts from the trigger
+		 * on. Samples which are queued when it fires are not
+		 * counted.
+		 */
+		if (feed_queue_logic_triggered(devc->feed_queue))
+			sr_sw_limits_update_samples_read(&devc->sw_limits,
+				bit_count);
 		devc->total_samples += bit_count;
-		memset(stream->sample_data, 0, sizeof(stream->sample_data));
 		stream->channel_index = 0;
 	}
 
@@ -1695,8 +1701,7 @@ SR_PRIV int la2016_receive_data(int fd, int revents, void *cb_data)
 		libusb_handle_events_timeout(drvc->sr_ctx->libusb_ctx, &tv);
 
 		feed_queue_logic_flush(devc->feed_queue);
-		feed_queue_logic_free(devc->feed_queue);
-		devc->feed_queue = NULL;
+		la2016_feed_queue_free(sdi);
 		if (devc->frame_begin_sent) {
 			std_session_send_df_frame_end(sdi);
 			devc->frame_begin_sent = FALSE;
@@ -1923,6 +1928,21 @@ SR_PRIV void la2016_release_resources(const struct sr_dev_inst *sdi)
 	(void)la2016_usbxfer_release(sdi);
 }
 
+/* Release the session feed queue, and its soft trigger if any. */
+SR_PRIV void la2016_feed_queue_free(const struct sr_dev_inst *sdi)
+{
+	struct dev_context *devc;
+
+	devc = sdi->priv;
+
+	feed_queue_logic_free(devc->feed_queue);
+	devc->feed_queue = NULL;
+	if (devc->stl) {
+		soft_trigger_logic_free(devc->stl);
+		devc->stl = NULL;
+	}
+}
+
 SR_PRIV int la2016_write_pwm_config(const struct sr_dev_inst *sdi, size_t idx)
 {
 	return set_pwm_config(sdi, idx);
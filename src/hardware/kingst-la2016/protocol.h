@@ -157,14 +157,15 @@ struct dev_context {
 	uint32_t read_pos;
 
 	struct feed_queue_logic *feed_queue;
+	struct soft_trigger_logic *stl;
 	GSList *transfers;
 	size_t transfer_bufsize;
 	struct stream_state_t {
 		size_t enabled_count;
 		uint32_t enabled_mask;
-		uint32_t channel_masks[32];
+		uint8_t channel_rows[32];
 		size_t channel_index;
-		uint32_t sample_data[32];
+		uint16_t channel_data[32];
 		uint64_t flush_period_ms;
 		uint64_t last_flushed;
 	} stream;
@@ -183,5 +184,6 @@ SR_PRIV int la2016_start_acquisition(const struct sr_dev_inst *sdi);
 SR_PRIV int la2016_abort_acquisition(const struct sr_dev_inst *sdi);
 SR_PRIV int la2016_receive_data(int fd, int revents, void *cb_data);
 SR_PRIV void la2016_release_resources(const struct sr_dev_inst *sdi);
+SR_PRIV void la2016_feed_queue_free(const struct sr_dev_inst *sdi);
 
 #endif
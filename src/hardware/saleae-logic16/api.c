@@ -578,17 +578,7 @@ static int configure_channels(const struct sr_dev_inst *sdi)
 		channel_bit = 1 << (ch->index);
 
 		devc->cur_channels |= channel_bit;
-
-#ifdef WORDS_BIGENDIAN
-		/*
-		 * Output logic data should be stored in little endian format.
-		 * To speed things up during conversion, do the switcharoo
-		 * here instead.
-		 */
-		channel_bit = 1 << (ch->index ^ 8);
-#endif
-
-		devc->channel_masks[devc->num_channels++] = channel_bit;
+		devc->channel_rows[devc->num_channels++] = ch->index;
 	}
 
 	return SR_OK;
@@ -30,6 +30,7 @@
 #include <libsigrok/libsigrok.h>
 #include "libsigrok-internal.h"
 #include "protocol.h"
+#include "transpose.h"
 
 #define FPGA_FIRMWARE_18	"saleae-logic16-fpga-18.bitstream"
 #define FPGA_FIRMWARE_33	"saleae-logic16-fpga-33.bitstream"
@@ -803,13 +804,19 @@ static void resubmit_transfer(struct libusb_transfer *transfer)
 	sr_err("%s: %s", __func__, libusb_error_name(ret));
 }
 
+/*
+ * The device sends one 16bit word per enabled channel in turn, which
+ * holds 16 samples of that channel, the most significant bit was
+ * sampled first. The words of all channels form a bit matrix, which
+ * gets transposed to get the samples.
+ */
 static size_t convert_sample_data(struct dev_context *devc,
 		uint8_t *dest, size_t destcnt, const uint8_t *src, size_t srccnt)
 {
 	uint16_t *channel_data;
+	uint16_t samples[16];
 	int i, cur_channel;
 	size_t ret = 0;
-	uint16_t sample, channel_mask;
 
 	srccnt /= 2;
 
@@ -817,14 +824,8 @@ static size_t convert_sample_data(struct dev_context *devc,
 	cur_channel = devc->cur_channel;
 
 	while (srccnt--) {
-		sample = src[0] | (src[1] << 8);
-		src += 2;
-
-		channel_mask = devc->channel_masks[cur_channel];
-
-		for (i = 15; i >= 0; --i, sample >>= 1)
-			if (sample & 1)
-				channel_data[i] |= channel_mask;
+		channel_data[devc->channel_rows[cur_channel]] =
+			read_u16le_inc(&src);
 
 		if (++cur_channel == devc->num_channels) {
 			cur_channel = 0;
@@ -832,9 +833,9 @@ static size_t convert_sample_data(struct dev_context *devc,
 				sr_err("Conversion buffer too small!");
 				break;
 			}
-			memcpy(dest, channel_data, 16 * 2);
-			memset(channel_data, 0, 16 * 2);
-			dest += 16 * 2;
+			sr_transpose_16x16(samples, channel_data);
+			for (i = 15; i >= 0; i--)
+				write_u16le_inc(&dest, samples[i]);
 			ret += 16;
 			destcnt -= 16 * 2;
 		}
@@ -79,7 +79,9 @@ struct dev_context {
 	int empty_transfer_count;
 	int num_channels;
 	int cur_channel;
-	uint16_t channel_masks[16];
+	/* Matrix row of each enabled channel, i.e. its index. */
+	uint8_t channel_rows[16];
+	/* One row of 16 samples per channel, see convert_sample_data(). */
 	uint16_t channel_data[16];
 	uint8_t *convbuffer;
 	size_t convbuffer_size;
@@ -22,9 +22,14 @@
  */
 
 #include <config.h>
+#include <errno.h>
+#include <fcntl.h>
 #include <stdlib.h>
 #include <string.h>
 #include <math.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
 #include <libsigrok/libsigrok.h>
 #include "libsigrok-internal.h"
 #include "protocol.h"
@@ -47,8 +52,8 @@ static const uint32_t drvopts[] = {
 static const uint32_t devopts[] = {
 	SR_CONF_CONTINUOUS,
 	SR_CONF_LIMIT_SAMPLES  | SR_CONF_GET | SR_CONF_SET,
-//	SR_CONF_LIMIT_MSEC     | SR_CONF_GET | SR_CONF_SET,
-//	SR_CONF_LIMIT_FRAMES   | SR_CONF_GET | SR_CONF_SET,
+	SR_CONF_LIMIT_MSEC     | SR_CONF_GET | SR_CONF_SET,
+	SR_CONF_LIMIT_FRAMES   | SR_CONF_GET | SR_CONF_SET,
 	SR_CONF_SAMPLERATE     | SR_CONF_GET | SR_CONF_SET | SR_CONF_LIST,
 	SR_CONF_TRIGGER_SOURCE | SR_CONF_GET | SR_CONF_SET | SR_CONF_LIST,
 	SR_CONF_TRIGGER_SLOPE  | SR_CONF_GET | SR_CONF_SET | SR_CONF_LIST,
@@ -109,9 +114,11 @@ static GSList *scan(struct sr_dev_driver *di, GSList *options)
 	sdi->model = g_strdup("ScopeIO device");
 
 	devc = g_malloc0(sizeof(struct dev_context));
+	devc->sockfd = -1;
 	devc->cur_samplerate = samplerates[0];
 	devc->num_analog_channels = num_analog_channels;
-	devc->limit_frames = limit_frames;
+	sr_sw_limits_init(&devc->limits);
+	devc->limits.limit_frames = limit_frames;
 	devc->capture_ratio = 20;
 	strcpy(devc->trigger_slope, "POS");
 
@@ -203,11 +210,8 @@ static int config_get(
 		*data = g_variant_new_uint64(-1);
 		break;
 	case SR_CONF_LIMIT_MSEC:
-		*data = g_variant_new_uint64(-1);
-		break;
 	case SR_CONF_LIMIT_FRAMES:
-		*data = g_variant_new_uint64(devc->limit_frames);
-		break;
+		return sr_sw_limits_config_get(&devc->limits, key, data);
 	case SR_CONF_MEASURED_QUANTITY:
 		/* Any channel in the group will do. */
 		ch = cg->channels->data;
@@ -263,10 +267,8 @@ static int config_set(
 	case SR_CONF_LIMIT_SAMPLES:
 		break;
 	case SR_CONF_LIMIT_MSEC:
-		break;
 	case SR_CONF_LIMIT_FRAMES:
-		devc->limit_frames = g_variant_get_uint64(data);
-		break;
+		return sr_sw_limits_config_set(&devc->limits, key, data);
 	case SR_CONF_MEASURED_QUANTITY:
 		for (l = cg->channels; l; l = l->next) {
 			ch = l->data;
@@ -346,53 +348,80 @@ static int config_list(
 
 static int dev_acquisition_start(const struct sr_dev_inst *sdi)
 {
-	sr_session_source_add(sdi->session, -1, 0, 100, scopeio_prepare_data, (struct sr_dev_inst *) sdi);
+	struct dev_context *devc;
+	uint8_t discard[SCOPEIO_REPLY_SIZE];
+
+	devc = sdi->priv;
+
+	/* Drop stale replies of a previous acquisition. */
+	while (recv(devc->sockfd, discard, sizeof(discard), 0) > 0)
+		;
+
 	std_session_send_df_header(sdi);
-	return SR_OK;
+
+	devc->pollfd.fd = devc->sockfd;
+	devc->pollfd.events = G_IO_IN | G_IO_ERR;
+	devc->pollfd.revents = 0;
+	sr_session_source_add_pollfd(sdi->session, &devc->pollfd,
+		SCOPEIO_RETRANSMIT_MS / 2, scopeio_receive_data,
+		(struct sr_dev_inst *)sdi);
+
+	return scopeio_acquisition_start(sdi);
 }
 
 static int dev_acquisition_stop(struct sr_dev_inst *sdi)
 {
 	struct dev_context *devc;
 
-	sr_session_source_remove(sdi->session, -1);
-
 	devc = sdi->priv;
-	if (devc->limit_frames > 0)
-		std_session_send_df_frame_end(sdi);
 
-	std_session_send_df_end(sdi);
+	sr_session_source_remove_pollfd(sdi->session, &devc->pollfd);
+	scopeio_acquisition_stop(sdi);
 
+	std_session_send_df_end(sdi);
 
 	return SR_OK;
 }
 
-#include <stdio.h>
-#include <stdlib.h>
-#include <string.h>
-#include <arpa/inet.h>
-#include <unistd.h>
-
-#define PORT 8080
-
 static int dev_open(struct sr_dev_inst *sdi)
 {
-	(void) sdi;
-	if ((scopeio_sockfd = socket(AF_INET, SOCK_DGRAM, 0)) < 0) {
-		sr_err("Socket creation failed");
+	struct dev_context *devc;
+	int flags;
+
+	devc = sdi->priv;
+
+	if ((devc->sockfd = socket(AF_INET, SOCK_DGRAM, 0)) < 0) {
+		sr_err("Socket creation failed: %s.", g_strerror(errno));
 		return SR_ERR;
 	}
-	memset(&scopeio_server_addr, 0, sizeof(scopeio_server_addr));
-	scopeio_server_addr.sin_family = AF_INET; // IPv4
-	scopeio_server_addr.sin_port = htons(PORT);
-	scopeio_server_addr.sin_addr.s_addr = INADDR_ANY;
+
+	/* The session loop must never block on the network. */
+	flags = fcntl(devc->sockfd, F_GETFL, 0);
+	if (flags < 0 || fcntl(devc->sockfd, F_SETFL, flags | O_NONBLOCK) < 0) {
+		sr_err("Cannot make socket non-blocking: %s.", g_strerror(errno));
+		close(devc->sockfd);
+		devc->sockfd = -1;
+		return SR_ERR;
+	}
+
+	memset(&devc->server_addr, 0, sizeof(devc->server_addr));
+	devc->server_addr.sin_family = AF_INET; // IPv4
+	devc->server_addr.sin_port = htons(SCOPEIO_PORT);
+	devc->server_addr.sin_addr.s_addr = INADDR_ANY;
 
 	return SR_OK;
 }
 
 static int dev_close(struct sr_dev_inst *sdi)
 {
-	(void) sdi;
+	struct dev_context *devc;
+
+	devc = sdi->priv;
+
+	if (devc->sockfd >= 0)
+		close(devc->sockfd);
+	devc->sockfd = -1;
+
 	return SR_OK;
 }
 
@@ -22,9 +22,12 @@
  */
 
 #include <config.h>
+#include <errno.h>
 #include <stdlib.h>
 #include <string.h>
 #include <math.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
 #include <libsigrok/libsigrok.h>
 #include "libsigrok-internal.h"
 #include "protocol.h"
@@ -42,9 +45,6 @@ SR_PRIV const char *scopeio_analog_pattern_str[] = {
 	"GP17",
 };
 
-SR_PRIV int scopeio_sockfd;
-SR_PRIV struct sockaddr_in scopeio_server_addr;
-
 // SR_PRIV void scopeio_free_analog_pattern(struct dev_context *devc)
 // {
 	// g_free(devc->analog_patterns[GN14]);
@@ -57,131 +57,229 @@ SR_PRIV struct sockaddr_in scopeio_server_addr;
 	// g_free(devc->analog_patterns[GP17]);
 // }
 
+/* Sample memory holds 13 bit ADC codes of a 3.3 V full scale range. */
+#define SAMPLE_MASK	((1U << SCOPEIO_SAMPLE_WIDTH) - 1)
+#define SAMPLE_VOLTS	(3.3f / 4096.0f)
+
+static void scopeio_decoder_reset(struct scopeio_decoder *dec)
+{
+	dec->bits = 0;
+	dec->num_bits = 0;
+	dec->channel = 0;
+	memset(dec->num_samples, 0, sizeof(dec->num_samples));
+}
+
+/* Emit all complete samples which are held in the bit buffer. */
+static void scopeio_decode_bits(struct scopeio_decoder *dec)
+{
+	unsigned int sample, ch;
+
+	while (dec->num_bits >= SCOPEIO_SAMPLE_WIDTH) {
+		dec->num_bits -= SCOPEIO_SAMPLE_WIDTH;
+		sample = (dec->bits >> dec->num_bits) & SAMPLE_MASK;
+		ch = dec->channel;
+		if (dec->num_samples[ch] < SCOPEIO_CHANNEL_SAMPLES)
+			dec->samples[ch][dec->num_samples[ch]++] =
+				sample * SAMPLE_VOLTS;
+		if (++dec->channel == SCOPEIO_CHANNELS)
+			dec->channel = 0;
+	}
+}
+
 /*
- * Fixup a memory image of generated logic data before it gets sent to
- * the session's datafeed. Mask out content from disabled channels.
- *
- * TODO: Need we apply a channel map, and enforce a dense representation
- * of the enabled channels' data?
+ * Feed sample memory bytes to the decoder. Takes 32 bits at a time, the
+ * buffer never holds more than 12 leftover bits before a refill.
  */
+static void scopeio_decode_data(struct scopeio_decoder *dec,
+		const uint8_t *data, size_t len)
+{
+	while (len >= sizeof(uint32_t)) {
+		dec->bits = (dec->bits << 32) | RB32(data);
+		dec->num_bits += 32;
+		data += sizeof(uint32_t);
+		len -= sizeof(uint32_t);
+		scopeio_decode_bits(dec);
+	}
+	while (len--) {
+		dec->bits = (dec->bits << 8) | *data++;
+		dec->num_bits += 8;
+		scopeio_decode_bits(dec);
+	}
+}
 
-#include <stdio.h>
-#include <stdlib.h>
-#include <string.h>
-#include <arpa/inet.h>
-#include <unistd.h>
+/*
+ * Request one block of sample memory. Each request carries a new tag,
+ * which the device repeats in every datagram of its reply. A failed
+ * send is not fatal, the block then gets re-requested when its reply
+ * does not arrive in time.
+ */
+static void scopeio_request_block(struct dev_context *devc,
+		struct scopeio_capture *cap, size_t idx)
+{
+	struct scopeio_block *block;
+	uint8_t rqst_buff[20];
+	uint8_t *rqst_ptr;
+	uint32_t addr;
+	ssize_t ret;
+
+	block = &cap->blocks[idx];
+	block->tag = devc->next_tag++;
+
+	rqst_ptr = rqst_buff + sizeof(uint16_t);
+	*rqst_ptr++ = 0x19;
+	*rqst_ptr++ = 0x01;
+	*rqst_ptr++ = block->tag >> 8;
+	*rqst_ptr++ = block->tag;
+	*rqst_ptr++ = 0x17;
+	*rqst_ptr++ = 0x02;
+	*rqst_ptr++ = 0x00;
+	*rqst_ptr++ = (SCOPEIO_BLOCK_SIZE - 1) / 256;
+	*rqst_ptr++ = (SCOPEIO_BLOCK_SIZE - 1) % 256;
+	*rqst_ptr++ = 0x16;
+	*rqst_ptr++ = 0x03;
+	addr = (idx << 10) | 0x80000000;
+	*rqst_ptr++ = addr >> 24;
+	*rqst_ptr++ = addr >> 16;
+	*rqst_ptr++ = addr >> 8;
+	*rqst_ptr++ = addr;
+	WL16(rqst_buff, rqst_ptr - rqst_buff - sizeof(uint16_t));
+
+	ret = sendto(devc->sockfd, rqst_buff, rqst_ptr - rqst_buff, 0,
+		(const struct sockaddr *)&devc->server_addr,
+		sizeof(devc->server_addr));
+	if (ret < 0)
+		sr_dbg("Cannot send request for block %zu: %s.",
+			idx, g_strerror(errno));
+
+	/* Data of earlier requests for the block gets dropped. */
+	block->state = BLOCK_REQUESTED;
+	block->fill = 0;
+	memset(block->received, 0, sizeof(block->received));
+	block->sent_us = g_get_monotonic_time();
+}
 
-#define CHAR_WIDTH    8
-#define CHANNELS      8
-#define SAMPLE_WIDTH 13
+/* Keep SCOPEIO_WINDOW requests in flight. */
+static void scopeio_fill_window(struct dev_context *devc,
+		struct scopeio_capture *cap)
+{
+	size_t idx, in_flight;
 
-float *decode (float *samples, int id, const unsigned char *block, size_t length);
-static int acc  = 0;
-static int data = 0;
-static int j    = 0;
+	in_flight = 0;
+	for (idx = 0; idx < SCOPEIO_BLOCKS; idx++) {
+		if (cap->blocks[idx].state == BLOCK_REQUESTED)
+			in_flight++;
+	}
+	while (in_flight < SCOPEIO_WINDOW && cap->next_block < SCOPEIO_BLOCKS) {
+		scopeio_request_block(devc, cap, cap->next_block++);
+		in_flight++;
+	}
+}
 
-float *decode (float *samples, int id, const unsigned char *block, size_t length)
+/*
+ * Store the data records of a reply datagram. The datagram's tag and
+ * address records identify the request, and where its data goes. Data
+ * of requests which are done or superseded, and of earlier frames, gets
+ * dropped, as do duplicates.
+ */
+static void scopeio_receive_reply(struct dev_context *devc,
+		struct scopeio_capture *cap, const uint8_t *buf, size_t len)
 {
-	for (size_t i = 0; i < length; i++) {
-		unsigned int sample;
-
-		switch(*block++) {
-		case 0x18:
-			int length;
-			length = *block++;
-
-			for (int i = 0; i <= length; i++) {
-				data <<= CHAR_WIDTH;
-				data |= *block++;
-				acc += CHAR_WIDTH;
-				data &= ((1 << (SAMPLE_WIDTH+CHAR_WIDTH-1))-1);
-				if (acc >= SAMPLE_WIDTH) {
-					acc %= SAMPLE_WIDTH;
-					sample = data;
-					sample >>= acc;
-					sample &= (1 << SAMPLE_WIDTH)-1;
-					if (j == id) {
-						*samples++ = 3.3*(float)sample/4096.0;
-						// *samples++ = sample;
-						// fprintf(stderr,"================ %d\n", sample);
-					}
-					j = (j+1) % (ARRAY_SIZE(scopeio_analog_pattern_str));
-				}
+	struct scopeio_block *block;
+	const uint8_t *end;
+	size_t rec_len, idx, offset, pos, count;
+	uint32_t addr;
+	int tag;
+
+	end = buf + len;
+	tag = -1;
+	block = NULL;
+	idx = offset = 0;
+	while (buf + 2 <= end) {
+		rec_len = buf[1] + 1;
+		if (buf + 2 + rec_len > end)
+			rec_len = (size_t)(end - buf - 2);
+		if (buf[0] == 0x19 && rec_len == 2) {
+			tag = RB16(&buf[2]);
+		} else if (buf[0] == 0x16 && rec_len == 4) {
+			addr = RB32(&buf[2]) & 0x7fffffff;
+			idx = addr / SCOPEIO_BLOCK_SIZE;
+			offset = addr % SCOPEIO_BLOCK_SIZE;
+			block = NULL;
+			if (idx < SCOPEIO_BLOCKS && cap->blocks[idx].tag == tag &&
+					cap->blocks[idx].state == BLOCK_REQUESTED)
+				block = &cap->blocks[idx];
+			if (!block) {
+				/* Stale, or a duplicate. */
+				return;
+			}
+		} else if (buf[0] == 0x18 && block) {
+			count = MIN(rec_len, SCOPEIO_BLOCK_SIZE - offset);
+			memcpy(&cap->data[idx * SCOPEIO_BLOCK_SIZE + offset],
+				buf + 2, count);
+			for (pos = offset; pos < offset + count; pos++) {
+				if (block->received[pos / 64] & (1ULL << (pos % 64)))
+					continue;
+				block->received[pos / 64] |= 1ULL << (pos % 64);
+				block->fill++;
+				devc->rx_bytes++;
 			}
-			break;
-		default:
-			block += (*block + 2);
+			offset += count;
 		}
+		buf += rec_len + 2;
 	}
-	return samples;
-}
 
-#define BLOCK  1024
-#define BLOCKS 16
-static float values[BLOCKS*BLOCK];
-#define XXX ((6+BLOCK+2*BLOCK/256))
-static char unsigned data_buffer[BLOCKS*XXX];
- 
+	if (block && block->fill == SCOPEIO_BLOCK_SIZE) {
+		block->state = BLOCK_DONE;
+		cap->done_blocks++;
+	}
+}
 
-static void scopeio_xx(void);
-static void scopeio_xx(void)
+/* Re-request blocks which timed out. */
+static int scopeio_check_timeouts(struct dev_context *devc,
+		struct scopeio_capture *cap)
 {
-	unsigned char *data_ptr;
-	data_ptr = data_buffer;
-	for(int i = 0; i < BLOCKS; i++) {
-		static union { char byte[4]; int word; } hton;
-		static unsigned char rqst_buff[256];
-		static unsigned char *rqst_ptr;
-
-		rqst_ptr = rqst_buff+sizeof(short);
-    	*rqst_ptr++ = 0x17;
-    	*rqst_ptr++ = 0x02;
-    	*rqst_ptr++ = 0x00;
-    	*rqst_ptr++ = (BLOCK-1)/256;
-    	*rqst_ptr++ = (BLOCK-1)%256;
-    	*rqst_ptr++ = 0x16;
-    	*rqst_ptr++ = 0x03;
-		hton.word = htonl((i << 10));
-    	*rqst_ptr++ = hton.byte[0] | 0x80;
-    	*rqst_ptr++ = hton.byte[1];
-    	*rqst_ptr++ = hton.byte[2];
-    	*rqst_ptr++ = hton.byte[3];
-		*(short *)rqst_buff = rqst_ptr-rqst_buff-sizeof(short);
-
-		sendto(scopeio_sockfd, rqst_buff, rqst_ptr-rqst_buff, 0, (const struct sockaddr *)&scopeio_server_addr, sizeof(scopeio_server_addr));
-		socklen_t addr_len = sizeof(scopeio_server_addr);
-
-		int n;
-		for (int j = 0 ;  j < XXX; j += n) {
-			n = recvfrom(scopeio_sockfd, data_ptr, XXX-j, 0, (struct sockaddr *)&scopeio_server_addr, &addr_len);
-			data_ptr += n;
+	struct scopeio_block *block;
+	int64_t now;
+	size_t idx;
+
+	now = g_get_monotonic_time();
+	for (idx = 0; idx < SCOPEIO_BLOCKS; idx++) {
+		block = &cap->blocks[idx];
+		if (block->state != BLOCK_REQUESTED)
+			continue;
+		if (now - block->sent_us < 1000 * SCOPEIO_RETRANSMIT_MS)
+			continue;
+		if (block->retries++ == SCOPEIO_MAX_RETRIES) {
+			sr_err("No reply for block %zu.", idx);
+			return SR_ERR_TIMEOUT;
 		}
+		sr_dbg("Re-requesting block %zu.", idx);
+		devc->retransmits++;
+		scopeio_request_block(devc, cap, idx);
 	}
+
+	return SR_OK;
 }
 
 static void send_analog_packet(
 	struct analog_gen *ag,
 	struct sr_dev_inst *sdi)
 {
-	float *last = values;
-	acc  = 0;
-	data = 0;
-	j    = 0;
-
-	last = decode(values, ag->id, data_buffer, sizeof(data_buffer));
-		// fprintf(stderr,"================ %d\n", last-values);
-
 	struct sr_datafeed_packet packet;
 	struct dev_context *devc;
+	struct scopeio_decoder *dec;
 
 	if (!ag->ch || !ag->ch->enabled)
 		return;
 
 	devc = sdi->priv;
+	dec = &devc->decoder;
+
 	packet.type = SR_DF_ANALOG;
 	packet.payload = &ag->packet;
 
-	ag->packet.meaning->channels = g_slist_append(NULL, ag->ch);
+	if (!ag->packet.meaning->channels)
+		ag->packet.meaning->channels = g_slist_append(NULL, ag->ch);
 	ag->packet.meaning->mq = ag->mq;
 	ag->packet.meaning->mqflags = ag->mq_flags;
 
@@ -256,37 +354,133 @@ static void send_analog_packet(
 		ag->packet.meaning->unit = SR_UNIT_UNITLESS;
 
 	if (!devc->avg) {
-
-		ag->packet.data = values;
-
-		ag->packet.num_samples = last-values; //630;
+		ag->packet.data = dec->samples[ag->id];
+		ag->packet.num_samples = dec->num_samples[ag->id];
 		sr_session_send(sdi, &packet);
 
 		/* Whichever channel group gets there first. */
 	} 
 }
 
-/* Callback handling data */
-SR_PRIV int scopeio_prepare_data(int fd, int revents, void *cb_data)
+/* Start fetching a frame's blocks. */
+static void scopeio_capture_start(struct dev_context *devc,
+		struct scopeio_capture *cap)
+{
+	memset(cap->blocks, 0, sizeof(cap->blocks));
+	cap->next_block = 0;
+	cap->done_blocks = 0;
+	devc->fetch = cap;
+	scopeio_fill_window(devc, cap);
+}
+
+/* Decode a completed frame, and send it to the session. */
+static void scopeio_send_frame(struct sr_dev_inst *sdi,
+		struct scopeio_capture *cap)
 {
-	struct sr_dev_inst *sdi;
 	struct dev_context *devc;
 	GHashTableIter iter;
 	void *value;
 
+	devc = sdi->priv;
+
+	/* One pass over the capture de-interleaves all channels. */
+	scopeio_decoder_reset(&devc->decoder);
+	scopeio_decode_data(&devc->decoder, cap->data, sizeof(cap->data));
+
+	std_session_send_df_frame_begin(sdi);
+	g_hash_table_iter_init(&iter, devc->ch_ag);
+	while (g_hash_table_iter_next(&iter, NULL, &value))
+		send_analog_packet(value, sdi);
+	std_session_send_df_frame_end(sdi);
+}
+
+SR_PRIV int scopeio_acquisition_start(const struct sr_dev_inst *sdi)
+{
+	struct dev_context *devc;
+
+	devc = sdi->priv;
+
+	sr_sw_limits_acquisition_start(&devc->limits);
+	devc->acq_start_us = g_get_monotonic_time();
+	devc->num_frames = 0;
+	devc->rx_bytes = 0;
+	devc->retransmits = 0;
+	scopeio_capture_start(devc, &devc->captures[0]);
+
+	return SR_OK;
+}
+
+/* Report the achieved transfer and frame rates. */
+SR_PRIV void scopeio_acquisition_stop(const struct sr_dev_inst *sdi)
+{
+	struct dev_context *devc;
+	int64_t elapsed_us;
+
+	devc = sdi->priv;
+
+	elapsed_us = MAX(g_get_monotonic_time() - devc->acq_start_us, 1);
+	devc->throughput = devc->rx_bytes * G_USEC_PER_SEC / elapsed_us;
+	devc->frame_rate = (double)devc->num_frames * G_USEC_PER_SEC /
+		elapsed_us;
+	sr_info("%" PRIu64 " frames in %" PRId64 " us, %.1f frames/s, %"
+		PRIu64 " bytes/s, %" PRIu64 " retransmits.", devc->num_frames,
+		elapsed_us, devc->frame_rate, devc->throughput,
+		devc->retransmits);
+}
+
+/*
+ * Receive callback of the socket. Drains all pending replies without
+ * blocking, re-requests lost blocks, and keeps the request window
+ * filled. When a frame is complete, the next frame's requests get sent
+ * before the completed frame is decoded, so the device and the network
+ * stay busy while the host works.
+ */
+SR_PRIV int scopeio_receive_data(int fd, int revents, void *cb_data)
+{
+	struct sr_dev_inst *sdi;
+	struct dev_context *devc;
+	struct scopeio_capture *done;
+	uint8_t buf[2 * SCOPEIO_REPLY_SIZE];
+	ssize_t len;
+	gboolean last;
+
 	(void)fd;
-	(void)revents;
 
 	sdi = cb_data;
 	devc = sdi->priv;
 
-	scopeio_xx();
-	g_hash_table_iter_init(&iter, devc->ch_ag);
-	while (g_hash_table_iter_next(&iter, NULL, &value)) {
-		send_analog_packet(value, sdi);
+	if (revents & G_IO_IN) {
+		while ((len = recv(devc->sockfd, buf, sizeof(buf), 0)) > 0)
+			scopeio_receive_reply(devc, devc->fetch, buf, len);
+		if (len < 0 && errno != EAGAIN && errno != EWOULDBLOCK) {
+			sr_err("Cannot receive from socket: %s.", g_strerror(errno));
+			sr_dev_acquisition_stop(sdi);
+			return G_SOURCE_CONTINUE;
+		}
 	}
-	std_session_send_df_frame_begin(sdi);
-	sr_dev_acquisition_stop(sdi);
-	return G_SOURCE_CONTINUE;
 
+	if (scopeio_check_timeouts(devc, devc->fetch) != SR_OK) {
+		sr_dev_acquisition_stop(sdi);
+		return G_SOURCE_CONTINUE;
+	}
+	scopeio_fill_window(devc, devc->fetch);
+
+	if (devc->fetch->done_blocks < SCOPEIO_BLOCKS)
+		return G_SOURCE_CONTINUE;
+
+	done = devc->fetch;
+	devc->num_frames++;
+	sr_sw_limits_update_frames_read(&devc->limits, 1);
+	last = sr_sw_limits_check(&devc->limits);
+	if (!last) {
+		scopeio_capture_start(devc, done == &devc->captures[0] ?
+			&devc->captures[1] : &devc->captures[0]);
+	}
+
+	scopeio_send_frame(sdi, done);
+
+	if (last)
+		sr_dev_acquisition_stop(sdi);
+
+	return G_SOURCE_CONTINUE;
 }
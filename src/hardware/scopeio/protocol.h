@@ -25,6 +25,7 @@
 #define LIBSIGROK_HARDWARE_SCOPEIO_PROTOCOL_H
 
 #include <stdint.h>
+#include <netinet/in.h>
 #include <libsigrok/libsigrok.h>
 #include "libsigrok-internal.h"
 
@@ -43,6 +44,32 @@
 #define DEFAULT_ANALOG_AMPLITUDE		10
 #define DEFAULT_ANALOG_OFFSET			0.
 
+/* UDP port of the ScopeIO server. */
+#define SCOPEIO_PORT			8080
+/* Sample memory bytes per block request, and blocks per capture. */
+#define SCOPEIO_BLOCK_SIZE		1024
+#define SCOPEIO_BLOCKS			16
+/*
+ * Largest reply datagram: tag and address records, and data records of
+ * up to 256 bytes. Replies may be split across several datagrams, each
+ * of them starts with the request's tag and the address of its data.
+ */
+#define SCOPEIO_REPLY_SIZE \
+	(4 + 6 + SCOPEIO_BLOCK_SIZE + 2 * SCOPEIO_BLOCK_SIZE / 256)
+/* Number of block requests which are kept in flight. */
+#define SCOPEIO_WINDOW			4
+/* Re-request blocks which were not received within this time. */
+#define SCOPEIO_RETRANSMIT_MS		20
+#define SCOPEIO_MAX_RETRIES		10
+
+/* Sample memory layout: interleaved channels, packed MSB first. */
+#define SCOPEIO_CHANNELS		8
+#define SCOPEIO_SAMPLE_WIDTH		13
+/* Samples per channel in one capture. */
+#define SCOPEIO_CHANNEL_SAMPLES \
+	((SCOPEIO_BLOCKS * SCOPEIO_BLOCK_SIZE * 8 / SCOPEIO_SAMPLE_WIDTH + \
+	  SCOPEIO_CHANNELS - 1) / SCOPEIO_CHANNELS)
+
 enum analog_channel { GN14, GP14, GN15, GP15, GN16, GP16, GN17, GP17 };
 extern SR_PRIV const char *scopeio_analog_pattern_str[8];
 
@@ -54,10 +81,63 @@ struct analog_pattern {
 struct scopeio_devcontext {
 };
 
+enum scopeio_block_state {
+	BLOCK_IDLE,
+	BLOCK_REQUESTED,
+	BLOCK_DONE,
+};
+
+struct scopeio_block {
+	enum scopeio_block_state state;
+	/* Tag of the most recent request, replies to others get dropped. */
+	uint16_t tag;
+	/* Received bytes, and a bit per received byte against duplicates. */
+	size_t fill;
+	uint64_t received[SCOPEIO_BLOCK_SIZE / 64];
+	int64_t sent_us;
+	unsigned int retries;
+};
+
+/* De-interleaves the sample memory bit stream into per-channel buffers. */
+struct scopeio_decoder {
+	uint64_t bits;
+	unsigned int num_bits;
+	unsigned int channel;
+	size_t num_samples[SCOPEIO_CHANNELS];
+	float samples[SCOPEIO_CHANNELS][SCOPEIO_CHANNEL_SAMPLES];
+};
+
+/* Block transfers of one frame's sample memory. */
+struct scopeio_capture {
+	struct scopeio_block blocks[SCOPEIO_BLOCKS];
+	uint8_t data[SCOPEIO_BLOCKS * SCOPEIO_BLOCK_SIZE];
+	size_t next_block;
+	size_t done_blocks;
+};
+
 struct dev_context {
 	uint64_t cur_samplerate;
-	uint64_t limit_frames;
+	struct sr_sw_limits limits;
 	uint8_t logic_data[LOGIC_BUFSIZE];
+	/* Network */
+	int sockfd;
+	struct sockaddr_in server_addr;
+	GPollFD pollfd;
+	/*
+	 * Double buffered frames: the next frame gets fetched while the
+	 * completed one is decoded and sent.
+	 */
+	struct scopeio_capture captures[2];
+	struct scopeio_capture *fetch;
+	uint16_t next_tag;
+	int64_t acq_start_us;
+	uint64_t num_frames;
+	uint64_t rx_bytes;
+	uint64_t retransmits;
+	/* Achieved rates of the most recent acquisition. */
+	uint64_t throughput;
+	double frame_rate;
+	struct scopeio_decoder decoder;
 	/* Analog */
 	// struct analog_pattern *analog_patterns[ARRAY_SIZE(analog_pattern_str)];
 	char trigger_slope[16];
@@ -87,8 +167,8 @@ struct analog_gen {
 	unsigned int num_avgs; /* Number of samples averaged */
 };
 
-SR_PRIV int scopeio_prepare_data(int fd, int revents, void *cb_data);
-extern SR_PRIV int scopeio_sockfd;
-extern SR_PRIV struct sockaddr_in scopeio_server_addr;
+SR_PRIV int scopeio_acquisition_start(const struct sr_dev_inst *sdi);
+SR_PRIV void scopeio_acquisition_stop(const struct sr_dev_inst *sdi);
+SR_PRIV int scopeio_receive_data(int fd, int revents, void *cb_data);
 
 #endif
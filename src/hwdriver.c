@@ -237,6 +237,10 @@ static struct sr_key_info sr_key_info_config[] = {
 		"Probe factor", NULL},
 	{SR_CONF_ADC_POWERLINE_CYCLES, SR_T_FLOAT, "nplc",
 		"Number of ADC powerline cycles", NULL},
+	{SR_CONF_USB_TRANSFER_SIZE, SR_T_UINT64, "usb_transfer_size",
+		"USB transfer size", NULL},
+	{SR_CONF_USB_TRANSFER_DEPTH, SR_T_UINT64, "usb_transfer_depth",
+		"USB transfers in flight", NULL},
 
 	/* Acquisition modes, sample limiting */
 	{SR_CONF_LIMIT_MSEC, SR_T_UINT64, "limit_time",
@@ -66,13 +66,16 @@ static int init(struct sr_input *in, GHashTable *options)
 	return SR_OK;
 }
 
-static int process_buffer(struct sr_input *in)
+/*
+ * Send the whole samples in the given data, return the number of
+ * bytes which were consumed.
+ */
+static size_t send_samples(struct sr_input *in, const char *data, size_t len)
 {
 	struct sr_datafeed_packet packet;
 	struct sr_datafeed_logic logic;
 	struct context *inc;
-	gsize chunk_size, i;
-	int chunk;
+	size_t chunk_size, chunk, i;
 
 	inc = in->priv;
 	if (!inc->started) {
@@ -91,36 +94,66 @@ static int process_buffer(struct sr_input *in)
 	logic.unitsize = inc->unitsize;
 
 	/* Cut off at multiple of unitsize. */
-	chunk_size = in->buf->len / logic.unitsize * logic.unitsize;
+	chunk_size = len / logic.unitsize * logic.unitsize;
 
 	for (i = 0; i < chunk_size; i += chunk) {
-		logic.data = in->buf->str + i;
+		logic.data = (void *)(data + i);
 		chunk = MIN(CHUNK_SIZE, chunk_size - i);
 		chunk /= logic.unitsize;
 		chunk *= logic.unitsize;
 		logic.length = chunk;
 		sr_session_send(in->sdi, &packet);
 	}
-	g_string_erase(in->buf, 0, chunk_size);
+
+	return chunk_size;
+}
+
+static int process_buffer(struct sr_input *in)
+{
+	size_t used;
+
+	used = send_samples(in, in->buf->str, in->buf->len);
+	g_string_erase(in->buf, 0, used);
 
 	return SR_OK;
 }
 
 static int receive(struct sr_input *in, GString *buf)
 {
-	int ret;
-
-	g_string_append_len(in->buf, buf->str, buf->len);
+	struct context *inc;
+	const char *data;
+	size_t len, fill, used;
 
 	if (!in->sdi_ready) {
+		g_string_append_len(in->buf, buf->str, buf->len);
 		/* sdi is ready, notify frontend. */
 		in->sdi_ready = TRUE;
 		return SR_OK;
 	}
 
-	ret = process_buffer(in);
+	/*
+	 * Only data which does not make up whole samples needs to get
+	 * buffered. Flush what is pending (and complete a partial sample
+	 * from the new data), then send the caller's data in place. It
+	 * is not NUL terminated and may be read-only, which sample data
+	 * doesn't care about.
+	 */
+	inc = in->priv;
+	data = buf->str;
+	len = buf->len;
+	if (in->buf->len) {
+		process_buffer(in);
+		fill = MIN(len, (in->buf->len + inc->unitsize - 1) /
+			inc->unitsize * inc->unitsize - in->buf->len);
+		g_string_append_len(in->buf, data, fill);
+		process_buffer(in);
+		data += fill;
+		len -= fill;
+	}
+	used = send_samples(in, data, len);
+	g_string_append_len(in->buf, data + used, len - used);
 
-	return ret;
+	return SR_OK;
 }
 
 static int end(struct sr_input *in)
@@ -179,6 +179,7 @@ static int receive(struct sr_input *in, GString *buf)
 {
 	int ret;
 
+	/* The caller's chunk is not NUL terminated, and may be read-only. */
 	g_string_append_len(in->buf, buf->str, buf->len);
 
 	if (!in->sdi_ready) {
@@ -225,6 +225,7 @@ struct context {
 	const char *column_formats;
 	size_t column_want_count;
 	struct column_details *column_details;
+	char **column_texts;
 
 	/* Line number to start processing. */
 	size_t start_line;
@@ -612,6 +613,7 @@ static int make_column_details_from_format(const struct sr_input *in,
 	inc->analog_datafeed_digits = g_malloc0(inc->analog_channels * sizeof(inc->analog_datafeed_digits[0]));
 	inc->analog_datafeed_channels = g_malloc0(inc->analog_channels * sizeof(inc->analog_datafeed_channels[0]));
 	inc->column_details = g_malloc0_n(column_count, sizeof(inc->column_details[0]));
+	inc->column_texts = g_malloc0_n(column_count, sizeof(inc->column_texts[0]));
 	column_idx = channel_idx = analog_idx = 0;
 	channel_name = g_string_sized_new(64);
 	for (format_idx = 0; format_idx < format_count; format_idx++) {
@@ -772,6 +774,47 @@ static char **split_line(char *buf, struct context *inc)
 	return fields;
 }
 
+/**
+ * Splits a text line into the columns of interest, in place.
+ *
+ * @param[in] buf	The input text line to split, gets modified.
+ * @param[in] inc	The input module's context.
+ *
+ * @returns The number of columns found, at most the wanted count.
+ *
+ * This routine is used for data lines. It terminates the columns'
+ * text at the separators and stores references to them in the
+ * context's column table. Columns beyond the wanted count are not
+ * inspected.
+ */
+static size_t split_line_inplace(char *buf, struct context *inc)
+{
+	const char *delim;
+	size_t delim_len, count;
+	char *sep, *end;
+
+	delim = inc->delimiter->str;
+	delim_len = inc->delimiter->len;
+	count = 0;
+	while (count < inc->column_want_count) {
+		inc->column_texts[count++] = buf;
+		if (delim_len == 1)
+			sep = strchr(buf, delim[0]);
+		else
+			sep = strstr(buf, delim);
+		/* Strip trailing whitespace, like split_line() does. */
+		end = sep ? sep : buf + strlen(buf);
+		while (end > buf && g_ascii_isspace(end[-1]))
+			end--;
+		*end = '\0';
+		if (!sep)
+			break;
+		buf = sep + delim_len;
+	}
+
+	return count;
+}
+
 /**
  * Parse a multi-bit field into several logic channels.
  *
@@ -1530,13 +1573,13 @@ static int initial_receive(const struct sr_input *in)
 static int process_buffer(struct sr_input *in, gboolean is_eof)
 {
 	struct context *inc;
-	gsize num_columns;
-	size_t line_idx, col_idx, col_nr;
+	size_t num_columns, term_len;
+	size_t col_idx, col_nr;
 	const struct column_details *details;
 	col_parse_cb parse_func;
 	int ret;
 	char *processed_up_to;
-	char **lines, *line, **columns, *column;
+	char *line, *next_line, *column;
 
 	inc = in->priv;
 	if (!inc->started) {
@@ -1570,10 +1613,24 @@ static int process_buffer(struct sr_input *in, gboolean is_eof)
 		processed_up_to += strlen(inc->termination);
 	}
 
-	/* Split input text lines and process their columns. */
+	/*
+	 * Split input text lines and process their columns. Both happens
+	 * in place, text lines and columns get NUL terminated within the
+	 * receive buffer.
+	 */
 	ret = SR_OK;
-	lines = g_strsplit(in->buf->str, inc->termination, 0);
-	for (line_idx = 0; (line = lines[line_idx]); line_idx++) {
+	term_len = strlen(inc->termination);
+	line = in->buf->str[0] ? in->buf->str : NULL;
+	for (; line; line = next_line) {
+		if (term_len == 1)
+			next_line = strchr(line, inc->termination[0]);
+		else
+			next_line = strstr(line, inc->termination);
+		if (next_line) {
+			*next_line = '\0';
+			next_line += term_len;
+		}
+
 		inc->line_number++;
 		if (inc->line_number < inc->start_line) {
 			sr_spew("Line %zu skipped (before start).", inc->line_number);
@@ -1599,18 +1656,10 @@ static int process_buffer(struct sr_input *in, gboolean is_eof)
 		}
 
 		/* Split the line into columns, check for minimum length. */
-		columns = split_line(line, inc);
-		if (!columns) {
-			sr_err("Error while parsing line %zu.", inc->line_number);
-			g_strfreev(lines);
-			return SR_ERR;
-		}
-		num_columns = g_strv_length(columns);
+		num_columns = split_line_inplace(line, inc);
 		if (num_columns < inc->column_want_count) {
 			sr_err("Insufficient column count %zu in line %zu.",
 				num_columns, inc->line_number);
-			g_strfreev(columns);
-			g_strfreev(lines);
 			return SR_ERR;
 		}
 
@@ -1618,7 +1667,7 @@ static int process_buffer(struct sr_input *in, gboolean is_eof)
 		clear_logic_samples(inc);
 		clear_analog_samples(inc);
 		for (col_idx = 0; col_idx < inc->column_want_count; col_idx++) {
-			column = columns[col_idx];
+			column = inc->column_texts[col_idx];
 			col_nr = col_idx + 1;
 			details = lookup_column_details(inc, col_nr);
 			if (!details || !details->text_format)
@@ -1627,11 +1676,8 @@ static int process_buffer(struct sr_input *in, gboolean is_eof)
 			if (!parse_func)
 				continue;
 			ret = parse_func(column, inc, details);
-			if (ret != SR_OK) {
-				g_strfreev(columns);
-				g_strfreev(lines);
+			if (ret != SR_OK)
 				return SR_ERR;
-			}
 		}
 
 		/* Send sample data to the session bus (buffered). */
@@ -1639,14 +1685,9 @@ static int process_buffer(struct sr_input *in, gboolean is_eof)
 		ret += queue_analog_samples(in);
 		if (ret != SR_OK) {
 			sr_err("Sending samples failed.");
-			g_strfreev(columns);
-			g_strfreev(lines);
 			return SR_ERR;
 		}
-
-		g_strfreev(columns);
 	}
-	g_strfreev(lines);
 	g_string_erase(in->buf, 0, processed_up_to - in->buf->str);
 
 	return ret;
@@ -1657,6 +1698,10 @@ static int receive(struct sr_input *in, GString *buf)
 	struct context *inc;
 	int ret;
 
+	/*
+	 * Text gets parsed from in->buf, which is NUL terminated. The
+	 * caller's chunk is not, and may be read-only.
+	 */
 	g_string_append_len(in->buf, buf->str, buf->len);
 
 	inc = in->priv;
@@ -1724,6 +1769,8 @@ static void cleanup(struct sr_input *in)
 	/* TODO Release channel names (before releasing details). */
 	g_free(inc->column_details);
 	inc->column_details = NULL;
+	g_free(inc->column_texts);
+	inc->column_texts = NULL;
 
 	/* Clear internal state, but keep what .init() has provided. */
 	save_ctx = *inc;
@@ -21,16 +21,56 @@
 #include "libsigrok-internal.h"
 #include <string.h>
 
+/*
+ * Sample data gets written into packets from the session's buffer pool.
+ * Sent packets are not touched again, consumers which keep them only
+ * take a reference, and the buffers get re-used in steady state.
+ */
+static struct sr_packet_pool *feed_queue_pool(const struct sr_dev_inst *sdi)
+{
+	struct sr_packet_pool *pool;
+
+	pool = sdi ? sr_session_packet_pool(sdi) : NULL;
+	if (!pool)
+		return sr_packet_pool_new();
+
+	return sr_packet_pool_ref(pool);
+}
+
 struct feed_queue_logic {
 	const struct sr_dev_inst *sdi;
 	size_t unit_size;
 	size_t alloc_count;
 	size_t fill_count;
 	uint8_t *data_bytes;
+	struct sr_packet_pool *pool;
+	struct sr_datafeed_packet *pooled;
+	/* Run-length encoded mode, fill_count counts runs. */
+	gboolean rle;
+	uint64_t *run_lengths;
 	struct sr_datafeed_packet packet;
-	struct sr_datafeed_logic logic;
+	struct sr_datafeed_logic_rle logic_rle;
+	/* Soft trigger which data gets checked against before sending. */
+	struct soft_trigger_logic *stl;
+	gboolean triggered;
 };
 
+/* Get the next packet's buffer from the pool. */
+static int feed_queue_logic_get_buffer(struct feed_queue_logic *q)
+{
+	const struct sr_datafeed_logic *logic;
+
+	q->pooled = sr_packet_pool_logic_new(q->pool,
+		q->alloc_count * q->unit_size, q->unit_size);
+	if (!q->pooled)
+		return SR_ERR_MALLOC;
+	logic = q->pooled->payload;
+	q->data_bytes = logic->data;
+	q->logic_rle.values = q->data_bytes;
+
+	return SR_OK;
+}
+
 SR_API struct feed_queue_logic *feed_queue_logic_alloc(
 	const struct sr_dev_inst *sdi,
 	size_t sample_count, size_t unit_size)
@@ -41,38 +81,132 @@ SR_API struct feed_queue_logic *feed_queue_logic_alloc(
 	q->sdi = sdi;
 	q->unit_size = unit_size;
 	q->alloc_count = sample_count;
-	q->data_bytes = g_try_malloc(q->alloc_count * q->unit_size);
-	if (!q->data_bytes) {
+	q->pool = feed_queue_pool(sdi);
+	if (feed_queue_logic_get_buffer(q) != SR_OK) {
+		sr_packet_pool_unref(q->pool);
 		g_free(q);
 		return NULL;
 	}
 
-	memset(&q->packet, 0, sizeof(q->packet));
-	memset(&q->logic, 0, sizeof(q->logic));
-	q->packet.type = SR_DF_LOGIC;
-	q->packet.payload = &q->logic;
-	q->logic.unitsize = q->unit_size;
-	q->logic.data = q->data_bytes;
-
 	return q;
 }
 
-SR_API int feed_queue_logic_submit_one(struct feed_queue_logic *q,
+/*
+ * Have the queue send SR_DF_LOGIC_RLE packets. Submitted repetitions
+ * of sample values are kept as runs, and don't get expanded. Must be
+ * called while the queue is empty.
+ */
+SR_API int feed_queue_logic_set_rle(struct feed_queue_logic *q,
+	gboolean rle)
+{
+	if (!q || q->fill_count)
+		return SR_ERR_ARG;
+
+	if (rle && !q->run_lengths) {
+		q->run_lengths = g_try_malloc(q->alloc_count * sizeof(uint64_t));
+		if (!q->run_lengths)
+			return SR_ERR_MALLOC;
+	}
+	q->rle = rle;
+	if (rle) {
+		q->packet.type = SR_DF_LOGIC_RLE;
+		q->packet.payload = &q->logic_rle;
+		q->logic_rle.unitsize = q->unit_size;
+		q->logic_rle.values = q->data_bytes;
+		q->logic_rle.lengths = q->run_lengths;
+	}
+
+	return SR_OK;
+}
+
+/*
+ * Have the queue check a soft trigger before sending data. Data before
+ * the trigger's match only goes to the trigger's pre-trigger buffer,
+ * which gets sent when the trigger fires, along with the trigger
+ * marker. Later data passes unchecked. Run-length encoded data gets
+ * checked without expanding it. The caller keeps ownership of the
+ * trigger, NULL stops the checks. Must be called while the queue is
+ * empty.
+ */
+SR_API int feed_queue_logic_set_soft_trigger(struct feed_queue_logic *q,
+	struct soft_trigger_logic *stl)
+{
+	if (!q || q->fill_count)
+		return SR_ERR_ARG;
+
+	q->stl = stl;
+	q->triggered = FALSE;
+
+	return SR_OK;
+}
+
+/* Whether submitted data reaches the session, after the soft trigger. */
+SR_API gboolean feed_queue_logic_triggered(struct feed_queue_logic *q)
+{
+	if (!q)
+		return FALSE;
+
+	return !q->stl || q->triggered;
+}
+
+/* Extend the most recent run when the value repeats, or start a new run. */
+static int feed_queue_logic_submit_run(struct feed_queue_logic *q,
 	const uint8_t *data, size_t repeat_count)
 {
 	uint8_t *wrptr;
 	int ret;
 
+	if (!repeat_count)
+		return SR_OK;
+
+	if (q->fill_count) {
+		wrptr = &q->data_bytes[(q->fill_count - 1) * q->unit_size];
+		if (memcmp(wrptr, data, q->unit_size) == 0) {
+			q->run_lengths[q->fill_count - 1] += repeat_count;
+			return SR_OK;
+		}
+	}
+
+	if (q->fill_count == q->alloc_count) {
+		ret = feed_queue_logic_flush(q);
+		if (ret != SR_OK)
+			return ret;
+	}
 	wrptr = &q->data_bytes[q->fill_count * q->unit_size];
-	while (repeat_count--) {
-		memcpy(wrptr, data, q->unit_size);
-		wrptr += q->unit_size;
-		q->fill_count++;
+	memcpy(wrptr, data, q->unit_size);
+	q->run_lengths[q->fill_count] = repeat_count;
+	q->fill_count++;
+
+	return SR_OK;
+}
+
+SR_API int feed_queue_logic_submit_one(struct feed_queue_logic *q,
+	const uint8_t *data, size_t repeat_count)
+{
+	uint8_t *wrptr;
+	size_t space, copy_count;
+	int ret;
+
+	if (!q->pooled) {
+		ret = feed_queue_logic_get_buffer(q);
+		if (ret != SR_OK)
+			return ret;
+	}
+
+	if (q->rle)
+		return feed_queue_logic_submit_run(q, data, repeat_count);
+
+	while (repeat_count) {
+		space = q->alloc_count - q->fill_count;
+		copy_count = MIN(repeat_count, space);
+		wrptr = &q->data_bytes[q->fill_count * q->unit_size];
+		sr_samples_fill(wrptr, data, q->unit_size, copy_count);
+		repeat_count -= copy_count;
+		q->fill_count += copy_count;
 		if (q->fill_count == q->alloc_count) {
 			ret = feed_queue_logic_flush(q);
 			if (ret != SR_OK)
 				return ret;
-			wrptr = &q->data_bytes[0];
 		}
 	}
 
@@ -86,6 +220,22 @@ SR_API int feed_queue_logic_submit_many(struct feed_queue_logic *q,
 	size_t space, copy_count;
 	int ret;
 
+	if (!q->pooled) {
+		ret = feed_queue_logic_get_buffer(q);
+		if (ret != SR_OK)
+			return ret;
+	}
+
+	if (q->rle) {
+		while (samples_count--) {
+			ret = feed_queue_logic_submit_run(q, data, 1);
+			if (ret != SR_OK)
+				return ret;
+			data += q->unit_size;
+		}
+		return SR_OK;
+	}
+
 	wrptr = &q->data_bytes[q->fill_count * q->unit_size];
 	while (samples_count) {
 		space = q->alloc_count - q->fill_count;
@@ -108,20 +258,91 @@ SR_API int feed_queue_logic_submit_many(struct feed_queue_logic *q,
 	return SR_OK;
 }
 
+/*
+ * Check the queued runs for the soft trigger. Sends the runs from the
+ * trigger's position on when it fires, nothing otherwise.
+ */
+static int feed_queue_logic_check_rle(struct feed_queue_logic *q)
+{
+	struct sr_datafeed_packet packet;
+	struct sr_datafeed_logic_rle tail;
+	int64_t offset;
+	uint64_t skip;
+	size_t run;
+
+	offset = soft_trigger_logic_check_rle(q->stl, &q->logic_rle, NULL);
+	if (offset < -1)
+		return offset;
+	if (offset == -1)
+		return SR_OK;
+	q->triggered = TRUE;
+
+	skip = offset;
+	for (run = 0; run < q->fill_count; run++) {
+		if (skip < q->run_lengths[run])
+			break;
+		skip -= q->run_lengths[run];
+	}
+	if (run == q->fill_count)
+		return SR_OK;
+	q->run_lengths[run] -= skip;
+
+	tail.num_runs = q->fill_count - run;
+	tail.unitsize = q->unit_size;
+	tail.values = &q->data_bytes[run * q->unit_size];
+	tail.lengths = &q->run_lengths[run];
+	packet.type = SR_DF_LOGIC_RLE;
+	packet.payload = &tail;
+
+	return sr_session_send(q->sdi, &packet);
+}
+
 SR_API int feed_queue_logic_flush(struct feed_queue_logic *q)
 {
-	int ret;
+	struct sr_datafeed_logic *logic;
+	int offset, ret;
 
 	if (!q->fill_count)
 		return SR_OK;
 
-	q->logic.length = q->fill_count * q->unit_size;
-	ret = sr_session_send(q->sdi, &q->packet);
+	/* Run-length encoded data is small, and consumers copy it. */
+	if (q->rle) {
+		q->logic_rle.num_runs = q->fill_count;
+		if (q->stl && !q->triggered)
+			ret = feed_queue_logic_check_rle(q);
+		else
+			ret = sr_session_send(q->sdi, &q->packet);
+		if (ret != SR_OK)
+			return ret;
+		q->fill_count = 0;
+		return SR_OK;
+	}
+
+	logic = (struct sr_datafeed_logic *)q->pooled->payload;
+	logic->length = q->fill_count * q->unit_size;
+	if (q->stl && !q->triggered) {
+		offset = soft_trigger_logic_check(q->stl, logic->data,
+			logic->length, NULL);
+		if (offset < -1)
+			return offset;
+		if (offset == -1) {
+			/* Not triggered, the buffer gets re-used. */
+			q->fill_count = 0;
+			return SR_OK;
+		}
+		q->triggered = TRUE;
+		logic->data = (uint8_t *)logic->data + offset * q->unit_size;
+		logic->length -= offset * q->unit_size;
+	}
+	ret = sr_session_send(q->sdi, q->pooled);
+	sr_packet_unref(q->pooled);
+	q->pooled = NULL;
+	q->data_bytes = NULL;
+	q->fill_count = 0;
 	if (ret != SR_OK)
 		return ret;
-	q->fill_count = 0;
 
-	return SR_OK;
+	return feed_queue_logic_get_buffer(q);
 }
 
 SR_API int feed_queue_logic_send_trigger(struct feed_queue_logic *q)
@@ -145,7 +366,9 @@ SR_API void feed_queue_logic_free(struct feed_queue_logic *q)
 	if (!q)
 		return;
 
-	g_free(q->data_bytes);
+	g_free(q->run_lengths);
+	sr_packet_unref(q->pooled);
+	sr_packet_pool_unref(q->pool);
 	g_free(q);
 }
 
@@ -155,38 +378,51 @@ struct feed_queue_analog {
 	size_t fill_count;
 	float *data_values;
 	int digits;
-	struct sr_datafeed_packet packet;
-	struct sr_datafeed_analog analog;
+	struct sr_channel *channel;
+	struct sr_packet_pool *pool;
+	struct sr_datafeed_packet *pooled;
+	/* Templates for the packets' payload details. */
 	struct sr_analog_encoding encoding;
 	struct sr_analog_meaning meaning;
 	struct sr_analog_spec spec;
-	GSList *channels;
 };
 
+/* Get the next packet's buffer from the pool. */
+static int feed_queue_analog_get_buffer(struct feed_queue_analog *q)
+{
+	const struct sr_datafeed_analog *analog;
+
+	q->pooled = sr_packet_pool_analog_new(q->pool,
+		q->alloc_count, q->channel);
+	if (!q->pooled)
+		return SR_ERR_MALLOC;
+	analog = q->pooled->payload;
+	q->data_values = analog->data;
+
+	return SR_OK;
+}
+
 SR_API struct feed_queue_analog *feed_queue_analog_alloc(
 	const struct sr_dev_inst *sdi,
 	size_t sample_count, int digits, struct sr_channel *ch)
 {
 	struct feed_queue_analog *q;
+	struct sr_datafeed_analog analog;
 
 	q = g_malloc0(sizeof(*q));
 	q->sdi = sdi;
 	q->alloc_count = sample_count;
-	q->data_values = g_try_malloc(q->alloc_count * sizeof(float));
-	if (!q->data_values) {
+	q->digits = digits;
+	q->channel = ch;
+	q->pool = feed_queue_pool(sdi);
+	if (feed_queue_analog_get_buffer(q) != SR_OK) {
+		sr_packet_pool_unref(q->pool);
 		g_free(q);
 		return NULL;
 	}
-	q->digits = digits;
-	q->channels = g_slist_append(NULL, ch);
 
-	memset(&q->packet, 0, sizeof(q->packet));
-	sr_analog_init(&q->analog, &q->encoding, &q->meaning, &q->spec, digits);
-	q->packet.type = SR_DF_ANALOG;
-	q->packet.payload = &q->analog;
+	sr_analog_init(&analog, &q->encoding, &q->meaning, &q->spec, digits);
 	q->encoding.is_signed = TRUE;
-	q->meaning.channels = q->channels;
-	q->analog.data = q->data_values;
 
 	return q;
 }
@@ -233,10 +469,24 @@ SR_API int feed_queue_analog_scale_offset(struct feed_queue_analog *q,
 SR_API int feed_queue_analog_submit_one(struct feed_queue_analog *q,
 	float data, size_t repeat_count)
 {
+	size_t space, copy_count;
+	float *wrptr;
 	int ret;
 
-	while (repeat_count--) {
-		q->data_values[q->fill_count++] = data;
+	if (!q->pooled) {
+		ret = feed_queue_analog_get_buffer(q);
+		if (ret != SR_OK)
+			return ret;
+	}
+
+	while (repeat_count) {
+		space = q->alloc_count - q->fill_count;
+		copy_count = MIN(repeat_count, space);
+		wrptr = &q->data_values[q->fill_count];
+		repeat_count -= copy_count;
+		q->fill_count += copy_count;
+		while (copy_count--)
+			*wrptr++ = data;
 		if (q->fill_count == q->alloc_count) {
 			ret = feed_queue_analog_flush(q);
 			if (ret != SR_OK)
@@ -249,18 +499,29 @@ SR_API int feed_queue_analog_submit_one(struct feed_queue_analog *q,
 
 SR_API int feed_queue_analog_flush(struct feed_queue_analog *q)
 {
+	struct sr_datafeed_analog *analog;
+	GSList *channels;
 	int ret;
 
 	if (!q->fill_count)
 		return SR_OK;
 
-	q->analog.num_samples = q->fill_count;
-	ret = sr_session_send(q->sdi, &q->packet);
+	analog = (struct sr_datafeed_analog *)q->pooled->payload;
+	analog->num_samples = q->fill_count;
+	*analog->encoding = q->encoding;
+	*analog->spec = q->spec;
+	channels = analog->meaning->channels;
+	*analog->meaning = q->meaning;
+	analog->meaning->channels = channels;
+	ret = sr_session_send(q->sdi, q->pooled);
+	sr_packet_unref(q->pooled);
+	q->pooled = NULL;
+	q->data_values = NULL;
+	q->fill_count = 0;
 	if (ret != SR_OK)
 		return ret;
-	q->fill_count = 0;
 
-	return SR_OK;
+	return feed_queue_analog_get_buffer(q);
 }
 
 SR_API void feed_queue_analog_free(struct feed_queue_analog *q)
@@ -269,7 +530,7 @@ SR_API void feed_queue_analog_free(struct feed_queue_analog *q)
 	if (!q)
 		return;
 
-	g_free(q->data_values);
-	g_slist_free(q->channels);
+	sr_packet_unref(q->pooled);
+	sr_packet_pool_unref(q->pool);
 	g_free(q);
 }
@@ -20,6 +20,13 @@
 #include <config.h>
 #include <string.h>
 #include <errno.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#ifdef HAVE_SYS_MMAN_H
+#include <sys/mman.h>
+#endif
 #include <glib.h>
 #include <glib/gstdio.h>
 #include <libsigrok/libsigrok.h>
@@ -33,6 +40,25 @@
 #define CHUNK_SIZE	(4 * 1024 * 1024)
 /** @endcond */
 
+#ifndef O_BINARY
+#define O_BINARY	0
+#endif
+
+/** @cond PRIVATE */
+struct sr_input_file {
+	int fd;
+	/* Size of a regular file, 0 for streams. */
+	uint64_t size;
+	uint64_t offset;
+	/* The file gets mapped window by window when possible. */
+	gboolean mapped;
+	void *map;
+	size_t map_len;
+	/* Buffer for read(), when the file cannot get mapped. */
+	uint8_t *buf;
+};
+/** @endcond */
+
 /**
  * @file
  *
@@ -450,10 +476,11 @@ SR_API int sr_input_scan_buffer(GString *buf, const struct sr_input **in)
 SR_API int sr_input_scan_file(const char *filename, const struct sr_input **in)
 {
 	int64_t filesize;
-	FILE *stream;
+	struct sr_input_file *file;
 	const struct sr_input_module *imod, *best_imod;
 	GHashTable *meta;
 	GString *header;
+	const void *data;
 	size_t count;
 	unsigned int midx, i;
 	unsigned int conf, best_conf;
@@ -466,28 +493,19 @@ SR_API int sr_input_scan_file(const char *filename, const struct sr_input **in)
 		sr_err("Invalid filename.");
 		return SR_ERR_ARG;
 	}
-	stream = g_fopen(filename, "rb");
-	if (!stream) {
-		sr_err("Failed to open %s: %s", filename, g_strerror(errno));
-		return SR_ERR;
-	}
-	filesize = sr_file_get_size(stream);
-	if (filesize < 0) {
-		sr_err("Failed to get size of %s: %s",
-			filename, g_strerror(errno));
-		fclose(stream);
-		return SR_ERR;
-	}
-	header = g_string_sized_new(CHUNK_SIZE);
-	count = fread(header->str, 1, header->allocated_len - 1, stream);
-	if (count < 1 || ferror(stream)) {
-		sr_err("Failed to read %s: %s", filename, g_strerror(errno));
-		fclose(stream);
-		g_string_free(header, TRUE);
+	ret = sr_input_file_open(filename, &file);
+	if (ret != SR_OK)
+		return ret;
+	filesize = file->size;
+	ret = sr_input_file_read(file, &data, &count);
+	if (ret != SR_OK || count < 1) {
+		if (ret == SR_OK)
+			sr_err("Failed to read %s: empty file.", filename);
+		sr_input_file_close(file);
 		return SR_ERR;
 	}
-	fclose(stream);
-	g_string_set_size(header, count);
+	header = g_string_new_len(data, MIN(count, CHUNK_SIZE - 1));
+	sr_input_file_close(file);
 
 	meta = g_hash_table_new(NULL, NULL);
 	g_hash_table_insert(meta, GINT_TO_POINTER(SR_INPUT_META_FILENAME),
@@ -601,6 +619,56 @@ SR_API int sr_input_send(const struct sr_input *in, GString *buf)
 	return in->module->receive((struct sr_input *)in, buf);
 }
 
+/**
+ * Send borrowed data to the specified input instance.
+ *
+ * Works like sr_input_send(), but takes a plain memory block (such as
+ * a window returned by sr_input_file_read()) which is passed to the
+ * input module without copying it. The data is only accessed during
+ * the call, the caller keeps ownership. Modules only retain those
+ * parts which they could not consume yet.
+ *
+ * The module's receive() gets a GString which refers to @a data. It is
+ * not NUL terminated, and can be read-only memory (a file mapping), so
+ * modules must neither treat it as a C string nor modify it.
+ *
+ * Callers should pass the data in blocks of a few MiB, since modules
+ * may need to buffer a complete block before the device instance is
+ * ready.
+ *
+ * @param in The input instance to send the data to.
+ * @param data The data, need not be NUL terminated, can be read-only.
+ *             Can be NULL when @a len is 0.
+ * @param len The number of bytes in @a data.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ * @retval other Error code which the input module returned.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_input_send_data(const struct sr_input *in,
+		const void *data, size_t len)
+{
+	GString view;
+
+	if (!in || (!data && len))
+		return SR_ERR_ARG;
+
+	/*
+	 * Input modules only read the buffer they receive. A GString
+	 * which refers to the caller's memory saves copying the data
+	 * into an intermediate buffer. It has no NUL terminator, and
+	 * must not get modified.
+	 */
+	view.str = (gchar *)data;
+	view.len = len;
+	view.allocated_len = len;
+
+	sr_spew("Sending %zu bytes to %s module.", len, in->module->id);
+	return in->module->receive((struct sr_input *)in, &view);
+}
+
 /**
  * Signal the input module no more data will come.
  *
@@ -703,4 +771,188 @@ SR_API void sr_input_free(const struct sr_input *in)
 	g_free((gpointer)in);
 }
 
+/**
+ * Open a file for feeding it to an input module.
+ *
+ * The file's content is returned in blocks by sr_input_file_read(),
+ * which are suitable for sr_input_send_data(). Regular files get
+ * mapped into memory where the platform supports it, which saves
+ * copying the data into an application buffer. Other files (pipes,
+ * devices) are read into an internal buffer.
+ *
+ * @param filename The name of the file to open.
+ * @param file Pointer to store the file handle in.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ * @retval SR_ERR The file could not be opened.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_input_file_open(const char *filename,
+		struct sr_input_file **file)
+{
+	struct sr_input_file *f;
+	struct stat st;
+	int fd;
+
+	if (!file)
+		return SR_ERR_ARG;
+	*file = NULL;
+	if (!filename || !filename[0]) {
+		sr_err("Invalid filename.");
+		return SR_ERR_ARG;
+	}
+
+	fd = g_open(filename, O_RDONLY | O_BINARY, 0);
+	if (fd < 0) {
+		sr_err("Failed to open %s: %s", filename, g_strerror(errno));
+		return SR_ERR;
+	}
+	if (fstat(fd, &st) < 0) {
+		sr_err("Failed to get size of %s: %s",
+			filename, g_strerror(errno));
+		close(fd);
+		return SR_ERR;
+	}
+
+	f = g_malloc0(sizeof(*f));
+	f->fd = fd;
+	if (S_ISREG(st.st_mode)) {
+		f->size = st.st_size;
+#ifdef HAVE_SYS_MMAN_H
+		f->mapped = TRUE;
+#endif
+	}
+	*file = f;
+
+	return SR_OK;
+}
+
+static void input_file_unmap(struct sr_input_file *file)
+{
+#ifdef HAVE_SYS_MMAN_H
+	if (file->map)
+		munmap(file->map, file->map_len);
+#endif
+	file->map = NULL;
+	file->map_len = 0;
+}
+
+static int input_file_map(struct sr_input_file *file,
+		const void **data, size_t *len)
+{
+#ifdef HAVE_SYS_MMAN_H
+	size_t map_len;
+	void *map;
+
+	map_len = MIN(CHUNK_SIZE, file->size - file->offset);
+	map = mmap(NULL, map_len, PROT_READ, MAP_PRIVATE,
+		file->fd, (off_t)file->offset);
+	if (map == MAP_FAILED)
+		return SR_ERR;
+#ifdef POSIX_MADV_SEQUENTIAL
+	posix_madvise(map, map_len, POSIX_MADV_SEQUENTIAL);
+#endif
+	file->map = map;
+	file->map_len = map_len;
+	*data = map;
+	*len = map_len;
+
+	return SR_OK;
+#else
+	(void)file;
+	(void)data;
+	(void)len;
+
+	return SR_ERR;
+#endif
+}
+
+/**
+ * Read the next block of an input file.
+ *
+ * The returned data remains valid until the next call to
+ * sr_input_file_read() or sr_input_file_close() for the same file.
+ * Only the most recent block is kept in memory.
+ *
+ * @param file The file handle returned by sr_input_file_open().
+ * @param data Pointer to store the block's address in.
+ * @param len Pointer to store the block's size in. Set to 0 at the
+ *            end of the file.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ * @retval SR_ERR Read error.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_input_file_read(struct sr_input_file *file,
+		const void **data, size_t *len)
+{
+	size_t count;
+	ssize_t ret;
+
+	if (!file || !data || !len)
+		return SR_ERR_ARG;
+	*data = NULL;
+	*len = 0;
+
+	input_file_unmap(file);
+	if (file->mapped) {
+		if (file->offset >= file->size)
+			return SR_OK;
+		if (input_file_map(file, data, len) == SR_OK) {
+			file->offset += *len;
+			return SR_OK;
+		}
+		/* Fall back to reading the remainder of the file. */
+		sr_dbg("Cannot map file, reading it instead.");
+		file->mapped = FALSE;
+		if (lseek(file->fd, (off_t)file->offset, SEEK_SET) < 0) {
+			sr_err("Failed to seek in file: %s", g_strerror(errno));
+			return SR_ERR;
+		}
+	}
+
+	if (!file->buf)
+		file->buf = g_malloc(CHUNK_SIZE);
+	count = 0;
+	while (count < CHUNK_SIZE) {
+		ret = read(file->fd, file->buf + count, CHUNK_SIZE - count);
+		if (ret < 0 && errno == EINTR)
+			continue;
+		if (ret < 0) {
+			sr_err("Failed to read file: %s", g_strerror(errno));
+			return SR_ERR;
+		}
+		if (!ret)
+			break;
+		count += ret;
+	}
+	file->offset += count;
+	*data = file->buf;
+	*len = count;
+
+	return SR_OK;
+}
+
+/**
+ * Close an input file which was opened by sr_input_file_open().
+ *
+ * @param file The file handle. Can be NULL.
+ *
+ * @since 0.6.0
+ */
+SR_API void sr_input_file_close(struct sr_input_file *file)
+{
+	if (!file)
+		return;
+
+	input_file_unmap(file);
+	close(file->fd);
+	g_free(file->buf);
+	g_free(file);
+}
+
 /** @} */
@@ -731,6 +731,7 @@ static int receive(struct sr_input *in, GString *buf)
 	int ret;
 
 	inc = in->priv;
+	/* Search the header in in->buf, not in the caller's chunk. */
 	g_string_append_len(in->buf, buf->str, buf->len);
 
 	if (!in->sdi_ready) {
@@ -1040,7 +1040,10 @@ static int receive(struct sr_input *in, GString *buf)
 	struct context *inc;
 	int rc;
 
-	/* Accumulate another chunk of input data. */
+	/*
+	 * Accumulate another chunk of input data. The chunk is not NUL
+	 * terminated and may be read-only, only in->buf gets parsed.
+	 */
 	g_string_append_len(in->buf, buf->str, buf->len);
 
 	/*
@@ -33,6 +33,7 @@ static int init(struct sr_input *in, GHashTable *options)
 
 static int receive(struct sr_input *in, GString *buf)
 {
+	/* Nothing to keep from the caller's (possibly read-only) chunk. */
 	(void)in;
 	(void)buf;
 
@@ -3396,6 +3396,8 @@ static int receive(struct sr_input *in, GString *buf)
 
 	/*
 	 * Accumulate all input chunks, potential deferred processing.
+	 * Text gets parsed from in->buf, the caller's chunk is not NUL
+	 * terminated and may be read-only.
 	 *
 	 * Remove an optional BOM at the very start of the input stream.
 	 * BEWARE! This may affect binary input, and we cannot tell if
@@ -205,6 +205,7 @@ static int receive(struct sr_input *in, GString *buf)
 {
 	int ret;
 
+	/* The caller's chunk may be read-only, convert from in->buf. */
 	g_string_append_len(in->buf, buf->str, buf->len);
 
 	if (!in->sdi_ready) {
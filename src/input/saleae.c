@@ -997,7 +997,10 @@ static int receive(struct sr_input *in, GString *buf)
 
 	inc = in->priv;
 
-	/* Accumulate another chunk of input data. */
+	/*
+	 * Accumulate another chunk of input data. The chunk is not NUL
+	 * terminated and may be read-only, only in->buf gets parsed.
+	 */
 	g_string_append_len(in->buf, buf->str, buf->len);
 
 	/*
@@ -1273,6 +1273,7 @@ static int receive(struct sr_input *in, GString *buf)
 	 * file content. Run another process() routine that is shared
 	 * with end(), to make sure pending data gets processed, even
 	 * when receive() is only invoked exactly once for short input.
+	 * The caller's chunk is not NUL terminated and may be read-only.
 	 */
 	g_string_append_len(in->buf, buf->str, buf->len);
 	return process_data(in);
@@ -809,6 +809,7 @@ static int process_buffer(struct sr_input *in)
 
 static int receive(struct sr_input *in, GString *buf)
 {
+	/* The caller's chunk is not NUL terminated, and may be read-only. */
 	g_string_append_len(in->buf, buf->str, buf->len);
 
 	if (!in->sdi_ready) {
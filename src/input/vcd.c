@@ -122,6 +122,8 @@
 
 #define CHUNK_SIZE (4 * 1024 * 1024)
 #define SCOPE_SEP '.'
+/* Number of identifier codes of up to three chars, see ident_code(). */
+#define IDENT_TABLE_MAX (1 + 94 + 94 * 94 + 94 * 94 * 94)
 
 struct context {
 	struct vcd_user_opt {
@@ -143,6 +145,10 @@ struct context {
 	gboolean ignore_end_keyword;
 	gboolean skip_until_end;
 	GSList *channels;
+	GHashTable *idents;
+	struct vcd_ident **ident_table;
+	size_t ident_table_size;
+	struct vcd_channel **analog_channels;
 	size_t unit_size;
 	size_t logic_count;
 	size_t analog_count;
@@ -188,6 +194,21 @@ struct vcd_channel {
 	struct feed_queue_analog *feed_analog;
 };
 
+/* The VCD signals (sigrok channels) which use an identifier code. */
+struct vcd_ident {
+	GSList *channels;
+	gboolean ignored;
+};
+
+static void free_ident(void *data)
+{
+	struct vcd_ident *ident;
+
+	ident = data;
+	g_slist_free(ident->channels);
+	g_free(ident);
+}
+
 static void free_channel(void *data)
 {
 	struct vcd_channel *vcd_ch;
@@ -951,6 +972,93 @@ static void create_channels(const struct sr_input *in,
 	}
 }
 
+/*
+ * VCD identifier codes are short sequences of printable ASCII chars,
+ * which generators typically assign in ascending order starting at
+ * '!'. Up to three characters get interpreted as a bijective base-94
+ * number (1 to 94 + 94^2 + 94^3), which directly indexes a table of
+ * known identifiers. The table only spans up to the largest code in
+ * use, ascending codes keep it as small as the number of signals.
+ * Longer identifiers get looked up in a hash table.
+ */
+static gboolean ident_code(const char *id, size_t *code)
+{
+	size_t value, len;
+	char c;
+
+	value = 0;
+	for (len = 0; (c = id[len]); len++) {
+		if (len == 3 || c < '!' || c > '~')
+			return FALSE;
+		value = value * 94 + (c - '!' + 1);
+	}
+	*code = value;
+
+	return len > 0;
+}
+
+static struct vcd_ident *add_ident(struct context *inc, const char *id)
+{
+	struct vcd_ident *ident;
+
+	ident = g_hash_table_lookup(inc->idents, id);
+	if (!ident) {
+		ident = g_malloc0(sizeof(*ident));
+		g_hash_table_insert(inc->idents, g_strdup(id), ident);
+	}
+
+	return ident;
+}
+
+static void create_ident_table(struct context *inc)
+{
+	GSList *l;
+	struct vcd_channel *vcd_ch;
+	struct vcd_ident *ident;
+	GHashTableIter iter;
+	gpointer key, value;
+	size_t code;
+
+	inc->idents = g_hash_table_new_full(g_str_hash, g_str_equal,
+		g_free, free_ident);
+	for (l = inc->channels; l; l = l->next) {
+		vcd_ch = l->data;
+		ident = add_ident(inc, vcd_ch->identifier);
+		ident->channels = g_slist_append(ident->channels, vcd_ch);
+	}
+	for (l = inc->ignored_signals; l; l = l->next) {
+		ident = add_ident(inc, l->data);
+		ident->ignored = TRUE;
+	}
+
+	inc->ident_table_size = 0;
+	g_hash_table_iter_init(&iter, inc->idents);
+	while (g_hash_table_iter_next(&iter, &key, NULL)) {
+		if (!ident_code(key, &code) || code >= IDENT_TABLE_MAX)
+			continue;
+		if (inc->ident_table_size <= code)
+			inc->ident_table_size = code + 1;
+	}
+	inc->ident_table = g_malloc0_n(inc->ident_table_size,
+		sizeof(inc->ident_table[0]));
+	g_hash_table_iter_init(&iter, inc->idents);
+	while (g_hash_table_iter_next(&iter, &key, &value)) {
+		if (!ident_code(key, &code) || code >= inc->ident_table_size)
+			continue;
+		inc->ident_table[code] = value;
+	}
+}
+
+static struct vcd_ident *lookup_ident(struct context *inc, const char *id)
+{
+	size_t code;
+
+	if (ident_code(id, &code) && code < inc->ident_table_size)
+		return inc->ident_table[code];
+
+	return g_hash_table_lookup(inc->idents, id);
+}
+
 static void create_feeds(const struct sr_input *in)
 {
 	struct context *inc;
@@ -969,10 +1077,13 @@ static void create_feeds(const struct sr_input *in)
 	}
 
 	/* Create one feed per analog channel. */
+	inc->analog_channels = g_malloc0_n(inc->analog_count,
+		sizeof(inc->analog_channels[0]));
 	for (l = inc->channels; l; l = l->next) {
 		vcd_ch = l->data;
 		if (vcd_ch->type != SR_CHANNEL_ANALOG)
 			continue;
+		inc->analog_channels[vcd_ch->array_index] = vcd_ch;
 		ch_idx = vcd_ch->array_index;
 		ch_idx += inc->logic_count;
 		ch = g_slist_nth_data(in->sdi->channels, ch_idx);
@@ -1108,6 +1219,7 @@ done_section:
 	if (!check_header_in_reread(in))
 		return SR_ERR_DATA;
 	create_feeds(in);
+	create_ident_table(inc);
 
 	/*
 	 * Allocate space for text to number conversion, and buffers to
@@ -1154,8 +1266,7 @@ done_section:
 static void add_samples(const struct sr_input *in, size_t count, gboolean flush)
 {
 	struct context *inc;
-	GSList *ch_list;
-	struct vcd_channel *vcd_ch;
+	size_t idx;
 	struct feed_queue_analog *q;
 	float value;
 
@@ -1167,31 +1278,23 @@ static void add_samples(const struct sr_input *in, size_t count, gboolean flush)
 		if (flush)
 			feed_queue_logic_flush(inc->feed_logic);
 	}
-	for (ch_list = inc->channels; ch_list; ch_list = ch_list->next) {
-		vcd_ch = ch_list->data;
-		if (vcd_ch->type != SR_CHANNEL_ANALOG)
-			continue;
-		q = vcd_ch->feed_analog;
+	for (idx = 0; idx < inc->analog_count; idx++) {
+		q = inc->analog_channels[idx]->feed_analog;
 		if (!q)
 			continue;
-		value = inc->current_floats[vcd_ch->array_index];
+		value = inc->current_floats[idx];
 		feed_queue_analog_submit_one(q, value, count);
 		if (flush)
 			feed_queue_analog_flush(q);
 	}
 }
 
-static gint vcd_compare_id(gconstpointer a, gconstpointer b)
-{
-	return strcmp((const char *)a, (const char *)b);
-}
-
 static gboolean is_ignored(struct context *inc, const char *id)
 {
-	GSList *ignored;
+	struct vcd_ident *ident;
 
-	ignored = g_slist_find_custom(inc->ignored_signals, id, vcd_compare_id);
-	return ignored != NULL;
+	ident = lookup_ident(inc, id);
+	return ident && ident->ignored;
 }
 
 /*
@@ -1230,6 +1333,7 @@ static void process_bits(struct context *inc, char *identifier,
 {
 	size_t size;
 	gboolean have_int;
+	struct vcd_ident *ident;
 	GSList *l;
 	struct vcd_channel *vcd_ch;
 	float int_val;
@@ -1241,10 +1345,9 @@ static void process_bits(struct context *inc, char *identifier,
 	size = 0;
 	have_int = FALSE;
 	int_val = 0;
-	for (l = inc->channels; l; l = l->next) {
+	ident = lookup_ident(inc, identifier);
+	for (l = ident ? ident->channels : NULL; l; l = l->next) {
 		vcd_ch = l->data;
-		if (g_strcmp0(identifier, vcd_ch->identifier) != 0)
-			continue;
 		if (vcd_ch->type == SR_CHANNEL_ANALOG) {
 			/* Special case for 'integer' VCD signal types. */
 			size = vcd_ch->size; /* Flag for "VCD signal found". */
@@ -1300,7 +1403,7 @@ static void process_bits(struct context *inc, char *identifier,
 			}
 		}
 	}
-	if (!size && !is_ignored(inc, identifier))
+	if (!size && !(ident && ident->ignored))
 		sr_warn("VCD signal not found for ID '%s'.", identifier);
 }
 
@@ -1311,16 +1414,16 @@ static void process_bits(struct context *inc, char *identifier,
 static void process_real(struct context *inc, char *identifier, float real_val)
 {
 	gboolean found;
+	struct vcd_ident *ident;
 	GSList *l;
 	struct vcd_channel *vcd_ch;
 
 	found = FALSE;
-	for (l = inc->channels; l; l = l->next) {
+	ident = lookup_ident(inc, identifier);
+	for (l = ident ? ident->channels : NULL; l; l = l->next) {
 		vcd_ch = l->data;
 		if (vcd_ch->type != SR_CHANNEL_ANALOG)
 			continue;
-		if (g_strcmp0(identifier, vcd_ch->identifier) != 0)
-			continue;
 
 		/* Found our (analog) channel. */
 		found = TRUE;
@@ -1328,7 +1431,7 @@ static void process_real(struct context *inc, char *identifier, float real_val)
 			identifier, vcd_ch->array_index, real_val);
 		inc->current_floats[vcd_ch->array_index] = real_val;
 	}
-	if (!found && !is_ignored(inc, identifier))
+	if (!found && !(ident && ident->ignored))
 		sr_warn("VCD signal not found for ID '%s'.", identifier);
 }
 
@@ -1997,7 +2100,11 @@ static int receive(struct sr_input *in, GString *buf)
 
 	inc = in->priv;
 
-	/* Collect all input chunks, potential deferred processing. */
+	/*
+	 * Collect all input chunks, potential deferred processing. Text
+	 * gets parsed from in->buf, the caller's chunk is not NUL
+	 * terminated and may be read-only.
+	 */
 	g_string_append_len(in->buf, buf->str, buf->len);
 	if (!inc->got_header && in->buf->len == buf->len)
 		check_remove_bom(in->buf);
@@ -2059,6 +2166,14 @@ static void cleanup(struct sr_input *in)
 
 	keep_header_for_reread(in);
 
+	if (inc->idents)
+		g_hash_table_destroy(inc->idents);
+	inc->idents = NULL;
+	g_free(inc->ident_table);
+	inc->ident_table = NULL;
+	inc->ident_table_size = 0;
+	g_free(inc->analog_channels);
+	inc->analog_channels = NULL;
 	g_slist_free_full(inc->channels, free_channel);
 	inc->channels = NULL;
 	feed_queue_logic_free(inc->feed_logic);
@@ -345,6 +345,7 @@ static int receive(struct sr_input *in, GString *buf)
 	int ret;
 	char channelname[16];
 
+	/* Parse from in->buf, the caller's chunk may be read-only. */
 	g_string_append_len(in->buf, buf->str, buf->len);
 
 	if (in->buf->len < MIN_DATA_CHUNK_OFFSET) {
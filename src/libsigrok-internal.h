@@ -1334,6 +1334,12 @@ struct sr_input_module {
 	 * the chance to examine the device instance, attach session callbacks
 	 * and so on.
 	 *
+	 * The @a buf GString can be a view of the caller's memory, see
+	 * sr_input_send_data(). Its data is not NUL terminated and can be
+	 * read-only. Modules must only read buf->len bytes from buf->str,
+	 * must not modify, resize or free it, and must not keep a reference
+	 * after returning. Copy what needs to be kept to in->buf.
+	 *
 	 * @retval SR_OK Success
 	 * @retval other Negative error code.
 	 */
@@ -1848,6 +1854,20 @@ struct sr_session {
 	unsigned int stop_check_id;
 	/** Whether the session has been started. */
 	gboolean running;
+	/** Queue size per datafeed callback thread, 0 for direct calls. */
+	size_t feed_high_water;
+	/** What to do when a datafeed callback queue is full. */
+	enum sr_datafeed_queue_policy feed_policy;
+	/** Buffers for the packets which devices send to this session. */
+	struct sr_packet_pool *packet_pool;
+	/** Samples per overview block, see sr_session_overview_enable(). */
+	uint64_t overview_resolution;
+	/** Overviews of the devices' data, struct sr_overview per sdi. */
+	GHashTable *overviews;
+	/** Whether USB devices handle their transfers in a thread. */
+	gboolean usb_event_thread;
+	/** USB stream statistics, struct sr_usb_stream_stats per sdi. */
+	GHashTable *usb_stats;
 };
 
 SR_PRIV int sr_session_source_add_internal(struct sr_session *session,
@@ -1878,10 +1898,48 @@ SR_PRIV int sr_session_send_meta(const struct sr_dev_inst *sdi,
 		uint32_t key, GVariant *var);
 SR_PRIV int sr_session_send(const struct sr_dev_inst *sdi,
 		const struct sr_datafeed_packet *packet);
+SR_PRIV struct sr_packet_pool *sr_session_packet_pool(
+		const struct sr_dev_inst *sdi);
+
+/** Chunk size in bytes when run-length encoded logic data gets expanded. */
+#define SR_LOGIC_RLE_EXPAND_SIZE	(4 * 1024 * 1024)
+
+/** State of the chunked expansion of run-length encoded logic data. */
+struct sr_logic_rle_expand {
+	const struct sr_datafeed_logic_rle *rle;
+	uint64_t run;
+	uint64_t run_done;
+};
+
+SR_PRIV void sr_samples_fill(uint8_t *buf, const uint8_t *value,
+		size_t unitsize, size_t count);
+SR_PRIV uint64_t sr_logic_rle_num_samples(const struct sr_datafeed_logic_rle *rle);
+SR_PRIV void sr_logic_rle_expand_init(struct sr_logic_rle_expand *expand,
+		const struct sr_datafeed_logic_rle *rle);
+SR_PRIV size_t sr_logic_rle_expand(struct sr_logic_rle_expand *expand,
+		uint8_t *buf, size_t count);
+
 SR_PRIV int sr_sessionfile_check(const char *filename);
 SR_PRIV struct sr_dev_inst *sr_session_prepare_sdi(const char *filename,
 		struct sr_session **session);
 
+/*--- packet_pool.c ---------------------------------------------------------*/
+
+struct sr_packet_pool;
+
+SR_PRIV struct sr_packet_pool *sr_packet_pool_new(void);
+SR_PRIV struct sr_packet_pool *sr_packet_pool_ref(struct sr_packet_pool *pool);
+SR_PRIV void sr_packet_pool_unref(struct sr_packet_pool *pool);
+SR_PRIV struct sr_datafeed_packet *sr_packet_pool_logic_new(
+		struct sr_packet_pool *pool, size_t length, uint16_t unitsize);
+SR_PRIV struct sr_datafeed_packet *sr_packet_pool_analog_new(
+		struct sr_packet_pool *pool, size_t num_samples,
+		struct sr_channel *ch);
+SR_PRIV gboolean sr_packet_is_pooled(const struct sr_datafeed_packet *packet);
+SR_PRIV struct sr_datafeed_packet *sr_packet_ref(
+		const struct sr_datafeed_packet *packet);
+SR_PRIV void sr_packet_unref(struct sr_datafeed_packet *packet);
+
 /*--- session_file.c --------------------------------------------------------*/
 
 #if !HAVE_ZIP_DISCARD
@@ -1893,6 +1951,86 @@ SR_PRIV void sr_zip_discard(struct zip *archive);
 SR_PRIV GKeyFile *sr_sessionfile_read_metadata(struct zip *archive,
 			const struct zip_stat *entry);
 
+/*--- session_index.c -------------------------------------------------------*/
+
+/** Summary of a chunk of a capture file in an srzip archive. */
+struct sr_index_chunk {
+	/** Sample number of the chunk's first sample. */
+	uint64_t first;
+	/** Number of samples in the chunk. */
+	uint64_t count;
+	/** Range of analog values. */
+	float min, max;
+	/** Archive entry, when the index belongs to an open file. */
+	uint64_t entry;
+};
+
+/** Chunk index of a capture file ("logic-1", "analog-1-9", ...). */
+struct sr_index_capture {
+	char *name;
+	/** SR_CHANNEL_LOGIC or SR_CHANNEL_ANALOG. */
+	int type;
+	/** Bytes per sample. */
+	size_t unitsize;
+	/** struct sr_index_chunk items. */
+	GArray *chunks;
+	/** Logic data: OR and AND of each chunk's samples. */
+	GByteArray *bits_or;
+	GByteArray *bits_and;
+};
+
+struct sr_session_index {
+	/** struct sr_index_capture items. */
+	GPtrArray *captures;
+};
+
+SR_PRIV struct sr_session_index *sr_session_index_new(void);
+SR_PRIV void sr_session_index_free(struct sr_session_index *index);
+SR_PRIV struct sr_index_capture *sr_session_index_find(
+		const struct sr_session_index *index, const char *name);
+SR_PRIV struct sr_index_capture *sr_session_index_add(
+		struct sr_session_index *index, const char *name,
+		int type, size_t unitsize);
+SR_PRIV void sr_session_index_chunk_start(struct sr_index_capture *cap);
+SR_PRIV void sr_session_index_add_logic(struct sr_index_capture *cap,
+		const uint8_t *data, size_t count);
+SR_PRIV void sr_session_index_add_analog(struct sr_index_capture *cap,
+		const float *values, size_t count);
+SR_PRIV uint8_t *sr_session_index_bits_or(const struct sr_index_capture *cap,
+		size_t chunk);
+SR_PRIV uint8_t *sr_session_index_bits_and(const struct sr_index_capture *cap,
+		size_t chunk);
+SR_PRIV size_t sr_session_index_lookup(const struct sr_index_capture *cap,
+		uint64_t sample);
+SR_PRIV uint64_t sr_session_index_num_samples(const struct sr_index_capture *cap);
+SR_PRIV void sr_session_index_save(const struct sr_session_index *index,
+		GKeyFile *kf);
+SR_PRIV struct sr_session_index *sr_session_index_load(GKeyFile *kf);
+
+/*--- overview.c ------------------------------------------------------------*/
+
+struct sr_overview_track;
+
+SR_PRIV struct sr_overview *sr_overview_new(uint64_t resolution);
+SR_PRIV void sr_overview_free(struct sr_overview *ov);
+SR_PRIV struct sr_overview_track *sr_overview_track_add(
+		struct sr_overview *ov, const char *name, int type,
+		size_t unitsize);
+SR_PRIV struct sr_overview_track *sr_overview_track_find(
+		const struct sr_overview *ov, const char *name);
+SR_PRIV void sr_overview_add_logic(struct sr_overview *ov,
+		struct sr_overview_track *track, const uint8_t *data,
+		size_t unitsize, uint64_t count);
+SR_PRIV void sr_overview_add_logic_rle(struct sr_overview *ov,
+		struct sr_overview_track *track,
+		const struct sr_datafeed_logic_rle *rle);
+SR_PRIV void sr_overview_add_analog(struct sr_overview *ov,
+		struct sr_overview_track *track, const float *values,
+		uint64_t count, size_t stride);
+SR_PRIV GByteArray *sr_overview_save(struct sr_overview *ov);
+SR_PRIV struct sr_overview *sr_overview_load(const uint8_t *data, size_t size);
+SR_PRIV void sr_session_overview_start(struct sr_session *session);
+
 /*--- analog.c --------------------------------------------------------------*/
 
 SR_PRIV int sr_analog_init(struct sr_datafeed_analog *analog,
@@ -1900,6 +2038,13 @@ SR_PRIV int sr_analog_init(struct sr_datafeed_analog *analog,
                            struct sr_analog_meaning *meaning,
                            struct sr_analog_spec *spec,
                            int digits);
+SR_PRIV int sr_analog_to_float_range(const struct sr_datafeed_analog *analog,
+		size_t first, size_t count, float *outbuf);
+
+/*--- conversion.c ----------------------------------------------------------*/
+
+SR_PRIV size_t sr_logic_find_change(const uint8_t *data, size_t count,
+		size_t unitsize, const uint8_t *prev, uint8_t *xor_mask);
 
 /*--- std.c -----------------------------------------------------------------*/
 
@@ -2012,13 +2157,32 @@ SR_PRIV void sr_hexdump_free(GString *s);
 
 /*--- soft-trigger.c --------------------------------------------------------*/
 
+/* Trigger stage, compiled to bit masks covering all channels at once. */
+struct soft_trigger_logic_stage {
+	int num_matches;
+	gboolean never;
+	gboolean has_edge;
+	uint64_t *level_mask;
+	uint64_t *level_value;
+	uint64_t *rise_mask;
+	uint64_t *fall_mask;
+	uint64_t *edge_mask;
+};
+
 struct soft_trigger_logic {
 	const struct sr_dev_inst *sdi;
 	const struct sr_trigger *trigger;
-	int count;
 	int unitsize;
 	int cur_stage;
-	uint8_t *prev_sample;
+	int num_stages;
+	int num_words;
+	struct soft_trigger_logic_stage *stages;
+	uint64_t *masks;
+	uint64_t *cur_sample;
+	/* Last samples of earlier buffers, for edges and stage fallback. */
+	uint8_t *history;
+	int history_size;
+	int history_fill;
 	uint8_t *pre_trigger_buffer;
 	uint8_t *pre_trigger_head;
 	int pre_trigger_size;
@@ -2032,6 +2196,8 @@ SR_PRIV struct soft_trigger_logic *soft_trigger_logic_new(
 SR_PRIV void soft_trigger_logic_free(struct soft_trigger_logic *st);
 SR_PRIV int soft_trigger_logic_check(struct soft_trigger_logic *st, uint8_t *buf,
 		int len, int *pre_trigger_samples);
+SR_PRIV int64_t soft_trigger_logic_check_rle(struct soft_trigger_logic *st,
+		const struct sr_datafeed_logic_rle *rle, int *pre_trigger_samples);
 
 /*--- serial.c --------------------------------------------------------------*/
 
@@ -2221,6 +2387,82 @@ SR_PRIV void sr_usb_close(struct sr_usb_dev_inst *usb);
 SR_PRIV int usb_source_add(struct sr_session *session, struct sr_context *ctx,
 		int timeout, sr_receive_data_callback cb, void *cb_data);
 SR_PRIV int usb_source_remove(struct sr_session *session, struct sr_context *ctx);
+/** Slot of a single producer, single consumer buffer ring. */
+struct sr_usb_ring_item {
+	uint8_t *buf;
+	size_t len;
+};
+
+/**
+ * Lock-free ring of buffers between exactly one producer thread and
+ * exactly one consumer thread. The producer only writes @a head, the
+ * consumer only writes @a tail, the capacity is a power of two.
+ */
+struct sr_usb_ring {
+	struct sr_usb_ring_item *items;
+	guint mask;
+	gint head;
+	gint tail;
+};
+
+SR_PRIV void sr_usb_ring_init(struct sr_usb_ring *ring, size_t size);
+SR_PRIV guint sr_usb_ring_count(struct sr_usb_ring *ring);
+SR_PRIV gboolean sr_usb_ring_push(struct sr_usb_ring *ring,
+		uint8_t *buf, size_t len);
+SR_PRIV gboolean sr_usb_ring_pop(struct sr_usb_ring *ring,
+		struct sr_usb_ring_item *item);
+struct sr_usb_stream;
+typedef void (*sr_usb_stream_data_callback)(uint8_t *data, size_t length,
+		void *cb_data);
+typedef void (*sr_usb_stream_end_callback)(void *cb_data);
+SR_PRIV struct sr_usb_stream *sr_usb_stream_new(const struct sr_dev_inst *sdi,
+		struct sr_context *ctx, size_t num_buffers, size_t buffer_size,
+		sr_usb_stream_data_callback data_cb,
+		sr_usb_stream_end_callback end_cb, void *cb_data);
+SR_PRIV void sr_usb_stream_free(struct sr_usb_stream *stream);
+SR_PRIV int sr_usb_stream_submit(struct sr_usb_stream *stream,
+		struct libusb_transfer *transfer);
+SR_PRIV gboolean sr_usb_stream_complete(struct sr_usb_stream *stream,
+		struct libusb_transfer *transfer);
+SR_PRIV void sr_usb_stream_finish(struct sr_usb_stream *stream);
+SR_PRIV size_t sr_usb_stream_backlog(struct sr_usb_stream *stream);
+
+/** Transfer sizing of a streaming USB device, see sr_usb_tuner_new(). */
+struct sr_usb_tuner {
+	/** Data rate of the device. */
+	uint64_t bytes_per_ms;
+	/** Transfer sizes are multiples of this. */
+	size_t block_size;
+	/** Current, minimum and maximum transfer size in bytes. */
+	size_t size, min_size, max_size;
+	/** Current, minimum and maximum number of transfers in flight. */
+	unsigned int depth, min_depth, max_depth;
+	/** Time source, in microseconds. g_get_monotonic_time() by default. */
+	gint64 (*clock)(void);
+
+	GMutex mutex;
+	struct usb_tuner_slot *slots;
+	int64_t window_start_us;
+	int64_t turnaround_max_us;
+	uint64_t completions;
+	uint64_t adjustments;
+	uint64_t latency_hist[SR_USB_LATENCY_BINS];
+};
+
+SR_PRIV struct sr_usb_tuner *sr_usb_tuner_new(uint64_t bytes_per_ms,
+		size_t block_size, unsigned int transfer_ms,
+		unsigned int queue_ms, unsigned int max_depth);
+SR_PRIV void sr_usb_tuner_limit(struct sr_usb_tuner *tuner,
+		uint64_t max_size, uint64_t max_depth);
+SR_PRIV unsigned int sr_usb_tuner_timeout(struct sr_usb_tuner *tuner);
+SR_PRIV void sr_usb_tuner_submit(struct sr_usb_tuner *tuner,
+		struct libusb_transfer *transfer);
+SR_PRIV void sr_usb_tuner_complete(struct sr_usb_tuner *tuner,
+		struct libusb_transfer *transfer, size_t backlog);
+SR_PRIV void sr_usb_tuner_remove(struct sr_usb_tuner *tuner,
+		struct libusb_transfer *transfer);
+SR_PRIV void sr_usb_tuner_free(struct sr_usb_tuner *tuner,
+		const struct sr_dev_inst *sdi);
 SR_PRIV int usb_get_port_path(libusb_device *dev, char *path, int path_len);
 SR_PRIV gboolean usb_match_manuf_prod(libusb_device *dev,
 		const char *manufacturer, const char *product);
@@ -2867,6 +3109,11 @@ struct feed_queue_analog;
 SR_API struct feed_queue_logic *feed_queue_logic_alloc(
 	const struct sr_dev_inst *sdi,
 	size_t sample_count, size_t unit_size);
+SR_API int feed_queue_logic_set_rle(struct feed_queue_logic *q,
+	gboolean rle);
+SR_API int feed_queue_logic_set_soft_trigger(struct feed_queue_logic *q,
+	struct soft_trigger_logic *stl);
+SR_API gboolean feed_queue_logic_triggered(struct feed_queue_logic *q);
 SR_API int feed_queue_logic_submit_one(struct feed_queue_logic *q,
 	const uint8_t *data, size_t repeat_count);
 SR_API int feed_queue_logic_submit_many(struct feed_queue_logic *q,
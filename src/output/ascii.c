@@ -172,6 +172,40 @@ static void maybe_add_trigger(struct context *ctx, GString *out)
 		offset + 1, "^", offset);
 }
 
+/*
+ * Append samples which equal their predecessor. These cannot show edges,
+ * each channel repeats the character of its current level.
+ */
+static void append_unchanged(struct context *ctx, GString *out, size_t count)
+{
+	size_t j, idx, len, n;
+	char c;
+
+	while (count) {
+		n = MIN(count, ctx->spl - ctx->spl_cnt);
+		for (j = 0; j < ctx->num_enabled_channels; j++) {
+			idx = ctx->channel_index[j];
+			c = ctx->charset[(ctx->prev_sample[idx / 8] >> (idx % 8)) & 1];
+			len = ctx->lines[j]->len;
+			g_string_set_size(ctx->lines[j], len + n);
+			memset(&ctx->lines[j]->str[len], c, n);
+		}
+		ctx->spl_cnt += n;
+		count -= n;
+		if (ctx->spl_cnt != ctx->spl)
+			continue;
+
+		/* Flush line buffers. */
+		for (j = 0; j < ctx->num_enabled_channels; j++) {
+			g_string_append_len(out, ctx->lines[j]->str, ctx->lines[j]->len);
+			g_string_append_c(out, '\n');
+			g_string_printf(ctx->lines[j], "%s:", ctx->aligned_names[j]);
+		}
+		maybe_add_trigger(ctx, out);
+		ctx->spl_cnt = 0;
+	}
+}
+
 static int receive(const struct sr_output *o, const struct sr_datafeed_packet *packet,
 		GString **out)
 {
@@ -181,7 +215,7 @@ static int receive(const struct sr_output *o, const struct sr_datafeed_packet *p
 	GSList *l;
 	struct context *ctx;
 	size_t idx, i, j;
-	size_t num_samples;
+	size_t num_samples, run;
 	const uint8_t *curr_sample;
 	size_t bytepos;
 	uint8_t bitmask, curbit, prevbit;
@@ -218,7 +252,17 @@ static int receive(const struct sr_output *o, const struct sr_datafeed_packet *p
 		logic = packet->payload;
 		num_samples = logic->length / logic->unitsize;
 		curr_sample = logic->data;
-		while (num_samples--) {
+		while (num_samples) {
+			/* Skip over unchanged samples without bit checks. */
+			run = sr_logic_find_change(curr_sample, num_samples,
+				logic->unitsize, ctx->prev_sample, NULL);
+			append_unchanged(ctx, *out, run);
+			curr_sample += run * logic->unitsize;
+			num_samples -= run;
+			if (!num_samples)
+				break;
+			num_samples--;
+
 			ctx->spl_cnt++;
 			for (j = 0; j < ctx->num_enabled_channels; j++) {
 				idx = ctx->channel_index[j];
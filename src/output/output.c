@@ -325,17 +325,78 @@ SR_API const struct sr_output *sr_output_new(const struct sr_output_module *omod
 	return op;
 }
 
+/*
+ * Pass run-length encoded logic data in expanded form to output modules
+ * which don't support SR_DF_LOGIC_RLE. Collects the text of all chunks.
+ */
+static int output_send_rle_expanded(const struct sr_output *o,
+		const struct sr_datafeed_logic_rle *rle, GString **out)
+{
+	struct sr_logic_rle_expand expand;
+	struct sr_datafeed_packet packet;
+	struct sr_datafeed_logic logic;
+	GString *chunk_out;
+	uint8_t *buf;
+	size_t buf_count, count;
+	uint64_t total;
+	int ret;
+
+	*out = NULL;
+	if (!rle->unitsize)
+		return SR_ERR_ARG;
+	total = sr_logic_rle_num_samples(rle);
+	if (!total)
+		return SR_OK;
+	buf_count = SR_LOGIC_RLE_EXPAND_SIZE / rle->unitsize;
+	if (buf_count > total)
+		buf_count = total;
+	buf = g_try_malloc(buf_count * rle->unitsize);
+	if (!buf)
+		return SR_ERR_MALLOC;
+
+	packet.type = SR_DF_LOGIC;
+	packet.payload = &logic;
+	logic.unitsize = rle->unitsize;
+	logic.data = buf;
+
+	ret = SR_OK;
+	sr_logic_rle_expand_init(&expand, rle);
+	while ((count = sr_logic_rle_expand(&expand, buf, buf_count))) {
+		logic.length = count * rle->unitsize;
+		chunk_out = NULL;
+		ret = o->module->receive(o, &packet, &chunk_out);
+		if (chunk_out && !*out) {
+			*out = chunk_out;
+		} else if (chunk_out) {
+			g_string_append_len(*out, chunk_out->str, chunk_out->len);
+			g_string_free(chunk_out, TRUE);
+		}
+		if (ret != SR_OK)
+			break;
+	}
+	g_free(buf);
+
+	return ret;
+}
+
 /**
  * Send a packet to the specified output instance.
  *
  * The instance's output is returned as a newly allocated GString,
  * which must be freed by the caller.
  *
+ * SR_DF_LOGIC_RLE packets get expanded to SR_DF_LOGIC packets for
+ * output modules which don't set the SR_OUTPUT_LOGIC_RLE flag.
+ *
  * @since 0.4.0
  */
 SR_API int sr_output_send(const struct sr_output *o,
 		const struct sr_datafeed_packet *packet, GString **out)
 {
+	if (packet->type == SR_DF_LOGIC_RLE &&
+			!(o->module->flags & SR_OUTPUT_LOGIC_RLE))
+		return output_send_rle_expanded(o, packet->payload, out);
+
 	return o->module->receive(o, packet, out);
 }
 
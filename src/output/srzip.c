@@ -21,19 +21,76 @@
 #include <stdlib.h>
 #include <string.h>
 #include <errno.h>
+#include <unistd.h>
 #include <glib.h>
 #include <glib/gstdio.h>
+#include <time.h>
 #include <zip.h>
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
 #include <libsigrok/libsigrok.h>
 #include "libsigrok-internal.h"
 
 #define LOG_PREFIX "output/srzip"
 #define CHUNK_SIZE (4 * 1024 * 1024)
 
+/* Number of chunk buffers per compression worker. */
+#define BUFFERS_PER_WORKER 2
+
+/* A filled chunk buffer, queued for compression. */
+struct chunk_job {
+	uint64_t seq;
+	char *name;
+	uint8_t *data;
+	size_t length;
+};
+
+/* A compressed chunk in the spool file, pending archive entry. */
+struct chunk_entry {
+	char *name;
+	const char *spool_filename;
+	uint64_t offset;
+	uint64_t size;
+	uint64_t comp_size;
+	uint32_t crc;
+	gboolean stored;
+	FILE *file;
+	uint64_t pos;
+};
+
 struct out_context {
 	gboolean zip_created;
 	uint64_t samplerate;
 	char *filename;
+	struct zip *archive;
+	GKeyFile *meta;
+	char *metabuf;
+	struct sr_session_index *index;
+	char *indexbuf;
+	gboolean with_overview;
+	struct sr_overview *overview;
+	GByteArray *overviewbuf;
+	gboolean unitsize_seen;
+	struct spool {
+		char *filename;
+		FILE *file;
+		uint64_t size;
+	} spool;
+	int level;
+	int workers;
+	struct compress_pool {
+		GThreadPool *threads;
+		GMutex mutex;
+		GCond cond;
+		GSList *free_bufs;
+		uint64_t next_seq;
+		uint64_t write_seq;
+		GPtrArray *entries;
+		int error;
+		uint64_t stall_count;
+		int64_t stall_time;
+	} pool;
 	size_t first_analog_index;
 	size_t analog_ch_count;
 	gint *analog_index_map;
@@ -42,37 +99,562 @@ struct out_context {
 		size_t alloc_size;
 		uint8_t *samples;
 		size_t fill_size;
+		size_t chunk_num;
+		struct sr_index_capture *index;
+		struct sr_overview_track *overview;
 	} logic_buff;
 	struct analog_buff {
 		size_t alloc_size;
 		float *samples;
 		size_t fill_size;
+		size_t chunk_num;
+		struct sr_index_capture *index;
+		struct sr_overview_track *overview;
 	} *analog_buff;
 };
 
 static int init(struct sr_output *o, GHashTable *options)
 {
 	struct out_context *outc;
-
-	(void)options;
+	const char *compression;
+	int level, workers;
 
 	if (!o->filename || o->filename[0] == '\0') {
 		sr_info("srzip output module requires a file name, cannot save.");
 		return SR_ERR_ARG;
 	}
 
+	compression = g_variant_get_string(
+		g_hash_table_lookup(options, "compression"), NULL);
+	if (g_ascii_strcasecmp(compression, "default") == 0) {
+		level = -1;
+	} else if (g_ascii_strcasecmp(compression, "store") == 0) {
+		level = 0;
+	} else if (g_ascii_strcasecmp(compression, "fast") == 0) {
+		level = 1;
+	} else if (g_ascii_strcasecmp(compression, "best") == 0) {
+		level = 9;
+	} else {
+		sr_err("Unsupported compression '%s'.", compression);
+		return SR_ERR_ARG;
+	}
+	workers = g_variant_get_int32(g_hash_table_lookup(options, "workers"));
+	if (workers < 0) {
+		sr_err("Invalid number of compression workers %d.", workers);
+		return SR_ERR_ARG;
+	}
+#ifndef HAVE_ZLIB
+	if (workers) {
+		sr_dbg("No zlib support, compressing when the archive gets closed.");
+		workers = 0;
+	}
+#endif
+
 	outc = g_malloc0(sizeof(*outc));
 	outc->filename = g_strdup(o->filename);
+	outc->level = level;
+	outc->workers = workers;
+	outc->with_overview = g_variant_get_boolean(
+		g_hash_table_lookup(options, "overview"));
 	o->priv = outc;
 
 	return SR_OK;
 }
 
+/**
+ * Apply the configured compression method to an archive entry.
+ *
+ * @param[in] outc Output module context.
+ * @param[in] index Archive entry index.
+ * @param[in] stored Entry data is not compressed.
+ */
+static void zip_set_compression(struct out_context *outc,
+	zip_int64_t index, gboolean stored)
+{
+#ifdef HAVE_ZIP_SET_FILE_COMPRESSION
+	if (stored) {
+		zip_set_file_compression(outc->archive, index, ZIP_CM_STORE, 0);
+	} else if (outc->level > 0) {
+		zip_set_file_compression(outc->archive, index,
+			ZIP_CM_DEFLATE, outc->level);
+	}
+#else
+	(void)outc;
+	(void)index;
+	(void)stored;
+#endif
+}
+
+/**
+ * Add a chunk of sample data to the srzip archive (synchronously).
+ *
+ * The data is appended to the spool file, and the archive entry
+ * references that region of the spool file. No archive update
+ * happens here, the cost of adding a chunk does not depend on the
+ * number of chunks which were added before. libzip compresses the
+ * data when the archive gets closed.
+ *
+ * @param[in] o Output module instance.
+ * @param[in] name Archive entry name.
+ * @param[in] buf Sample data.
+ * @param[in] length Sample data size in bytes.
+ *
+ * @returns SR_OK et al error codes.
+ */
+static int zip_add_chunk_sync(const struct sr_output *o,
+	const char *name, const void *buf, size_t length)
+{
+	struct out_context *outc;
+	struct zip_source *src;
+	uint64_t offset;
+	zip_int64_t index;
+
+	outc = o->priv;
+
+	offset = outc->spool.size;
+	if (fwrite(buf, 1, length, outc->spool.file) != length ||
+			fflush(outc->spool.file) != 0) {
+		sr_err("Cannot write to spool file '%s': %s",
+			outc->spool.filename, g_strerror(errno));
+		return SR_ERR_IO;
+	}
+	outc->spool.size += length;
+
+	src = zip_source_file(outc->archive, outc->spool.filename,
+		offset, length);
+	if (!src) {
+		sr_err("Cannot reference chunk '%s': %s",
+			name, zip_strerror(outc->archive));
+		return SR_ERR;
+	}
+	index = zip_add(outc->archive, name, src);
+	if (index < 0) {
+		sr_err("Failed to add chunk '%s': %s",
+			name, zip_strerror(outc->archive));
+		zip_source_free(src);
+		return SR_ERR;
+	}
+	zip_set_compression(outc, index, outc->level == 0);
+
+	return SR_OK;
+}
+
+#ifdef HAVE_ZLIB
+
+/**
+ * Compress a chunk and append it to the spool file (worker thread).
+ *
+ * Compression runs in parallel, the spool file receives the chunks
+ * in the order of their submission. The chunk buffer returns to the
+ * free list when done.
+ */
+static void zip_pool_compress(gpointer data, gpointer user_data)
+{
+	struct chunk_job *job;
+	struct out_context *outc;
+	struct compress_pool *pool;
+	struct chunk_entry *entry;
+	z_stream strm;
+	uint8_t *comp;
+	const uint8_t *wrbuf;
+	size_t wrlen;
+	int ret;
+
+	job = data;
+	outc = user_data;
+	pool = &outc->pool;
+
+	entry = g_malloc0(sizeof(*entry));
+	entry->name = job->name;
+	entry->spool_filename = outc->spool.filename;
+	entry->size = job->length;
+	entry->crc = crc32(0L, job->data, job->length);
+
+	ret = SR_OK;
+	comp = NULL;
+	wrbuf = job->data;
+	wrlen = job->length;
+	if (outc->level == 0) {
+		entry->stored = TRUE;
+	} else {
+		memset(&strm, 0, sizeof(strm));
+		if (deflateInit2(&strm,
+				outc->level < 0 ? Z_DEFAULT_COMPRESSION : outc->level,
+				Z_DEFLATED, -MAX_WBITS, 8,
+				Z_DEFAULT_STRATEGY) != Z_OK) {
+			ret = SR_ERR;
+		} else {
+			wrlen = deflateBound(&strm, job->length);
+			comp = g_try_malloc(wrlen);
+			if (!comp) {
+				ret = SR_ERR_MALLOC;
+			} else {
+				strm.next_in = job->data;
+				strm.avail_in = job->length;
+				strm.next_out = comp;
+				strm.avail_out = wrlen;
+				if (deflate(&strm, Z_FINISH) != Z_STREAM_END)
+					ret = SR_ERR;
+				wrbuf = comp;
+				wrlen = strm.total_out;
+			}
+			deflateEnd(&strm);
+		}
+	}
+	entry->comp_size = wrlen;
+
+	/* Wait for our turn, only one worker at a time writes. */
+	g_mutex_lock(&pool->mutex);
+	while (pool->write_seq != job->seq)
+		g_cond_wait(&pool->cond, &pool->mutex);
+	if (pool->error)
+		ret = pool->error;
+	g_mutex_unlock(&pool->mutex);
+
+	if (ret == SR_OK) {
+		entry->offset = outc->spool.size;
+		if (fwrite(wrbuf, 1, wrlen, outc->spool.file) != wrlen) {
+			sr_err("Cannot write to spool file '%s': %s",
+				outc->spool.filename, g_strerror(errno));
+			ret = SR_ERR_IO;
+		}
+		outc->spool.size += wrlen;
+	}
+	g_free(comp);
+
+	g_mutex_lock(&pool->mutex);
+	if (ret == SR_OK) {
+		g_ptr_array_add(pool->entries, entry);
+	} else {
+		if (!pool->error)
+			sr_err("Failed to compress chunk '%s'.", entry->name);
+		pool->error = ret;
+		g_free(entry->name);
+		g_free(entry);
+	}
+	pool->write_seq++;
+	pool->free_bufs = g_slist_prepend(pool->free_bufs, job->data);
+	g_cond_broadcast(&pool->cond);
+	g_mutex_unlock(&pool->mutex);
+
+	g_free(job);
+}
+
+/**
+ * Provide a compressed chunk from the spool file to libzip.
+ *
+ * The stat call reports the data as compressed already, libzip
+ * copies it into the archive as is.
+ */
+static zip_int64_t zip_pool_source(void *userdata, void *data,
+	zip_uint64_t len, enum zip_source_cmd cmd)
+{
+	struct chunk_entry *entry;
+	struct zip_stat *st;
+	int *errs;
+	size_t rdlen;
+
+	entry = userdata;
+
+	switch (cmd) {
+	case ZIP_SOURCE_OPEN:
+		entry->file = g_fopen(entry->spool_filename, "rb");
+		if (!entry->file)
+			return -1;
+		if (fseeko(entry->file, entry->offset, SEEK_SET) != 0) {
+			fclose(entry->file);
+			entry->file = NULL;
+			return -1;
+		}
+		entry->pos = 0;
+		return 0;
+	case ZIP_SOURCE_READ:
+		rdlen = MIN(len, entry->comp_size - entry->pos);
+		rdlen = fread(data, 1, rdlen, entry->file);
+		if (ferror(entry->file))
+			return -1;
+		entry->pos += rdlen;
+		return rdlen;
+	case ZIP_SOURCE_CLOSE:
+		if (entry->file)
+			fclose(entry->file);
+		entry->file = NULL;
+		return 0;
+	case ZIP_SOURCE_STAT:
+		if (len < sizeof(*st))
+			return -1;
+		st = data;
+		zip_stat_init(st);
+		st->valid = ZIP_STAT_SIZE | ZIP_STAT_COMP_SIZE |
+			ZIP_STAT_COMP_METHOD | ZIP_STAT_CRC | ZIP_STAT_MTIME;
+		st->size = entry->size;
+		st->comp_size = entry->comp_size;
+		st->comp_method = entry->stored ? ZIP_CM_STORE : ZIP_CM_DEFLATE;
+		st->crc = entry->crc;
+		st->mtime = time(NULL);
+		return sizeof(*st);
+	case ZIP_SOURCE_ERROR:
+		if (len < 2 * sizeof(int))
+			return -1;
+		errs = data;
+		errs[0] = ZIP_ER_READ;
+		errs[1] = errno;
+		return 2 * sizeof(int);
+	case ZIP_SOURCE_FREE:
+		if (entry->file)
+			fclose(entry->file);
+		entry->file = NULL;
+		return 0;
+	default:
+		return -1;
+	}
+}
+
+static void free_entry(void *p)
+{
+	struct chunk_entry *entry;
+
+	entry = p;
+	g_free(entry->name);
+	g_free(entry);
+}
+
+/**
+ * Start the compression workers.
+ *
+ * Allocates the chunk buffers which circulate between the session
+ * thread and the workers. Their number bounds the compression queue
+ * and applies backpressure when compression can't keep up.
+ *
+ * @param[in] o Output module instance.
+ *
+ * @returns SR_OK et al error codes.
+ */
+static int zip_pool_start(const struct sr_output *o)
+{
+	struct out_context *outc;
+	struct compress_pool *pool;
+	GError *error;
+	uint8_t *buf;
+	int idx;
+
+	outc = o->priv;
+	pool = &outc->pool;
+	if (!outc->workers)
+		return SR_OK;
+
+	g_mutex_init(&pool->mutex);
+	g_cond_init(&pool->cond);
+	pool->entries = g_ptr_array_new_with_free_func(free_entry);
+	for (idx = 0; idx < outc->workers * BUFFERS_PER_WORKER; idx++) {
+		buf = g_try_malloc(CHUNK_SIZE);
+		if (!buf)
+			return SR_ERR_MALLOC;
+		pool->free_bufs = g_slist_prepend(pool->free_bufs, buf);
+	}
+
+	error = NULL;
+	pool->threads = g_thread_pool_new(zip_pool_compress, outc,
+		outc->workers, FALSE, &error);
+	if (!pool->threads) {
+		sr_err("Cannot start compression workers: %s", error->message);
+		g_error_free(error);
+		return SR_ERR;
+	}
+	sr_dbg("Started %d compression workers.", outc->workers);
+
+	return SR_OK;
+}
+
+/**
+ * Queue a chunk of sample data for compression.
+ *
+ * Hands the buffer over to the compression workers, and returns a
+ * free buffer to the caller. Blocks when all buffers are in use.
+ *
+ * @param[in] o Output module instance.
+ * @param[in] name Archive entry name.
+ * @param[in] buf Sample data.
+ * @param[in] length Sample data size in bytes.
+ * @param[out] next_buf Buffer to continue filling.
+ *
+ * @returns SR_OK et al error codes.
+ */
+static int zip_add_chunk_pool(const struct sr_output *o,
+	const char *name, void *buf, size_t length, void **next_buf)
+{
+	struct out_context *outc;
+	struct compress_pool *pool;
+	struct chunk_job *job;
+	int64_t stall_start;
+	int ret;
+
+	outc = o->priv;
+	pool = &outc->pool;
+
+	g_mutex_lock(&pool->mutex);
+	ret = pool->error;
+	if (ret != SR_OK) {
+		g_mutex_unlock(&pool->mutex);
+		return ret;
+	}
+	if (!pool->free_bufs) {
+		pool->stall_count++;
+		stall_start = g_get_monotonic_time();
+		while (!pool->free_bufs)
+			g_cond_wait(&pool->cond, &pool->mutex);
+		pool->stall_time += g_get_monotonic_time() - stall_start;
+	}
+	*next_buf = pool->free_bufs->data;
+	pool->free_bufs = g_slist_delete_link(pool->free_bufs,
+		pool->free_bufs);
+	job = g_malloc0(sizeof(*job));
+	job->seq = pool->next_seq++;
+	job->name = g_strdup(name);
+	job->data = buf;
+	job->length = length;
+	g_mutex_unlock(&pool->mutex);
+
+	g_thread_pool_push(pool->threads, job, NULL);
+
+	return SR_OK;
+}
+
+/**
+ * Wait for the compression workers, and add their output to the archive.
+ *
+ * @param[in] o Output module instance.
+ *
+ * @returns SR_OK et al error codes.
+ */
+static int zip_pool_finish(const struct sr_output *o)
+{
+	struct out_context *outc;
+	struct compress_pool *pool;
+	struct chunk_entry *entry;
+	struct zip_source *src;
+	zip_int64_t index;
+	guint idx;
+
+	outc = o->priv;
+	pool = &outc->pool;
+	if (!pool->threads)
+		return SR_OK;
+
+	g_thread_pool_free(pool->threads, FALSE, TRUE);
+	pool->threads = NULL;
+	sr_info("Compression queue stalled %" PRIu64 " times, %" PRIi64 "ms total.",
+		pool->stall_count, pool->stall_time / 1000);
+	if (pool->error)
+		return pool->error;
+
+	for (idx = 0; idx < pool->entries->len; idx++) {
+		entry = g_ptr_array_index(pool->entries, idx);
+		src = zip_source_function(outc->archive, zip_pool_source, entry);
+		if (!src) {
+			sr_err("Cannot reference chunk '%s': %s",
+				entry->name, zip_strerror(outc->archive));
+			return SR_ERR;
+		}
+		index = zip_add(outc->archive, entry->name, src);
+		if (index < 0) {
+			sr_err("Failed to add chunk '%s': %s",
+				entry->name, zip_strerror(outc->archive));
+			zip_source_free(src);
+			return SR_ERR;
+		}
+		/* Deflated data passes as is, stored data must stay so. */
+		if (entry->stored)
+			zip_set_compression(outc, index, TRUE);
+	}
+
+	return SR_OK;
+}
+
+static void zip_pool_free(struct out_context *outc)
+{
+	struct compress_pool *pool;
+
+	pool = &outc->pool;
+	if (!pool->entries)
+		return;
+
+	if (pool->threads)
+		g_thread_pool_free(pool->threads, FALSE, TRUE);
+	pool->threads = NULL;
+	g_slist_free_full(pool->free_bufs, g_free);
+	pool->free_bufs = NULL;
+	g_ptr_array_free(pool->entries, TRUE);
+	pool->entries = NULL;
+	g_cond_clear(&pool->cond);
+	g_mutex_clear(&pool->mutex);
+}
+
+#else
+
+static int zip_pool_start(const struct sr_output *o)
+{
+	(void)o;
+
+	return SR_OK;
+}
+
+static int zip_add_chunk_pool(const struct sr_output *o,
+	const char *name, void *buf, size_t length, void **next_buf)
+{
+	(void)o;
+	(void)name;
+	(void)buf;
+	(void)length;
+	(void)next_buf;
+
+	return SR_ERR_NA;
+}
+
+static int zip_pool_finish(const struct sr_output *o)
+{
+	(void)o;
+
+	return SR_OK;
+}
+
+static void zip_pool_free(struct out_context *outc)
+{
+	(void)outc;
+}
+
+#endif
+
+/**
+ * Add a chunk of sample data to the srzip archive.
+ *
+ * @param[in] o Output module instance.
+ * @param[in] name Archive entry name.
+ * @param[in] buf Sample data.
+ * @param[in] length Sample data size in bytes.
+ * @param[out] next_buf Buffer to continue filling, may differ from buf.
+ *
+ * @returns SR_OK et al error codes.
+ */
+static int zip_add_chunk(const struct sr_output *o,
+	const char *name, void *buf, size_t length, void **next_buf)
+{
+	struct out_context *outc;
+
+	outc = o->priv;
+	if (outc->workers)
+		return zip_add_chunk_pool(o, name, buf, length, next_buf);
+
+	*next_buf = buf;
+
+	return zip_add_chunk_sync(o, name, buf, length);
+}
+
 static int zip_create(const struct sr_output *o)
 {
 	struct out_context *outc;
 	struct zip *zipfile;
-	struct zip_source *versrc, *metasrc;
+	struct zip_source *versrc;
 	struct sr_channel *ch;
 	size_t ch_nr;
 	size_t alloc_size;
@@ -80,8 +662,8 @@ static int zip_create(const struct sr_output *o)
 	GKeyFile *meta;
 	GSList *l;
 	const char *devgroup;
-	char *s, *metabuf;
-	gsize metalen;
+	char *s;
+	int fd;
 	guint logic_channels, enabled_logic_channels;
 	guint enabled_analog_channels;
 	guint index;
@@ -110,8 +692,38 @@ static int zip_create(const struct sr_output *o)
 		return SR_ERR;
 	}
 
-	/* init "metadata" */
+	/*
+	 * Chunk data gets spooled to a scratch file next to the
+	 * archive, libzip only reads it back when the archive gets
+	 * closed at the end of the acquisition.
+	 */
+	outc->spool.filename = g_strdup_printf("%s.XXXXXX", outc->filename);
+	fd = g_mkstemp(outc->spool.filename);
+	if (fd < 0) {
+		sr_err("Cannot create spool file '%s': %s",
+			outc->spool.filename, g_strerror(errno));
+		zip_discard(zipfile);
+		return SR_ERR;
+	}
+	outc->spool.file = fdopen(fd, "wb");
+	if (!outc->spool.file) {
+		sr_err("Cannot open spool file '%s': %s",
+			outc->spool.filename, g_strerror(errno));
+		close(fd);
+		g_unlink(outc->spool.filename);
+		zip_discard(zipfile);
+		return SR_ERR;
+	}
+	outc->spool.size = 0;
+	outc->archive = zipfile;
+
+	/*
+	 * init "metadata", keep it around. It gets completed as data
+	 * arrives (unit size) and gets written along with the ZIP
+	 * archive's central directory at the end of the acquisition.
+	 */
 	meta = g_key_file_new();
+	outc->meta = meta;
 
 	g_key_file_set_string(meta, "global", "sigrok version",
 			sr_package_version_string_get());
@@ -227,33 +839,171 @@ static int zip_create(const struct sr_output *o)
 		outc->analog_buff[index].fill_size = 0;
 	}
 
-	metabuf = g_key_file_to_data(meta, &metalen, NULL);
-	g_key_file_free(meta);
+	outc->logic_buff.chunk_num = 1;
+	for (index = 0; index < outc->analog_ch_count; index++)
+		outc->analog_buff[index].chunk_num = 1;
 
-	metasrc = zip_source_buffer(zipfile, metabuf, metalen, FALSE);
-	if (zip_add(zipfile, "metadata", metasrc) < 0) {
-		sr_err("Error saving metadata into zipfile: %s",
-			zip_strerror(zipfile));
-		zip_source_free(metasrc);
-		zip_discard(zipfile);
-		g_free(metabuf);
+	/* Summarize the chunks for random access by readers. */
+	outc->index = sr_session_index_new();
+	if (outc->with_overview)
+		outc->overview = sr_overview_new(0);
+	if (enabled_logic_channels > 0) {
+		outc->logic_buff.index = sr_session_index_add(outc->index,
+			"logic-1", SR_CHANNEL_LOGIC,
+			outc->logic_buff.zip_unit_size);
+		if (outc->overview)
+			outc->logic_buff.overview = sr_overview_track_add(
+				outc->overview, "logic-1", SR_CHANNEL_LOGIC,
+				outc->logic_buff.zip_unit_size);
+	}
+	for (index = 0; index < outc->analog_ch_count; index++) {
+		s = g_strdup_printf("analog-1-%zu",
+			outc->first_analog_index + index);
+		outc->analog_buff[index].index = sr_session_index_add(
+			outc->index, s, SR_CHANNEL_ANALOG, 0);
+		if (outc->overview)
+			outc->analog_buff[index].overview = sr_overview_track_add(
+				outc->overview, s, SR_CHANNEL_ANALOG, 0);
+		g_free(s);
+	}
+
+	return zip_pool_start(o);
+}
+
+/**
+ * Add the chunk index to the srzip archive.
+ *
+ * @param[in] o Output module instance.
+ *
+ * @returns SR_OK et al error codes.
+ */
+static int zip_add_index(const struct sr_output *o)
+{
+	struct out_context *outc;
+	struct zip_source *src;
+	GKeyFile *kf;
+	gsize len;
+
+	outc = o->priv;
+	kf = g_key_file_new();
+	sr_session_index_save(outc->index, kf);
+	outc->indexbuf = g_key_file_to_data(kf, &len, NULL);
+	g_key_file_free(kf);
+
+	src = zip_source_buffer(outc->archive, outc->indexbuf, len, FALSE);
+	if (zip_add(outc->archive, "index", src) < 0) {
+		sr_err("Error saving index into zipfile: %s",
+			zip_strerror(outc->archive));
+		zip_source_free(src);
 		return SR_ERR;
 	}
 
-	if (zip_close(zipfile) < 0) {
-		sr_err("Error saving zipfile: %s", zip_strerror(zipfile));
-		zip_discard(zipfile);
-		g_free(metabuf);
+	return SR_OK;
+}
+
+/**
+ * Add the multi-resolution overview to the srzip archive.
+ *
+ * @param[in] o Output module instance.
+ *
+ * @returns SR_OK et al error codes.
+ */
+static int zip_add_overview(const struct sr_output *o)
+{
+	struct out_context *outc;
+	struct zip_source *src;
+
+	outc = o->priv;
+	if (!outc->overview)
+		return SR_OK;
+
+	outc->overviewbuf = sr_overview_save(outc->overview);
+	src = zip_source_buffer(outc->archive, outc->overviewbuf->data,
+		outc->overviewbuf->len, FALSE);
+	if (zip_add(outc->archive, "overview", src) < 0) {
+		sr_err("Error saving overview into zipfile: %s",
+			zip_strerror(outc->archive));
+		zip_source_free(src);
 		return SR_ERR;
 	}
-	g_free(metabuf);
 
 	return SR_OK;
 }
 
+/**
+ * Complete the srzip archive.
+ *
+ * Adds the metadata, and has libzip write the archive. This is where
+ * the chunks get compressed and the central directory gets written,
+ * exactly once per acquisition.
+ *
+ * @param[in] o Output module instance.
+ *
+ * @returns SR_OK et al error codes.
+ */
+static int zip_finalize(const struct sr_output *o)
+{
+	struct out_context *outc;
+	struct zip_source *metasrc;
+	gsize metalen;
+	int ret;
+
+	outc = o->priv;
+	if (!outc->archive)
+		return SR_OK;
+
+	ret = zip_pool_finish(o);
+	if (ret == SR_OK)
+		ret = zip_add_index(o);
+	if (ret == SR_OK)
+		ret = zip_add_overview(o);
+	outc->metabuf = g_key_file_to_data(outc->meta, &metalen, NULL);
+	metasrc = zip_source_buffer(outc->archive,
+		outc->metabuf, metalen, FALSE);
+	if (ret == SR_OK && zip_add(outc->archive, "metadata", metasrc) < 0) {
+		sr_err("Error saving metadata into zipfile: %s",
+			zip_strerror(outc->archive));
+		zip_source_free(metasrc);
+		ret = SR_ERR;
+	} else if (ret != SR_OK) {
+		zip_source_free(metasrc);
+	}
+
+	if (fclose(outc->spool.file) != 0) {
+		sr_err("Cannot write to spool file '%s': %s",
+			outc->spool.filename, g_strerror(errno));
+		ret = SR_ERR_IO;
+	}
+	outc->spool.file = NULL;
+
+	if (ret != SR_OK) {
+		zip_discard(outc->archive);
+	} else if (zip_close(outc->archive) < 0) {
+		sr_err("Error saving session file: %s",
+			zip_strerror(outc->archive));
+		zip_discard(outc->archive);
+		ret = SR_ERR;
+	}
+	outc->archive = NULL;
+
+	g_unlink(outc->spool.filename);
+	g_free(outc->metabuf);
+	outc->metabuf = NULL;
+	g_free(outc->indexbuf);
+	outc->indexbuf = NULL;
+	if (outc->overviewbuf)
+		g_byte_array_free(outc->overviewbuf, TRUE);
+	outc->overviewbuf = NULL;
+
+	return ret;
+}
+
 /**
  * Append a block of logic data to an srzip archive.
  *
+ * Passes ownership of the logic buffer's samples, when the caller
+ * passes that buffer. The buffer may get replaced.
+ *
  * @param[in] o Output module instance.
  * @param[in] buf Logic data samples as byte sequence.
  * @param[in] unitsize Logic data unit size (bytes per sample).
@@ -265,121 +1015,41 @@ static int zip_append(const struct sr_output *o,
 	uint8_t *buf, size_t unitsize, size_t length)
 {
 	struct out_context *outc;
-	struct zip *archive;
-	struct zip_source *logicsrc;
-	int64_t i, num_files;
-	struct zip_stat zs;
-	struct zip_source *metasrc;
-	GKeyFile *kf;
-	GError *error;
-	uint64_t chunk_num;
-	const char *entry_name;
-	char *metabuf;
-	gsize metalen;
 	char *chunkname;
-	unsigned int next_chunk_num;
+	void *next_buf;
+	int ret;
 
 	if (!length)
 		return SR_OK;
 
 	outc = o->priv;
-	if (!(archive = zip_open(outc->filename, 0, NULL)))
-		return SR_ERR;
-
-	if (zip_stat(archive, "metadata", 0, &zs) < 0) {
-		sr_err("Failed to open metadata: %s", zip_strerror(archive));
-		zip_discard(archive);
-		return SR_ERR;
-	}
-	kf = sr_sessionfile_read_metadata(archive, &zs);
-	if (!kf) {
-		zip_discard(archive);
-		return SR_ERR_DATA;
-	}
-	/*
-	 * If the file was only initialized but doesn't yet have any
-	 * data it in, it won't have a unitsize field in metadata yet.
-	 */
-	error = NULL;
-	metabuf = NULL;
-	if (!g_key_file_has_key(kf, "device 1", "unitsize", &error)) {
-		if (error && error->code != G_KEY_FILE_ERROR_KEY_NOT_FOUND) {
-			sr_err("Failed to check unitsize key: %s", error->message);
-			g_error_free(error);
-			g_key_file_free(kf);
-			zip_discard(archive);
-			return SR_ERR;
-		}
-		g_clear_error(&error);
-
-		/* Add unitsize field. */
-		g_key_file_set_integer(kf, "device 1", "unitsize", unitsize);
-		metabuf = g_key_file_to_data(kf, &metalen, NULL);
-		metasrc = zip_source_buffer(archive, metabuf, metalen, FALSE);
-
-		if (zip_replace(archive, zs.index, metasrc) < 0) {
-			sr_err("Failed to replace metadata: %s",
-				zip_strerror(archive));
-			g_key_file_free(kf);
-			zip_source_free(metasrc);
-			zip_discard(archive);
-			g_free(metabuf);
-			return SR_ERR;
-		}
-	}
-	g_key_file_free(kf);
 
-	next_chunk_num = 1;
-	num_files = zip_get_num_entries(archive, 0);
-	for (i = 0; i < num_files; i++) {
-		entry_name = zip_get_name(archive, i, 0);
-		if (!entry_name || strncmp(entry_name, "logic-1", 7) != 0)
-			continue;
-		if (entry_name[7] == '\0') {
-			/*
-			 * This file has no extra chunks, just a single
-			 * "logic-1". Rename it to "logic-1-1" and continue
-			 * with chunk 2.
-			 */
-			if (zip_rename(archive, i, "logic-1-1") < 0) {
-				sr_err("Failed to rename 'logic-1' to 'logic-1-1': %s",
-					zip_strerror(archive));
-				zip_discard(archive);
-				g_free(metabuf);
-				return SR_ERR;
-			}
-			next_chunk_num = 2;
-			break;
-		} else if (entry_name[7] == '-') {
-			chunk_num = g_ascii_strtoull(entry_name + 8, NULL, 10);
-			if (chunk_num < G_MAXINT && chunk_num >= next_chunk_num)
-				next_chunk_num = chunk_num + 1;
-		}
+	/* Add the unitsize field when the first logic data arrives. */
+	if (!outc->unitsize_seen) {
+		g_key_file_set_integer(outc->meta, "device 1",
+			"unitsize", unitsize);
+		outc->unitsize_seen = TRUE;
 	}
 
 	if (length % unitsize != 0) {
 		sr_warn("Chunk size %zu not a multiple of the"
 			" unit size %zu.", length, unitsize);
 	}
-	logicsrc = zip_source_buffer(archive, buf, length, FALSE);
-	chunkname = g_strdup_printf("logic-1-%u", next_chunk_num);
-	i = zip_add(archive, chunkname, logicsrc);
-	g_free(chunkname);
-	if (i < 0) {
-		sr_err("Failed to add chunk 'logic-1-%u': %s",
-			next_chunk_num, zip_strerror(archive));
-		zip_source_free(logicsrc);
-		zip_discard(archive);
-		g_free(metabuf);
-		return SR_ERR;
-	}
-	if (zip_close(archive) < 0) {
-		sr_err("Error saving session file: %s", zip_strerror(archive));
-		zip_discard(archive);
-		g_free(metabuf);
-		return SR_ERR;
+	if (outc->logic_buff.index) {
+		sr_session_index_chunk_start(outc->logic_buff.index);
+		sr_session_index_add_logic(outc->logic_buff.index, buf,
+			length / unitsize);
 	}
-	g_free(metabuf);
+	if (outc->logic_buff.overview)
+		sr_overview_add_logic(outc->overview, outc->logic_buff.overview,
+			buf, unitsize, length / unitsize);
+	chunkname = g_strdup_printf("logic-1-%zu", outc->logic_buff.chunk_num);
+	ret = zip_add_chunk(o, chunkname, buf, length, &next_buf);
+	g_free(chunkname);
+	if (ret != SR_OK)
+		return ret;
+	outc->logic_buff.samples = next_buf;
+	outc->logic_buff.chunk_num++;
 
 	return SR_OK;
 }
@@ -499,6 +1169,63 @@ static int zip_append_queue(const struct sr_output *o,
 	return SR_OK;
 }
 
+/**
+ * Queue run-length encoded logic data for srzip archive writes.
+ *
+ * Fills the local buffer with repetitions of each run's value, without
+ * an intermediate expansion of the complete input.
+ *
+ * @param[in] o Output module instance.
+ * @param[in] rle Run-length encoded logic data.
+ *
+ * @returns SR_OK et al error codes.
+ */
+static int zip_append_queue_rle(const struct sr_output *o,
+	const struct sr_datafeed_logic_rle *rle)
+{
+	struct out_context *outc;
+	struct logic_buff *buff;
+	uint8_t *value;
+	const uint8_t *rdptr;
+	uint8_t *wrptr;
+	uint64_t run, send_count;
+	size_t copy_size, remain, copy_count;
+	int ret;
+
+	outc = o->priv;
+	buff = &outc->logic_buff;
+
+	/* Adjust between input and output unit sizes once per run. */
+	value = g_malloc0(buff->zip_unit_size + 1);
+	copy_size = MIN((size_t)rle->unitsize, buff->zip_unit_size);
+	rdptr = rle->values;
+	ret = SR_OK;
+	for (run = 0; run < rle->num_runs && ret == SR_OK; run++) {
+		memcpy(value, rdptr, copy_size);
+		rdptr += rle->unitsize;
+		send_count = rle->lengths[run];
+		while (send_count) {
+			remain = buff->alloc_size - buff->fill_size;
+			wrptr = &buff->samples[buff->fill_size * buff->zip_unit_size];
+			copy_count = MIN(send_count, remain);
+			sr_samples_fill(wrptr, value, buff->zip_unit_size,
+				copy_count);
+			buff->fill_size += copy_count;
+			send_count -= copy_count;
+			if (buff->fill_size < buff->alloc_size)
+				continue;
+			ret = zip_append(o, buff->samples, buff->zip_unit_size,
+				buff->fill_size * buff->zip_unit_size);
+			if (ret != SR_OK)
+				break;
+			buff->fill_size = 0;
+		}
+	}
+	g_free(value);
+
+	return ret;
+}
+
 /**
  * Append analog data of a channel to an srzip archive.
  *
@@ -506,72 +1233,34 @@ static int zip_append_queue(const struct sr_output *o,
  * @param[in] values Sample data as array of floating point values.
  * @param[in] count Number of samples (float items, not bytes).
  * @param[in] ch_nr 1-based channel number.
+ * @param[in] buff Channel's sample buffer (tracks the chunk number).
  *
  * @returns SR_OK et al error codes.
  */
 static int zip_append_analog(const struct sr_output *o,
-	const float *values, size_t count, size_t ch_nr)
+	float *values, size_t count, size_t ch_nr,
+	struct analog_buff *buff)
 {
 	struct out_context *outc;
-	struct zip *archive;
-	struct zip_source *analogsrc;
-	int64_t i, num_files;
-	size_t size;
-	struct zip_stat zs;
-	uint64_t chunk_num;
-	const char *entry_name;
-	char *basename;
-	gsize baselen;
 	char *chunkname;
-	unsigned int next_chunk_num;
+	void *next_buf;
+	int ret;
 
 	outc = o->priv;
-
-	if (!(archive = zip_open(outc->filename, 0, NULL)))
-		return SR_ERR;
-
-	if (zip_stat(archive, "metadata", 0, &zs) < 0) {
-		sr_err("Failed to open metadata: %s", zip_strerror(archive));
-		zip_discard(archive);
-		return SR_ERR;
-	}
-
-	basename = g_strdup_printf("analog-1-%zu", ch_nr);
-	baselen = strlen(basename);
-	next_chunk_num = 1;
-	num_files = zip_get_num_entries(archive, 0);
-	for (i = 0; i < num_files; i++) {
-		entry_name = zip_get_name(archive, i, 0);
-		if (!entry_name || strncmp(entry_name, basename, baselen) != 0) {
-			continue;
-		} else if (entry_name[baselen] == '-') {
-			chunk_num = g_ascii_strtoull(entry_name + baselen + 1, NULL, 10);
-			if (chunk_num < G_MAXINT && chunk_num >= next_chunk_num)
-				next_chunk_num = chunk_num + 1;
-		}
-	}
-
-	size = sizeof(values[0]) * count;
-	analogsrc = zip_source_buffer(archive, values, size, FALSE);
-	chunkname = g_strdup_printf("%s-%u", basename, next_chunk_num);
-	i = zip_add(archive, chunkname, analogsrc);
-	if (i < 0) {
-		sr_err("Failed to add chunk '%s': %s", chunkname, zip_strerror(archive));
-		g_free(chunkname);
-		g_free(basename);
-		zip_source_free(analogsrc);
-		zip_discard(archive);
-		return SR_ERR;
-	}
+	sr_session_index_chunk_start(buff->index);
+	sr_session_index_add_analog(buff->index, values, count);
+	if (buff->overview)
+		sr_overview_add_analog(outc->overview, buff->overview,
+			values, count, 1);
+	chunkname = g_strdup_printf("analog-1-%zu-%zu",
+		ch_nr, buff->chunk_num);
+	ret = zip_add_chunk(o, chunkname,
+		values, sizeof(values[0]) * count, &next_buf);
 	g_free(chunkname);
-	if (zip_close(archive) < 0) {
-		sr_err("Error saving session file: %s", zip_strerror(archive));
-		g_free(basename);
-		zip_discard(archive);
-		return SR_ERR;
-	}
-
-	g_free(basename);
+	if (ret != SR_OK)
+		return ret;
+	buff->samples = next_buf;
+	buff->chunk_num++;
 
 	return SR_OK;
 }
@@ -606,7 +1295,7 @@ static int zip_append_analog_queue(const struct sr_output *o,
 			if (!buff->fill_size)
 				continue;
 			ret = zip_append_analog(o,
-				buff->samples, buff->fill_size, nr);
+				buff->samples, buff->fill_size, nr, buff);
 			if (ret != SR_OK)
 				return ret;
 			buff->fill_size = 0;
@@ -659,7 +1348,7 @@ static int zip_append_analog_queue(const struct sr_output *o,
 		}
 		if (send_size && !remain) {
 			ret = zip_append_analog(o,
-				buff->samples, buff->fill_size, nr);
+				buff->samples, buff->fill_size, nr, buff);
 			if (ret != SR_OK) {
 				g_free(values);
 				return ret;
@@ -672,7 +1361,8 @@ static int zip_append_analog_queue(const struct sr_output *o,
 
 	/* Flush to the ZIP archive if the caller wants us to. */
 	if (flush && buff->fill_size) {
-		ret = zip_append_analog(o, buff->samples, buff->fill_size, nr);
+		ret = zip_append_analog(o,
+			buff->samples, buff->fill_size, nr, buff);
 		if (ret != SR_OK)
 			return ret;
 		buff->fill_size = 0;
@@ -687,6 +1377,7 @@ static int receive(const struct sr_output *o, const struct sr_datafeed_packet *p
 	struct out_context *outc;
 	const struct sr_datafeed_meta *meta;
 	const struct sr_datafeed_logic *logic;
+	const struct sr_datafeed_logic_rle *rle;
 	const struct sr_datafeed_analog *analog;
 	const struct sr_config *src;
 	GSList *l;
@@ -719,6 +1410,17 @@ static int receive(const struct sr_output *o, const struct sr_datafeed_packet *p
 		if (ret != SR_OK)
 			return ret;
 		break;
+	case SR_DF_LOGIC_RLE:
+		if (!outc->zip_created) {
+			if ((ret = zip_create(o)) != SR_OK)
+				return ret;
+			outc->zip_created = TRUE;
+		}
+		rle = packet->payload;
+		ret = zip_append_queue_rle(o, rle);
+		if (ret != SR_OK)
+			return ret;
+		break;
 	case SR_DF_ANALOG:
 		if (!outc->zip_created) {
 			if ((ret = zip_create(o)) != SR_OK)
@@ -738,6 +1440,9 @@ static int receive(const struct sr_output *o, const struct sr_datafeed_packet *p
 			ret = zip_append_analog_queue(o, NULL, TRUE);
 			if (ret != SR_OK)
 				return ret;
+			ret = zip_finalize(o);
+			if (ret != SR_OK)
+				return ret;
 		}
 		break;
 	}
@@ -746,11 +1451,27 @@ static int receive(const struct sr_output *o, const struct sr_datafeed_packet *p
 }
 
 static struct sr_option options[] = {
+	{"compression", "Compression", "Compression of sample data (default, store, fast, best)", NULL, NULL},
+	{"workers", "Workers", "Number of compression threads (0 to compress when the file gets closed)", NULL, NULL},
+	{"overview", "Overview", "Store a multi-resolution overview of the samples (readers create it when needed otherwise)", NULL, NULL},
 	ALL_ZERO
 };
 
 static const struct sr_option *get_options(void)
 {
+	GSList *l = NULL;
+
+	if (!options[0].def) {
+		options[0].def = g_variant_ref_sink(g_variant_new_string("default"));
+		l = g_slist_append(l, g_variant_ref_sink(g_variant_new_string("default")));
+		l = g_slist_append(l, g_variant_ref_sink(g_variant_new_string("store")));
+		l = g_slist_append(l, g_variant_ref_sink(g_variant_new_string("fast")));
+		l = g_slist_append(l, g_variant_ref_sink(g_variant_new_string("best")));
+		options[0].values = l;
+		options[1].def = g_variant_ref_sink(g_variant_new_int32(2));
+		options[2].def = g_variant_ref_sink(g_variant_new_boolean(FALSE));
+	}
+
 	return options;
 }
 
@@ -761,6 +1482,16 @@ static int cleanup(struct sr_output *o)
 
 	outc = o->priv;
 
+	/* Don't lose data when the session did not send SR_DF_END. */
+	if (outc->archive)
+		zip_finalize(o);
+	zip_pool_free(outc);
+	if (outc->meta)
+		g_key_file_free(outc->meta);
+	sr_session_index_free(outc->index);
+	sr_overview_free(outc->overview);
+	g_free(outc->spool.filename);
+
 	g_free(outc->analog_index_map);
 	g_free(outc->filename);
 	g_free(outc->logic_buff.samples);
@@ -779,7 +1510,7 @@ SR_PRIV struct sr_output_module output_srzip = {
 	.name = "srzip",
 	.desc = "srzip session file format data",
 	.exts = (const char*[]){"sr", NULL},
-	.flags = SR_OUTPUT_INTERNAL_IO_HANDLING,
+	.flags = SR_OUTPUT_INTERNAL_IO_HANDLING | SR_OUTPUT_LOGIC_RLE,
 	.options = get_options,
 	.init = init,
 	.receive = receive,
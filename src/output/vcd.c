@@ -40,7 +40,6 @@
 #define LOG_PREFIX "output/vcd"
 
 static const int with_queue_stats = 0;
-static const int with_pool_stats = 0;
 
 struct vcd_channel_desc {
 	size_t index;
@@ -53,10 +52,18 @@ struct vcd_channel_desc {
 	uint64_t last_rcvd_snum;
 };
 
-/** Queued values for a given sample number. */
+/** Marks queue items which only carry a timestamp. */
+#define VCD_NO_CHANNEL	((size_t)-1)
+
+/** Queued value change for a given sample number. */
 struct vcd_queue_item {
 	uint64_t samplenum;	/**!< sample number, _not_ timestamp */
-	GString *values;	/**!< text of value changes */
+	uint64_t seq;		/**!< order of arrival, for equal sample numbers */
+	size_t desc_idx;	/**!< channel description, or VCD_NO_CHANNEL */
+	union {
+		uint8_t logic;
+		double real;
+	} value;
 };
 
 struct context {
@@ -67,12 +74,14 @@ struct context {
 	uint64_t period;
 	struct vcd_channel_desc *channels;
 	uint64_t samplerate;
-	GSList *free_list, *used_list;
-	size_t alloced, freed, reused, pooled;
-	GList *vcd_queue_list;
-	GList *vcd_queue_last;
+	struct vcd_queue_item *queue;
+	size_t queue_len, queue_size;
+	uint64_t queue_seq;
 	gboolean immediate_write;
 	uint8_t *last_logic;
+	size_t last_logic_size;
+	float *floats;
+	size_t floats_size;
 };
 
 /*
@@ -179,10 +188,28 @@ static GString *vcd_identifier(size_t idx)
 
 static void append_vcd_timestamp(GString *s, double ts, gboolean lf)
 {
+	char text[24], *p;
+	uint64_t value;
 
 	g_string_append_c(s, '\n');
 	g_string_append_c(s, '#');
-	g_string_append_printf(s, "%.0f", ts);
+	/*
+	 * Timestamps are integer in the typical case (the timescale is
+	 * a multiple of the samplerate). Avoid printf() for those, it
+	 * would dominate the cost of the output module.
+	 */
+	if (ts >= 0 && ts < (double)(UINT64_C(1) << 53) &&
+	    ts == (double)(uint64_t)ts) {
+		value = ts;
+		p = &text[sizeof(text)];
+		do {
+			*--p = '0' + value % 10;
+			value /= 10;
+		} while (value);
+		g_string_append_len(s, p, &text[sizeof(text)] - p);
+	} else {
+		g_string_append_printf(s, "%.0f", ts);
+	}
 	g_string_append_c(s, lf ? '\n' : ' ');
 }
 
@@ -190,7 +217,7 @@ static void format_vcd_value_bit(GString *s, uint8_t bit_value, GString *id)
 {
 
 	g_string_append_c(s, bit_value ? '1' : '0');
-	g_string_append(s, id->str);
+	g_string_append_len(s, id->str, id->len);
 }
 
 static void format_vcd_value_real(GString *s, double real_value, GString *id)
@@ -199,7 +226,7 @@ static void format_vcd_value_real(GString *s, double real_value, GString *id)
 	g_string_append_c(s, 'r');
 	g_string_append_printf(s, "%.16g", real_value);
 	g_string_append_c(s, ' ');
-	g_string_append(s, id->str);
+	g_string_append_len(s, id->str, id->len);
 }
 
 static int init(struct sr_output *o, GHashTable *options)
@@ -297,6 +324,7 @@ static int init(struct sr_output *o, GHashTable *options)
 	ctx->last_logic = g_malloc0(alloc_size);
 	if (ctx->logic_count && !ctx->last_logic)
 		return SR_ERR_MALLOC;
+	ctx->last_logic_size = alloc_size;
 
 	return SR_OK;
 }
@@ -443,345 +471,120 @@ static GString *chk_header(const struct sr_output *o)
  * have seen samples from all involved channels for a given samplenumber.
  * Data for a given sample number can only get emitted when we are sure
  * no other channel's data can arrive any more.
+ *
+ * The queue is a binary min-heap in one array, ordered by sample number
+ * and by arrival for changes of the same sample number. Items hold the
+ * raw values, text only gets generated when items are written out. For
+ * trivial cases (logic only, one analog channel only) the queue is
+ * bypassed.
  */
 
-static struct vcd_queue_item *queue_alloc_item(struct context *ctx, uint64_t snum)
+static gboolean queue_item_before(const struct vcd_queue_item *a,
+	const struct vcd_queue_item *b)
 {
-	GSList *node;
-	struct vcd_queue_item *item;
-
-	/* Get an item from the free list if available. */
-	node = ctx->free_list;
-	if (node) {
-		ctx->reused++;
-
-		/* Unlink GSList node from the free list. */
-		ctx->free_list = node->next;
-		node->next = NULL;
-		item = node->data;
-		node->data = NULL;
-
-		/* Setup content of the item. */
-		item->samplenum = snum;
-		if (!item->values)
-			item->values = g_string_sized_new(32);
-		else
-			g_string_truncate(item->values, 0);
-
-		/* Keep GSList node in the used list (avoid free/alloc). */
-		node->next = ctx->used_list;
-		ctx->used_list = node;
-
-		return item;
-	}
-
-	/* Dynamic allocation of an item. */
-	ctx->alloced++;
-	item = g_malloc0(sizeof(*item));
-	if (!item)
-		return NULL;
-	item->samplenum = snum;
-	item->values = g_string_sized_new(32);
-
-	/* Create a used list item, to later move to the free list. */
-	ctx->used_list = g_slist_prepend(ctx->used_list, item);
-
-	return item;
+	if (a->samplenum != b->samplenum)
+		return a->samplenum < b->samplenum;
+	return a->seq < b->seq;
 }
 
-static void queue_free_item(struct context *ctx, struct vcd_queue_item *item)
+static int queue_push(struct context *ctx, uint64_t snum,
+	size_t desc_idx, struct vcd_queue_item **ret_item)
 {
-	GSList *node;
-
-	/*
-	 * Put item back into the free list. We can assume to find a
-	 * used list node, it got allocated when the item was acquired.
-	 */
-	node = ctx->used_list;
-	if (node) {
-		ctx->pooled++;
-
-		ctx->used_list = node->next;
-		node->next = NULL;
-		node->data = item;
-
-		item->samplenum = 0;
-		g_string_truncate(item->values, 0);
+	struct vcd_queue_item *queue, item;
+	size_t new_size, pos, parent;
 
-		node->next = ctx->free_list;
-		ctx->free_list = node;
-
-		return;
+	if (ctx->queue_len == ctx->queue_size) {
+		new_size = ctx->queue_size ? 2 * ctx->queue_size : 256;
+		queue = g_try_realloc(ctx->queue, new_size * sizeof(*queue));
+		if (!queue)
+			return SR_ERR_MALLOC;
+		ctx->queue = queue;
+		ctx->queue_size = new_size;
 	}
+	if (with_queue_stats)
+		sr_spew("%s(), queue nr %" PRIu64, __func__, snum);
+
+	item.samplenum = snum;
+	item.seq = ctx->queue_seq++;
+	item.desc_idx = desc_idx;
+	item.value.real = 0.0;
+
+	/* Sift up. Items mostly arrive in order, this rarely iterates. */
+	pos = ctx->queue_len++;
+	while (pos) {
+		parent = (pos - 1) / 2;
+		if (!queue_item_before(&item, &ctx->queue[parent]))
+			break;
+		ctx->queue[pos] = ctx->queue[parent];
+		pos = parent;
+	}
+	ctx->queue[pos] = item;
+	*ret_item = &ctx->queue[pos];
 
-	/*
-	 * Release dynamically allocated resources. Could also be used
-	 * to release free list items when the use list is empty.
-	 */
-	ctx->freed++;
-	if (item->values)
-		g_string_free(item->values, TRUE);
-	g_free(item);
+	return SR_OK;
 }
 
-static void queue_drain_pool_cb(gpointer data, gpointer cb_data)
+static int queue_logic(struct context *ctx, uint64_t snum,
+	size_t desc_idx, uint8_t bit_value)
 {
-	struct context *ctx;
 	struct vcd_queue_item *item;
+	int rc;
 
-	item = data;
-	ctx = cb_data;
-	queue_free_item(ctx, item);
-}
-
-static void queue_drain_pool(struct context *ctx)
-{
-	GSList *list;
+	rc = queue_push(ctx, snum, desc_idx, &item);
+	if (rc != SR_OK)
+		return rc;
+	item->value.logic = bit_value;
 
-	/*
-	 * Grab the list and "empty" the context member. Then
-	 * iterate over the items, have dymamic memory released.
-	 * Then free the GSList nodes (but not their data parts).
-	 * Do this for the used and the free lists.
-	 */
-	list = ctx->used_list;
-	ctx->used_list = NULL;
-	g_slist_foreach(list, queue_drain_pool_cb, ctx);
-	g_slist_free(list);
-
-	list = ctx->free_list;
-	ctx->free_list = NULL;
-	g_slist_foreach(list, queue_drain_pool_cb, ctx);
-	g_slist_free(list);
+	return SR_OK;
 }
 
-static int cmp_snum(gconstpointer l, gconstpointer d)
+static int queue_real(struct context *ctx, uint64_t snum,
+	size_t desc_idx, double real_value)
 {
-	const struct vcd_queue_item *list_item;
-	const uint64_t *snum_ptr;
-
-	list_item = l;
-	snum_ptr = d;
-	if (list_item->samplenum > *snum_ptr)
-		return +1;
-	if (list_item->samplenum < *snum_ptr)
-		return -1;
-	return 0;
-}
+	struct vcd_queue_item *item;
+	int rc;
 
-static int cmp_items(gconstpointer a, gconstpointer b)
-{
-	const struct vcd_queue_item *item_a, *item_b;
-
-	item_a = a;
-	item_b = b;
-	if (item_a->samplenum > item_b->samplenum)
-		return +1;
-	if (item_a->samplenum < item_b->samplenum)
-		return -1;
-	return 0;
+	rc = queue_push(ctx, snum, desc_idx, &item);
+	if (rc != SR_OK)
+		return rc;
+	item->value.real = real_value;
+
+	return SR_OK;
 }
 
-/*
- * Position the current pointer of the VCD value queue to a specific
- * sample number. Create a new queue item when needed. The logic assumes
- * a specific use pattern: Reception of striped sample data for channels
- * and processing in strict order of sample numbers within a channel.
- * Lower sample numbers near the start of the queue when channels change
- * between session feed packets, before another linear sequence follows.
- *
- * Naive use of convenience glib routines would severely lose performance.
- * That's why custom code is used, which is as complex as it needs to be,
- * yet shall execute faster than a simpler implementation. For trivial
- * cases (logic only, one analog channel only) this queue is bypassed.
- */
+/* Queue a timestamp which has no value changes. */
 static int queue_samplenum(struct context *ctx, uint64_t snum)
 {
-	struct vcd_queue_item *item, *add_item;
-	GList *walk_list, *after_snum, *before_snum, *add_list;
-	GList *last;
-	gboolean add_after_last, do_search;
-
-	/* Already at that position? */
-	item = ctx->vcd_queue_last ? ctx->vcd_queue_last->data : NULL;
-	if (item && item->samplenum == snum)
-		return SR_OK;
-
-	/*
-	 * Search after the current position in the remaining queue. The
-	 * custom code uses the queue's being sorted by sample number.
-	 * Narrow down a later insert position as much as possible. This
-	 * avoids linear search in huge spaces later on.
-	 */
-	last = NULL;
-	add_after_last = FALSE;
-	after_snum = NULL;
-	before_snum = NULL;
-	walk_list = ctx->vcd_queue_last;
-	while (walk_list) {
-		item = walk_list->data;
-		if (!item)
-			break;
-		if (item->samplenum == snum) {
-			ctx->vcd_queue_last = walk_list;
-			return SR_OK;
-		}
-		last = walk_list;
-		if (item->samplenum < snum)
-			before_snum = walk_list;
-		if (item->samplenum > snum) {
-			after_snum = walk_list;
-			break;
-		}
-		if (!walk_list->next)
-			add_after_last = TRUE;
-		walk_list = walk_list->next;
-	}
-
-	/*
-	 * No exact match at or beyond the current position. Run another
-	 * search from the start of the queue, again restrict the space
-	 * which is searched, and narrow down the insert position when
-	 * no match is found.
-	 *
-	 * If the searched sample number is larger than any we have seen
-	 * before, or was in the above covered range but was not found,
-	 * then we know that another queue item needs to get added, and
-	 * where to put it. In that case we need not iterate the earlier
-	 * list items.
-	 */
-	walk_list = ctx->vcd_queue_list;
-	do_search = TRUE;
-	if (add_after_last)
-		do_search = FALSE;
-	if (before_snum)
-		do_search = FALSE;
-	while (do_search && walk_list && walk_list != ctx->vcd_queue_last) {
-		item = walk_list->data;
-		if (!item)
-			break;
-		if (item->samplenum == snum) {
-			ctx->vcd_queue_last = walk_list;
-			return SR_OK;
-		}
-		if (item->samplenum < snum)
-			before_snum = walk_list;
-		if (item->samplenum > snum) {
-			after_snum = walk_list;
-			break;
-		}
-		walk_list = walk_list->next;
-	}
-
-	/*
-	 * The complete existing queue was exhausted, no exact match was
-	 * found. A new queue item must get inserted. Identify a good
-	 * position where to start searching for the exact position to
-	 * link the new item to the list. Assume that the combination of
-	 * the glib routine's list traversal and the sample number check
-	 * in the callback is expensive, reduce the amount of work done.
-	 *
-	 * If we have seen an item with a larger sample number than the
-	 * wanted, check its immediate predecessor. If this has a smaller
-	 * sample number, then we found a perfect location to insert the
-	 * new item. If we know that the new item must be inserted after
-	 * the last traversed queue item, start there.
-	 */
-	if (!before_snum) do {
-		if (add_after_last)
-			break;
-		if (!after_snum)
-			break;
-		walk_list = after_snum->prev;
-		if (!walk_list)
-			break;
-		item = walk_list->data;
-		if (!item)
-			break;
-		if (item->samplenum == snum) {
-			ctx->vcd_queue_last = walk_list;
-			return SR_OK;
-		}
-		if (item->samplenum < snum)
-			before_snum = walk_list;
-	} while (0);
-	add_list = add_after_last ? last : before_snum;
-	if (!add_list) {
-		walk_list = ctx->vcd_queue_list;
-		while (walk_list) {
-			item = walk_list->data;
-			if (!item)
-				break;
-			if (item->samplenum == snum) {
-				ctx->vcd_queue_last = walk_list;
-				return SR_OK;
-			}
-			if (item->samplenum > snum) {
-				after_snum = walk_list;
-				break;
-			}
-			add_list = walk_list;
-			walk_list = walk_list->next;
-		}
-	}
-	if (add_list && (item = add_list->data) && item->samplenum == snum) {
-		ctx->vcd_queue_last = add_list;
-		return SR_OK;
-	}
+	struct vcd_queue_item *item;
 
-	/*
-	 * Create a new queue item for the so far untracked sample
-	 * number. Immediately search for the inserted position (is
-	 * unfortunately not returned from the insert call), and
-	 * cache that position for subsequent lookups.
-	 */
-	if (with_queue_stats)
-		sr_dbg("%s(), queue nr %" PRIu64, __func__, snum);
-	add_item = queue_alloc_item(ctx, snum);
-	if (!add_item)
-		return SR_ERR_MALLOC;
-	if (!add_list)
-		add_list = ctx->vcd_queue_list;
-	if (add_list && add_list->prev)
-		add_list = add_list->prev;
-	walk_list = g_list_insert_sorted(add_list, add_item, cmp_items);
-	if (!walk_list->prev)
-		ctx->vcd_queue_list = walk_list;
-	walk_list = g_list_find_custom(walk_list, &snum, cmp_snum);
-	item = walk_list ? walk_list->data : NULL;
-	if (item && item->samplenum == snum) {
-		ctx->vcd_queue_last = walk_list;
-	}
-	return SR_OK;
+	return queue_push(ctx, snum, VCD_NO_CHANNEL, &item);
 }
 
-/*
- * Prepare to append another text fragment for a value change to the
- * queue item which corresponds to the current sample number. Return
- * the GString which the caller then will append to.
- */
-static GString *queue_value_text_prep(struct context *ctx)
+/* Remove the first item from the queue, and return a copy of it. */
+static void queue_pop(struct context *ctx, struct vcd_queue_item *ret_item)
 {
-	struct vcd_queue_item *item;
-	GString *buff;
-
-	/* Cope with not-yet-positioned write pointers. */
-	item = ctx->vcd_queue_last ? ctx->vcd_queue_last->data : NULL;
-	if (!item)
-		return NULL;
-
-	/* Create a GString if not done already. */
-	buff = item->values;
-	if (!buff) {
-		buff = g_string_sized_new(20);
-		item->values = buff;
-	}
+	struct vcd_queue_item *queue, last;
+	size_t len, pos, child;
 
-	/* Separate items with spaces (if previous content is present). */
-	if (buff->len)
-		g_string_append_c(buff, ' ');
+	queue = ctx->queue;
+	*ret_item = queue[0];
+	len = --ctx->queue_len;
+	if (!len)
+		return;
 
-	return buff;
+	/* Sift down the former last item from the top. */
+	last = queue[len];
+	pos = 0;
+	while ((child = 2 * pos + 1) < len) {
+		if (child + 1 < len &&
+		    queue_item_before(&queue[child + 1], &queue[child]))
+			child++;
+		if (!queue_item_before(&queue[child], &last))
+			break;
+		queue[pos] = queue[child];
+		pos = child;
+	}
+	queue[pos] = last;
 }
 
 static double snum_to_ts(struct context *ctx, uint64_t snum)
@@ -795,15 +598,27 @@ static double snum_to_ts(struct context *ctx, uint64_t snum)
 	return ts;
 }
 
+static void format_queue_item(struct context *ctx,
+	const struct vcd_queue_item *item, GString *s)
+{
+	struct vcd_channel_desc *desc;
+
+	desc = &ctx->channels[item->desc_idx];
+	if (desc->type == SR_CHANNEL_LOGIC)
+		format_vcd_value_bit(s, item->value.logic, desc->name);
+	else
+		format_vcd_value_real(s, item->value.real, desc->name);
+}
+
 /*
- * Unqueue one item of the VCD values queue which corresponds to one
- * sample number. Append all of the text to the passed in GString.
+ * Unqueue all items of the VCD values queue which correspond to the
+ * first queued sample number. Append all of the text to the passed in
+ * GString.
  */
-static int unqueue_item(struct context *ctx,
-	struct vcd_queue_item *item, GString *s)
+static void unqueue_samplenum(struct context *ctx, GString *s)
 {
-	double ts;
-	GString *buff;
+	struct vcd_queue_item item;
+	uint64_t snum;
 	gboolean is_empty;
 
 	/*
@@ -812,14 +627,26 @@ static int unqueue_item(struct context *ctx,
 	 * timestamp but no value changes, assuming this is the last
 	 * entry which corresponds to SR_DF_END.
 	 */
-	ts = snum_to_ts(ctx, item->samplenum);
-	buff = item->values;
-	is_empty = !buff || !buff->len || !buff->str || !*buff->str;
-	append_vcd_timestamp(s, ts, is_empty);
-	if (!is_empty)
-		g_string_append(s, buff->str);
+	queue_pop(ctx, &item);
+	snum = item.samplenum;
+	while (item.desc_idx == VCD_NO_CHANNEL && ctx->queue_len &&
+	    ctx->queue[0].samplenum == snum)
+		queue_pop(ctx, &item);
+	is_empty = item.desc_idx == VCD_NO_CHANNEL;
+	if (with_queue_stats)
+		sr_dbg("%s(), dump nr %" PRIu64, __func__, snum);
+	append_vcd_timestamp(s, snum_to_ts(ctx, snum), is_empty);
+	if (is_empty)
+		return;
+	format_queue_item(ctx, &item, s);
 
-	return SR_OK;
+	while (ctx->queue_len && ctx->queue[0].samplenum == snum) {
+		queue_pop(ctx, &item);
+		if (item.desc_idx == VCD_NO_CHANNEL)
+			continue;
+		g_string_append_c(s, ' ');
+		format_queue_item(ctx, &item, s);
+	}
 }
 
 /*
@@ -931,13 +758,9 @@ static uint64_t get_max_snum_flush(struct context *ctx)
  * Pass all queued value changes when we are certain we have received
  * data from all channels.
  */
-static int write_completed_changes(struct context *ctx, GString *out)
+static void write_completed_changes(struct context *ctx, GString *out)
 {
 	uint64_t upto_snum;
-	GList **listref, *node;
-	struct vcd_queue_item *item;
-	int rc;
-	size_t dumped;
 
 	/* Determine the number which all data was received for so far. */
 	upto_snum = get_max_snum_export(ctx);
@@ -945,37 +768,101 @@ static int write_completed_changes(struct context *ctx, GString *out)
 		sr_spew("%s(), check up to %" PRIu64, __func__, upto_snum);
 
 	/*
-	 * Forward and consume those items from the head of the list
+	 * Forward and consume those items from the head of the queue
 	 * which we completely have accumulated and are certain about.
 	 */
-	dumped = 0;
-	listref = &ctx->vcd_queue_list;
-	while (*listref) {
-		/* Find items before the targetted sample number. */
-		node = *listref;
-		item = node->data;
-		if (!item)
-			break;
-		if (item->samplenum >= upto_snum)
-			break;
+	while (ctx->queue_len && ctx->queue[0].samplenum < upto_snum)
+		unqueue_samplenum(ctx, out);
+}
+
+/* The last sample buffer must hold the received packets' unitsize. */
+static int grow_last_logic(struct context *ctx, size_t unit_size)
+{
+	uint8_t *last_logic;
+
+	last_logic = g_try_realloc(ctx->last_logic, unit_size);
+	if (!last_logic)
+		return SR_ERR_MALLOC;
+	memset(&last_logic[ctx->last_logic_size], 0,
+		unit_size - ctx->last_logic_size);
+	ctx->last_logic = last_logic;
+	ctx->last_logic_size = unit_size;
+
+	return SR_OK;
+}
+
+/*
+ * Check one logic sample for value changes, and queue or emit the text
+ * for the changed channels.
+ */
+static int process_logic_sample(struct context *ctx, GString *out,
+	const uint8_t *sample, size_t unit_size, uint64_t snum_curr)
+{
+	struct vcd_channel_desc *desc;
+	uint8_t *last_logic, prevbit, curbit;
+	size_t index, p, queued;
+	gboolean changed;
+	double ts;
+	int rc;
+
+	last_logic = ctx->last_logic;
+
+	/* Check whether any logic value has changed. */
+	changed = memcmp(last_logic, sample, unit_size) != 0;
+	changed |= snum_curr == 0;
+	if (!changed)
+		return SR_OK;
+	memcpy(last_logic, sample, unit_size);
+
+	/* Avoid the queue for logic-only setups. */
+	if (ctx->immediate_write) {
+		ts = snum_to_ts(ctx, snum_curr);
+		append_vcd_timestamp(out, ts, FALSE);
+	}
+
+	/* Iterate over individual logic channels. */
+	queued = 0;
+	for (p = 0; p < ctx->enabled_count; p++) {
+		/*
+		 * TODO Check whether the mapping from
+		 * data image positions to channel numbers
+		 * is required. Experiments suggest that
+		 * the data image "is dense", and packs
+		 * bits of enabled channels, and leaves no
+		 * room for positions of disabled channels.
+		 */
+		desc = &ctx->channels[p];
+		if (desc->type != SR_CHANNEL_LOGIC)
+			continue;
+		index = desc->index;
+		prevbit = desc->last.logic;
+
+		/* Skip over unchanged values. */
+		curbit = sample[index / 8];
+		curbit = (curbit & (1 << (index % 8))) ? 1 : 0;
+		if (snum_curr != 0 && prevbit == curbit)
+			continue;
+		desc->last.logic = curbit;
 
 		/*
-		 * Unlink the item from the list. Void cached positions.
-		 * Append its timestamp and values to the caller's text.
+		 * Queue, or immediately emit the text for
+		 * the observed value change.
 		 */
-		dumped++;
-		if (with_queue_stats)
-			sr_dbg("%s(), dump nr %" PRIu64,
-				__func__, item->samplenum);
-		if (ctx->vcd_queue_last == node)
-			ctx->vcd_queue_last = NULL;
-		*listref = g_list_remove_link(*listref, node);
-		rc = unqueue_item(ctx, item, out);
-		queue_free_item(ctx, item);
+		if (ctx->immediate_write) {
+			g_string_append_c(out, ' ');
+			format_vcd_value_bit(out, curbit, desc->name);
+			continue;
+		}
+		rc = queue_logic(ctx, snum_curr, p, curbit);
 		if (rc != SR_OK)
 			return rc;
+		queued++;
 	}
 
+	/* Keep the timestamp when no enabled channel has changed. */
+	if (!ctx->immediate_write && !queued)
+		return queue_samplenum(ctx, snum_curr);
+
 	return SR_OK;
 }
 
@@ -986,15 +873,15 @@ static int receive(const struct sr_output *o,
 	struct context *ctx;
 	const struct sr_datafeed_meta *meta;
 	const struct sr_datafeed_logic *logic;
+	const struct sr_datafeed_logic_rle *rle;
 	const struct sr_datafeed_analog *analog;
 	const struct sr_config *src;
 	GSList *l;
 	struct vcd_channel_desc *desc;
-	uint64_t snum_curr;
-	size_t count, index, p, unit_size;
+	uint64_t snum_curr, run;
+	size_t count, index, unit_size;
 	gboolean changed;
-	GString *s_val;
-	uint8_t *sample, *last_logic, prevbit, curbit;
+	const uint8_t *sample;
 	GSList *channels;
 	struct sr_channel *channel;
 	int rc;
@@ -1025,68 +912,55 @@ static int receive(const struct sr_output *o,
 		count = logic->length / unit_size;
 		snum_curr = get_last_snum_logic(ctx);
 		upd_last_snum_logic(ctx, count);
+		if (unit_size > ctx->last_logic_size) {
+			rc = grow_last_logic(ctx, unit_size);
+			if (rc != SR_OK)
+				return rc;
+		}
 
-		last_logic = ctx->last_logic;
-		while (count--) {
-			/* Check whether any logic value has changed. */
-			changed = memcmp(last_logic, sample, unit_size) != 0;
-			changed |= snum_curr == 0;
-			if (changed)
-				memcpy(last_logic, sample, unit_size);
-
-			/*
-			 * Start or continue tracking that sample number.
-			 * Avoid string copies for logic-only setups.
-			 */
-			if (changed) {
-				if (ctx->immediate_write) {
-					ts = snum_to_ts(ctx, snum_curr);
-					append_vcd_timestamp(*out, ts, FALSE);
-				} else {
-					queue_samplenum(ctx, snum_curr);
-				}
+		/* Only samples which differ from their predecessor. */
+		while (count) {
+			run = sr_logic_find_change(sample, count, unit_size,
+				snum_curr ? ctx->last_logic : NULL, NULL);
+			if (run == count) {
+				snum_curr += count;
+				break;
 			}
+			sample += run * unit_size;
+			snum_curr += run;
+			count -= run;
+			rc = process_logic_sample(ctx, *out, sample,
+				unit_size, snum_curr);
+			if (rc != SR_OK)
+				return rc;
+			snum_curr++;
+			sample += unit_size;
+			count--;
+		}
+		write_completed_changes(ctx, *out);
+		break;
+	case SR_DF_LOGIC_RLE:
+		*out = chk_header(o);
 
-			/* Iterate over individual logic channels. */
-			for (p = 0; changed && p < ctx->enabled_count; p++) {
-				/*
-				 * TODO Check whether the mapping from
-				 * data image positions to channel numbers
-				 * is required. Experiments suggest that
-				 * the data image "is dense", and packs
-				 * bits of enabled channels, and leaves no
-				 * room for positions of disabled channels.
-				 */
-				desc = &ctx->channels[p];
-				if (desc->type != SR_CHANNEL_LOGIC)
-					continue;
-				index = desc->index;
-				prevbit = desc->last.logic;
-
-				/* Skip over unchanged values. */
-				curbit = sample[index / 8];
-				curbit = (curbit & (1 << (index % 8))) ? 1 : 0;
-				if (snum_curr != 0 && prevbit == curbit)
-					continue;
-				desc->last.logic = curbit;
-
-				/*
-				 * Queue, or immediately emit the text for
-				 * the observed value change.
-				 */
-				if (ctx->immediate_write) {
-					g_string_append_c(*out, ' ');
-					s_val = *out;
-				} else {
-					s_val = queue_value_text_prep(ctx);
-					if (!s_val)
-						break;
-				}
-				format_vcd_value_bit(s_val, curbit, desc->name);
+		/* Only the first sample of a run can change values. */
+		rle = packet->payload;
+		sample = rle->values;
+		unit_size = rle->unitsize;
+		snum_curr = get_last_snum_logic(ctx);
+		upd_last_snum_logic(ctx, sr_logic_rle_num_samples(rle));
+		if (unit_size > ctx->last_logic_size) {
+			rc = grow_last_logic(ctx, unit_size);
+			if (rc != SR_OK)
+				return rc;
+		}
+		for (run = 0; run < rle->num_runs; run++) {
+			if (rle->lengths[run]) {
+				rc = process_logic_sample(ctx, *out, sample,
+					unit_size, snum_curr);
+				if (rc != SR_OK)
+					return rc;
+				snum_curr += rle->lengths[run];
 			}
-
-			/* Advance to next set of logic samples. */
-			snum_curr++;
 			sample += unit_size;
 		}
 		write_completed_changes(ctx, *out);
@@ -1122,16 +996,20 @@ static int receive(const struct sr_output *o,
 
 		/*
 		 * Convert incoming data to an array of single precision
-		 * floating point values.
+		 * floating point values. The buffer is kept across packets.
 		 */
-		floats = g_try_malloc(sizeof(*floats) * analog->num_samples);
-		if (!floats)
-			return SR_ERR_MALLOC;
+		if (count > ctx->floats_size) {
+			floats = g_try_realloc(ctx->floats,
+				sizeof(*floats) * count);
+			if (!floats)
+				return SR_ERR_MALLOC;
+			ctx->floats = floats;
+			ctx->floats_size = count;
+		}
+		floats = ctx->floats;
 		rc = sr_analog_to_float(analog, floats);
-		if (rc != SR_OK) {
-			g_free(floats);
+		if (rc != SR_OK)
 			return rc;
-		}
 
 		/*
 		 * Check for changes in the channel's values. Have the
@@ -1151,22 +1029,24 @@ static int receive(const struct sr_output *o,
 			if (ctx->immediate_write) {
 				ts = snum_to_ts(ctx, snum_curr + index);
 				append_vcd_timestamp(*out, ts, FALSE);
-				s_val = *out;
-			} else {
-				queue_samplenum(ctx, snum_curr + index);
-				s_val = queue_value_text_prep(ctx);
+				format_vcd_value_real(*out, value, desc->name);
+				continue;
 			}
-			format_vcd_value_real(s_val, value, desc->name);
+			rc = queue_real(ctx, snum_curr + index,
+				desc - ctx->channels, value);
+			if (rc != SR_OK)
+				return rc;
 		}
 
-		g_free(floats);
 		write_completed_changes(ctx, *out);
 		break;
 	case SR_DF_END:
 		*out = chk_header(o);
 		/* Push the final timestamp as length indicator. */
 		snum_curr = get_max_snum_flush(ctx);
-		queue_samplenum(ctx, snum_curr);
+		rc = queue_samplenum(ctx, snum_curr);
+		if (rc != SR_OK)
+			return rc;
 		/* Flush previously queued value changes. */
 		write_completed_changes(ctx, *out);
 		break;
@@ -1185,13 +1065,9 @@ static int cleanup(struct sr_output *o)
 
 	ctx = o->priv;
 
-	if (with_pool_stats)
-		sr_info("STATS: alloc/reuse %zu/%zu, pool/free %zu/%zu",
-			ctx->alloced, ctx->reused, ctx->pooled, ctx->freed);
-	queue_drain_pool(ctx);
-	if (with_pool_stats)
-		sr_info("STATS: alloc/reuse %zu/%zu, pool/free %zu/%zu",
-			ctx->alloced, ctx->reused, ctx->pooled, ctx->freed);
+	g_free(ctx->queue);
+	g_free(ctx->floats);
+	g_free(ctx->last_logic);
 
 	while (ctx->enabled_count--) {
 		desc = &ctx->channels[ctx->enabled_count];
@@ -1208,7 +1084,7 @@ struct sr_output_module output_vcd = {
 	.name = "VCD",
 	.desc = "Value Change Dump data",
 	.exts = (const char*[]){"vcd", NULL},
-	.flags = 0,
+	.flags = SR_OUTPUT_LOGIC_RLE,
 	.options = NULL,
 	.init = init,
 	.receive = receive,
@@ -0,0 +1,1057 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * Copyright (C) 2026 The sigrok project developers
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file
+ * Multi-resolution overviews of sample data
+ */
+
+#include "config.h"
+
+#include <glib.h>
+#include <libsigrok/libsigrok.h>
+#include <math.h>
+#include <string.h>
+
+#include "libsigrok-internal.h"
+
+#define LOG_PREFIX "overview"
+
+/*
+ * An overview summarizes a stream of samples in blocks. The finest
+ * level's blocks hold "resolution" samples, each coarser level's blocks
+ * summarize FANOUT blocks of the level below. A block's summary is
+ *   logic data: the bitwise OR and AND of its samples, and the bits
+ *               which changed at one of its samples (compared to the
+ *               preceding sample), unitsize bytes each
+ *   analog data: the minimum and maximum of its (non-NaN) values
+ * Queries combine the coarsest blocks which fit into a bin, so their
+ * cost depends on the number of bins, not on the number of samples.
+ */
+
+/** @cond PRIVATE */
+#define DEFAULT_RESOLUTION 1024
+#define FANOUT_SHIFT 4
+#define FANOUT (1 << FANOUT_SHIFT)
+#define MAX_LEVELS 12
+
+#define SAVE_MAGIC "SROV"
+#define SAVE_VERSION 1
+/** @endcond */
+
+/** @private */
+struct sr_overview_track {
+	char *name;
+	int type;
+	size_t unitsize;
+	size_t rec_size;
+	uint64_t num_samples;
+	/* Complete blocks. */
+	GByteArray *levels[MAX_LEVELS];
+	/* Summaries of the blocks which are in progress. */
+	uint8_t *pending[MAX_LEVELS];
+	/* Most recent logic sample, to detect changes. */
+	uint8_t *last;
+	gboolean mismatch_seen;
+};
+
+/** @private */
+struct sr_overview {
+	GMutex mutex;
+	uint64_t resolution;
+	unsigned int shift;
+	GPtrArray *tracks;
+	/* Conversion buffer for analog packets. */
+	float *values;
+	size_t values_alloc;
+};
+
+/**
+ * Create an overview without tracks.
+ *
+ * @param resolution Samples per block of the finest level, a power
+ *                   of two. Zero selects the default resolution.
+ *
+ * @return The overview, NULL for an invalid resolution.
+ *
+ * @private
+ */
+SR_PRIV struct sr_overview *sr_overview_new(uint64_t resolution)
+{
+	struct sr_overview *ov;
+
+	if (!resolution)
+		resolution = DEFAULT_RESOLUTION;
+	if (resolution & (resolution - 1))
+		return NULL;
+
+	ov = g_malloc0(sizeof(*ov));
+	g_mutex_init(&ov->mutex);
+	ov->resolution = resolution;
+	while (((uint64_t)1 << ov->shift) < resolution)
+		ov->shift++;
+	ov->tracks = g_ptr_array_new();
+
+	return ov;
+}
+
+static void track_free(struct sr_overview_track *track)
+{
+	size_t level;
+
+	for (level = 0; level < MAX_LEVELS; level++) {
+		g_byte_array_free(track->levels[level], TRUE);
+		g_free(track->pending[level]);
+	}
+	g_free(track->last);
+	g_free(track->name);
+	g_free(track);
+}
+
+static void tracks_free(struct sr_overview *ov)
+{
+	guint i;
+
+	for (i = 0; i < ov->tracks->len; i++)
+		track_free(g_ptr_array_index(ov->tracks, i));
+	g_ptr_array_set_size(ov->tracks, 0);
+}
+
+/** @private */
+SR_PRIV void sr_overview_free(struct sr_overview *ov)
+{
+	if (!ov)
+		return;
+
+	tracks_free(ov);
+	g_ptr_array_free(ov->tracks, TRUE);
+	g_mutex_clear(&ov->mutex);
+	g_free(ov->values);
+	g_free(ov);
+}
+
+static void rec_init(const struct sr_overview_track *track, uint8_t *rec)
+{
+	float range[2];
+
+	if (track->type == SR_CHANNEL_LOGIC) {
+		memset(rec, 0x00, track->unitsize);
+		memset(rec + track->unitsize, 0xff, track->unitsize);
+		memset(rec + 2 * track->unitsize, 0x00, track->unitsize);
+	} else {
+		range[0] = INFINITY;
+		range[1] = -INFINITY;
+		memcpy(rec, range, sizeof(range));
+	}
+}
+
+static void rec_merge(const struct sr_overview_track *track,
+	uint8_t *dst, const uint8_t *src)
+{
+	float *range;
+	const float *src_range;
+	size_t idx, us;
+
+	if (track->type == SR_CHANNEL_LOGIC) {
+		us = track->unitsize;
+		for (idx = 0; idx < us; idx++) {
+			dst[idx] |= src[idx];
+			dst[us + idx] &= src[us + idx];
+			dst[2 * us + idx] |= src[2 * us + idx];
+		}
+	} else {
+		range = (float *)dst;
+		src_range = (const float *)src;
+		range[0] = MIN(range[0], src_range[0]);
+		range[1] = MAX(range[1], src_range[1]);
+	}
+}
+
+static void track_setup(struct sr_overview_track *track, size_t unitsize)
+{
+	size_t level;
+
+	track->unitsize = unitsize;
+	if (track->type == SR_CHANNEL_LOGIC) {
+		track->rec_size = 3 * unitsize;
+		track->last = g_malloc0(unitsize);
+	} else {
+		track->rec_size = 2 * sizeof(float);
+	}
+	for (level = 0; level < MAX_LEVELS; level++) {
+		track->pending[level] = g_malloc(track->rec_size);
+		rec_init(track, track->pending[level]);
+	}
+}
+
+/**
+ * Add a track to an overview.
+ *
+ * @param ov The overview. Must not be NULL.
+ * @param name The track's name, e.g. a capture file or channel name.
+ * @param type SR_CHANNEL_LOGIC or SR_CHANNEL_ANALOG.
+ * @param unitsize Bytes per sample of logic data. Zero to take it from
+ *                 the first data which gets added.
+ *
+ * @return The (empty) track.
+ *
+ * @private
+ */
+SR_PRIV struct sr_overview_track *sr_overview_track_add(
+		struct sr_overview *ov, const char *name, int type,
+		size_t unitsize)
+{
+	struct sr_overview_track *track;
+	size_t level;
+
+	track = g_malloc0(sizeof(*track));
+	track->name = g_strdup(name);
+	track->type = type;
+	for (level = 0; level < MAX_LEVELS; level++)
+		track->levels[level] = g_byte_array_new();
+	if (type != SR_CHANNEL_LOGIC || unitsize)
+		track_setup(track, unitsize);
+
+	g_mutex_lock(&ov->mutex);
+	g_ptr_array_add(ov->tracks, track);
+	g_mutex_unlock(&ov->mutex);
+
+	return track;
+}
+
+/**
+ * Look up an overview's track.
+ *
+ * @return The track, NULL when not found.
+ *
+ * @private
+ */
+SR_PRIV struct sr_overview_track *sr_overview_track_find(
+		const struct sr_overview *ov, const char *name)
+{
+	struct sr_overview_track *track;
+	guint i;
+
+	for (i = 0; i < ov->tracks->len; i++) {
+		track = g_ptr_array_index(ov->tracks, i);
+		if (!strcmp(track->name, name))
+			return track;
+	}
+
+	return NULL;
+}
+
+/* The logic track, or the analog track of the given number. */
+static struct sr_overview_track *track_get(const struct sr_overview *ov,
+	int type, unsigned int channel)
+{
+	struct sr_overview_track *track;
+	guint i;
+
+	for (i = 0; i < ov->tracks->len; i++) {
+		track = g_ptr_array_index(ov->tracks, i);
+		if (track->type != type)
+			continue;
+		if (type == SR_CHANNEL_LOGIC || channel-- == 0)
+			return track;
+	}
+
+	return NULL;
+}
+
+/*
+ * Store the finest level's current block, and propagate it to the
+ * coarser levels' blocks. The coarsest level keeps growing.
+ */
+static void block_done(struct sr_overview_track *track, size_t level)
+{
+	g_byte_array_append(track->levels[level], track->pending[level],
+		track->rec_size);
+	if (level + 1 < MAX_LEVELS)
+		rec_merge(track, track->pending[level + 1], track->pending[level]);
+	rec_init(track, track->pending[level]);
+
+	if (level + 1 < MAX_LEVELS &&
+			(track->levels[level]->len / track->rec_size) % FANOUT == 0)
+		block_done(track, level + 1);
+}
+
+/* Space left in the finest level's current block. */
+static uint64_t block_space(const struct sr_overview *ov,
+	const struct sr_overview_track *track)
+{
+	return ov->resolution - (track->num_samples & (ov->resolution - 1));
+}
+
+static void block_advance(const struct sr_overview *ov,
+	struct sr_overview_track *track, uint64_t count)
+{
+	track->num_samples += count;
+	if (!(track->num_samples & (ov->resolution - 1)))
+		block_done(track, 0);
+}
+
+static void fold_logic(struct sr_overview_track *track,
+	const uint8_t *data, uint64_t count)
+{
+	uint8_t *bits_or, *bits_and, *bits_changed, *last;
+	uint8_t v_or, v_and, v_changed, v_last;
+	size_t us, idx;
+	uint64_t i;
+
+	us = track->unitsize;
+	bits_or = track->pending[0];
+	bits_and = bits_or + us;
+	bits_changed = bits_and + us;
+	last = track->last;
+
+	if (us == 1) {
+		v_or = *bits_or;
+		v_and = *bits_and;
+		v_changed = *bits_changed;
+		v_last = *last;
+		for (i = 0; i < count; i++) {
+			v_or |= data[i];
+			v_and &= data[i];
+			v_changed |= data[i] ^ v_last;
+			v_last = data[i];
+		}
+		*bits_or = v_or;
+		*bits_and = v_and;
+		*bits_changed = v_changed;
+		*last = v_last;
+		return;
+	}
+
+	for (i = 0; i < count; i++) {
+		for (idx = 0; idx < us; idx++) {
+			bits_or[idx] |= data[idx];
+			bits_and[idx] &= data[idx];
+			bits_changed[idx] |= data[idx] ^ last[idx];
+		}
+		last = (uint8_t *)data;
+		data += us;
+	}
+	if (count)
+		memcpy(track->last, last, us);
+}
+
+static gboolean logic_unitsize_check(struct sr_overview_track *track,
+	size_t unitsize)
+{
+	if (!track->unitsize && unitsize)
+		track_setup(track, unitsize);
+	if (track->unitsize == unitsize)
+		return TRUE;
+
+	if (!track->mismatch_seen) {
+		sr_warn("Unit size %zu differs from %zu, ignoring data.",
+			unitsize, track->unitsize);
+		track->mismatch_seen = TRUE;
+	}
+
+	return FALSE;
+}
+
+/**
+ * Add logic samples to an overview's track.
+ *
+ * @private
+ */
+SR_PRIV void sr_overview_add_logic(struct sr_overview *ov,
+		struct sr_overview_track *track, const uint8_t *data,
+		size_t unitsize, uint64_t count)
+{
+	uint64_t len;
+
+	g_mutex_lock(&ov->mutex);
+	if (!logic_unitsize_check(track, unitsize)) {
+		g_mutex_unlock(&ov->mutex);
+		return;
+	}
+	if (!track->num_samples && count)
+		memcpy(track->last, data, unitsize);
+	while (count) {
+		len = MIN(count, block_space(ov, track));
+		fold_logic(track, data, len);
+		block_advance(ov, track, len);
+		data += len * unitsize;
+		count -= len;
+	}
+	g_mutex_unlock(&ov->mutex);
+}
+
+/**
+ * Add run-length encoded logic samples to an overview's track.
+ *
+ * Each run gets processed once per block which it touches.
+ *
+ * @private
+ */
+SR_PRIV void sr_overview_add_logic_rle(struct sr_overview *ov,
+		struct sr_overview_track *track,
+		const struct sr_datafeed_logic_rle *rle)
+{
+	const uint8_t *value;
+	uint8_t *bits_or, *bits_and, *bits_changed;
+	uint64_t count, len;
+	size_t run, us, idx;
+
+	g_mutex_lock(&ov->mutex);
+	if (!logic_unitsize_check(track, rle->unitsize)) {
+		g_mutex_unlock(&ov->mutex);
+		return;
+	}
+	us = track->unitsize;
+	bits_or = track->pending[0];
+	bits_and = bits_or + us;
+	bits_changed = bits_and + us;
+	for (run = 0; run < rle->num_runs; run++) {
+		value = (const uint8_t *)rle->values + run * us;
+		count = rle->lengths[run];
+		if (!count)
+			continue;
+		if (!track->num_samples)
+			memcpy(track->last, value, us);
+		for (idx = 0; idx < us; idx++)
+			bits_changed[idx] |= value[idx] ^ track->last[idx];
+		memcpy(track->last, value, us);
+		while (count) {
+			for (idx = 0; idx < us; idx++) {
+				bits_or[idx] |= value[idx];
+				bits_and[idx] &= value[idx];
+			}
+			len = MIN(count, block_space(ov, track));
+			block_advance(ov, track, len);
+			count -= len;
+		}
+	}
+	g_mutex_unlock(&ov->mutex);
+}
+
+/**
+ * Add analog values to an overview's track.
+ *
+ * @param stride Distance of consecutive values, for interleaved data.
+ *
+ * @private
+ */
+SR_PRIV void sr_overview_add_analog(struct sr_overview *ov,
+		struct sr_overview_track *track, const float *values,
+		uint64_t count, size_t stride)
+{
+	float *range;
+	uint64_t len, i;
+
+	g_mutex_lock(&ov->mutex);
+	range = (float *)track->pending[0];
+	while (count) {
+		len = MIN(count, block_space(ov, track));
+		for (i = 0; i < len; i++) {
+			if (values[i * stride] < range[0])
+				range[0] = values[i * stride];
+			if (values[i * stride] > range[1])
+				range[1] = values[i * stride];
+		}
+		block_advance(ov, track, len);
+		values += len * stride;
+		count -= len;
+	}
+	g_mutex_unlock(&ov->mutex);
+}
+
+/*
+ * Merge the finest level's blocks [first, end) into a summary, using
+ * the coarsest blocks which fit.
+ */
+static void track_merge(const struct sr_overview_track *track,
+	uint64_t first, uint64_t end, uint8_t *rec)
+{
+	uint64_t complete, span;
+	size_t level;
+
+	complete = track->levels[0]->len / track->rec_size;
+	while (first < end) {
+		if (first >= complete) {
+			/* The block which is in progress. */
+			rec_merge(track, rec, track->pending[0]);
+			break;
+		}
+		for (level = MAX_LEVELS - 1; level > 0; level--) {
+			span = (uint64_t)1 << (level * FANOUT_SHIFT);
+			if (!(first & (span - 1)) && first + span <= end &&
+					(first >> (level * FANOUT_SHIFT)) <
+					track->levels[level]->len / track->rec_size)
+				break;
+		}
+		rec_merge(track, rec, track->levels[level]->data +
+			(first >> (level * FANOUT_SHIFT)) * track->rec_size);
+		first += (uint64_t)1 << (level * FANOUT_SHIFT);
+	}
+}
+
+/*
+ * Summarize [start, start + count) in num_bins bins, which differ in
+ * size by one sample at most. Bins get extended to block boundaries.
+ * Returns the summaries, rec_size bytes per bin.
+ */
+static uint8_t *track_query(const struct sr_overview *ov,
+	const struct sr_overview_track *track,
+	uint64_t start, uint64_t count, size_t num_bins)
+{
+	uint8_t *recs;
+	uint64_t bin_start, bin_end;
+	size_t bin;
+
+	if (!num_bins || count < num_bins || start + count < start ||
+			start + count > track->num_samples)
+		return NULL;
+
+	recs = g_malloc(num_bins * track->rec_size);
+	for (bin = 0; bin < num_bins; bin++) {
+		bin_start = start + count / num_bins * bin +
+			count % num_bins * bin / num_bins;
+		bin_end = start + count / num_bins * (bin + 1) +
+			count % num_bins * (bin + 1) / num_bins;
+		rec_init(track, recs + bin * track->rec_size);
+		track_merge(track, bin_start >> ov->shift,
+			(bin_end + ov->resolution - 1) >> ov->shift,
+			recs + bin * track->rec_size);
+	}
+
+	return recs;
+}
+
+/**
+ * Serialize an overview, e.g. for storing it in a session file.
+ *
+ * The data is "SROV", the format version and the resolution, and the
+ * number of tracks. Each track has its type, unitsize, name, number of
+ * samples, and its finest level's blocks. Numbers are little endian.
+ *
+ * @private
+ */
+SR_PRIV GByteArray *sr_overview_save(struct sr_overview *ov)
+{
+	const struct sr_overview_track *track;
+	GByteArray *data;
+	const float *range;
+	uint8_t buf[8];
+	size_t len;
+	guint i;
+
+	data = g_byte_array_new();
+	g_mutex_lock(&ov->mutex);
+	g_byte_array_append(data, (const guint8 *)SAVE_MAGIC, 4);
+	WL32(buf, SAVE_VERSION);
+	g_byte_array_append(data, buf, 4);
+	WL64(buf, ov->resolution);
+	g_byte_array_append(data, buf, 8);
+	WL32(buf, ov->tracks->len);
+	g_byte_array_append(data, buf, 4);
+	for (i = 0; i < ov->tracks->len; i++) {
+		track = g_ptr_array_index(ov->tracks, i);
+		WL32(buf, track->type);
+		g_byte_array_append(data, buf, 4);
+		WL32(buf, track->unitsize);
+		g_byte_array_append(data, buf, 4);
+		len = strlen(track->name);
+		WL32(buf, len);
+		g_byte_array_append(data, buf, 4);
+		g_byte_array_append(data, (const guint8 *)track->name, len);
+		WL64(buf, track->num_samples);
+		g_byte_array_append(data, buf, 8);
+		if (!track->rec_size)
+			continue;
+		if (track->type == SR_CHANNEL_LOGIC) {
+			g_byte_array_append(data, track->levels[0]->data,
+				track->levels[0]->len);
+			if (track->num_samples & (ov->resolution - 1))
+				g_byte_array_append(data, track->pending[0],
+					track->rec_size);
+			continue;
+		}
+		range = (const float *)track->levels[0]->data;
+		for (len = 0; len < track->levels[0]->len / track->rec_size; len++) {
+			write_fltle(buf, range[2 * len]);
+			write_fltle(buf + 4, range[2 * len + 1]);
+			g_byte_array_append(data, buf, 8);
+		}
+		if (track->num_samples & (ov->resolution - 1)) {
+			range = (const float *)track->pending[0];
+			write_fltle(buf, range[0]);
+			write_fltle(buf + 4, range[1]);
+			g_byte_array_append(data, buf, 8);
+		}
+	}
+	g_mutex_unlock(&ov->mutex);
+
+	return data;
+}
+
+/**
+ * Restore an overview from data which sr_overview_save() created.
+ *
+ * @return The overview, NULL for invalid data.
+ *
+ * @private
+ */
+SR_PRIV struct sr_overview *sr_overview_load(const uint8_t *data, size_t size)
+{
+	struct sr_overview *ov;
+	struct sr_overview_track *track;
+	const uint8_t *p, *end;
+	float *range;
+	char *name;
+	uint64_t num_samples, blocks, block, count;
+	uint32_t num_tracks, type, unitsize, len;
+
+	p = data;
+	end = data + size;
+	if (size < 20 || memcmp(p, SAVE_MAGIC, 4) || RL32(p + 4) != SAVE_VERSION)
+		return NULL;
+	if (!(ov = sr_overview_new(RL64(p + 8))) || !RL64(p + 8)) {
+		sr_overview_free(ov);
+		return NULL;
+	}
+	num_tracks = RL32(p + 16);
+	p += 20;
+
+	while (num_tracks--) {
+		if (end - p < 12)
+			goto fail;
+		type = RL32(p);
+		unitsize = RL32(p + 4);
+		len = RL32(p + 8);
+		p += 12;
+		if ((type != SR_CHANNEL_LOGIC && type != SR_CHANNEL_ANALOG) ||
+				unitsize > 1024 || (uint64_t)(end - p) < len + 8)
+			goto fail;
+		name = g_strndup((const char *)p, len);
+		track = sr_overview_track_add(ov, name, type,
+			type == SR_CHANNEL_LOGIC ? unitsize : 0);
+		g_free(name);
+		p += len;
+		num_samples = RL64(p);
+		p += 8;
+		/* Logic tracks which never received data. */
+		if (!track->rec_size) {
+			if (num_samples)
+				goto fail;
+			continue;
+		}
+
+		blocks = num_samples / ov->resolution +
+			!!(num_samples & (ov->resolution - 1));
+		if (blocks > (uint64_t)(end - p) / track->rec_size)
+			goto fail;
+		for (block = 0; block < blocks; block++) {
+			if (type == SR_CHANNEL_LOGIC) {
+				memcpy(track->pending[0], p, track->rec_size);
+			} else {
+				range = (float *)track->pending[0];
+				range[0] = read_fltle(p);
+				range[1] = read_fltle(p + 4);
+			}
+			p += track->rec_size;
+			count = MIN(num_samples - track->num_samples,
+				ov->resolution);
+			block_advance(ov, track, count);
+		}
+	}
+
+	return ov;
+
+fail:
+	sr_overview_free(ov);
+	return NULL;
+}
+
+/* Datafeed callback which builds the overviews of a session's devices. */
+static void overview_feed(const struct sr_dev_inst *sdi,
+	const struct sr_datafeed_packet *packet, void *cb_data)
+{
+	struct sr_session *session;
+	struct sr_overview *ov;
+	struct sr_overview_track *track;
+	const struct sr_datafeed_logic *logic;
+	const struct sr_datafeed_analog *analog;
+	struct sr_channel *ch;
+	GSList *l;
+	size_t num_channels, idx;
+
+	session = cb_data;
+	if (!(ov = g_hash_table_lookup(session->overviews, sdi)))
+		return;
+
+	switch (packet->type) {
+	case SR_DF_LOGIC:
+		logic = packet->payload;
+		if (!logic->unitsize ||
+				!(track = track_get(ov, SR_CHANNEL_LOGIC, 0)))
+			break;
+		sr_overview_add_logic(ov, track, logic->data, logic->unitsize,
+			logic->length / logic->unitsize);
+		break;
+	case SR_DF_LOGIC_RLE:
+		if (!(track = track_get(ov, SR_CHANNEL_LOGIC, 0)))
+			break;
+		sr_overview_add_logic_rle(ov, track, packet->payload);
+		break;
+	case SR_DF_ANALOG:
+		analog = packet->payload;
+		num_channels = g_slist_length(analog->meaning->channels);
+		if (!num_channels || !analog->num_samples)
+			break;
+		if (ov->values_alloc < analog->num_samples * num_channels) {
+			g_free(ov->values);
+			ov->values_alloc = analog->num_samples * num_channels;
+			ov->values = g_malloc(ov->values_alloc * sizeof(float));
+		}
+		if (sr_analog_to_float(analog, ov->values) != SR_OK)
+			break;
+		for (l = analog->meaning->channels, idx = 0; l; l = l->next, idx++) {
+			ch = l->data;
+			if (!(track = sr_overview_track_find(ov, ch->name)) ||
+					track->type != SR_CHANNEL_ANALOG)
+				continue;
+			sr_overview_add_analog(ov, track, ov->values + idx,
+				analog->num_samples, num_channels);
+		}
+		break;
+	default:
+		break;
+	}
+}
+
+/**
+ * Enable overviews of the data which a session's devices acquire.
+ *
+ * While the session runs, an overview of each device's data gets built
+ * from the datafeed, which can be queried at any time, also while the
+ * acquisition is in progress. See sr_session_overview_get().
+ *
+ * Overviews summarize blocks of @a resolution samples, and coarser
+ * blocks of these. A device's overview takes about three times the
+ * logic unitsize, and eight bytes per analog channel, per block.
+ *
+ * The overviews get built by a datafeed callback, which
+ * sr_session_datafeed_callback_remove_all() removes as well. That also
+ * disables the overviews, call this function again to re-enable them.
+ *
+ * @param session The session to use. Must not be NULL.
+ * @param resolution Samples per block, a power of two. Zero selects
+ *                   the default of 1024 samples.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ * @retval SR_ERR The session is running.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_session_overview_enable(struct sr_session *session,
+		uint64_t resolution)
+{
+	int ret;
+
+	if (!session)
+		return SR_ERR_ARG;
+	if (session->running) {
+		sr_err("Cannot enable overviews while the session is running.");
+		return SR_ERR;
+	}
+	if (!resolution)
+		resolution = DEFAULT_RESOLUTION;
+	if (resolution & (resolution - 1))
+		return SR_ERR_ARG;
+
+	if (!session->overviews) {
+		ret = sr_session_datafeed_callback_add_flags(session,
+			overview_feed, session,
+			SR_DATAFEED_CB_LOGIC_RLE);
+		if (ret != SR_OK)
+			return ret;
+		session->overviews = g_hash_table_new_full(g_direct_hash,
+			g_direct_equal, NULL, (GDestroyNotify)sr_overview_free);
+	}
+	session->overview_resolution = resolution;
+
+	return SR_OK;
+}
+
+/**
+ * Get the overview of a device's data.
+ *
+ * The overview's logic data track holds the device's logic data, its
+ * analog tracks the data of the device's analog channels which were
+ * enabled when the session started, in the channels' order.
+ *
+ * @param session The session to use. Must not be NULL.
+ * @param sdi The device. Must not be NULL.
+ *
+ * @return The overview, owned by the session. It remains valid until
+ *         the session gets started again, or destroyed. NULL when
+ *         overviews are not enabled, or the session has not been
+ *         started yet.
+ *
+ * @since 0.6.0
+ */
+SR_API struct sr_overview *sr_session_overview_get(struct sr_session *session,
+		const struct sr_dev_inst *sdi)
+{
+	if (!session || !sdi || !session->overviews)
+		return NULL;
+
+	return g_hash_table_lookup(session->overviews, sdi);
+}
+
+/**
+ * Prepare the overviews of a session's devices, before it starts.
+ *
+ * @private
+ */
+SR_PRIV void sr_session_overview_start(struct sr_session *session)
+{
+	struct sr_overview *ov;
+	struct sr_dev_inst *sdi;
+	struct sr_channel *ch;
+	GSList *l, *c;
+	gboolean has_logic;
+
+	if (!session->overviews)
+		return;
+
+	g_hash_table_remove_all(session->overviews);
+	for (l = session->devs; l; l = l->next) {
+		sdi = l->data;
+		ov = sr_overview_new(session->overview_resolution);
+		has_logic = FALSE;
+		for (c = sdi->channels; c; c = c->next) {
+			ch = c->data;
+			if (ch->enabled && ch->type == SR_CHANNEL_LOGIC)
+				has_logic = TRUE;
+		}
+		if (has_logic)
+			sr_overview_track_add(ov, "logic", SR_CHANNEL_LOGIC, 0);
+		for (c = sdi->channels; c; c = c->next) {
+			ch = c->data;
+			if (ch->enabled && ch->type == SR_CHANNEL_ANALOG)
+				sr_overview_track_add(ov, ch->name,
+					SR_CHANNEL_ANALOG, 0);
+		}
+		g_hash_table_insert(session->overviews, sdi, ov);
+	}
+}
+
+/**
+ * Get the properties of an overview.
+ *
+ * @param[in] ov The overview. Must not be NULL.
+ * @param[out] resolution Samples per block of the finest level. Can be
+ *             NULL.
+ * @param[out] unitsize The number of bytes per logic sample, zero when
+ *             there is no logic data (yet). Can be NULL.
+ * @param[out] num_analog The number of analog tracks. Can be NULL.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_overview_get_info(struct sr_overview *ov, uint64_t *resolution,
+		unsigned int *unitsize, unsigned int *num_analog)
+{
+	const struct sr_overview_track *track;
+	unsigned int count;
+	guint i;
+
+	if (!ov)
+		return SR_ERR_ARG;
+
+	g_mutex_lock(&ov->mutex);
+	if (resolution)
+		*resolution = ov->resolution;
+	if (unitsize) {
+		track = track_get(ov, SR_CHANNEL_LOGIC, 0);
+		*unitsize = track ? track->unitsize : 0;
+	}
+	if (num_analog) {
+		count = 0;
+		for (i = 0; i < ov->tracks->len; i++) {
+			track = g_ptr_array_index(ov->tracks, i);
+			if (track->type == SR_CHANNEL_ANALOG)
+				count++;
+		}
+		*num_analog = count;
+	}
+	g_mutex_unlock(&ov->mutex);
+
+	return SR_OK;
+}
+
+/**
+ * Get the number of samples which an overview's track summarizes.
+ *
+ * @param[in] ov The overview. Must not be NULL.
+ * @param[in] type SR_CHANNEL_LOGIC for the logic data, or
+ *            SR_CHANNEL_ANALOG for an analog track.
+ * @param[in] channel The analog track, counting from 0. Ignored for
+ *            logic data.
+ * @param[out] count The number of samples. Must not be NULL.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument, or no such track.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_overview_get_num_samples(struct sr_overview *ov,
+		enum sr_channeltype type, unsigned int channel, uint64_t *count)
+{
+	const struct sr_overview_track *track;
+
+	if (!ov || !count)
+		return SR_ERR_ARG;
+
+	g_mutex_lock(&ov->mutex);
+	track = track_get(ov, type, channel);
+	if (track)
+		*count = track->num_samples;
+	g_mutex_unlock(&ov->mutex);
+
+	return track ? SR_OK : SR_ERR_ARG;
+}
+
+/**
+ * Get an overview of a range of logic data.
+ *
+ * Splits the range into @a num_bins bins of (nearly) equal size, and
+ * returns the bitwise OR, the AND, and the changed bits of each bin's
+ * samples: a channel's bit is set in the OR when the channel was high
+ * at some point within the bin, clear in the AND when it was low at
+ * some point, and set in the changed bits when the channel toggled.
+ *
+ * Bins are extended to the overview's block boundaries, their results
+ * can include up to (resolution - 1) samples before and after them.
+ * Use the sample data for ranges where this matters.
+ *
+ * @param[in] ov The overview. Must not be NULL.
+ * @param[in] start The number of the range's first sample.
+ * @param[in] count The number of samples in the range. Must not be
+ *            less than @a num_bins, the range must be within the data.
+ * @param[in] num_bins The number of bins.
+ * @param[out] bits_or Receives each bin's OR, unitsize bytes per bin.
+ *             Must not be NULL.
+ * @param[out] bits_and Receives each bin's AND, unitsize bytes per bin.
+ *             Must not be NULL.
+ * @param[out] bits_changed Receives each bin's changed bits, unitsize
+ *             bytes per bin. Can be NULL.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument, or there is no logic data.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_overview_logic_get(struct sr_overview *ov,
+		uint64_t start, uint64_t count, size_t num_bins,
+		uint8_t *bits_or, uint8_t *bits_and, uint8_t *bits_changed)
+{
+	const struct sr_overview_track *track;
+	uint8_t *recs, *rec;
+	size_t bin, us;
+
+	if (!ov || !bits_or || !bits_and)
+		return SR_ERR_ARG;
+
+	g_mutex_lock(&ov->mutex);
+	recs = NULL;
+	track = track_get(ov, SR_CHANNEL_LOGIC, 0);
+	if (track && track->unitsize)
+		recs = track_query(ov, track, start, count, num_bins);
+	if (!recs) {
+		g_mutex_unlock(&ov->mutex);
+		return SR_ERR_ARG;
+	}
+	us = track->unitsize;
+	for (bin = 0; bin < num_bins; bin++) {
+		rec = recs + bin * track->rec_size;
+		memcpy(bits_or + bin * us, rec, us);
+		memcpy(bits_and + bin * us, rec + us, us);
+		if (bits_changed)
+			memcpy(bits_changed + bin * us, rec + 2 * us, us);
+	}
+	g_mutex_unlock(&ov->mutex);
+	g_free(recs);
+
+	return SR_OK;
+}
+
+/**
+ * Get an overview of a range of analog data.
+ *
+ * Splits the range into @a num_bins bins of (nearly) equal size, and
+ * returns the minimum and maximum value of each bin's samples. NaN
+ * samples are ignored, bins which only hold NaN samples get a NaN
+ * minimum and maximum. Bins are extended to the overview's block
+ * boundaries, like with sr_overview_logic_get().
+ *
+ * @param[in] ov The overview. Must not be NULL.
+ * @param[in] channel The analog track, counting from 0.
+ * @param[in] start The number of the range's first sample.
+ * @param[in] count The number of samples in the range. Must not be
+ *            less than @a num_bins, the range must be within the data.
+ * @param[in] num_bins The number of bins.
+ * @param[out] min Receives each bin's minimum. Must not be NULL.
+ * @param[out] max Receives each bin's maximum. Must not be NULL.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument, or no such track.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_overview_analog_get(struct sr_overview *ov,
+		unsigned int channel, uint64_t start, uint64_t count,
+		size_t num_bins, float *min, float *max)
+{
+	const struct sr_overview_track *track;
+	const float *range;
+	uint8_t *recs;
+	size_t bin;
+
+	if (!ov || !min || !max)
+		return SR_ERR_ARG;
+
+	g_mutex_lock(&ov->mutex);
+	recs = NULL;
+	if ((track = track_get(ov, SR_CHANNEL_ANALOG, channel)))
+		recs = track_query(ov, track, start, count, num_bins);
+	g_mutex_unlock(&ov->mutex);
+	if (!recs)
+		return SR_ERR_ARG;
+
+	range = (const float *)recs;
+	for (bin = 0; bin < num_bins; bin++) {
+		min[bin] = range[2 * bin];
+		max[bin] = range[2 * bin + 1];
+		if (min[bin] > max[bin])
+			min[bin] = max[bin] = NAN;
+	}
+	g_free(recs);
+
+	return SR_OK;
+}
@@ -0,0 +1,339 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * Copyright (C) 2026 The sigrok project developers
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file
+ * Reference counted, pooled datafeed packet buffers
+ */
+
+#include "config.h"
+
+#include <glib.h>
+#include <libsigrok/libsigrok.h>
+#include <string.h>
+
+#include "libsigrok-internal.h"
+
+#define LOG_PREFIX "packet-pool"
+
+/*
+ * Pooled packets are single allocations which hold the packet, its
+ * payload description, and the sample data. Blocks are kept in size
+ * classes of powers of two. Released blocks are kept for re-use until
+ * the pool gets destroyed, so a pool's memory is bounded by the peak
+ * number of packets in flight (see the session's datafeed queues).
+ * Requests beyond the largest class get served by blocks which are not
+ * kept.
+ */
+#define POOL_MIN_SHIFT		8
+#define POOL_NUM_CLASSES	19
+#define POOL_DATA_ALIGN		64
+#define POOL_CLASS_NONE		(-1)
+#define POOL_MAGIC		0x7370722d706f6f6cULL
+
+struct sr_packet_pool {
+	gint refcount;
+	GMutex mutex;
+	struct packet_block *idle[POOL_NUM_CLASSES];
+};
+
+struct packet_block {
+	/* Must be the first member, packet pointers are block pointers. */
+	struct sr_datafeed_packet packet;
+	/* POOL_MAGIC while the block exists, see sr_packet_is_pooled(). */
+	uint64_t magic;
+	gint refcount;
+	struct sr_packet_pool *pool;
+	int size_class;
+	struct packet_block *next_idle;
+	union {
+		struct sr_datafeed_logic logic;
+		struct {
+			struct sr_datafeed_analog analog;
+			struct sr_analog_encoding encoding;
+			struct sr_analog_meaning meaning;
+			struct sr_analog_spec spec;
+			GSList channel;
+		} analog;
+	} payload;
+};
+
+#define BLOCK_HEADER_SIZE \
+	((sizeof(struct packet_block) + POOL_DATA_ALIGN - 1) & \
+	 ~(size_t)(POOL_DATA_ALIGN - 1))
+
+static void *block_data(struct packet_block *block)
+{
+	return (uint8_t *)block + BLOCK_HEADER_SIZE;
+}
+
+static int size_class(size_t size)
+{
+	int cls;
+
+	cls = 0;
+	while (((size_t)1 << (POOL_MIN_SHIFT + cls)) < size) {
+		cls++;
+		if (cls == POOL_NUM_CLASSES)
+			return POOL_CLASS_NONE;
+	}
+
+	return cls;
+}
+
+static void block_destroy(struct packet_block *block)
+{
+	block->magic = 0;
+	g_free(block);
+}
+
+/**
+ * Create a packet buffer pool.
+ *
+ * @return The new pool, to be released with sr_packet_pool_unref().
+ *
+ * @private
+ */
+SR_PRIV struct sr_packet_pool *sr_packet_pool_new(void)
+{
+	struct sr_packet_pool *pool;
+
+	pool = g_malloc0(sizeof(*pool));
+	pool->refcount = 1;
+	g_mutex_init(&pool->mutex);
+
+	return pool;
+}
+
+/** @private */
+SR_PRIV struct sr_packet_pool *sr_packet_pool_ref(struct sr_packet_pool *pool)
+{
+	g_atomic_int_inc(&pool->refcount);
+
+	return pool;
+}
+
+/**
+ * Release a reference to a packet buffer pool.
+ *
+ * Packets which are still in use keep their pool alive. The pool's
+ * memory is released when the last of them got released.
+ *
+ * @private
+ */
+SR_PRIV void sr_packet_pool_unref(struct sr_packet_pool *pool)
+{
+	struct packet_block *block;
+	int cls;
+
+	if (!pool || !g_atomic_int_dec_and_test(&pool->refcount))
+		return;
+
+	for (cls = 0; cls < POOL_NUM_CLASSES; cls++) {
+		while ((block = pool->idle[cls])) {
+			pool->idle[cls] = block->next_idle;
+			block_destroy(block);
+		}
+	}
+	g_mutex_clear(&pool->mutex);
+	g_free(pool);
+}
+
+static struct packet_block *block_get(struct sr_packet_pool *pool,
+		size_t size)
+{
+	struct packet_block *block;
+	int cls;
+
+	cls = size_class(size);
+	block = NULL;
+	if (cls != POOL_CLASS_NONE) {
+		g_mutex_lock(&pool->mutex);
+		block = pool->idle[cls];
+		if (block)
+			pool->idle[cls] = block->next_idle;
+		g_mutex_unlock(&pool->mutex);
+		size = (size_t)1 << (POOL_MIN_SHIFT + cls);
+	}
+
+	if (!block) {
+		block = g_try_malloc(BLOCK_HEADER_SIZE + size);
+		if (!block)
+			return NULL;
+		block->size_class = cls;
+		block->magic = POOL_MAGIC;
+	}
+
+	block->refcount = 1;
+	block->pool = sr_packet_pool_ref(pool);
+	block->next_idle = NULL;
+	memset(&block->payload, 0, sizeof(block->payload));
+
+	return block;
+}
+
+/**
+ * Get a logic packet from a pool.
+ *
+ * The packet's data buffer can hold @a length bytes, which is the
+ * initial payload length. Callers fill in the data and may reduce
+ * the length before sending the packet.
+ *
+ * @param pool The pool to allocate from. Must not be NULL.
+ * @param length Size of the data buffer in bytes.
+ * @param unitsize Size of one sample in bytes.
+ *
+ * @return The packet, to be released with sr_packet_unref(). NULL when
+ *         memory is exhausted.
+ *
+ * @private
+ */
+SR_PRIV struct sr_datafeed_packet *sr_packet_pool_logic_new(
+		struct sr_packet_pool *pool, size_t length, uint16_t unitsize)
+{
+	struct packet_block *block;
+	struct sr_datafeed_logic *logic;
+
+	block = block_get(pool, length);
+	if (!block)
+		return NULL;
+
+	logic = &block->payload.logic;
+	logic->length = length;
+	logic->unitsize = unitsize;
+	logic->data = block_data(block);
+	block->packet.type = SR_DF_LOGIC;
+	block->packet.payload = logic;
+
+	return &block->packet;
+}
+
+/**
+ * Get an analog packet from a pool.
+ *
+ * The packet's encoding is initialized for native float samples, and
+ * @a num_samples is the initial number of samples. The meaning's
+ * channel list is the single channel @a ch (or empty). Callers fill in
+ * the data and the remaining meaning and encoding details.
+ *
+ * @param pool The pool to allocate from. Must not be NULL.
+ * @param num_samples Number of float samples the data buffer can hold.
+ * @param ch The channel which the samples belong to. Can be NULL.
+ *
+ * @return The packet, to be released with sr_packet_unref(). NULL when
+ *         memory is exhausted.
+ *
+ * @private
+ */
+SR_PRIV struct sr_datafeed_packet *sr_packet_pool_analog_new(
+		struct sr_packet_pool *pool, size_t num_samples,
+		struct sr_channel *ch)
+{
+	struct packet_block *block;
+	struct sr_datafeed_analog *analog;
+
+	block = block_get(pool, num_samples * sizeof(float));
+	if (!block)
+		return NULL;
+
+	analog = &block->payload.analog.analog;
+	sr_analog_init(analog, &block->payload.analog.encoding,
+		&block->payload.analog.meaning, &block->payload.analog.spec, 0);
+	analog->data = block_data(block);
+	analog->num_samples = num_samples;
+	if (ch) {
+		block->payload.analog.channel.data = ch;
+		block->payload.analog.channel.next = NULL;
+		analog->meaning->channels = &block->payload.analog.channel;
+	}
+	block->packet.type = SR_DF_ANALOG;
+	block->packet.payload = analog;
+
+	return &block->packet;
+}
+
+/**
+ * Check whether a packet was taken from a packet buffer pool.
+ *
+ * Pooled packets point to the payload right behind them in their block.
+ * Only then the block's magic gets checked, it lies between the packet
+ * and its payload. This takes no lock, so that the datafeed of sessions
+ * in different threads doesn't serialize on it.
+ *
+ * @private
+ */
+SR_PRIV gboolean sr_packet_is_pooled(const struct sr_datafeed_packet *packet)
+{
+	const struct packet_block *block;
+
+	block = (const struct packet_block *)packet;
+	if (packet->payload != (const void *)&block->payload)
+		return FALSE;
+
+	return block->magic == POOL_MAGIC;
+}
+
+/**
+ * Take another reference to a pooled packet.
+ *
+ * @private
+ */
+SR_PRIV struct sr_datafeed_packet *sr_packet_ref(
+		const struct sr_datafeed_packet *packet)
+{
+	struct packet_block *block;
+
+	block = (struct packet_block *)packet;
+	g_atomic_int_inc(&block->refcount);
+
+	return &block->packet;
+}
+
+/**
+ * Release a reference to a pooled packet.
+ *
+ * The last reference returns the packet's buffer to its pool.
+ *
+ * @private
+ */
+SR_PRIV void sr_packet_unref(struct sr_datafeed_packet *packet)
+{
+	struct packet_block *block;
+	struct sr_packet_pool *pool;
+	int cls;
+
+	if (!packet)
+		return;
+
+	block = (struct packet_block *)packet;
+	if (!g_atomic_int_dec_and_test(&block->refcount))
+		return;
+
+	pool = block->pool;
+	cls = block->size_class;
+	if (cls != POOL_CLASS_NONE) {
+		g_mutex_lock(&pool->mutex);
+		block->next_idle = pool->idle[cls];
+		pool->idle[cls] = block;
+		g_mutex_unlock(&pool->mutex);
+	} else {
+		block_destroy(block);
+	}
+	sr_packet_pool_unref(pool);
+}
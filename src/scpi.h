@@ -87,6 +87,13 @@ struct sr_scpi_hw_info {
 	char *firmware_version;
 };
 
+/**
+ * Consumer of partially received block data, see sr_scpi_read_block().
+ * Returns the number of bytes consumed, or SR_ERR* to abort reception.
+ */
+typedef int (*sr_scpi_block_cb)(const uint8_t *data, size_t len,
+		void *cb_data);
+
 struct sr_scpi_dev_inst {
 	const char *name;
 	const char *prefix;
@@ -160,6 +167,9 @@ SR_PRIV int sr_scpi_get_data(struct sr_scpi_dev_inst *scpi,
 			const char *command, GString **scpi_response);
 SR_PRIV int sr_scpi_get_block(struct sr_scpi_dev_inst *scpi,
 			const char *command, GByteArray **scpi_response);
+SR_PRIV int sr_scpi_read_block(struct sr_scpi_dev_inst *scpi,
+			const char *command, uint8_t *buf, size_t bufsize,
+			size_t *datalen, sr_scpi_block_cb cb, void *cb_data);
 SR_PRIV int sr_scpi_get_hw_id(struct sr_scpi_dev_inst *scpi,
 			struct sr_scpi_hw_info **scpi_response);
 SR_PRIV void sr_scpi_hw_info_free(struct sr_scpi_hw_info *hw_info);
@@ -20,6 +20,7 @@
 
 #include <config.h>
 #include <glib.h>
+#include <limits.h>
 #include <string.h>
 #include <libsigrok/libsigrok.h>
 #include "libsigrok-internal.h"
@@ -962,62 +963,79 @@ SR_PRIV int sr_scpi_get_uint8v(struct sr_scpi_dev_inst *scpi,
 }
 
 /**
- * Send a SCPI command, read the reply, parse it as binary data with a
- * "definite length block" header and store the as an result in scpi_response.
+ * Read up to the requested length of response data, without mutex.
+ * Keeps polling until at least one byte was received or the timeout
+ * has expired. Received data extends the timeout.
  *
- * Callers must free the allocated memory (unless it's NULL) regardless of
- * the routine's return code. See @ref g_byte_array_free().
- *
- * @param[in] scpi Previously initialised SCPI device structure.
- * @param[in] command The SCPI command to send to the device (can be NULL).
- * @param[out] scpi_response Pointer where to store the parsed result.
+ * @param scpi Previously initialised SCPI device structure.
+ * @param buf Buffer to store the received data in.
+ * @param maxlen Maximum number of bytes to read.
+ * @param abs_timeout_us Absolute timeout in microseconds, gets updated.
  *
- * @return SR_OK upon successfully parsing all values, SR_ERR* upon a parsing
- *         error or upon no response.
+ * @return read length on success, SR_ERR* on failure.
  */
-SR_PRIV int sr_scpi_get_block(struct sr_scpi_dev_inst *scpi,
-			       const char *command, GByteArray **scpi_response)
+static int scpi_read_some(struct sr_scpi_dev_inst *scpi,
+			uint8_t *buf, size_t maxlen, gint64 *abs_timeout_us)
 {
-	int ret;
-	GString* response;
-	gsize oldlen;
-	char buf[10];
-	long llen;
-	long datalen;
-	gint64 timeout;
+	int len;
 
-	*scpi_response = NULL;
+	if (maxlen > INT_MAX)
+		maxlen = INT_MAX;
 
-	g_mutex_lock(&scpi->scpi_mutex);
-
-	if (command)
-		if (scpi_send(scpi, command) != SR_OK) {
-			g_mutex_unlock(&scpi->scpi_mutex);
+	while (1) {
+		len = scpi_read_data(scpi, (char *)buf, maxlen);
+		if (len < 0) {
+			sr_err("Incompletely read SCPI response.");
 			return SR_ERR;
 		}
-
-	if (sr_scpi_read_begin(scpi) != SR_OK) {
-		g_mutex_unlock(&scpi->scpi_mutex);
-		return SR_ERR;
+		if (len > 0) {
+			*abs_timeout_us = g_get_monotonic_time() +
+				scpi->read_timeout_us;
+			return len;
+		}
+		if (g_get_monotonic_time() > *abs_timeout_us) {
+			sr_err("Timed out waiting for SCPI response.");
+			return SR_ERR_TIMEOUT;
+		}
 	}
+}
 
-	/*
-	 * Assume an initial maximum length, optionally gets adjusted below.
-	 * Prepare a NULL return value for when error paths will be taken.
-	 */
-	response = g_string_sized_new(1024);
-
-	timeout = g_get_monotonic_time() + scpi->read_timeout_us;
+/* Read exactly the requested length of response data, without mutex. */
+static int scpi_read_exact(struct sr_scpi_dev_inst *scpi,
+			uint8_t *buf, size_t len, gint64 *abs_timeout_us)
+{
+	int ret;
 
-	/* Get (the first chunk of) the response. */
-	do {
-		ret = scpi_read_response(scpi, response, timeout);
-		if (ret < 0) {
-			g_mutex_unlock(&scpi->scpi_mutex);
-			g_string_free(response, TRUE);
+	while (len) {
+		ret = scpi_read_some(scpi, buf, len, abs_timeout_us);
+		if (ret < 0)
 			return ret;
-		}
-	} while (response->len < 2);
+		buf += ret;
+		len -= ret;
+	}
+
+	return SR_OK;
+}
+
+/**
+ * Read and parse the length spec of a data block, without mutex.
+ *
+ * Only the length spec itself is taken from the transport, so that the
+ * data bytes which follow can get read into their final location.
+ *
+ * @param scpi Previously initialised SCPI device structure.
+ * @param abs_timeout_us Absolute timeout in microseconds, gets updated.
+ * @param datalen Pointer where to store the data block's length.
+ *
+ * @return SR_OK upon success, SR_ERR* upon failure.
+ */
+static int scpi_block_header(struct sr_scpi_dev_inst *scpi,
+			gint64 *abs_timeout_us, size_t *datalen)
+{
+	int ret;
+	char buf[10];
+	long llen;
+	long len;
 
 	/*
 	 * SCPI protocol data blocks are preceeded with a length spec.
@@ -1026,18 +1044,20 @@ SR_PRIV int sr_scpi_get_block(struct sr_scpi_dev_inst *scpi,
 	 * respective number of characters which specify the data block's
 	 * length. Raw data bytes follow (thus one must no longer assume
 	 * that the received input stream would be an ASCIIZ string).
-	 *
-	 * Get the data block length, and strip off the length spec from
-	 * the input buffer, leaving just the data bytes.
+	 * A late terminator of the previous response on stream transports
+	 * precedes the '#' marker, see scpi_block_trailer(), and is skipped.
 	 */
-	if (response->str[0] != '#') {
-		g_mutex_unlock(&scpi->scpi_mutex);
-		g_string_free(response, TRUE);
+	do {
+		ret = scpi_read_exact(scpi, (uint8_t *)buf, 1, abs_timeout_us);
+		if (ret != SR_OK)
+			return ret;
+	} while (buf[0] == '\r' || buf[0] == '\n');
+	ret = scpi_read_exact(scpi, (uint8_t *)buf + 1, 1, abs_timeout_us);
+	if (ret != SR_OK)
+		return ret;
+	if (buf[0] != '#' || !g_ascii_isdigit(buf[1]))
 		return SR_ERR_DATA;
-	}
-	buf[0] = response->str[1];
-	buf[1] = '\0';
-	ret = sr_atol(buf, &llen);
+	llen = buf[1] - '0';
 	/*
 	 * The form "#0..." is legal, and does not mean "empty response",
 	 * but means that the number of data bytes is not known (or was
@@ -1056,70 +1076,302 @@ SR_PRIV int sr_scpi_get_block(struct sr_scpi_dev_inst *scpi,
 	 * INDEFINITE LENGTH ARBITRARY BLOCK RESPONSE DATA. The latter
 	 * with a leading "#0" length and a trailing "NL^END" marker.
 	 */
-	if (ret == SR_OK && !llen) {
+	if (!llen) {
 		sr_err("unsupported INDEFINITE LENGTH ARBITRARY BLOCK RESPONSE");
-		ret = SR_ERR_NA;
+		return SR_ERR_NA;
 	}
+
+	ret = scpi_read_exact(scpi, (uint8_t *)buf, llen, abs_timeout_us);
+	if (ret != SR_OK)
+		return ret;
+	buf[llen] = '\0';
+	if (sr_atol(buf, &len) != SR_OK || len < 0)
+		return SR_ERR_DATA;
+	*datalen = len;
+
+	return SR_OK;
+}
+
+/**
+ * Read the data bytes of a block into a buffer, without mutex.
+ *
+ * Without a callback the buffer must hold the complete data block.
+ * With a callback the buffer is a window which receives the data in
+ * pieces, see @ref sr_scpi_read_block().
+ *
+ * @param scpi Previously initialised SCPI device structure.
+ * @param buf Buffer to receive the data bytes.
+ * @param bufsize Size of the buffer.
+ * @param datalen Length of the data block.
+ * @param abs_timeout_us Absolute timeout in microseconds, gets updated.
+ * @param cb Consumer of received data (can be NULL).
+ * @param cb_data Opaque data for the consumer.
+ * @param received Pointer where to store the number of received bytes.
+ *
+ * @return SR_OK upon success, SR_ERR* upon failure.
+ */
+static int scpi_block_payload(struct sr_scpi_dev_inst *scpi,
+			uint8_t *buf, size_t bufsize, size_t datalen,
+			gint64 *abs_timeout_us, sr_scpi_block_cb cb,
+			void *cb_data, size_t *received)
+{
+	int ret;
+	size_t fill, start;
+
+	*received = 0;
+	fill = start = 0;
+	while (*received < datalen) {
+		if (fill == bufsize) {
+			if (!start) {
+				sr_err("Block data consumer stalled.");
+				return SR_ERR_DATA;
+			}
+			memmove(buf, buf + start, fill - start);
+			fill -= start;
+			start = 0;
+		}
+		ret = scpi_read_some(scpi, buf + fill,
+			MIN(bufsize - fill, datalen - *received),
+			abs_timeout_us);
+		if (ret < 0)
+			return ret;
+		fill += ret;
+		*received += ret;
+		if (!cb)
+			continue;
+		ret = cb(buf + start, fill - start, cb_data);
+		if (ret < 0)
+			return ret;
+		start += MIN((size_t)ret, fill - start);
+		if (start == fill)
+			fill = start = 0;
+	}
+	if (fill != start)
+		sr_dbg("Dropping %zu unconsumed block data bytes.", fill - start);
+
+	return SR_OK;
+}
+
+/**
+ * Consume the response terminator after a data block, without mutex.
+ *
+ * IEEE 488.2 terminates the response with NL^END after the block's
+ * data bytes, some devices send CR+NL. Message based transports flag
+ * the end of the response, stream transports (serial, raw TCP) guess
+ * it from the received data, and a block whose last byte is 0x0a looks
+ * complete to them. So stream transports get drained of the bytes
+ * which are pending, without waiting for more. A terminator which
+ * arrives later gets skipped by the next block's header read.
+ *
+ * Other bytes after a completely received block are dropped with a
+ * warning, a missing terminator is not an error either.
+ *
+ * @param scpi Previously initialised SCPI device structure.
+ * @param abs_timeout_us Absolute timeout in microseconds, gets updated.
+ *
+ * @return SR_OK upon success, SR_ERR* upon failure.
+ */
+static int scpi_block_trailer(struct sr_scpi_dev_inst *scpi,
+			gint64 *abs_timeout_us)
+{
+	gboolean stream;
+	size_t dropped;
+	int len;
+	char c;
+
+	stream = scpi->transport == SCPI_TRANSPORT_SERIAL ||
+		scpi->transport == SCPI_TRANSPORT_RAW_TCP;
+	dropped = 0;
+	while (stream || !sr_scpi_read_complete(scpi)) {
+		len = scpi_read_data(scpi, &c, 1);
+		if (len < 0)
+			return SR_ERR;
+		if (!len) {
+			if (stream)
+				break;
+			if (g_get_monotonic_time() > *abs_timeout_us) {
+				sr_warn("No terminator after data block.");
+				break;
+			}
+			continue;
+		}
+		*abs_timeout_us = g_get_monotonic_time() + scpi->read_timeout_us;
+		if (c == '\n')
+			break;
+		if (c != '\r')
+			dropped++;
+	}
+	if (dropped)
+		sr_warn("Dropped %zu unexpected bytes after data block.",
+			dropped);
+
+	return SR_OK;
+}
+
+static int scpi_block_discard(const uint8_t *data, size_t len, void *cb_data)
+{
+	(void)data;
+	(void)cb_data;
+
+	return MIN(len, INT_MAX);
+}
+
+/**
+ * Send a SCPI command, read the reply, parse its "definite length block"
+ * header and receive the data bytes straight into a caller's buffer.
+ *
+ * Without a callback, the complete data block is stored in the buffer.
+ * Data blocks which exceed the buffer's size are read and discarded,
+ * and SR_ERR_DATA is returned.
+ *
+ * With a callback, the buffer serves as a window which the data bytes
+ * are received into, and the callback gets invoked whenever data has
+ * arrived. This allows callers to process large data blocks while they
+ * are still being transferred, and to use a buffer which is smaller
+ * than the data block. The callback gets all received but not yet
+ * consumed data, and returns the number of bytes which it consumed, or
+ * an SR_ERR* code to abort the reception. Bytes which are not consumed
+ * (like a partial sample) are passed to the next callback invocation.
+ *
+ * @param[in] scpi Previously initialised SCPI device structure.
+ * @param[in] command The SCPI command to send to the device (can be NULL).
+ * @param[in] buf Buffer to receive the data bytes.
+ * @param[in] bufsize Size of the buffer.
+ * @param[out] datalen Pointer where to store the number of received
+ *             data bytes.
+ * @param[in] cb Consumer of received data (can be NULL).
+ * @param[in] cb_data Opaque data for the consumer.
+ *
+ * @return SR_OK upon successfully receiving the complete data block,
+ *         SR_ERR_TIMEOUT when the data block was received partially,
+ *         SR_ERR* upon other errors.
+ */
+SR_PRIV int sr_scpi_read_block(struct sr_scpi_dev_inst *scpi,
+			const char *command, uint8_t *buf, size_t bufsize,
+			size_t *datalen, sr_scpi_block_cb cb, void *cb_data)
+{
+	int ret;
+	size_t blocklen;
+	gint64 timeout;
+
+	*datalen = 0;
+
+	if (!buf || !bufsize)
+		return SR_ERR_ARG;
+
+	g_mutex_lock(&scpi->scpi_mutex);
+
+	if (command)
+		if (scpi_send(scpi, command) != SR_OK) {
+			g_mutex_unlock(&scpi->scpi_mutex);
+			return SR_ERR;
+		}
+
+	if (sr_scpi_read_begin(scpi) != SR_OK) {
+		g_mutex_unlock(&scpi->scpi_mutex);
+		return SR_ERR;
+	}
+
+	timeout = g_get_monotonic_time() + scpi->read_timeout_us;
+
+	ret = scpi_block_header(scpi, &timeout, &blocklen);
 	if (ret != SR_OK) {
 		g_mutex_unlock(&scpi->scpi_mutex);
-		g_string_free(response, TRUE);
 		return ret;
 	}
 
-	while (response->len < (unsigned long)(2 + llen)) {
-		ret = scpi_read_response(scpi, response, timeout);
-		if (ret < 0) {
+	if (!cb && blocklen > bufsize) {
+		sr_err("Data block of %zu bytes exceeds buffer size %zu.",
+			blocklen, bufsize);
+		if (scpi_block_payload(scpi, buf, bufsize, blocklen, &timeout,
+				scpi_block_discard, NULL, datalen) == SR_OK)
+			scpi_block_trailer(scpi, &timeout);
+		g_mutex_unlock(&scpi->scpi_mutex);
+		*datalen = 0;
+		return SR_ERR_DATA;
+	}
+
+	ret = scpi_block_payload(scpi, buf, bufsize, blocklen, &timeout,
+		cb, cb_data, datalen);
+	if (ret == SR_OK)
+		ret = scpi_block_trailer(scpi, &timeout);
+
+	g_mutex_unlock(&scpi->scpi_mutex);
+
+	return ret;
+}
+
+/**
+ * Send a SCPI command, read the reply, parse it as binary data with a
+ * "definite length block" header and store the as an result in scpi_response.
+ *
+ * Callers must free the allocated memory (unless it's NULL) regardless of
+ * the routine's return code. See @ref g_byte_array_free().
+ *
+ * @param[in] scpi Previously initialised SCPI device structure.
+ * @param[in] command The SCPI command to send to the device (can be NULL).
+ * @param[out] scpi_response Pointer where to store the parsed result.
+ *
+ * @return SR_OK upon successfully parsing all values, SR_ERR* upon a parsing
+ *         error or upon no response.
+ */
+SR_PRIV int sr_scpi_get_block(struct sr_scpi_dev_inst *scpi,
+			       const char *command, GByteArray **scpi_response)
+{
+	int ret;
+	GByteArray *response;
+	size_t datalen, received;
+	gint64 timeout;
+
+	*scpi_response = NULL;
+
+	g_mutex_lock(&scpi->scpi_mutex);
+
+	if (command)
+		if (scpi_send(scpi, command) != SR_OK) {
 			g_mutex_unlock(&scpi->scpi_mutex);
-			g_string_free(response, TRUE);
-			return ret;
+			return SR_ERR;
 		}
+
+	if (sr_scpi_read_begin(scpi) != SR_OK) {
+		g_mutex_unlock(&scpi->scpi_mutex);
+		return SR_ERR;
 	}
 
-	memcpy(buf, &response->str[2], llen);
-	buf[llen] = '\0';
-	ret = sr_atol(buf, &datalen);
-	if ((ret != SR_OK) || (datalen == 0)) {
+	timeout = g_get_monotonic_time() + scpi->read_timeout_us;
+
+	ret = scpi_block_header(scpi, &timeout, &datalen);
+	if (ret == SR_OK && datalen > G_MAXUINT)
+		ret = SR_ERR_DATA;
+	if (ret != SR_OK) {
 		g_mutex_unlock(&scpi->scpi_mutex);
-		g_string_free(response, TRUE);
 		return ret;
 	}
-	g_string_erase(response, 0, 2 + llen);
 
 	/*
-	 * Re-allocate the buffer size to the now known length
-	 * and keep reading more chunks of response data.
+	 * The data block's length is known, allocate the buffer once
+	 * and receive the data bytes straight into it.
 	 */
-	oldlen = response->len;
-	g_string_set_size(response, datalen);
-	g_string_set_size(response, oldlen);
-
-	if (oldlen < (unsigned long)(datalen)) {
-		do {
-			oldlen = response->len;
-			ret = scpi_read_response(scpi, response, timeout);
-
-			/* On timeout truncate the buffer and send the partial response
-			 * instead of getting stuck on timeouts...
-			 */
-			if (ret == SR_ERR_TIMEOUT) {
-				datalen = oldlen;
-				break;
-			}
-			if (ret < 0) {
-				g_mutex_unlock(&scpi->scpi_mutex);
-				g_string_free(response, TRUE);
-				return ret;
-			}
-			if (ret > 0)
-				timeout = g_get_monotonic_time() + scpi->read_timeout_us;
-		} while (response->len < (unsigned long)(datalen));
-	}
+	response = g_byte_array_sized_new(datalen);
+	g_byte_array_set_size(response, datalen);
+	ret = scpi_block_payload(scpi, response->data, datalen, datalen,
+		&timeout, NULL, NULL, &received);
+	if (ret == SR_OK)
+		ret = scpi_block_trailer(scpi, &timeout);
 
 	g_mutex_unlock(&scpi->scpi_mutex);
 
-	/* Convert received data to byte array. */
-	*scpi_response = g_byte_array_new_take(
-		(guint8*)g_string_free(response, FALSE), datalen);
+	/* On timeout truncate the buffer and send the partial response
+	 * instead of getting stuck on timeouts...
+	 */
+	if (ret == SR_ERR_TIMEOUT)
+		ret = SR_OK;
+	if (ret != SR_OK) {
+		g_byte_array_free(response, TRUE);
+		return ret;
+	}
+	g_byte_array_set_size(response, received);
+	*scpi_response = response;
 
 	return SR_OK;
 }
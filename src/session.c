@@ -49,8 +49,43 @@
 struct datafeed_callback {
 	sr_datafeed_callback cb;
 	void *cb_data;
+	uint32_t flags;
+
+	/* Packet queue and thread, when the session feed is threaded. */
+	GThread *thread;
+	GMutex mutex;
+	GCond not_empty;
+	GCond not_full;
+	struct datafeed_queue_item *items;
+	size_t size;
+	size_t head;
+	size_t count;
+	gboolean quit;
+	struct sr_datafeed_queue_stats stats;
+	uint64_t latency_sum_us;
 };
 
+/*
+ * A packet copy which is shared by all datafeed callback queues. Not
+ * needed for pooled packets, which are reference counted themselves.
+ */
+struct shared_packet {
+	gint refcount;
+	struct sr_datafeed_packet *packet;
+};
+
+struct datafeed_queue_item {
+	const struct sr_dev_inst *sdi;
+	struct sr_datafeed_packet *packet;
+	struct shared_packet *shared;
+	int64_t queued_us;
+};
+
+static void datafeed_dump(const struct sr_datafeed_packet *packet);
+static int session_send_rle_expanded(const struct sr_dev_inst *sdi,
+		const struct sr_datafeed_logic_rle *rle, gboolean via_transforms,
+		struct datafeed_callback *target);
+
 /** Custom GLib event source for generic descriptor I/O.
  * @see https://developer.gnome.org/glib/stable/glib-The-Main-Event-Loop.html
  */
@@ -226,6 +261,8 @@ SR_API int sr_session_new(struct sr_context *ctx,
 
 	g_mutex_init(&session->main_mutex);
 
+	session->packet_pool = sr_packet_pool_new();
+
 	/* To maintain API compatibility, we need a lookup table
 	 * which maps poll_object IDs to GSource* pointers.
 	 */
@@ -261,6 +298,14 @@ SR_API int sr_session_destroy(struct sr_session *session)
 
 	g_hash_table_unref(session->event_sources);
 
+	sr_packet_pool_unref(session->packet_pool);
+
+	if (session->overviews)
+		g_hash_table_destroy(session->overviews);
+
+	if (session->usb_stats)
+		g_hash_table_destroy(session->usb_stats);
+
 	g_mutex_clear(&session->main_mutex);
 
 	g_free(session);
@@ -444,9 +489,210 @@ SR_API int sr_session_dev_remove(struct sr_session *session,
 	return SR_OK;
 }
 
+static void datafeed_callback_free(struct datafeed_callback *cb_struct)
+{
+	g_free(cb_struct->items);
+	g_mutex_clear(&cb_struct->mutex);
+	g_cond_clear(&cb_struct->not_empty);
+	g_cond_clear(&cb_struct->not_full);
+	g_free(cb_struct);
+}
+
+static void shared_packet_unref(struct shared_packet *shared)
+{
+	if (!g_atomic_int_dec_and_test(&shared->refcount))
+		return;
+	sr_packet_free(shared->packet);
+	g_free(shared);
+}
+
+/* Packets which may get dropped when a queue is full. */
+static gboolean packet_droppable(const struct sr_datafeed_packet *packet)
+{
+	switch (packet->type) {
+	case SR_DF_LOGIC:
+	case SR_DF_LOGIC_RLE:
+	case SR_DF_ANALOG:
+		return TRUE;
+	default:
+		return FALSE;
+	}
+}
+
+/* Pass a packet to one callback, expanding run-length encoded data. */
+static void datafeed_deliver(const struct sr_dev_inst *sdi,
+		struct datafeed_callback *cb_struct,
+		const struct sr_datafeed_packet *packet)
+{
+	if (packet->type == SR_DF_LOGIC_RLE &&
+			!(cb_struct->flags & SR_DATAFEED_CB_LOGIC_RLE)) {
+		session_send_rle_expanded(sdi, packet->payload, FALSE, cb_struct);
+		return;
+	}
+	if (sr_log_loglevel_get() >= SR_LOG_DBG)
+		datafeed_dump(packet);
+	cb_struct->cb(sdi, packet, cb_struct->cb_data);
+}
+
+static gpointer datafeed_thread(gpointer data)
+{
+	struct datafeed_callback *cb_struct;
+	struct datafeed_queue_item item;
+	int64_t latency;
+
+	cb_struct = data;
+
+	g_mutex_lock(&cb_struct->mutex);
+	for (;;) {
+		while (!cb_struct->count && !cb_struct->quit)
+			g_cond_wait(&cb_struct->not_empty, &cb_struct->mutex);
+		if (!cb_struct->count)
+			break;
+		item = cb_struct->items[cb_struct->head];
+		cb_struct->head = (cb_struct->head + 1) % cb_struct->size;
+		cb_struct->count--;
+		g_cond_signal(&cb_struct->not_full);
+		g_mutex_unlock(&cb_struct->mutex);
+
+		datafeed_deliver(item.sdi, cb_struct, item.packet);
+		latency = g_get_monotonic_time() - item.queued_us;
+		if (item.shared)
+			shared_packet_unref(item.shared);
+		else
+			sr_packet_unref(item.packet);
+
+		g_mutex_lock(&cb_struct->mutex);
+		cb_struct->stats.packets++;
+		cb_struct->latency_sum_us += latency;
+		if ((uint64_t)latency > cb_struct->stats.latency_max_us)
+			cb_struct->stats.latency_max_us = latency;
+	}
+	g_mutex_unlock(&cb_struct->mutex);
+
+	return NULL;
+}
+
+/*
+ * Queue a packet for a threaded callback. Pooled packets only get
+ * referenced. Other packets get copied upon the first call, and
+ * *shared is passed on to the other callbacks' queues.
+ */
+static int datafeed_queue_push(const struct sr_dev_inst *sdi,
+		struct datafeed_callback *cb_struct,
+		const struct sr_datafeed_packet *packet, gboolean pooled,
+		struct shared_packet **shared)
+{
+	struct datafeed_queue_item *item;
+	gboolean droppable;
+	int ret;
+
+	droppable = sdi->session->feed_policy == SR_DATAFEED_QUEUE_DROP &&
+		packet_droppable(packet);
+
+	g_mutex_lock(&cb_struct->mutex);
+	if (droppable && cb_struct->count == cb_struct->size) {
+		cb_struct->stats.dropped++;
+		g_mutex_unlock(&cb_struct->mutex);
+		return SR_OK;
+	}
+	g_mutex_unlock(&cb_struct->mutex);
+
+	if (!pooled && !*shared) {
+		*shared = g_malloc0(sizeof(**shared));
+		(*shared)->refcount = 1;
+		ret = sr_packet_copy(packet, &(*shared)->packet);
+		if (ret != SR_OK) {
+			g_free((*shared)->packet);
+			g_free(*shared);
+			*shared = NULL;
+			return ret;
+		}
+	}
+
+	g_mutex_lock(&cb_struct->mutex);
+	while (cb_struct->count == cb_struct->size) {
+		if (droppable) {
+			cb_struct->stats.dropped++;
+			g_mutex_unlock(&cb_struct->mutex);
+			return SR_OK;
+		}
+		g_cond_wait(&cb_struct->not_full, &cb_struct->mutex);
+	}
+	item = &cb_struct->items[(cb_struct->head + cb_struct->count) %
+		cb_struct->size];
+	item->sdi = sdi;
+	item->shared = *shared;
+	if (pooled) {
+		item->packet = sr_packet_ref(packet);
+	} else {
+		item->packet = (*shared)->packet;
+		g_atomic_int_inc(&(*shared)->refcount);
+	}
+	item->queued_us = g_get_monotonic_time();
+	cb_struct->count++;
+	if (cb_struct->count > cb_struct->stats.max_depth)
+		cb_struct->stats.max_depth = cb_struct->count;
+	g_cond_signal(&cb_struct->not_empty);
+	g_mutex_unlock(&cb_struct->mutex);
+
+	return SR_OK;
+}
+
+static int datafeed_threads_start(struct sr_session *session)
+{
+	struct datafeed_callback *cb_struct;
+	GSList *l;
+
+	if (!session->feed_high_water)
+		return SR_OK;
+
+	for (l = session->datafeed_callbacks; l; l = l->next) {
+		cb_struct = l->data;
+		g_free(cb_struct->items);
+		cb_struct->items = g_malloc(session->feed_high_water *
+			sizeof(cb_struct->items[0]));
+		cb_struct->size = session->feed_high_water;
+		cb_struct->head = 0;
+		cb_struct->count = 0;
+		cb_struct->quit = FALSE;
+		memset(&cb_struct->stats, 0, sizeof(cb_struct->stats));
+		cb_struct->latency_sum_us = 0;
+		cb_struct->thread = g_thread_try_new("sr-datafeed",
+			datafeed_thread, cb_struct, NULL);
+		if (!cb_struct->thread) {
+			sr_err("Cannot create datafeed thread.");
+			return SR_ERR;
+		}
+	}
+
+	return SR_OK;
+}
+
+/* Have all callback threads drain their queues, and terminate. */
+static void datafeed_threads_stop(struct sr_session *session)
+{
+	struct datafeed_callback *cb_struct;
+	GSList *l;
+
+	for (l = session->datafeed_callbacks; l; l = l->next) {
+		cb_struct = l->data;
+		if (!cb_struct->thread)
+			continue;
+		g_mutex_lock(&cb_struct->mutex);
+		cb_struct->quit = TRUE;
+		g_cond_signal(&cb_struct->not_empty);
+		g_mutex_unlock(&cb_struct->mutex);
+		g_thread_join(cb_struct->thread);
+		cb_struct->thread = NULL;
+	}
+}
+
 /**
  * Remove all datafeed callbacks in a session.
  *
+ * This also disables the session's overviews, if enabled, see
+ * sr_session_overview_enable().
+ *
  * @param session The session to use. Must not be NULL.
  *
  * @retval SR_OK Success.
@@ -461,9 +707,17 @@ SR_API int sr_session_datafeed_callback_remove_all(struct sr_session *session)
 		return SR_ERR_ARG;
 	}
 
-	g_slist_free_full(session->datafeed_callbacks, g_free);
+	datafeed_threads_stop(session);
+	g_slist_free_full(session->datafeed_callbacks,
+		(GDestroyNotify)datafeed_callback_free);
 	session->datafeed_callbacks = NULL;
 
+	/* The overviews' callback is gone, overviews are disabled now. */
+	if (session->overviews) {
+		g_hash_table_destroy(session->overviews);
+		session->overviews = NULL;
+	}
+
 	return SR_OK;
 }
 
@@ -482,6 +736,30 @@ SR_API int sr_session_datafeed_callback_remove_all(struct sr_session *session)
  */
 SR_API int sr_session_datafeed_callback_add(struct sr_session *session,
 		sr_datafeed_callback cb, void *cb_data)
+{
+	return sr_session_datafeed_callback_add_flags(session, cb, cb_data, 0);
+}
+
+/**
+ * Add a datafeed callback to a session, which declares capabilities.
+ *
+ * Callbacks which set SR_DATAFEED_CB_LOGIC_RLE receive run-length
+ * encoded logic data as is. Other callbacks receive the expanded
+ * SR_DF_LOGIC equivalent.
+ *
+ * @param session The session to use. Must not be NULL.
+ * @param cb Function to call when a chunk of data is received.
+ *           Must not be NULL.
+ * @param cb_data Opaque pointer passed in by the caller.
+ * @param flags Bitwise OR of enum sr_datafeed_callback_flag values.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_BUG No session exists.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_session_datafeed_callback_add_flags(struct sr_session *session,
+		sr_datafeed_callback cb, void *cb_data, uint32_t flags)
 {
 	struct datafeed_callback *cb_struct;
 
@@ -498,6 +776,10 @@ SR_API int sr_session_datafeed_callback_add(struct sr_session *session,
 	cb_struct = g_malloc0(sizeof(struct datafeed_callback));
 	cb_struct->cb = cb;
 	cb_struct->cb_data = cb_data;
+	cb_struct->flags = flags;
+	g_mutex_init(&cb_struct->mutex);
+	g_cond_init(&cb_struct->not_empty);
+	g_cond_init(&cb_struct->not_full);
 
 	session->datafeed_callbacks =
 	    g_slist_append(session->datafeed_callbacks, cb_struct);
@@ -505,6 +787,183 @@ SR_API int sr_session_datafeed_callback_add(struct sr_session *session,
 	return SR_OK;
 }
 
+/**
+ * Have each datafeed callback run in a thread of its own.
+ *
+ * By default sr_session_send() calls all datafeed callbacks directly,
+ * which means a slow consumer (e.g. an output module which formats
+ * text) stalls the driver which is sending the data. In threaded mode
+ * every callback gets a queue of up to @a high_water packets and a
+ * thread which drains it. Packets are copied once and shared between
+ * all queues, packets from the session's buffer pool are not copied at
+ * all. What happens when a queue is full is determined by
+ * @a policy.
+ *
+ * Callbacks then run concurrently with the session's main loop and
+ * with each other, and must not call into the session. Callbacks
+ * which get added while the session is running are called directly.
+ * All queues are drained before the session's stopped callback runs
+ * and before sr_session_run() returns.
+ *
+ * @param session The session to use. Must not be NULL.
+ * @param high_water Maximum number of packets queued per callback.
+ *                   Zero disables the threaded mode.
+ * @param policy What to do with packets when a queue is full.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ * @retval SR_ERR The session is running.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_session_datafeed_threads_set(struct sr_session *session,
+		size_t high_water, enum sr_datafeed_queue_policy policy)
+{
+	if (!session) {
+		sr_err("%s: session was NULL", __func__);
+		return SR_ERR_ARG;
+	}
+
+	if (policy != SR_DATAFEED_QUEUE_BLOCK &&
+			policy != SR_DATAFEED_QUEUE_DROP)
+		return SR_ERR_ARG;
+
+	if (session->running) {
+		sr_err("Cannot change the datafeed mode of a running session.");
+		return SR_ERR;
+	}
+
+	session->feed_high_water = high_water;
+	session->feed_policy = policy;
+
+	return SR_OK;
+}
+
+/**
+ * Get the queue statistics of a threaded datafeed callback.
+ *
+ * The statistics cover the most recent session run, and remain
+ * available after the session stopped. They are all zero when the
+ * session is not in threaded mode.
+ *
+ * @param session The session to use. Must not be NULL.
+ * @param cb The callback as passed to sr_session_datafeed_callback_add().
+ * @param cb_data The callback's data as passed at registration time.
+ * @param stats Pointer to where the statistics get stored.
+ *              Must not be NULL.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument, or unknown callback.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_session_datafeed_stats_get(struct sr_session *session,
+		sr_datafeed_callback cb, void *cb_data,
+		struct sr_datafeed_queue_stats *stats)
+{
+	struct datafeed_callback *cb_struct;
+	GSList *l;
+
+	if (!session || !stats)
+		return SR_ERR_ARG;
+
+	for (l = session->datafeed_callbacks; l; l = l->next) {
+		cb_struct = l->data;
+		if (cb_struct->cb != cb || cb_struct->cb_data != cb_data)
+			continue;
+		g_mutex_lock(&cb_struct->mutex);
+		*stats = cb_struct->stats;
+		stats->depth = cb_struct->count;
+		if (cb_struct->stats.packets)
+			stats->latency_avg_us = cb_struct->latency_sum_us /
+				cb_struct->stats.packets;
+		g_mutex_unlock(&cb_struct->mutex);
+		return SR_OK;
+	}
+
+	return SR_ERR_ARG;
+}
+
+/**
+ * Have USB devices handle their transfers in a thread of their own.
+ *
+ * By default USB transfers complete in the session's main loop, so a
+ * slow datafeed callback delays the resubmission of transfers, and the
+ * device's buffer can overflow. With the event thread enabled, drivers
+ * which support it run libusb's event handling in a thread, which
+ * resubmits transfers immediately, and pass the received data to the
+ * session's thread through a lock-free ring. Drivers without support
+ * are not affected.
+ *
+ * The thread handles the events of all USB devices, so it is only used
+ * when the session holds a single USB device. Sessions with multiple
+ * USB devices handle the events of all of them in the main loop.
+ *
+ * @param session The session to use. Must not be NULL.
+ * @param enable TRUE to enable the USB event thread.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ * @retval SR_ERR The session is running.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_session_usb_event_thread_set(struct sr_session *session,
+		gboolean enable)
+{
+	if (!session)
+		return SR_ERR_ARG;
+
+	if (session->running) {
+		sr_err("Cannot change the USB mode of a running session.");
+		return SR_ERR;
+	}
+
+	session->usb_event_thread = enable;
+
+	return SR_OK;
+}
+
+/**
+ * Get the statistics of a device's USB transfers.
+ *
+ * The statistics cover the device's most recent acquisition, and are
+ * available after the acquisition has finished. Overflows count data
+ * which was lost because the session thread did not keep up, underruns
+ * count the times at which no transfer was pending on the device. Both
+ * are only counted with the USB event thread. Drivers which adjust
+ * their transfers at runtime report the final transfer size and count,
+ * and a histogram of the transfers' latencies.
+ *
+ * @param session The session to use. Must not be NULL.
+ * @param sdi The device. Must not be NULL.
+ * @param stats Pointer to where the statistics get stored.
+ *              Must not be NULL.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ * @retval SR_ERR_NA The device did not report USB statistics.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_session_usb_stats_get(struct sr_session *session,
+		const struct sr_dev_inst *sdi, struct sr_usb_stream_stats *stats)
+{
+	struct sr_usb_stream_stats *dev_stats;
+
+	if (!session || !sdi || !stats)
+		return SR_ERR_ARG;
+
+	if (!session->usb_stats)
+		return SR_ERR_NA;
+	dev_stats = g_hash_table_lookup(session->usb_stats, sdi);
+	if (!dev_stats)
+		return SR_ERR_NA;
+	*stats = *dev_stats;
+
+	return SR_OK;
+}
+
 /**
  * Get the trigger assigned to this session.
  *
@@ -691,6 +1150,7 @@ static gboolean delayed_stop_check(void *data)
 
 	session->running = FALSE;
 	unset_main_context(session);
+	datafeed_threads_stop(session);
 
 	sr_info("Stopped.");
 
@@ -806,6 +1266,18 @@ SR_API int sr_session_start(struct sr_session *session)
 	if (ret != SR_OK)
 		return ret;
 
+	sr_session_overview_start(session);
+
+	if (session->usb_stats)
+		g_hash_table_remove_all(session->usb_stats);
+
+	ret = datafeed_threads_start(session);
+	if (ret != SR_OK) {
+		datafeed_threads_stop(session);
+		unset_main_context(session);
+		return ret;
+	}
+
 	sr_info("Starting.");
 
 	session->running = TRUE;
@@ -837,6 +1309,7 @@ SR_API int sr_session_start(struct sr_session *session)
 		 * sources... */
 		session->running = FALSE;
 
+		datafeed_threads_stop(session);
 		unset_main_context(session);
 		return ret;
 	}
@@ -1035,6 +1508,7 @@ static void datafeed_dump(const struct sr_datafeed_packet *packet)
 {
 	const struct sr_datafeed_logic *logic;
 	const struct sr_datafeed_analog *analog;
+	const struct sr_datafeed_logic_rle *rle;
 
 	/* Please use the same order as in libsigrok.h. */
 	switch (packet->type) {
@@ -1066,6 +1540,11 @@ static void datafeed_dump(const struct sr_datafeed_packet *packet)
 		sr_dbg("bus: Received SR_DF_ANALOG packet (%d samples).",
 		       analog->num_samples);
 		break;
+	case SR_DF_LOGIC_RLE:
+		rle = packet->payload;
+		sr_dbg("bus: Received SR_DF_LOGIC_RLE packet (%" PRIu64 " runs, "
+		       "unitsize = %d).", rle->num_runs, rle->unitsize);
+		break;
 	default:
 		sr_dbg("bus: Received unknown packet type: %d.", packet->type);
 		break;
@@ -1108,6 +1587,76 @@ SR_PRIV int sr_session_send_meta(const struct sr_dev_inst *sdi,
 	return ret;
 }
 
+/*
+ * Send run-length encoded logic data in expanded form, in chunks of
+ * bounded size. Either passes the chunks through the complete session
+ * feed (when transforms need to see them), or to the @a target callback,
+ * or to those directly called callbacks which did not declare
+ * SR_DF_LOGIC_RLE support.
+ */
+static int session_send_rle_expanded(const struct sr_dev_inst *sdi,
+		const struct sr_datafeed_logic_rle *rle, gboolean via_transforms,
+		struct datafeed_callback *target)
+{
+	struct sr_logic_rle_expand expand;
+	struct sr_datafeed_packet packet;
+	struct sr_datafeed_logic logic;
+	struct datafeed_callback *cb_struct;
+	uint8_t *buf;
+	size_t buf_count, count;
+	uint64_t total;
+	GSList *l;
+	int ret;
+
+	if (!rle->unitsize)
+		return SR_ERR_ARG;
+	total = sr_logic_rle_num_samples(rle);
+	if (!total)
+		return SR_OK;
+	buf_count = SR_LOGIC_RLE_EXPAND_SIZE / rle->unitsize;
+	if (buf_count > total)
+		buf_count = total;
+	buf = g_try_malloc(buf_count * rle->unitsize);
+	if (!buf)
+		return SR_ERR_MALLOC;
+
+	packet.type = SR_DF_LOGIC;
+	packet.payload = &logic;
+	logic.unitsize = rle->unitsize;
+	logic.data = buf;
+
+	ret = SR_OK;
+	sr_logic_rle_expand_init(&expand, rle);
+	while ((count = sr_logic_rle_expand(&expand, buf, buf_count))) {
+		logic.length = count * rle->unitsize;
+		if (via_transforms) {
+			ret = sr_session_send(sdi, &packet);
+			if (ret != SR_OK)
+				break;
+			continue;
+		}
+		if (target) {
+			if (sr_log_loglevel_get() >= SR_LOG_DBG)
+				datafeed_dump(&packet);
+			target->cb(sdi, &packet, target->cb_data);
+			continue;
+		}
+		for (l = sdi->session->datafeed_callbacks; l; l = l->next) {
+			cb_struct = l->data;
+			if (cb_struct->flags & SR_DATAFEED_CB_LOGIC_RLE)
+				continue;
+			if (cb_struct->thread)
+				continue;
+			if (sr_log_loglevel_get() >= SR_LOG_DBG)
+				datafeed_dump(&packet);
+			cb_struct->cb(sdi, &packet, cb_struct->cb_data);
+		}
+	}
+	g_free(buf);
+
+	return ret;
+}
+
 /**
  * Send a packet to whatever is listening on the datafeed bus.
  *
@@ -1128,7 +1677,9 @@ SR_PRIV int sr_session_send(const struct sr_dev_inst *sdi,
 	struct datafeed_callback *cb_struct;
 	struct sr_datafeed_packet *packet_in, *packet_out;
 	struct sr_transform *t;
-	int ret;
+	struct shared_packet *shared;
+	gboolean need_expand, pooled;
+	int ret, cb_ret;
 
 	if (!sdi) {
 		sr_err("%s: sdi was NULL", __func__);
@@ -1145,6 +1696,11 @@ SR_PRIV int sr_session_send(const struct sr_dev_inst *sdi,
 		return SR_ERR_BUG;
 	}
 
+	/* Transform modules only understand expanded logic data. */
+	if (packet->type == SR_DF_LOGIC_RLE && sdi->session->transforms)
+		return session_send_rle_expanded(sdi, packet->payload,
+			TRUE, NULL);
+
 	/*
 	 * Pass the packet to the first transform module. If that returns
 	 * another packet (instead of NULL), pass that packet to the next
@@ -1178,16 +1734,69 @@ SR_PRIV int sr_session_send(const struct sr_dev_inst *sdi,
 
 	/*
 	 * If the last transform did output a packet, pass it to all datafeed
-	 * callbacks.
+	 * callbacks. Threaded callbacks get it queued. Run-length encoded
+	 * logic data gets expanded for those callbacks which don't support
+	 * it. A callback's queue error doesn't keep the packet from the
+	 * other callbacks, the first error gets returned.
 	 */
+	need_expand = FALSE;
+	pooled = sdi->session->feed_high_water && sr_packet_is_pooled(packet);
+	shared = NULL;
+	ret = SR_OK;
 	for (l = sdi->session->datafeed_callbacks; l; l = l->next) {
+		cb_struct = l->data;
+		if (cb_struct->thread) {
+			cb_ret = datafeed_queue_push(sdi, cb_struct, packet,
+				pooled, &shared);
+			if (cb_ret != SR_OK) {
+				sr_err("Cannot queue packet for datafeed "
+					"callback: %d.", cb_ret);
+				if (ret == SR_OK)
+					ret = cb_ret;
+			}
+			continue;
+		}
+		if (packet->type == SR_DF_LOGIC_RLE &&
+				!(cb_struct->flags & SR_DATAFEED_CB_LOGIC_RLE)) {
+			need_expand = TRUE;
+			continue;
+		}
 		if (sr_log_loglevel_get() >= SR_LOG_DBG)
 			datafeed_dump(packet);
-		cb_struct = l->data;
 		cb_struct->cb(sdi, packet, cb_struct->cb_data);
 	}
+	if (shared)
+		shared_packet_unref(shared);
+	if (need_expand) {
+		cb_ret = session_send_rle_expanded(sdi, packet->payload,
+			FALSE, NULL);
+		if (ret == SR_OK)
+			ret = cb_ret;
+	}
 
-	return SR_OK;
+	return ret;
+}
+
+/**
+ * Get the packet buffer pool of the session which a device belongs to.
+ *
+ * Drivers can fill sample data into packets from this pool, which get
+ * recycled after consumers released them. See sr_packet_pool_logic_new().
+ *
+ * @param sdi The device instance. Must not be NULL.
+ *
+ * @return The session's pool, or NULL when the device is not part of
+ *         a session.
+ *
+ * @private
+ */
+SR_PRIV struct sr_packet_pool *sr_session_packet_pool(
+		const struct sr_dev_inst *sdi)
+{
+	if (!sdi->session)
+		return NULL;
+
+	return sdi->session->packet_pool;
 }
 
 /**
@@ -1494,6 +2103,110 @@ static void copy_src(struct sr_config *src, struct sr_datafeed_meta *meta_copy)
 	meta_copy->config = g_slist_append(meta_copy->config, item);
 }
 
+/**
+ * Fill a buffer with repetitions of one sample value.
+ *
+ * @param[out] buf The buffer to fill, count * unitsize bytes.
+ * @param[in] value The sample value, unitsize bytes.
+ * @param[in] unitsize The size of a sample in bytes.
+ * @param[in] count The number of samples to write.
+ *
+ * @private
+ */
+SR_PRIV void sr_samples_fill(uint8_t *buf, const uint8_t *value,
+		size_t unitsize, size_t count)
+{
+	size_t total, filled, len;
+
+	if (!count)
+		return;
+	if (unitsize == 1) {
+		memset(buf, value[0], count);
+		return;
+	}
+
+	/* Double the filled part in each step, for large memcpy() calls. */
+	memcpy(buf, value, unitsize);
+	total = count * unitsize;
+	filled = unitsize;
+	while (filled < total) {
+		len = MIN(filled, total - filled);
+		memcpy(&buf[filled], buf, len);
+		filled += len;
+	}
+}
+
+/**
+ * Get the number of samples which run-length encoded logic data expands to.
+ *
+ * @private
+ */
+SR_PRIV uint64_t sr_logic_rle_num_samples(const struct sr_datafeed_logic_rle *rle)
+{
+	uint64_t total, run;
+
+	total = 0;
+	for (run = 0; run < rle->num_runs; run++)
+		total += rle->lengths[run];
+
+	return total;
+}
+
+/**
+ * Start the expansion of run-length encoded logic data.
+ *
+ * @private
+ */
+SR_PRIV void sr_logic_rle_expand_init(struct sr_logic_rle_expand *expand,
+		const struct sr_datafeed_logic_rle *rle)
+{
+	expand->rle = rle;
+	expand->run = 0;
+	expand->run_done = 0;
+}
+
+/**
+ * Expand the next part of run-length encoded logic data.
+ *
+ * Repeated calls expand the complete payload in chunks of at most
+ * count samples.
+ *
+ * @param[in,out] expand The expansion state.
+ * @param[out] buf The buffer for at least count samples.
+ * @param[in] count The maximum number of samples to expand.
+ *
+ * @returns The number of expanded samples, 0 at the end of the data.
+ *
+ * @private
+ */
+SR_PRIV size_t sr_logic_rle_expand(struct sr_logic_rle_expand *expand,
+		uint8_t *buf, size_t count)
+{
+	const struct sr_datafeed_logic_rle *rle;
+	const uint8_t *value;
+	uint64_t remain;
+	size_t done, len;
+
+	rle = expand->rle;
+	done = 0;
+	while (done < count && expand->run < rle->num_runs) {
+		remain = rle->lengths[expand->run] - expand->run_done;
+		len = MIN(remain, count - done);
+		value = rle->values;
+		value += expand->run * rle->unitsize;
+		sr_samples_fill(&buf[done * rle->unitsize], value,
+			rle->unitsize, len);
+		done += len;
+		expand->run_done += len;
+		if (expand->run_done == rle->lengths[expand->run]) {
+			expand->run++;
+			expand->run_done = 0;
+		}
+	}
+
+	return done;
+}
+
 SR_API int sr_packet_copy(const struct sr_datafeed_packet *packet,
 		struct sr_datafeed_packet **copy)
 {
@@ -1501,6 +2214,8 @@ SR_API int sr_packet_copy(const struct sr_datafeed_packet *packet,
 	struct sr_datafeed_meta *meta_copy;
 	const struct sr_datafeed_logic *logic;
 	struct sr_datafeed_logic *logic_copy;
+	const struct sr_datafeed_logic_rle *rle;
+	struct sr_datafeed_logic_rle *rle_copy;
 	const struct sr_datafeed_analog *analog;
 	struct sr_datafeed_analog *analog_copy;
 	struct sr_analog_encoding *encoding_copy;
@@ -1514,6 +2229,8 @@ SR_API int sr_packet_copy(const struct sr_datafeed_packet *packet,
 	switch (packet->type) {
 	case SR_DF_TRIGGER:
 	case SR_DF_END:
+	case SR_DF_FRAME_BEGIN:
+	case SR_DF_FRAME_END:
 		/* No payload. */
 		break;
 	case SR_DF_HEADER:
@@ -1524,7 +2241,7 @@ SR_API int sr_packet_copy(const struct sr_datafeed_packet *packet,
 	case SR_DF_META:
 		meta = packet->payload;
 		meta_copy = g_malloc0(sizeof(struct sr_datafeed_meta));
-		g_slist_foreach(meta->config, (GFunc)copy_src, meta_copy->config);
+		g_slist_foreach(meta->config, (GFunc)copy_src, meta_copy);
 		(*copy)->payload = meta_copy;
 		break;
 	case SR_DF_LOGIC:
@@ -1534,12 +2251,12 @@ SR_API int sr_packet_copy(const struct sr_datafeed_packet *packet,
 			return SR_ERR;
 		logic_copy->length = logic->length;
 		logic_copy->unitsize = logic->unitsize;
-		logic_copy->data = g_malloc(logic->length * logic->unitsize);
+		logic_copy->data = g_malloc(logic->length);
 		if (!logic_copy->data) {
 			g_free(logic_copy);
 			return SR_ERR;
 		}
-		memcpy(logic_copy->data, logic->data, logic->length * logic->unitsize);
+		memcpy(logic_copy->data, logic->data, logic->length);
 		(*copy)->payload = logic_copy;
 		break;
 	case SR_DF_ANALOG:
@@ -1566,6 +2283,19 @@ SR_API int sr_packet_copy(const struct sr_datafeed_packet *packet,
 		analog_copy->spec = spec_copy;
 		(*copy)->payload = analog_copy;
 		break;
+	case SR_DF_LOGIC_RLE:
+		rle = packet->payload;
+		rle_copy = g_malloc(sizeof(*rle_copy));
+		rle_copy->num_runs = rle->num_runs;
+		rle_copy->unitsize = rle->unitsize;
+		rle_copy->values = g_malloc(rle->num_runs * rle->unitsize);
+		memcpy(rle_copy->values, rle->values,
+				rle->num_runs * rle->unitsize);
+		rle_copy->lengths = g_malloc(rle->num_runs * sizeof(uint64_t));
+		memcpy(rle_copy->lengths, rle->lengths,
+				rle->num_runs * sizeof(uint64_t));
+		(*copy)->payload = rle_copy;
+		break;
 	default:
 		sr_err("Unknown packet type %d", packet->type);
 		return SR_ERR;
@@ -1578,6 +2308,7 @@ SR_API void sr_packet_free(struct sr_datafeed_packet *packet)
 {
 	const struct sr_datafeed_meta *meta;
 	const struct sr_datafeed_logic *logic;
+	const struct sr_datafeed_logic_rle *rle;
 	const struct sr_datafeed_analog *analog;
 	struct sr_config *src;
 	GSList *l;
@@ -1585,6 +2316,8 @@ SR_API void sr_packet_free(struct sr_datafeed_packet *packet)
 	switch (packet->type) {
 	case SR_DF_TRIGGER:
 	case SR_DF_END:
+	case SR_DF_FRAME_BEGIN:
+	case SR_DF_FRAME_END:
 		/* No payload. */
 		break;
 	case SR_DF_HEADER:
@@ -1615,6 +2348,12 @@ SR_API void sr_packet_free(struct sr_datafeed_packet *packet)
 		g_free(analog->spec);
 		g_free((void *)packet->payload);
 		break;
+	case SR_DF_LOGIC_RLE:
+		rle = packet->payload;
+		g_free(rle->values);
+		g_free(rle->lengths);
+		g_free((void *)packet->payload);
+		break;
 	default:
 		sr_err("Unknown packet type %d", packet->type);
 	}
@@ -34,22 +34,57 @@
 #define CHUNKSIZE (4 * 1024 * 1024)
 /** @endcond */
 
+/*
+ * Capture file chunks get decompressed by worker threads ahead of their
+ * delivery. Each worker uses its own archive handle, libzip archives
+ * must not be shared across threads. Chunks larger than STREAM_SIZE
+ * (unchunked capture files of older versions) are not held in memory,
+ * but get streamed by the session thread.
+ */
+#define MAX_WORKERS		8
+#define CHUNKS_PER_WORKER	2
+#define STREAM_SIZE		(4 * CHUNKSIZE)
+
 SR_PRIV struct sr_dev_driver session_driver_info;
 
+/* An archive entry which holds a chunk of capture data. */
+struct session_chunk {
+	zip_uint64_t index;
+	char *name;
+	uint64_t size;
+	/* Analog channel of the samples, NULL for logic data. */
+	struct sr_channel *analog_ch;
+	gboolean streamed;
+	/* Decompressed data, protected by the read-ahead mutex. */
+	gboolean done;
+	int error;
+	GSList *packets;
+};
+
 struct session_vdev {
 	char *sessionfile;
 	char *capturefile;
 	struct zip *archive;
 	struct zip_file *capfile;
-	int bytes_read;
+	uint64_t bytes_read;
 	uint64_t samplerate;
 	int unitsize;
 	int num_logic_channels;
 	int num_analog_channels;
-	int cur_analog_channel;
-	GArray *analog_channels;
-	int cur_chunk;
+	GPtrArray *chunks;
+	size_t cur_chunk;
 	gboolean finished;
+	struct read_ahead {
+		struct sr_packet_pool *pool;
+		GMutex mutex;
+		GCond cond;
+		GThread *threads[MAX_WORKERS];
+		struct zip *archives[MAX_WORKERS];
+		int workers;
+		size_t depth;
+		size_t next_job;
+		gboolean stop;
+	} ahead;
 };
 
 static const uint32_t devopts[] = {
@@ -61,143 +96,450 @@ static const uint32_t devopts[] = {
 	SR_CONF_SESSIONFILE | SR_CONF_SET,
 };
 
-static gboolean stream_session_data(struct sr_dev_inst *sdi)
+static void free_chunk(void *p)
 {
-	struct session_vdev *vdev;
-	struct sr_datafeed_packet packet;
-	struct sr_datafeed_logic logic;
-	struct sr_datafeed_analog analog;
-	struct sr_analog_encoding encoding;
-	struct sr_analog_meaning meaning;
-	struct sr_analog_spec spec;
+	struct session_chunk *chunk;
+
+	chunk = p;
+	g_slist_free_full(chunk->packets, (GDestroyNotify)sr_packet_unref);
+	g_free(chunk->name);
+	g_free(chunk);
+}
+
+static struct session_chunk *stat_chunk(struct session_vdev *vdev,
+	const char *name, struct sr_channel *analog_ch)
+{
+	struct session_chunk *chunk;
 	struct zip_stat zs;
-	int ret, got_data;
-	char capturefile[128];
-	void *buf;
 
-	got_data = FALSE;
+	if (zip_stat(vdev->archive, name, 0, &zs) == -1)
+		return NULL;
+
+	chunk = g_malloc0(sizeof(*chunk));
+	chunk->index = zs.index;
+	chunk->name = g_strdup(name);
+	chunk->size = zs.size;
+	chunk->analog_ch = analog_ch;
+	chunk->streamed = zs.size > STREAM_SIZE;
+
+	return chunk;
+}
+
+/*
+ * Add the archive entries of one capture file to the list of chunks.
+ * That's either the entry of the plain name, or its chunks name-1,
+ * name-2, etc.
+ */
+static int add_capture_chunks(struct session_vdev *vdev, const char *name,
+	struct sr_channel *analog_ch)
+{
+	struct session_chunk *chunk;
+	char *chunk_name;
+	int num;
+
+	chunk = stat_chunk(vdev, name, analog_ch);
+	if (chunk) {
+		g_ptr_array_add(vdev->chunks, chunk);
+		return SR_OK;
+	}
+
+	for (num = 1; ; num++) {
+		chunk_name = g_strdup_printf("%s-%d", name, num);
+		chunk = stat_chunk(vdev, chunk_name, analog_ch);
+		g_free(chunk_name);
+		if (!chunk)
+			break;
+		g_ptr_array_add(vdev->chunks, chunk);
+	}
+	if (num == 1) {
+		sr_err("No capture file '%s' in session file '%s'.",
+			name, vdev->sessionfile);
+		return SR_ERR_DATA;
+	}
+
+	return SR_OK;
+}
+
+static int list_chunks(const struct sr_dev_inst *sdi)
+{
+	struct session_vdev *vdev;
+	struct sr_channel *ch;
+	GSList *l;
+	char *name;
+	int index, ret;
+
 	vdev = sdi->priv;
+	vdev->chunks = g_ptr_array_new_with_free_func(free_chunk);
 
-	if (!vdev->capfile) {
-		/* No capture file opened yet, or finished with the last
-		 * chunked one. */
-		if (vdev->capturefile && (vdev->cur_chunk == 0)) {
-			/* capturefile is always the unchunked base name. */
-			if (zip_stat(vdev->archive, vdev->capturefile, 0, &zs) != -1) {
-				/* No chunks, just a single capture file. */
-				vdev->cur_chunk = 0;
-				if (!(vdev->capfile = zip_fopen(vdev->archive,
-						vdev->capturefile, 0)))
-					return FALSE;
-				sr_dbg("Opened %s.", vdev->capturefile);
-			} else {
-				/* Try as first chunk filename. */
-				snprintf(capturefile, sizeof(capturefile) - 1, "%s-1", vdev->capturefile);
-				if (zip_stat(vdev->archive, capturefile, 0, &zs) != -1) {
-					vdev->cur_chunk = 1;
-					if (!(vdev->capfile = zip_fopen(vdev->archive,
-							capturefile, 0)))
-						return FALSE;
-					sr_dbg("Opened %s.", capturefile);
-				} else {
-					sr_err("No capture file '%s' in " "session file '%s'.",
-							vdev->capturefile, vdev->sessionfile);
-					return FALSE;
-				}
-			}
+	/* Purely analog session files have no logic capture file. */
+	if (vdev->capturefile) {
+		if (!vdev->unitsize) {
+			sr_warn("Neither analog nor logic data. Ignoring.");
 		} else {
-			/* Capture data is chunked, advance to the next chunk. */
-			vdev->cur_chunk++;
-			snprintf(capturefile, sizeof(capturefile) - 1, "%s-%d", vdev->capturefile,
-					vdev->cur_chunk);
-			if (zip_stat(vdev->archive, capturefile, 0, &zs) != -1) {
-				if (!(vdev->capfile = zip_fopen(vdev->archive,
-						capturefile, 0)))
-					return FALSE;
-				sr_dbg("Opened %s.", capturefile);
-			} else if (vdev->cur_analog_channel < vdev->num_analog_channels) {
-				vdev->capturefile = g_strdup_printf("analog-1-%d",
-						vdev->num_logic_channels + vdev->cur_analog_channel + 1);
-				vdev->cur_analog_channel++;
-				vdev->cur_chunk = 0;
-				return TRUE;
-			} else {
-				/* We got all the chunks, finish up. */
-				g_free(vdev->capturefile);
-
-				/* If the file has logic channels, the initial value for
-				 * capturefile is set by stream_session_data() - however only
-				 * once. In order to not mess this mechanism up, we simulate
-				 * this here if needed. For purely analog files, capturefile
-				 * is not set.
-				 */
-				if (vdev->num_logic_channels)
-					vdev->capturefile = g_strdup("logic-1");
-				else
-					vdev->capturefile = NULL;
-				return FALSE;
-			}
+			ret = add_capture_chunks(vdev, vdev->capturefile, NULL);
+			if (ret != SR_OK)
+				return ret;
 		}
 	}
 
-	buf = g_malloc(CHUNKSIZE);
-
-	/* unitsize is not defined for purely analog session files. */
-	if (vdev->unitsize)
-		ret = zip_fread(vdev->capfile, buf,
-				CHUNKSIZE / vdev->unitsize * vdev->unitsize);
-	else
-		ret = zip_fread(vdev->capfile, buf, CHUNKSIZE);
-
-	if (ret > 0) {
-		if (vdev->cur_analog_channel != 0) {
-			got_data = TRUE;
-			packet.type = SR_DF_ANALOG;
-			packet.payload = &analog;
-			/* TODO: Use proper 'digits' value for this device (and its modes). */
-			sr_analog_init(&analog, &encoding, &meaning, &spec, 2);
-			analog.meaning->channels = g_slist_prepend(NULL,
-					g_array_index(vdev->analog_channels,
-						struct sr_channel *, vdev->cur_analog_channel - 1));
-			analog.num_samples = ret / sizeof(float);
-			analog.meaning->mq = SR_MQ_VOLTAGE;
-			analog.meaning->unit = SR_UNIT_VOLT;
-			analog.meaning->mqflags = SR_MQFLAG_DC;
-			analog.data = (float *) buf;
-		} else if (vdev->unitsize) {
-			got_data = TRUE;
-			if (ret % vdev->unitsize != 0)
-				sr_warn("Read size %d not a multiple of the"
-					" unit size %d.", ret, vdev->unitsize);
-			packet.type = SR_DF_LOGIC;
-			packet.payload = &logic;
-			logic.length = ret;
-			logic.unitsize = vdev->unitsize;
-			logic.data = buf;
-		} else {
-			/*
-			 * Neither analog data, nor logic which has
-			 * unitsize, must be an unexpected API use.
-			 */
-			sr_warn("Neither analog nor logic data. Ignoring.");
+	index = 0;
+	for (l = sdi->channels; l; l = l->next) {
+		ch = l->data;
+		if (ch->type != SR_CHANNEL_ANALOG)
+			continue;
+		if (index++ == vdev->num_analog_channels)
+			break;
+		name = g_strdup_printf("analog-1-%d",
+			vdev->num_logic_channels + index);
+		ret = add_capture_chunks(vdev, name, ch);
+		g_free(name);
+		if (ret != SR_OK)
+			return ret;
+	}
+
+	return SR_OK;
+}
+
+/* Largest packet payload for a chunk's data. */
+static size_t chunk_packet_size(const struct session_vdev *vdev,
+	const struct session_chunk *chunk)
+{
+	if (chunk->analog_ch || !vdev->unitsize)
+		return CHUNKSIZE;
+
+	return CHUNKSIZE / vdev->unitsize * vdev->unitsize;
+}
+
+static struct sr_datafeed_packet *chunk_packet_new(
+	const struct session_vdev *vdev, const struct session_chunk *chunk,
+	size_t size, void **data)
+{
+	struct sr_datafeed_packet *packet;
+	struct sr_datafeed_logic *logic;
+	struct sr_datafeed_analog *analog;
+
+	if (!chunk->analog_ch) {
+		packet = sr_packet_pool_logic_new(vdev->ahead.pool,
+			size, vdev->unitsize);
+		if (!packet)
+			return NULL;
+		logic = (struct sr_datafeed_logic *)packet->payload;
+		*data = logic->data;
+		return packet;
+	}
+
+	packet = sr_packet_pool_analog_new(vdev->ahead.pool,
+		size / sizeof(float), chunk->analog_ch);
+	if (!packet)
+		return NULL;
+	analog = (struct sr_datafeed_analog *)packet->payload;
+	/* TODO: Use proper 'digits' value for this device (and its modes). */
+	analog->encoding->digits = 2;
+	analog->spec->spec_digits = 2;
+	analog->meaning->mq = SR_MQ_VOLTAGE;
+	analog->meaning->unit = SR_UNIT_VOLT;
+	analog->meaning->mqflags = SR_MQFLAG_DC;
+	*data = analog->data;
+
+	return packet;
+}
+
+/* Trim a packet to the amount of data which was read. */
+static void chunk_packet_trim(const struct session_vdev *vdev,
+	struct sr_datafeed_packet *packet, size_t size)
+{
+	struct sr_datafeed_logic *logic;
+	struct sr_datafeed_analog *analog;
+
+	if (packet->type == SR_DF_ANALOG) {
+		analog = (struct sr_datafeed_analog *)packet->payload;
+		analog->num_samples = size / sizeof(float);
+		return;
+	}
+
+	logic = (struct sr_datafeed_logic *)packet->payload;
+	if (size % vdev->unitsize != 0)
+		sr_warn("Read size %zu not a multiple of the"
+			" unit size %d.", size, vdev->unitsize);
+	logic->length = size;
+}
+
+/*
+ * Read the next packet's worth of data from a capture file. Returns
+ * NULL at the end of the file, or on errors (see @a ret).
+ */
+static struct sr_datafeed_packet *read_packet(const struct session_vdev *vdev,
+	const struct session_chunk *chunk, struct zip_file *zf, int *ret)
+{
+	struct sr_datafeed_packet *packet;
+	void *data;
+	zip_int64_t len;
+
+	*ret = SR_OK;
+	packet = chunk_packet_new(vdev, chunk,
+		chunk_packet_size(vdev, chunk), &data);
+	if (!packet) {
+		*ret = SR_ERR_MALLOC;
+		return NULL;
+	}
+	len = zip_fread(zf, data, chunk_packet_size(vdev, chunk));
+	if (len <= 0) {
+		if (len < 0) {
+			sr_err("Cannot read '%s': %s", chunk->name,
+				zip_file_strerror(zf));
+			*ret = SR_ERR_IO;
 		}
-		if (got_data) {
-			vdev->bytes_read += ret;
-			sr_session_send(sdi, &packet);
+		sr_packet_unref(packet);
+		return NULL;
+	}
+	chunk_packet_trim(vdev, packet, len);
+
+	return packet;
+}
+
+/* Decompress a chunk into a list of packets. */
+static int decode_chunk(const struct session_vdev *vdev, struct zip *archive,
+	struct session_chunk *chunk, GSList **packets)
+{
+	struct sr_datafeed_packet *packet;
+	struct zip_file *zf;
+	int ret;
+
+	*packets = NULL;
+	zf = zip_fopen_index(archive, chunk->index, 0);
+	if (!zf) {
+		sr_err("Cannot open '%s': %s", chunk->name,
+			zip_strerror(archive));
+		return SR_ERR_IO;
+	}
+	while ((packet = read_packet(vdev, chunk, zf, &ret)))
+		*packets = g_slist_prepend(*packets, packet);
+	zip_fclose(zf);
+	*packets = g_slist_reverse(*packets);
+
+	return ret;
+}
+
+/*
+ * Read-ahead worker. Takes the next chunk in sequence as long as the
+ * read-ahead depth allows, and hands the decompressed packets to the
+ * session thread.
+ */
+static gpointer read_ahead_worker(gpointer data)
+{
+	struct session_vdev *vdev;
+	struct read_ahead *ahead;
+	struct session_chunk *chunk;
+	struct zip *archive;
+	GSList *packets;
+	int ret;
+
+	vdev = data;
+	ahead = &vdev->ahead;
+
+	g_mutex_lock(&ahead->mutex);
+	archive = ahead->archives[ahead->workers++];
+	g_cond_broadcast(&ahead->cond);
+	while (TRUE) {
+		while (!ahead->stop && ahead->next_job < vdev->chunks->len &&
+				ahead->next_job >= vdev->cur_chunk + ahead->depth)
+			g_cond_wait(&ahead->cond, &ahead->mutex);
+		if (ahead->stop || ahead->next_job >= vdev->chunks->len)
+			break;
+		chunk = g_ptr_array_index(vdev->chunks, ahead->next_job++);
+		g_mutex_unlock(&ahead->mutex);
+
+		packets = NULL;
+		ret = SR_OK;
+		if (!chunk->streamed)
+			ret = decode_chunk(vdev, archive, chunk, &packets);
+
+		g_mutex_lock(&ahead->mutex);
+		chunk->packets = packets;
+		chunk->error = ret;
+		chunk->done = TRUE;
+		g_cond_broadcast(&ahead->cond);
+	}
+	g_mutex_unlock(&ahead->mutex);
+
+	return NULL;
+}
+
+static void read_ahead_start(struct session_vdev *vdev)
+{
+	struct read_ahead *ahead;
+	struct zip *archive;
+	GThread *thread;
+	int count, idx, ret;
+
+	ahead = &vdev->ahead;
+	ahead->workers = 0;
+	ahead->next_job = 0;
+	ahead->stop = FALSE;
+	g_mutex_init(&ahead->mutex);
+	g_cond_init(&ahead->cond);
+
+	count = CLAMP((int)g_get_num_processors() - 1, 1, MAX_WORKERS);
+	for (idx = 0; idx < count; idx++) {
+		archive = zip_open(vdev->sessionfile, 0, &ret);
+		if (!archive) {
+			sr_warn("Cannot open session file for read-ahead: "
+				"zip error %d.", ret);
+			break;
 		}
+		ahead->archives[idx] = archive;
+	}
+	count = idx;
+	ahead->depth = count * CHUNKS_PER_WORKER;
+
+	/* Workers pick their archive, and count themselves as started. */
+	for (idx = 0; idx < count; idx++) {
+		thread = g_thread_new("session-read-ahead",
+			read_ahead_worker, vdev);
+		ahead->threads[idx] = thread;
+	}
+	g_mutex_lock(&ahead->mutex);
+	while (ahead->workers < count)
+		g_cond_wait(&ahead->cond, &ahead->mutex);
+	g_mutex_unlock(&ahead->mutex);
+
+	sr_dbg("Started %d read-ahead workers.", count);
+}
+
+static void read_ahead_stop(struct session_vdev *vdev)
+{
+	struct read_ahead *ahead;
+	int idx;
+
+	ahead = &vdev->ahead;
+	g_mutex_lock(&ahead->mutex);
+	ahead->stop = TRUE;
+	g_cond_broadcast(&ahead->cond);
+	g_mutex_unlock(&ahead->mutex);
+
+	for (idx = 0; idx < ahead->workers; idx++) {
+		g_thread_join(ahead->threads[idx]);
+		ahead->threads[idx] = NULL;
+		zip_discard(ahead->archives[idx]);
+		ahead->archives[idx] = NULL;
+	}
+	ahead->workers = 0;
+	g_cond_clear(&ahead->cond);
+	g_mutex_clear(&ahead->mutex);
+}
+
+static void next_chunk(struct session_vdev *vdev)
+{
+	g_mutex_lock(&vdev->ahead.mutex);
+	vdev->cur_chunk++;
+	g_cond_broadcast(&vdev->ahead.cond);
+	g_mutex_unlock(&vdev->ahead.mutex);
+}
+
+static void send_packet(struct sr_dev_inst *sdi,
+	struct sr_datafeed_packet *packet)
+{
+	struct session_vdev *vdev;
+	const struct sr_datafeed_logic *logic;
+	const struct sr_datafeed_analog *analog;
+
+	vdev = sdi->priv;
+	if (packet->type == SR_DF_LOGIC) {
+		logic = packet->payload;
+		vdev->bytes_read += logic->length;
 	} else {
-		/* done with this capture file */
-		zip_fclose(vdev->capfile);
-		vdev->capfile = NULL;
-		if (vdev->cur_chunk != 0) {
-			/* There might be more chunks, so don't fall through
-			 * to the SR_DF_END here. */
-			got_data = TRUE;
+		analog = packet->payload;
+		vdev->bytes_read += analog->num_samples * sizeof(float);
+	}
+	sr_session_send(sdi, packet);
+	sr_packet_unref(packet);
+}
+
+/*
+ * Stream a chunk which is too large for read-ahead, one packet per
+ * call. Returns FALSE when the chunk is done.
+ */
+static gboolean stream_chunk(struct sr_dev_inst *sdi,
+	struct session_chunk *chunk, int *ret)
+{
+	struct session_vdev *vdev;
+	struct sr_datafeed_packet *packet;
+
+	vdev = sdi->priv;
+	*ret = SR_OK;
+	if (!vdev->capfile) {
+		vdev->capfile = zip_fopen_index(vdev->archive, chunk->index, 0);
+		if (!vdev->capfile) {
+			sr_err("Cannot open '%s': %s", chunk->name,
+				zip_strerror(vdev->archive));
+			*ret = SR_ERR_IO;
+			return FALSE;
 		}
+		sr_dbg("Opened %s.", chunk->name);
+	}
+
+	packet = read_packet(vdev, chunk, vdev->capfile, ret);
+	if (packet) {
+		send_packet(sdi, packet);
+		return TRUE;
+	}
+
+	zip_fclose(vdev->capfile);
+	vdev->capfile = NULL;
+
+	return FALSE;
+}
+
+static gboolean stream_session_data(struct sr_dev_inst *sdi)
+{
+	struct session_vdev *vdev;
+	struct session_chunk *chunk;
+	GSList *packets, *l;
+	gint64 deadline;
+	int ret;
+
+	vdev = sdi->priv;
+	if (vdev->cur_chunk >= vdev->chunks->len)
+		return FALSE;
+	chunk = g_ptr_array_index(vdev->chunks, vdev->cur_chunk);
+
+	if (chunk->streamed || !vdev->ahead.workers) {
+		if (stream_chunk(sdi, chunk, &ret))
+			return TRUE;
+		if (ret != SR_OK)
+			return FALSE;
+		next_chunk(vdev);
+		return TRUE;
 	}
-	g_free(buf);
 
-	return got_data;
+	/*
+	 * Wait for the read-ahead workers. Don't block the main loop
+	 * for long, acquisition stop requests need to get through.
+	 */
+	deadline = g_get_monotonic_time() + 100 * G_TIME_SPAN_MILLISECOND;
+	g_mutex_lock(&vdev->ahead.mutex);
+	while (!chunk->done) {
+		if (!g_cond_wait_until(&vdev->ahead.cond,
+				&vdev->ahead.mutex, deadline))
+			break;
+	}
+	if (!chunk->done) {
+		g_mutex_unlock(&vdev->ahead.mutex);
+		return TRUE;
+	}
+	packets = chunk->packets;
+	chunk->packets = NULL;
+	ret = chunk->error;
+	vdev->cur_chunk++;
+	g_cond_broadcast(&vdev->ahead.cond);
+	g_mutex_unlock(&vdev->ahead.mutex);
+
+	sr_dbg("Read %s.", chunk->name);
+	for (l = packets; l; l = l->next)
+		send_packet(sdi, l->data);
+	g_slist_free(packets);
+
+	return ret == SR_OK;
 }
 
 static int receive_data(int fd, int revents, void *cb_data)
@@ -216,6 +558,11 @@ static int receive_data(int fd, int revents, void *cb_data)
 	if (!vdev->finished)
 		return G_SOURCE_CONTINUE;
 
+	read_ahead_stop(vdev);
+	g_ptr_array_free(vdev->chunks, TRUE);
+	vdev->chunks = NULL;
+	sr_packet_pool_unref(vdev->ahead.pool);
+	vdev->ahead.pool = NULL;
 	if (vdev->capfile) {
 		zip_fclose(vdev->capfile);
 		vdev->capfile = NULL;
@@ -224,6 +571,7 @@ static int receive_data(int fd, int revents, void *cb_data)
 		zip_discard(vdev->archive);
 		vdev->archive = NULL;
 	}
+	sr_dbg("Read %" PRIu64 " bytes of capture data.", vdev->bytes_read);
 
 	std_session_send_df_end(sdi);
 
@@ -334,20 +682,11 @@ static int config_list(uint32_t key, GVariant **data,
 static int dev_acquisition_start(const struct sr_dev_inst *sdi)
 {
 	struct session_vdev *vdev;
+	struct sr_packet_pool *pool;
 	int ret;
-	GSList *l;
-	struct sr_channel *ch;
 
 	vdev = sdi->priv;
 	vdev->bytes_read = 0;
-	vdev->cur_analog_channel = 0;
-	vdev->analog_channels = g_array_sized_new(FALSE, FALSE,
-			sizeof(struct sr_channel *), vdev->num_analog_channels);
-	for (l = sdi->channels; l; l = l->next) {
-		ch = l->data;
-		if (ch->type == SR_CHANNEL_ANALOG)
-			g_array_append_val(vdev->analog_channels, ch);
-	}
 	vdev->cur_chunk = 0;
 	vdev->finished = FALSE;
 
@@ -360,6 +699,19 @@ static int dev_acquisition_start(const struct sr_dev_inst *sdi)
 		return SR_ERR;
 	}
 
+	ret = list_chunks(sdi);
+	if (ret != SR_OK) {
+		g_ptr_array_free(vdev->chunks, TRUE);
+		vdev->chunks = NULL;
+		zip_discard(vdev->archive);
+		vdev->archive = NULL;
+		return ret;
+	}
+
+	pool = sr_session_packet_pool(sdi);
+	vdev->ahead.pool = pool ? sr_packet_pool_ref(pool) : sr_packet_pool_new();
+	read_ahead_start(vdev);
+
 	std_session_send_df_header(sdi);
 
 	/* freewheeling source */
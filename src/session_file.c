@@ -24,11 +24,17 @@
 #include <errno.h>
 #include <glib.h>
 #include <glib/gstdio.h>
+#include <math.h>
 #include <libsigrok/libsigrok.h>
 #include "libsigrok-internal.h"
 
 /** @cond PRIVATE */
 #define LOG_PREFIX "session-file"
+
+/* Chunks up to this size get decompressed as a whole, and kept. */
+#define CHUNK_CACHE_SIZE (16 * 1024 * 1024)
+/* Number of samples which overviews process at a time. */
+#define OVERVIEW_BLOCK 65536
 /** @endcond */
 
 /**
@@ -393,4 +399,1128 @@ SR_API int sr_session_load(struct sr_context *ctx, const char *filename,
 	return ret;
 }
 
+/** @cond PRIVATE */
+struct sr_session_file {
+	char *filename;
+	struct zip *archive;
+	uint64_t samplerate;
+	struct sr_session_index *index;
+	struct sr_index_capture *logic;
+	GPtrArray *analog;
+	struct sr_overview *overview;
+	/* Most recently decompressed chunk. */
+	struct {
+		const struct sr_index_capture *cap;
+		size_t chunk;
+		uint8_t *data;
+		size_t alloc;
+	} cache;
+	/* Sequential reader of a chunk which is too large for the cache. */
+	struct {
+		const struct sr_index_capture *cap;
+		size_t chunk;
+		struct zip_file *zf;
+		uint64_t pos;
+	} stream;
+	uint8_t *scratch;
+};
+/** @endcond */
+
+/* Read from an archive entry until the buffer is full, or at its end. */
+static zip_int64_t read_full(struct zip_file *zf, void *buf, uint64_t len)
+{
+	zip_int64_t ret;
+	uint64_t done;
+
+	done = 0;
+	while (done < len) {
+		ret = zip_fread(zf, (uint8_t *)buf + done, len - done);
+		if (ret < 0)
+			return ret;
+		if (ret == 0)
+			break;
+		done += ret;
+	}
+
+	return done;
+}
+
+/*
+ * Stat the archive entry of a capture file chunk. The chunks of a
+ * capture file "name" are "name-1", "name-2", etc, while files of
+ * older versions can have the plain "name" entry.
+ */
+static int stat_chunk(struct zip *archive, const char *name, size_t chunk,
+	gboolean plain, struct zip_stat *zs)
+{
+	char *entry_name;
+	int ret;
+
+	if (plain)
+		return zip_stat(archive, name, 0, zs);
+
+	entry_name = g_strdup_printf("%s-%zu", name, chunk + 1);
+	ret = zip_stat(archive, entry_name, 0, zs);
+	g_free(entry_name);
+
+	return ret;
+}
+
+/*
+ * Look up the archive entries of an index's chunks. Fails when the
+ * index doesn't match the archive (stale or damaged index).
+ */
+static int resolve_chunks(struct sr_session_file *sf,
+	struct sr_index_capture *cap)
+{
+	struct sr_index_chunk *chunk;
+	struct zip_stat zs;
+	gboolean plain;
+	size_t n;
+
+	plain = cap->chunks->len == 1 &&
+		zip_stat(sf->archive, cap->name, 0, &zs) != -1;
+	for (n = 0; n < cap->chunks->len; n++) {
+		chunk = &g_array_index(cap->chunks, struct sr_index_chunk, n);
+		if (stat_chunk(sf->archive, cap->name, n, plain, &zs) == -1)
+			return SR_ERR_DATA;
+		if (zs.size / cap->unitsize != chunk->count)
+			return SR_ERR_DATA;
+		chunk->entry = zs.index;
+	}
+	/* All chunks must be covered. */
+	if (!plain && stat_chunk(sf->archive, cap->name, n, FALSE, &zs) != -1)
+		return SR_ERR_DATA;
+
+	return SR_OK;
+}
+
+/* Summarize a capture file's chunks, decompressing all of them. */
+static int scan_capture(struct sr_session_file *sf,
+	struct sr_index_capture *cap)
+{
+	struct zip_stat zs;
+	struct zip_file *zf;
+	gboolean plain;
+	uint64_t len;
+	size_t n;
+	zip_int64_t ret;
+
+	plain = zip_stat(sf->archive, cap->name, 0, &zs) != -1;
+	len = CHUNK_CACHE_SIZE / cap->unitsize * cap->unitsize;
+	for (n = 0; stat_chunk(sf->archive, cap->name, n, plain, &zs) != -1; n++) {
+		zf = zip_fopen_index(sf->archive, zs.index, 0);
+		if (!zf) {
+			sr_err("Cannot open '%s': %s", zs.name,
+				zip_strerror(sf->archive));
+			return SR_ERR_IO;
+		}
+		sr_session_index_chunk_start(cap);
+		while ((ret = read_full(zf, sf->scratch, len)) > 0) {
+			if (cap->type == SR_CHANNEL_LOGIC)
+				sr_session_index_add_logic(cap, sf->scratch,
+					ret / cap->unitsize);
+			else
+				sr_session_index_add_analog(cap,
+					(const float *)sf->scratch,
+					ret / cap->unitsize);
+		}
+		if (ret < 0) {
+			sr_err("Cannot read '%s': %s", zs.name,
+				zip_file_strerror(zf));
+			zip_fclose(zf);
+			return SR_ERR_IO;
+		}
+		zip_fclose(zf);
+		if (plain)
+			break;
+	}
+
+	return SR_OK;
+}
+
+/*
+ * Indexes of session files which don't have one are kept in the user's
+ * cache directory, in files named by the hash of the session file's
+ * path. They hold the session file's size and modification time, to
+ * detect when the file changed.
+ */
+static char *index_cache_path(const char *filename)
+{
+	char *cwd, *path, *sum, *name, *cache_path;
+
+	if (g_path_is_absolute(filename)) {
+		path = g_strdup(filename);
+	} else {
+		cwd = g_get_current_dir();
+		path = g_build_filename(cwd, filename, NULL);
+		g_free(cwd);
+	}
+	sum = g_compute_checksum_for_string(G_CHECKSUM_SHA256, path, -1);
+	name = g_strdup_printf("%s.index", sum);
+	cache_path = g_build_filename(g_get_user_cache_dir(),
+		"libsigrok", name, NULL);
+	g_free(name);
+	g_free(sum);
+	g_free(path);
+
+	return cache_path;
+}
+
+static void index_cache_stamp(const char *filename, GKeyFile *kf)
+{
+	GStatBuf st;
+
+	if (g_stat(filename, &st) != 0)
+		return;
+	g_key_file_set_uint64(kf, "file", "size", st.st_size);
+	g_key_file_set_uint64(kf, "file", "mtime", st.st_mtime);
+}
+
+static struct sr_session_index *index_cache_load(const char *filename)
+{
+	struct sr_session_index *index;
+	GKeyFile *kf, *stamp;
+	char *path;
+
+	path = index_cache_path(filename);
+	kf = g_key_file_new();
+	stamp = g_key_file_new();
+	index = NULL;
+	index_cache_stamp(filename, stamp);
+	if (g_key_file_load_from_file(kf, path, G_KEY_FILE_NONE, NULL) &&
+			g_key_file_has_group(stamp, "file") &&
+			g_key_file_get_uint64(kf, "file", "size", NULL) ==
+			g_key_file_get_uint64(stamp, "file", "size", NULL) &&
+			g_key_file_get_uint64(kf, "file", "mtime", NULL) ==
+			g_key_file_get_uint64(stamp, "file", "mtime", NULL)) {
+		index = sr_session_index_load(kf);
+	}
+	g_key_file_free(stamp);
+	g_key_file_free(kf);
+	g_free(path);
+
+	return index;
+}
+
+static void index_cache_save(const char *filename,
+	const struct sr_session_index *index)
+{
+	GKeyFile *kf;
+	GError *error;
+	char *path, *dir, *data;
+	gsize len;
+
+	kf = g_key_file_new();
+	index_cache_stamp(filename, kf);
+	sr_session_index_save(index, kf);
+	data = g_key_file_to_data(kf, &len, NULL);
+	g_key_file_free(kf);
+
+	path = index_cache_path(filename);
+	dir = g_path_get_dirname(path);
+	error = NULL;
+	if (g_mkdir_with_parents(dir, 0700) != 0 ||
+			!g_file_set_contents(path, data, len, &error)) {
+		sr_dbg("Cannot cache session file index in '%s'.", path);
+		if (error)
+			g_error_free(error);
+	}
+	g_free(dir);
+	g_free(path);
+	g_free(data);
+}
+
+static struct sr_session_index *index_read(struct sr_session_file *sf)
+{
+	struct sr_session_index *index;
+	struct zip_stat zs;
+	GKeyFile *kf;
+
+	if (zip_stat(sf->archive, "index", 0, &zs) == -1)
+		return NULL;
+	kf = sr_sessionfile_read_metadata(sf->archive, &zs);
+	if (!kf)
+		return NULL;
+	index = sr_session_index_load(kf);
+	g_key_file_free(kf);
+
+	return index;
+}
+
+/*
+ * Check an index against the capture files of the archive, and take
+ * the captures which the reader uses from it.
+ */
+static int index_use(struct sr_session_file *sf,
+	struct sr_session_index *index, GKeyFile *meta, const char *group)
+{
+	struct sr_index_capture *cap;
+	char *name;
+	int unitsize, total_logic, total_analog, i;
+
+	sf->index = index;
+	sf->logic = NULL;
+	g_ptr_array_set_size(sf->analog, 0);
+
+	unitsize = 0;
+	total_logic = 0;
+	if (g_key_file_has_key(meta, group, "capturefile", NULL)) {
+		unitsize = g_key_file_get_integer(meta, group, "unitsize", NULL);
+		total_logic = g_key_file_get_integer(meta, group,
+			"total probes", NULL);
+	}
+	if (unitsize > 0) {
+		name = g_key_file_get_string(meta, group, "capturefile", NULL);
+		cap = sr_session_index_find(index, name);
+		g_free(name);
+		if (!cap || cap->type != SR_CHANNEL_LOGIC ||
+				cap->unitsize != (size_t)unitsize ||
+				resolve_chunks(sf, cap) != SR_OK)
+			return SR_ERR_DATA;
+		sf->logic = cap;
+	}
+
+	total_analog = g_key_file_get_integer(meta, group, "total analog", NULL);
+	for (i = 0; i < total_analog; i++) {
+		name = g_strdup_printf("analog-1-%d", total_logic + i + 1);
+		cap = sr_session_index_find(index, name);
+		g_free(name);
+		if (!cap || cap->type != SR_CHANNEL_ANALOG ||
+				resolve_chunks(sf, cap) != SR_OK)
+			return SR_ERR_DATA;
+		g_ptr_array_add(sf->analog, cap);
+	}
+
+	return SR_OK;
+}
+
+/* Create the index of a session file which doesn't have one. */
+static struct sr_session_index *index_build(struct sr_session_file *sf,
+	GKeyFile *meta, const char *group)
+{
+	struct sr_session_index *index;
+	struct sr_index_capture *cap;
+	char *name;
+	int unitsize, total_logic, total_analog, i, ret;
+
+	sr_info("Indexing session file '%s'.", sf->filename);
+	index = sr_session_index_new();
+	ret = SR_OK;
+
+	total_logic = 0;
+	name = g_key_file_get_string(meta, group, "capturefile", NULL);
+	if (name) {
+		unitsize = g_key_file_get_integer(meta, group, "unitsize", NULL);
+		total_logic = g_key_file_get_integer(meta, group,
+			"total probes", NULL);
+		if (unitsize > 0) {
+			cap = sr_session_index_add(index, name,
+				SR_CHANNEL_LOGIC, unitsize);
+			ret = scan_capture(sf, cap);
+		}
+		g_free(name);
+	}
+
+	total_analog = g_key_file_get_integer(meta, group, "total analog", NULL);
+	for (i = 0; i < total_analog && ret == SR_OK; i++) {
+		name = g_strdup_printf("analog-1-%d", total_logic + i + 1);
+		cap = sr_session_index_add(index, name, SR_CHANNEL_ANALOG, 0);
+		g_free(name);
+		ret = scan_capture(sf, cap);
+	}
+
+	if (ret != SR_OK) {
+		sr_session_index_free(index);
+		return NULL;
+	}
+
+	return index;
+}
+
+/**
+ * Open a session file for random access.
+ *
+ * Unlike sr_session_load(), which replays the whole capture into a
+ * session, this provides access to arbitrary sample ranges of the
+ * capture, and to overviews of the capture's data.
+ *
+ * Session files which were written with an index of their chunks get
+ * opened instantly. For other files, the index gets created when they
+ * get opened first, which takes as long as decompressing the capture,
+ * and is kept in the user's cache directory.
+ *
+ * A session file handle must not be used by multiple threads at the
+ * same time.
+ *
+ * @param[in] filename The name of the session file.
+ * @param[out] file The session file handle.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ * @retval SR_ERR_DATA Malformed session file.
+ * @retval SR_ERR This is not a session file.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_session_file_open(const char *filename,
+		struct sr_session_file **file)
+{
+	struct sr_session_file *sf;
+	struct sr_session_index *index;
+	struct zip_stat zs;
+	GKeyFile *meta;
+	const char *group;
+	char *val;
+	gboolean cached;
+	int ret;
+
+	if (!filename || !file)
+		return SR_ERR_ARG;
+	*file = NULL;
+
+	if ((ret = sr_sessionfile_check(filename)) != SR_OK)
+		return ret;
+
+	sf = g_malloc0(sizeof(*sf));
+	sf->filename = g_strdup(filename);
+	sf->analog = g_ptr_array_new();
+	sf->scratch = g_malloc(CHUNK_CACHE_SIZE);
+	if (!(sf->archive = zip_open(filename, 0, NULL))) {
+		sr_session_file_close(sf);
+		return SR_ERR;
+	}
+	meta = NULL;
+	if (zip_stat(sf->archive, "metadata", 0, &zs) != -1)
+		meta = sr_sessionfile_read_metadata(sf->archive, &zs);
+	if (!meta) {
+		sr_session_file_close(sf);
+		return SR_ERR_DATA;
+	}
+
+	/* Session files have a single device. */
+	group = "device 1";
+	val = g_key_file_get_string(meta, group, "samplerate", NULL);
+	if (!val || sr_parse_sizestring(val, &sf->samplerate) != SR_OK) {
+		g_free(val);
+		g_key_file_free(meta);
+		sr_session_file_close(sf);
+		return SR_ERR_DATA;
+	}
+	g_free(val);
+
+	/* The archive's own index, a cached one, or create it. */
+	cached = FALSE;
+	index = index_read(sf);
+	if (index && index_use(sf, index, meta, group) != SR_OK) {
+		sr_warn("Session file index doesn't match its content.");
+		sr_session_index_free(index);
+		index = NULL;
+	}
+	if (!index && (index = index_cache_load(filename))) {
+		if (index_use(sf, index, meta, group) != SR_OK) {
+			sr_session_index_free(index);
+			index = NULL;
+		}
+	}
+	if (!index && (index = index_build(sf, meta, group))) {
+		if (index_use(sf, index, meta, group) != SR_OK) {
+			sr_session_index_free(index);
+			index = NULL;
+		}
+		cached = TRUE;
+	}
+	sf->index = index;
+	g_key_file_free(meta);
+	if (!index) {
+		sr_session_file_close(sf);
+		return SR_ERR_DATA;
+	}
+	if (cached)
+		index_cache_save(filename, index);
+
+	*file = sf;
+
+	return SR_OK;
+}
+
+/**
+ * Close a session file which was opened with sr_session_file_open().
+ *
+ * @param[in] file The session file handle. Can be NULL.
+ *
+ * @since 0.6.0
+ */
+SR_API void sr_session_file_close(struct sr_session_file *file)
+{
+	if (!file)
+		return;
+
+	if (file->stream.zf)
+		zip_fclose(file->stream.zf);
+	if (file->archive)
+		zip_discard(file->archive);
+	sr_session_index_free(file->index);
+	sr_overview_free(file->overview);
+	g_ptr_array_free(file->analog, TRUE);
+	g_free(file->cache.data);
+	g_free(file->scratch);
+	g_free(file->filename);
+	g_free(file);
+}
+
+/**
+ * Get the properties of a session file's capture.
+ *
+ * @param[in] file The session file handle. Must not be NULL.
+ * @param[out] samplerate The samplerate. Can be NULL.
+ * @param[out] unitsize The number of bytes per logic sample, zero when
+ *             the capture has no logic data. Can be NULL.
+ * @param[out] num_analog The number of analog channels. Can be NULL.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_session_file_get_info(const struct sr_session_file *file,
+		uint64_t *samplerate, unsigned int *unitsize,
+		unsigned int *num_analog)
+{
+	if (!file)
+		return SR_ERR_ARG;
+
+	if (samplerate)
+		*samplerate = file->samplerate;
+	if (unitsize)
+		*unitsize = file->logic ? file->logic->unitsize : 0;
+	if (num_analog)
+		*num_analog = file->analog->len;
+
+	return SR_OK;
+}
+
+static const struct sr_index_capture *get_capture(
+	const struct sr_session_file *file, enum sr_channeltype type,
+	unsigned int channel)
+{
+	if (!file)
+		return NULL;
+	if (type == SR_CHANNEL_LOGIC)
+		return file->logic;
+	if (type == SR_CHANNEL_ANALOG && channel < file->analog->len)
+		return g_ptr_array_index(file->analog, channel);
+
+	return NULL;
+}
+
+/**
+ * Get the number of samples of a session file's capture.
+ *
+ * @param[in] file The session file handle. Must not be NULL.
+ * @param[in] type SR_CHANNEL_LOGIC for the logic data, or
+ *            SR_CHANNEL_ANALOG for an analog channel's data.
+ * @param[in] channel The analog channel, counting from 0 (see
+ *            sr_session_file_get_info()). Ignored for logic data.
+ * @param[out] count The number of samples. Must not be NULL.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument, or no such data.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_session_file_get_num_samples(const struct sr_session_file *file,
+		enum sr_channeltype type, unsigned int channel, uint64_t *count)
+{
+	const struct sr_index_capture *cap;
+
+	if (!count || !(cap = get_capture(file, type, channel)))
+		return SR_ERR_ARG;
+
+	*count = sr_session_index_num_samples(cap);
+
+	return SR_OK;
+}
+
+/*
+ * Read data from a chunk. Small chunks get decompressed as a whole and
+ * are kept for subsequent reads. Large chunks get read sequentially,
+ * reading backwards restarts at the chunk's start.
+ */
+static int chunk_read(struct sr_session_file *sf,
+	const struct sr_index_capture *cap, size_t n,
+	uint64_t offset, uint8_t *buf, uint64_t len)
+{
+	const struct sr_index_chunk *chunk;
+	struct zip_file *zf;
+	uint64_t size, skip;
+	zip_int64_t ret;
+
+	chunk = &g_array_index(cap->chunks, struct sr_index_chunk, n);
+	size = chunk->count * cap->unitsize;
+
+	if (size <= CHUNK_CACHE_SIZE) {
+		if (sf->cache.cap != cap || sf->cache.chunk != n) {
+			sf->cache.cap = NULL;
+			if (sf->cache.alloc < size) {
+				g_free(sf->cache.data);
+				sf->cache.data = g_try_malloc(size);
+				sf->cache.alloc = sf->cache.data ? size : 0;
+				if (!sf->cache.data)
+					return SR_ERR_MALLOC;
+			}
+			zf = zip_fopen_index(sf->archive, chunk->entry, 0);
+			if (!zf) {
+				sr_err("Cannot open chunk: %s",
+					zip_strerror(sf->archive));
+				return SR_ERR_IO;
+			}
+			ret = read_full(zf, sf->cache.data, size);
+			zip_fclose(zf);
+			if (ret < 0 || (uint64_t)ret != size) {
+				sr_err("Cannot read chunk.");
+				return SR_ERR_IO;
+			}
+			sf->cache.cap = cap;
+			sf->cache.chunk = n;
+		}
+		memcpy(buf, sf->cache.data + offset, len);
+		return SR_OK;
+	}
+
+	if (sf->stream.zf && (sf->stream.cap != cap ||
+			sf->stream.chunk != n || sf->stream.pos > offset)) {
+		zip_fclose(sf->stream.zf);
+		sf->stream.zf = NULL;
+	}
+	if (!sf->stream.zf) {
+		sf->stream.zf = zip_fopen_index(sf->archive, chunk->entry, 0);
+		if (!sf->stream.zf) {
+			sr_err("Cannot open chunk: %s",
+				zip_strerror(sf->archive));
+			return SR_ERR_IO;
+		}
+		sf->stream.cap = cap;
+		sf->stream.chunk = n;
+		sf->stream.pos = 0;
+	}
+	while (sf->stream.pos < offset) {
+		skip = MIN(offset - sf->stream.pos, CHUNK_CACHE_SIZE);
+		ret = read_full(sf->stream.zf, sf->scratch, skip);
+		if (ret < 0 || (uint64_t)ret != skip)
+			break;
+		sf->stream.pos += skip;
+	}
+	ret = -1;
+	if (sf->stream.pos == offset)
+		ret = read_full(sf->stream.zf, buf, len);
+	if (ret < 0 || (uint64_t)ret != len) {
+		sr_err("Cannot read chunk.");
+		zip_fclose(sf->stream.zf);
+		sf->stream.zf = NULL;
+		return SR_ERR_IO;
+	}
+	sf->stream.pos += len;
+
+	return SR_OK;
+}
+
+static int read_samples(struct sr_session_file *sf,
+	const struct sr_index_capture *cap, uint64_t start, uint64_t count,
+	uint8_t *buf, uint64_t *num_read)
+{
+	const struct sr_index_chunk *chunk;
+	uint64_t total, offset, len;
+	size_t n;
+	int ret;
+
+	*num_read = 0;
+	total = sr_session_index_num_samples(cap);
+	if (start >= total)
+		return SR_OK;
+	count = MIN(count, total - start);
+
+	n = sr_session_index_lookup(cap, start);
+	while (count) {
+		chunk = &g_array_index(cap->chunks, struct sr_index_chunk, n);
+		offset = start - chunk->first;
+		len = MIN(count, chunk->count - offset);
+		n++;
+		if (!len)
+			continue;
+		ret = chunk_read(sf, cap, n - 1, offset * cap->unitsize,
+			buf, len * cap->unitsize);
+		if (ret != SR_OK)
+			return ret;
+		buf += len * cap->unitsize;
+		start += len;
+		count -= len;
+		*num_read += len;
+	}
+
+	return SR_OK;
+}
+
+/**
+ * Read a range of a session file's logic data.
+ *
+ * Only the chunks which hold the range get decompressed.
+ *
+ * @param[in] file The session file handle. Must not be NULL.
+ * @param[in] start The number of the first sample to read.
+ * @param[in] count The number of samples to read.
+ * @param[out] buf Receives the samples, unitsize bytes each. Must
+ *             have room for @a count samples.
+ * @param[out] num_read The number of samples read, less than @a count
+ *             at the end of the capture. Must not be NULL.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument, or the capture has no logic data.
+ * @retval SR_ERR_IO Reading the session file failed.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_session_file_read_logic(struct sr_session_file *file,
+		uint64_t start, uint64_t count, uint8_t *buf,
+		uint64_t *num_read)
+{
+	const struct sr_index_capture *cap;
+
+	if (!buf || !num_read || !(cap = get_capture(file, SR_CHANNEL_LOGIC, 0)))
+		return SR_ERR_ARG;
+
+	return read_samples(file, cap, start, count, buf, num_read);
+}
+
+/**
+ * Read a range of an analog channel's data from a session file.
+ *
+ * @param[in] file The session file handle. Must not be NULL.
+ * @param[in] channel The analog channel, counting from 0.
+ * @param[in] start The number of the first sample to read.
+ * @param[in] count The number of samples to read.
+ * @param[out] buf Receives the samples. Must have room for @a count
+ *             samples.
+ * @param[out] num_read The number of samples read, less than @a count
+ *             at the end of the capture. Must not be NULL.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument, or no such channel.
+ * @retval SR_ERR_IO Reading the session file failed.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_session_file_read_analog(struct sr_session_file *file,
+		unsigned int channel, uint64_t start, uint64_t count,
+		float *buf, uint64_t *num_read)
+{
+	const struct sr_index_capture *cap;
+
+	if (!buf || !num_read ||
+			!(cap = get_capture(file, SR_CHANNEL_ANALOG, channel)))
+		return SR_ERR_ARG;
+
+	return read_samples(file, cap, start, count, (uint8_t *)buf, num_read);
+}
+
+/** @cond PRIVATE */
+struct overview {
+	const struct sr_index_capture *cap;
+	uint64_t start;
+	uint64_t count;
+	size_t num_bins;
+	uint8_t *bits_or;
+	uint8_t *bits_and;
+	float *min;
+	float *max;
+};
+/** @endcond */
+
+/* Sample number where a bin starts. Bins differ in size by one at most. */
+static uint64_t bin_start(const struct overview *ov, size_t bin)
+{
+	return ov->start + ov->count / ov->num_bins * bin +
+		ov->count % ov->num_bins * bin / ov->num_bins;
+}
+
+/* Merge a chunk's summary from the index into a bin. */
+static void overview_merge_chunk(struct overview *ov, size_t bin, size_t n)
+{
+	const struct sr_index_capture *cap;
+	const struct sr_index_chunk *chunk;
+	const uint8_t *bits_or, *bits_and;
+	size_t idx;
+
+	cap = ov->cap;
+	if (cap->type == SR_CHANNEL_LOGIC) {
+		bits_or = sr_session_index_bits_or(cap, n);
+		bits_and = sr_session_index_bits_and(cap, n);
+		for (idx = 0; idx < cap->unitsize; idx++) {
+			ov->bits_or[bin * cap->unitsize + idx] |= bits_or[idx];
+			ov->bits_and[bin * cap->unitsize + idx] &= bits_and[idx];
+		}
+		return;
+	}
+
+	chunk = &g_array_index(cap->chunks, struct sr_index_chunk, n);
+	ov->min[bin] = MIN(ov->min[bin], chunk->min);
+	ov->max[bin] = MAX(ov->max[bin], chunk->max);
+}
+
+/* Merge samples into a bin. */
+static int overview_merge_samples(struct sr_session_file *sf,
+	struct overview *ov, size_t bin, size_t n,
+	uint64_t start, uint64_t count)
+{
+	const struct sr_index_capture *cap;
+	const struct sr_index_chunk *chunk;
+	const uint8_t *data;
+	const float *values;
+	uint8_t *bits_or, *bits_and;
+	uint64_t len, pos;
+	size_t idx;
+	int ret;
+
+	cap = ov->cap;
+	chunk = &g_array_index(cap->chunks, struct sr_index_chunk, n);
+	bits_or = ov->bits_or + bin * cap->unitsize;
+	bits_and = ov->bits_and + bin * cap->unitsize;
+	while (count) {
+		len = MIN(count, OVERVIEW_BLOCK);
+		ret = chunk_read(sf, cap, n, (start - chunk->first) * cap->unitsize,
+			sf->scratch, len * cap->unitsize);
+		if (ret != SR_OK)
+			return ret;
+		if (cap->type == SR_CHANNEL_LOGIC) {
+			data = sf->scratch;
+			for (pos = 0; pos < len; pos++) {
+				for (idx = 0; idx < cap->unitsize; idx++) {
+					bits_or[idx] |= data[idx];
+					bits_and[idx] &= data[idx];
+				}
+				data += cap->unitsize;
+			}
+		} else {
+			values = (const float *)sf->scratch;
+			for (pos = 0; pos < len; pos++) {
+				if (values[pos] < ov->min[bin])
+					ov->min[bin] = values[pos];
+				if (values[pos] > ov->max[bin])
+					ov->max[bin] = values[pos];
+			}
+		}
+		start += len;
+		count -= len;
+	}
+
+	return SR_OK;
+}
+
+static gboolean overview_valid(const struct overview *ov)
+{
+	return ov->num_bins && ov->count >= ov->num_bins &&
+		ov->start + ov->count >= ov->start &&
+		ov->start + ov->count <= sr_session_index_num_samples(ov->cap);
+}
+
+/*
+ * Summarize a range of samples in bins. Chunks which fall into a
+ * single bin get summarized from the index. Only chunks which span
+ * bin boundaries, or the range's boundaries, get decompressed.
+ */
+static int overview_get(struct sr_session_file *sf, struct overview *ov)
+{
+	const struct sr_index_chunk *chunk;
+	uint64_t pos, end, chunk_end, seg_end;
+	size_t bin, n;
+	int ret;
+
+	pos = ov->start;
+	end = ov->start + ov->count;
+	bin = 0;
+	n = sr_session_index_lookup(ov->cap, pos);
+	while (pos < end) {
+		chunk = &g_array_index(ov->cap->chunks, struct sr_index_chunk, n);
+		chunk_end = MIN(chunk->first + chunk->count, end);
+		while (pos < chunk_end) {
+			while (bin_start(ov, bin + 1) <= pos)
+				bin++;
+			seg_end = MIN(chunk_end, bin_start(ov, bin + 1));
+			if (pos == chunk->first &&
+					seg_end == chunk->first + chunk->count) {
+				overview_merge_chunk(ov, bin, n);
+			} else {
+				ret = overview_merge_samples(sf, ov, bin, n,
+					pos, seg_end - pos);
+				if (ret != SR_OK)
+					return ret;
+			}
+			pos = seg_end;
+		}
+		n++;
+	}
+
+	return SR_OK;
+}
+
+/**
+ * Get an overview of a range of a session file's logic data.
+ *
+ * Splits the range into @a num_bins bins of (nearly) equal size, and
+ * returns the bitwise OR and AND of each bin's samples. A channel's
+ * bit is set in the OR when the channel was high at some point within
+ * the bin, and is clear in the AND when it was low at some point.
+ *
+ * Overviews of large ranges are mostly taken from the file's index,
+ * and don't need to decompress the samples.
+ *
+ * @param[in] file The session file handle. Must not be NULL.
+ * @param[in] start The number of the range's first sample.
+ * @param[in] count The number of samples in the range. Must not be
+ *            less than @a num_bins, the range must be within the
+ *            capture.
+ * @param[in] num_bins The number of bins.
+ * @param[out] bits_or Receives each bin's OR, unitsize bytes per bin.
+ *             Must not be NULL.
+ * @param[out] bits_and Receives each bin's AND, unitsize bytes per bin.
+ *             Must not be NULL.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument, or the capture has no logic data.
+ * @retval SR_ERR_IO Reading the session file failed.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_session_file_logic_overview(struct sr_session_file *file,
+		uint64_t start, uint64_t count, size_t num_bins,
+		uint8_t *bits_or, uint8_t *bits_and)
+{
+	struct overview ov;
+
+	memset(&ov, 0, sizeof(ov));
+	ov.cap = get_capture(file, SR_CHANNEL_LOGIC, 0);
+	if (!ov.cap || !bits_or || !bits_and)
+		return SR_ERR_ARG;
+
+	ov.start = start;
+	ov.count = count;
+	ov.num_bins = num_bins;
+	ov.bits_or = bits_or;
+	ov.bits_and = bits_and;
+	if (!overview_valid(&ov))
+		return SR_ERR_ARG;
+	memset(bits_or, 0x00, num_bins * ov.cap->unitsize);
+	memset(bits_and, 0xff, num_bins * ov.cap->unitsize);
+
+	return overview_get(file, &ov);
+}
+
+/**
+ * Get an overview of a range of an analog channel's data.
+ *
+ * Splits the range into @a num_bins bins of (nearly) equal size, and
+ * returns the minimum and maximum value of each bin's samples. NaN
+ * samples are ignored, bins which only hold NaN samples get a NaN
+ * minimum and maximum.
+ *
+ * @param[in] file The session file handle. Must not be NULL.
+ * @param[in] channel The analog channel, counting from 0.
+ * @param[in] start The number of the range's first sample.
+ * @param[in] count The number of samples in the range. Must not be
+ *            less than @a num_bins, the range must be within the
+ *            capture.
+ * @param[in] num_bins The number of bins.
+ * @param[out] min Receives each bin's minimum. Must not be NULL.
+ * @param[out] max Receives each bin's maximum. Must not be NULL.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument, or no such channel.
+ * @retval SR_ERR_IO Reading the session file failed.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_session_file_analog_overview(struct sr_session_file *file,
+		unsigned int channel, uint64_t start, uint64_t count,
+		size_t num_bins, float *min, float *max)
+{
+	struct overview ov;
+	size_t bin;
+	int ret;
+
+	memset(&ov, 0, sizeof(ov));
+	ov.cap = get_capture(file, SR_CHANNEL_ANALOG, channel);
+	if (!ov.cap || !min || !max)
+		return SR_ERR_ARG;
+
+	ov.start = start;
+	ov.count = count;
+	ov.num_bins = num_bins;
+	ov.min = min;
+	ov.max = max;
+	if (!overview_valid(&ov))
+		return SR_ERR_ARG;
+	for (bin = 0; bin < num_bins; bin++) {
+		min[bin] = INFINITY;
+		max[bin] = -INFINITY;
+	}
+
+	ret = overview_get(file, &ov);
+	for (bin = 0; bin < num_bins; bin++) {
+		if (min[bin] > max[bin])
+			min[bin] = max[bin] = NAN;
+	}
+
+	return ret;
+}
+
+static struct sr_overview *overview_read(struct sr_session_file *sf)
+{
+	struct sr_overview *ov;
+	struct zip_stat zs;
+	struct zip_file *zf;
+	uint8_t *data;
+	zip_int64_t ret;
+
+	if (zip_stat(sf->archive, "overview", 0, &zs) == -1)
+		return NULL;
+	if (!(data = g_try_malloc(zs.size)))
+		return NULL;
+	if (!(zf = zip_fopen_index(sf->archive, zs.index, 0))) {
+		g_free(data);
+		return NULL;
+	}
+	ret = read_full(zf, data, zs.size);
+	zip_fclose(zf);
+	ov = NULL;
+	if (ret >= 0 && (uint64_t)ret == zs.size)
+		ov = sr_overview_load(data, zs.size);
+	g_free(data);
+
+	return ov;
+}
+
+/* Check that an overview has the session file's captures. */
+static gboolean overview_matches(struct sr_session_file *sf,
+	struct sr_overview *ov)
+{
+	const struct sr_index_capture *cap;
+	uint64_t count;
+	unsigned int unitsize, num_analog;
+	guint i;
+
+	sr_overview_get_info(ov, NULL, &unitsize, &num_analog);
+	if (num_analog != sf->analog->len)
+		return FALSE;
+	if (unitsize != (sf->logic ? sf->logic->unitsize : 0))
+		return FALSE;
+	if (sf->logic && (!sr_overview_track_find(ov, sf->logic->name) ||
+			sr_overview_get_num_samples(ov, SR_CHANNEL_LOGIC, 0,
+			&count) != SR_OK ||
+			count != sr_session_index_num_samples(sf->logic)))
+		return FALSE;
+	for (i = 0; i < sf->analog->len; i++) {
+		cap = g_ptr_array_index(sf->analog, i);
+		if (!sr_overview_track_find(ov, cap->name) ||
+				sr_overview_get_num_samples(ov, SR_CHANNEL_ANALOG,
+				i, &count) != SR_OK ||
+				count != sr_session_index_num_samples(cap))
+			return FALSE;
+	}
+
+	return TRUE;
+}
+
+static int overview_add_capture(struct sr_session_file *sf,
+	struct sr_overview *ov, const struct sr_index_capture *cap)
+{
+	struct sr_overview_track *track;
+	const struct sr_index_chunk *chunk;
+	uint64_t offset, len, max_len;
+	size_t n;
+	int ret;
+
+	track = sr_overview_track_add(ov, cap->name, cap->type, cap->unitsize);
+	max_len = CHUNK_CACHE_SIZE / cap->unitsize;
+	for (n = 0; n < cap->chunks->len; n++) {
+		chunk = &g_array_index(cap->chunks, struct sr_index_chunk, n);
+		for (offset = 0; offset < chunk->count; offset += len) {
+			len = MIN(chunk->count - offset, max_len);
+			ret = chunk_read(sf, cap, n, offset * cap->unitsize,
+				sf->scratch, len * cap->unitsize);
+			if (ret != SR_OK)
+				return ret;
+			if (cap->type == SR_CHANNEL_LOGIC)
+				sr_overview_add_logic(ov, track, sf->scratch,
+					cap->unitsize, len);
+			else
+				sr_overview_add_analog(ov, track,
+					(const float *)sf->scratch, len, 1);
+		}
+	}
+
+	return SR_OK;
+}
+
+/**
+ * Get the multi-resolution overview of a session file's capture.
+ *
+ * The overview answers sr_overview_logic_get() and
+ * sr_overview_analog_get() queries for arbitrary ranges, in time which
+ * doesn't depend on the ranges' size. Its logic track holds the
+ * capture's logic data, its analog tracks the analog channels' data,
+ * in the order of sr_session_file_read_analog()'s channels.
+ *
+ * Session files which were written with an overview provide it right
+ * away. For other files, it gets created when it is requested first,
+ * which takes as long as decompressing the capture.
+ *
+ * @param[in] file The session file handle. Must not be NULL.
+ * @param[out] overview The overview, owned by the session file handle.
+ *             Must not be NULL.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ * @retval SR_ERR_IO Reading the session file failed.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_session_file_get_overview(struct sr_session_file *file,
+		struct sr_overview **overview)
+{
+	struct sr_overview *ov;
+	guint i;
+	int ret;
+
+	if (!file || !overview)
+		return SR_ERR_ARG;
+
+	if (!file->overview) {
+		ov = overview_read(file);
+		if (ov && !overview_matches(file, ov)) {
+			sr_warn("Session file overview doesn't match its content.");
+			sr_overview_free(ov);
+			ov = NULL;
+		}
+		if (!ov) {
+			sr_info("Creating overview of session file '%s'.",
+				file->filename);
+			ov = sr_overview_new(0);
+			ret = SR_OK;
+			if (file->logic)
+				ret = overview_add_capture(file, ov, file->logic);
+			for (i = 0; i < file->analog->len && ret == SR_OK; i++)
+				ret = overview_add_capture(file, ov,
+					g_ptr_array_index(file->analog, i));
+			if (ret != SR_OK) {
+				sr_overview_free(ov);
+				return ret;
+			}
+		}
+		file->overview = ov;
+	}
+	*overview = file->overview;
+
+	return SR_OK;
+}
+
 /** @} */
@@ -0,0 +1,484 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * Copyright (C) 2026 The sigrok project developers
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file
+ * Chunk index of srzip session files
+ */
+
+#include "config.h"
+
+#include <glib.h>
+#include <libsigrok/libsigrok.h>
+#include <math.h>
+#include <string.h>
+
+#include "libsigrok-internal.h"
+
+#define LOG_PREFIX "session-index"
+
+/*
+ * The index is a key file, one group per capture file ("logic-1",
+ * "analog-1-9", ...), which lists per chunk:
+ *   samples: number of samples
+ *   or, and: logic data only, bitwise OR and AND of all samples, as
+ *            hex strings of unitsize bytes
+ *   min, max: analog data only, the range of the (non-NaN) values
+ * The first sample number of a chunk follows from the preceding
+ * chunks' sample counts.
+ */
+
+/**
+ * Create an empty chunk index.
+ *
+ * @private
+ */
+SR_PRIV struct sr_session_index *sr_session_index_new(void)
+{
+	struct sr_session_index *index;
+
+	index = g_malloc0(sizeof(*index));
+	index->captures = g_ptr_array_new();
+
+	return index;
+}
+
+static void capture_free(struct sr_index_capture *cap)
+{
+	g_free(cap->name);
+	g_array_free(cap->chunks, TRUE);
+	if (cap->bits_or)
+		g_byte_array_free(cap->bits_or, TRUE);
+	if (cap->bits_and)
+		g_byte_array_free(cap->bits_and, TRUE);
+	g_free(cap);
+}
+
+/** @private */
+SR_PRIV void sr_session_index_free(struct sr_session_index *index)
+{
+	guint i;
+
+	if (!index)
+		return;
+
+	for (i = 0; i < index->captures->len; i++)
+		capture_free(g_ptr_array_index(index->captures, i));
+	g_ptr_array_free(index->captures, TRUE);
+	g_free(index);
+}
+
+/**
+ * Look up a capture file's index.
+ *
+ * @param index The chunk index. Must not be NULL.
+ * @param name The capture file name, e.g. "logic-1" or "analog-1-9".
+ *
+ * @return The capture file's index, NULL when not found.
+ *
+ * @private
+ */
+SR_PRIV struct sr_index_capture *sr_session_index_find(
+		const struct sr_session_index *index, const char *name)
+{
+	struct sr_index_capture *cap;
+	guint i;
+
+	for (i = 0; i < index->captures->len; i++) {
+		cap = g_ptr_array_index(index->captures, i);
+		if (!strcmp(cap->name, name))
+			return cap;
+	}
+
+	return NULL;
+}
+
+/**
+ * Add a capture file to the index.
+ *
+ * @param index The chunk index. Must not be NULL.
+ * @param name The capture file name.
+ * @param type SR_CHANNEL_LOGIC or SR_CHANNEL_ANALOG.
+ * @param unitsize Bytes per sample of logic data.
+ *
+ * @return The capture file's (empty) index.
+ *
+ * @private
+ */
+SR_PRIV struct sr_index_capture *sr_session_index_add(
+		struct sr_session_index *index, const char *name,
+		int type, size_t unitsize)
+{
+	struct sr_index_capture *cap;
+
+	cap = g_malloc0(sizeof(*cap));
+	cap->name = g_strdup(name);
+	cap->type = type;
+	if (type == SR_CHANNEL_LOGIC) {
+		cap->unitsize = unitsize;
+		cap->bits_or = g_byte_array_new();
+		cap->bits_and = g_byte_array_new();
+	} else {
+		cap->unitsize = sizeof(float);
+	}
+	cap->chunks = g_array_new(FALSE, TRUE, sizeof(struct sr_index_chunk));
+	g_ptr_array_add(index->captures, cap);
+
+	return cap;
+}
+
+/**
+ * Start the next chunk of a capture file.
+ *
+ * Data which gets added after this call accumulates in the chunk.
+ *
+ * @private
+ */
+SR_PRIV void sr_session_index_chunk_start(struct sr_index_capture *cap)
+{
+	struct sr_index_chunk chunk, *prev;
+
+	memset(&chunk, 0, sizeof(chunk));
+	if (cap->chunks->len) {
+		prev = &g_array_index(cap->chunks, struct sr_index_chunk,
+			cap->chunks->len - 1);
+		chunk.first = prev->first + prev->count;
+	}
+	chunk.min = INFINITY;
+	chunk.max = -INFINITY;
+	g_array_append_val(cap->chunks, chunk);
+
+	if (cap->type != SR_CHANNEL_LOGIC)
+		return;
+	g_byte_array_set_size(cap->bits_or, cap->bits_or->len + cap->unitsize);
+	g_byte_array_set_size(cap->bits_and, cap->bits_and->len + cap->unitsize);
+	memset(sr_session_index_bits_or(cap, cap->chunks->len - 1),
+		0x00, cap->unitsize);
+	memset(sr_session_index_bits_and(cap, cap->chunks->len - 1),
+		0xff, cap->unitsize);
+}
+
+static struct sr_index_chunk *last_chunk(struct sr_index_capture *cap)
+{
+	return &g_array_index(cap->chunks, struct sr_index_chunk,
+		cap->chunks->len - 1);
+}
+
+/**
+ * Account logic samples to the current chunk.
+ *
+ * @param cap The capture file's index, with a chunk started.
+ * @param data Sample data, unitsize bytes per sample.
+ * @param count Number of samples.
+ *
+ * @private
+ */
+SR_PRIV void sr_session_index_add_logic(struct sr_index_capture *cap,
+		const uint8_t *data, size_t count)
+{
+	uint8_t *bits_or, *bits_and;
+	size_t unitsize, pos, idx;
+
+	unitsize = cap->unitsize;
+	bits_or = sr_session_index_bits_or(cap, cap->chunks->len - 1);
+	bits_and = sr_session_index_bits_and(cap, cap->chunks->len - 1);
+	for (pos = 0; pos < count; pos++) {
+		for (idx = 0; idx < unitsize; idx++) {
+			bits_or[idx] |= data[idx];
+			bits_and[idx] &= data[idx];
+		}
+		data += unitsize;
+	}
+	last_chunk(cap)->count += count;
+}
+
+/**
+ * Account analog samples to the current chunk.
+ *
+ * @private
+ */
+SR_PRIV void sr_session_index_add_analog(struct sr_index_capture *cap,
+		const float *values, size_t count)
+{
+	struct sr_index_chunk *chunk;
+	size_t pos;
+
+	chunk = last_chunk(cap);
+	for (pos = 0; pos < count; pos++) {
+		if (values[pos] < chunk->min)
+			chunk->min = values[pos];
+		if (values[pos] > chunk->max)
+			chunk->max = values[pos];
+	}
+	chunk->count += count;
+}
+
+/** @private */
+SR_PRIV uint8_t *sr_session_index_bits_or(const struct sr_index_capture *cap,
+		size_t chunk)
+{
+	return cap->bits_or->data + chunk * cap->unitsize;
+}
+
+/** @private */
+SR_PRIV uint8_t *sr_session_index_bits_and(const struct sr_index_capture *cap,
+		size_t chunk)
+{
+	return cap->bits_and->data + chunk * cap->unitsize;
+}
+
+/**
+ * Find the chunk which holds a sample.
+ *
+ * @return The chunk's position in the capture file's list of chunks.
+ *         The number of chunks when the sample is beyond the end.
+ *
+ * @private
+ */
+SR_PRIV size_t sr_session_index_lookup(const struct sr_index_capture *cap,
+		uint64_t sample)
+{
+	const struct sr_index_chunk *chunks;
+	size_t lo, hi, mid;
+
+	chunks = (const struct sr_index_chunk *)cap->chunks->data;
+	lo = 0;
+	hi = cap->chunks->len;
+	while (lo < hi) {
+		mid = lo + (hi - lo) / 2;
+		if (chunks[mid].first + chunks[mid].count <= sample)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	return lo;
+}
+
+/** @private */
+SR_PRIV uint64_t sr_session_index_num_samples(const struct sr_index_capture *cap)
+{
+	const struct sr_index_chunk *chunk;
+
+	if (!cap->chunks->len)
+		return 0;
+	chunk = &g_array_index(cap->chunks, struct sr_index_chunk,
+		cap->chunks->len - 1);
+
+	return chunk->first + chunk->count;
+}
+
+static void set_hex_list(GKeyFile *kf, const char *group, const char *key,
+	const uint8_t *data, size_t unitsize, size_t count)
+{
+	GString *s;
+	size_t pos, idx;
+
+	s = g_string_sized_new(count * (2 * unitsize + 1));
+	for (pos = 0; pos < count; pos++) {
+		for (idx = 0; idx < unitsize; idx++)
+			g_string_append_printf(s, "%02x", *data++);
+		g_string_append_c(s, ';');
+	}
+	g_key_file_set_value(kf, group, key, s->str);
+	g_string_free(s, TRUE);
+}
+
+/**
+ * Store the index in a key file.
+ *
+ * @private
+ */
+SR_PRIV void sr_session_index_save(const struct sr_session_index *index,
+		GKeyFile *kf)
+{
+	const struct sr_index_capture *cap;
+	const struct sr_index_chunk *chunk;
+	GString *samples;
+	double *min, *max;
+	guint i, n;
+
+	for (i = 0; i < index->captures->len; i++) {
+		cap = g_ptr_array_index(index->captures, i);
+		samples = g_string_sized_new(cap->chunks->len * 8);
+		min = g_malloc0(sizeof(*min) * (cap->chunks->len + 1));
+		max = g_malloc0(sizeof(*max) * (cap->chunks->len + 1));
+		for (n = 0; n < cap->chunks->len; n++) {
+			chunk = &g_array_index(cap->chunks, struct sr_index_chunk, n);
+			g_string_append_printf(samples, "%" PRIu64 ";", chunk->count);
+			/* Empty or all NaN chunks have no range. */
+			min[n] = chunk->min <= chunk->max ? chunk->min : NAN;
+			max[n] = chunk->min <= chunk->max ? chunk->max : NAN;
+		}
+		g_key_file_set_value(kf, cap->name, "samples", samples->str);
+		if (cap->type == SR_CHANNEL_LOGIC) {
+			g_key_file_set_integer(kf, cap->name, "unitsize",
+				cap->unitsize);
+			set_hex_list(kf, cap->name, "or", cap->bits_or->data,
+				cap->unitsize, cap->chunks->len);
+			set_hex_list(kf, cap->name, "and", cap->bits_and->data,
+				cap->unitsize, cap->chunks->len);
+		} else {
+			g_key_file_set_double_list(kf, cap->name, "min",
+				min, cap->chunks->len);
+			g_key_file_set_double_list(kf, cap->name, "max",
+				max, cap->chunks->len);
+		}
+		g_string_free(samples, TRUE);
+		g_free(min);
+		g_free(max);
+	}
+}
+
+static int get_hex_list(GKeyFile *kf, const char *group, const char *key,
+	GByteArray *dst, size_t unitsize, gsize count)
+{
+	char **items;
+	gsize num, pos, idx;
+	int ret;
+
+	items = g_key_file_get_string_list(kf, group, key, &num, NULL);
+	if (!items)
+		return SR_ERR_DATA;
+
+	ret = SR_OK;
+	g_byte_array_set_size(dst, count * unitsize);
+	if (num != count)
+		ret = SR_ERR_DATA;
+	for (pos = 0; pos < num && ret == SR_OK; pos++) {
+		if (strlen(items[pos]) != 2 * unitsize) {
+			ret = SR_ERR_DATA;
+			break;
+		}
+		for (idx = 0; idx < unitsize; idx++) {
+			if (!g_ascii_isxdigit(items[pos][2 * idx]) ||
+					!g_ascii_isxdigit(items[pos][2 * idx + 1])) {
+				ret = SR_ERR_DATA;
+				break;
+			}
+			dst->data[pos * unitsize + idx] =
+				g_ascii_xdigit_value(items[pos][2 * idx]) << 4 |
+				g_ascii_xdigit_value(items[pos][2 * idx + 1]);
+		}
+	}
+	g_strfreev(items);
+
+	return ret;
+}
+
+static int load_capture(GKeyFile *kf, const char *group,
+	struct sr_index_capture *cap)
+{
+	struct sr_index_chunk chunk;
+	char **items;
+	double *min, *max;
+	gsize num, num_min, num_max, pos;
+	uint64_t first;
+	int ret;
+
+	items = g_key_file_get_string_list(kf, group, "samples", &num, NULL);
+	if (!items)
+		return SR_ERR_DATA;
+	first = 0;
+	for (pos = 0; pos < num; pos++) {
+		memset(&chunk, 0, sizeof(chunk));
+		chunk.first = first;
+		chunk.count = g_ascii_strtoull(items[pos], NULL, 10);
+		first += chunk.count;
+		g_array_append_val(cap->chunks, chunk);
+	}
+	g_strfreev(items);
+
+	if (cap->type == SR_CHANNEL_LOGIC) {
+		ret = get_hex_list(kf, group, "or", cap->bits_or,
+			cap->unitsize, num);
+		if (ret == SR_OK)
+			ret = get_hex_list(kf, group, "and", cap->bits_and,
+				cap->unitsize, num);
+		return ret;
+	}
+
+	min = g_key_file_get_double_list(kf, group, "min", &num_min, NULL);
+	max = g_key_file_get_double_list(kf, group, "max", &num_max, NULL);
+	ret = SR_OK;
+	if (!min || !max || num_min != num || num_max != num)
+		ret = SR_ERR_DATA;
+	for (pos = 0; pos < num && ret == SR_OK; pos++) {
+		g_array_index(cap->chunks, struct sr_index_chunk, pos).min =
+			isnan(min[pos]) ? INFINITY : min[pos];
+		g_array_index(cap->chunks, struct sr_index_chunk, pos).max =
+			isnan(max[pos]) ? -INFINITY : max[pos];
+	}
+	g_free(min);
+	g_free(max);
+
+	return ret;
+}
+
+/**
+ * Load an index from a key file.
+ *
+ * Groups which don't describe a capture file are ignored.
+ *
+ * @return The index, NULL when the key file holds malformed entries.
+ *
+ * @private
+ */
+SR_PRIV struct sr_session_index *sr_session_index_load(GKeyFile *kf)
+{
+	struct sr_session_index *index;
+	struct sr_index_capture *cap;
+	char **groups;
+	int type, unitsize;
+	gsize i;
+	int ret;
+
+	index = sr_session_index_new();
+	groups = g_key_file_get_groups(kf, NULL);
+	ret = SR_OK;
+	for (i = 0; groups[i] && ret == SR_OK; i++) {
+		if (!g_key_file_has_key(kf, groups[i], "samples", NULL))
+			continue;
+		if (g_str_has_prefix(groups[i], "logic-")) {
+			type = SR_CHANNEL_LOGIC;
+			unitsize = g_key_file_get_integer(kf, groups[i],
+				"unitsize", NULL);
+			if (unitsize <= 0) {
+				ret = SR_ERR_DATA;
+				break;
+			}
+		} else if (g_str_has_prefix(groups[i], "analog-")) {
+			type = SR_CHANNEL_ANALOG;
+			unitsize = sizeof(float);
+		} else {
+			continue;
+		}
+		cap = sr_session_index_add(index, groups[i], type, unitsize);
+		ret = load_capture(kf, groups[i], cap);
+	}
+	g_strfreev(groups);
+
+	if (ret != SR_OK) {
+		sr_warn("Malformed session file index.");
+		sr_session_index_free(index);
+		return NULL;
+	}
+
+	return index;
+}
@@ -41,6 +41,105 @@ SR_PRIV int logic_channel_unitsize(GSList *channels)
 	return (number + 7) / 8;
 }
 
+/* Set a channel's bit in a bit mask (same layout as sample data). */
+static void mask_set_bit(uint64_t *mask, int index)
+{
+	uint8_t *bytes;
+
+	bytes = (uint8_t *)mask;
+	bytes[index / 8] |= 1 << (index % 8);
+}
+
+/*
+ * Translate the trigger's stages into bit masks. Each stage's
+ * conditions then get checked for all channels at once by means
+ * of a few word wide logical operations, instead of extracting
+ * individual bits for each match of the stage.
+ */
+static int compile_stages(struct soft_trigger_logic *stl)
+{
+	struct soft_trigger_logic_stage *stage;
+	const struct sr_trigger_stage *trigger_stage;
+	const struct sr_trigger_match *match;
+	uint64_t *masks;
+	GSList *l, *m;
+	int index;
+
+	stl->num_words = (stl->unitsize + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+	if (!stl->num_words)
+		stl->num_words = 1;
+	stl->num_stages = g_slist_length(stl->trigger->stages);
+	stl->stages = g_malloc0(sizeof(*stl->stages) * (stl->num_stages + 1));
+	stl->masks = g_malloc0(sizeof(*stl->masks)
+		* stl->num_words * 5 * (stl->num_stages + 1));
+	/* Current and previous sample, loaded from the buffer. */
+	stl->cur_sample = g_malloc0(sizeof(uint64_t) * stl->num_words * 2);
+	/*
+	 * A partial match which fails falls back to the sample after
+	 * where it started, which can be up to num_stages - 2 samples
+	 * before the buffer. The sample before that is needed for edges.
+	 */
+	stl->history_size = MAX(stl->num_stages - 1, 1);
+	stl->history = g_malloc0(stl->history_size * MAX(stl->unitsize, 1));
+
+	masks = stl->masks;
+	stage = stl->stages;
+	for (l = stl->trigger->stages; l; l = l->next, stage++) {
+		trigger_stage = l->data;
+		stage->level_mask = masks;
+		masks += stl->num_words;
+		stage->level_value = masks;
+		masks += stl->num_words;
+		stage->rise_mask = masks;
+		masks += stl->num_words;
+		stage->fall_mask = masks;
+		masks += stl->num_words;
+		stage->edge_mask = masks;
+		masks += stl->num_words;
+
+		stage->num_matches = g_slist_length(trigger_stage->matches);
+		for (m = trigger_stage->matches; m; m = m->next) {
+			match = m->data;
+			if (!match->channel->enabled)
+				/* Ignore disabled channels with a trigger. */
+				continue;
+			index = match->channel->index;
+			if (index >= stl->unitsize * 8) {
+				sr_err("Trigger on channel %d exceeds unit size %d.",
+					index, stl->unitsize);
+				return SR_ERR_ARG;
+			}
+			switch (match->match) {
+			case SR_TRIGGER_ZERO:
+				mask_set_bit(stage->level_mask, index);
+				break;
+			case SR_TRIGGER_ONE:
+				mask_set_bit(stage->level_mask, index);
+				mask_set_bit(stage->level_value, index);
+				break;
+			case SR_TRIGGER_RISING:
+				mask_set_bit(stage->rise_mask, index);
+				stage->has_edge = TRUE;
+				break;
+			case SR_TRIGGER_FALLING:
+				mask_set_bit(stage->fall_mask, index);
+				stage->has_edge = TRUE;
+				break;
+			case SR_TRIGGER_EDGE:
+				mask_set_bit(stage->edge_mask, index);
+				stage->has_edge = TRUE;
+				break;
+			default:
+				/* Not a logic condition, never matches. */
+				stage->never = TRUE;
+				break;
+			}
+		}
+	}
+
+	return SR_OK;
+}
+
 SR_PRIV struct soft_trigger_logic *soft_trigger_logic_new(
 		const struct sr_dev_inst *sdi, struct sr_trigger *trigger,
 		int pre_trigger_samples)
@@ -51,7 +150,10 @@ SR_PRIV struct soft_trigger_logic *soft_trigger_logic_new(
 	stl->sdi = sdi;
 	stl->trigger = trigger;
 	stl->unitsize = logic_channel_unitsize(sdi->channels);
-	stl->prev_sample = g_malloc0(stl->unitsize);
+	if (compile_stages(stl) != SR_OK) {
+		soft_trigger_logic_free(stl);
+		return NULL;
+	}
 	stl->pre_trigger_size = stl->unitsize * pre_trigger_samples;
 	stl->pre_trigger_buffer = g_try_malloc(stl->pre_trigger_size);
 	if (pre_trigger_samples > 0 && !stl->pre_trigger_buffer) {
@@ -76,7 +178,10 @@ SR_PRIV struct soft_trigger_logic *soft_trigger_logic_new(
 SR_PRIV void soft_trigger_logic_free(struct soft_trigger_logic *stl)
 {
 	g_free(stl->pre_trigger_buffer);
-	g_free(stl->prev_sample);
+	g_free(stl->history);
+	g_free(stl->cur_sample);
+	g_free(stl->masks);
+	g_free(stl->stages);
 	g_free(stl);
 }
 
@@ -138,84 +243,155 @@ static void pre_trigger_send(struct soft_trigger_logic *stl,
 	}
 }
 
-static gboolean logic_check_match(struct soft_trigger_logic *stl,
-		uint8_t *sample, struct sr_trigger_match *match)
+/* Load a sample into (zero padded) words, keeps the byte layout. */
+static inline uint64_t load_word(const uint8_t *sample, int unitsize)
+{
+	uint64_t word;
+
+	word = 0;
+	switch (unitsize) {
+	case 1:
+		memcpy(&word, sample, 1);
+		break;
+	case 2:
+		memcpy(&word, sample, 2);
+		break;
+	case 4:
+		memcpy(&word, sample, 4);
+		break;
+	case 8:
+		memcpy(&word, sample, 8);
+		break;
+	default:
+		memcpy(&word, sample, unitsize);
+		break;
+	}
+
+	return word;
+}
+
+static inline void load_words(uint64_t *words, const uint8_t *sample,
+		int unitsize, int num_words)
+{
+	words[num_words - 1] = 0;
+	memcpy(words, sample, unitsize);
+}
+
+/* Check one word of a stage's conditions. Bits set in the result fail. */
+static inline uint64_t stage_mismatch(const struct soft_trigger_logic_stage *stage,
+		int w, uint64_t curr, uint64_t prev)
+{
+	uint64_t fail;
+
+	fail = (curr ^ stage->level_value[w]) & stage->level_mask[w];
+	fail |= stage->rise_mask[w] & (prev | ~curr);
+	fail |= stage->fall_mask[w] & (~prev | curr);
+	fail |= stage->edge_mask[w] & ~(prev ^ curr);
+
+	return fail;
+}
+
+/* A sample of the buffer, or of earlier buffers for negative indices. */
+static inline const uint8_t *sample_at(const struct soft_trigger_logic *stl,
+		const uint8_t *buf, int sample)
+{
+	if (sample >= 0)
+		return buf + sample * stl->unitsize;
+
+	return stl->history + (stl->history_fill + sample) * stl->unitsize;
+}
+
+static gboolean stage_match(struct soft_trigger_logic *stl,
+		const struct soft_trigger_logic_stage *stage,
+		const uint8_t *buf, int sample)
 {
-	int bit, prev_bit;
-	gboolean result;
+	const uint8_t *curr, *prev;
+	uint64_t curr_word, prev_word;
+	uint64_t *curr_words, *prev_words;
+	int w;
 
-	stl->count++;
-	result = FALSE;
-	bit = *(sample + match->channel->index / 8)
-			& (1 << (match->channel->index % 8));
-	if (match->match == SR_TRIGGER_ZERO)
-		result = bit == 0;
-	else if (match->match == SR_TRIGGER_ONE)
-		result = bit != 0;
-	else {
-		/* Edge matches. */
-		if (stl->count == 1)
-			/* First sample, don't have enough for an edge match yet. */
+	if (stage->never)
+		return FALSE;
+	/* First sample, don't have enough for an edge match yet. */
+	if (stage->has_edge && sample + stl->history_fill < 1)
+		return FALSE;
+
+	curr = sample_at(stl, buf, sample);
+	prev = stage->has_edge ? sample_at(stl, buf, sample - 1) : NULL;
+
+	/* Most devices have up to 64 channels, use a single word. */
+	if (stl->num_words == 1) {
+		curr_word = load_word(curr, stl->unitsize);
+		prev_word = prev ? load_word(prev, stl->unitsize) : 0;
+		return !stage_mismatch(stage, 0, curr_word, prev_word);
+	}
+
+	curr_words = stl->cur_sample;
+	load_words(curr_words, curr, stl->unitsize, stl->num_words);
+	prev_words = &stl->cur_sample[stl->num_words];
+	if (prev)
+		load_words(prev_words, prev, stl->unitsize, stl->num_words);
+	else
+		memset(prev_words, 0, sizeof(uint64_t) * stl->num_words);
+	for (w = 0; w < stl->num_words; w++) {
+		if (stage_mismatch(stage, w, curr_words[w], prev_words[w]))
 			return FALSE;
-		prev_bit = *(stl->prev_sample + match->channel->index / 8)
-				& (1 << (match->channel->index % 8));
-		if (match->match == SR_TRIGGER_RISING)
-			result = prev_bit == 0 && bit != 0;
-		else if (match->match == SR_TRIGGER_FALLING)
-			result = prev_bit != 0 && bit == 0;
-		else if (match->match == SR_TRIGGER_EDGE)
-			result = prev_bit != bit;
 	}
 
-	return result;
+	return TRUE;
 }
 
-/* Returns the offset (in samples) within buf of where the trigger
- * occurred, or -1 if not triggered. */
-SR_PRIV int soft_trigger_logic_check(struct soft_trigger_logic *stl,
-		uint8_t *buf, int len, int *pre_trigger_samples)
+/* Keep the last samples up to (and including) num_samples - 1. */
+static void history_update(struct soft_trigger_logic *stl,
+		const uint8_t *buf, int num_samples)
+{
+	int size, keep;
+
+	size = stl->history_size;
+	if (num_samples >= size) {
+		memcpy(stl->history, buf + (num_samples - size) * stl->unitsize,
+			size * stl->unitsize);
+		stl->history_fill = size;
+		return;
+	}
+
+	keep = MIN(stl->history_fill, size - num_samples);
+	memmove(stl->history,
+		stl->history + (stl->history_fill - keep) * stl->unitsize,
+		keep * stl->unitsize);
+	memcpy(stl->history + keep * stl->unitsize, buf,
+		num_samples * stl->unitsize);
+	stl->history_fill = keep + num_samples;
+}
+
+/*
+ * Run the trigger stages over a buffer of samples. Returns the offset
+ * (in samples) of the match of the last stage, or -1 if not triggered.
+ * Keeps the last inspected samples for edge checks and the fallback of
+ * partial matches on the next buffer.
+ */
+static int trigger_scan(struct soft_trigger_logic *stl,
+		const uint8_t *buf, int num_samples)
 {
-	struct sr_trigger_stage *stage;
-	struct sr_trigger_match *match;
-	GSList *l, *l_stage;
+	const struct soft_trigger_logic_stage *stage;
 	int offset;
 	int i;
-	gboolean match_found;
 
 	offset = -1;
-	for (i = 0; i < len; i += stl->unitsize) {
-		l_stage = g_slist_nth(stl->trigger->stages, stl->cur_stage);
-		stage = l_stage->data;
-		if (!stage->matches)
+	for (i = 0; i < num_samples; i++) {
+		stage = &stl->stages[stl->cur_stage];
+		if (!stage->num_matches)
 			/* No matches supplied, client error. */
 			return SR_ERR_ARG;
 
-		match_found = TRUE;
-		for (l = stage->matches; l; l = l->next) {
-			match = l->data;
-			if (!match->channel->enabled)
-				/* Ignore disabled channels with a trigger. */
-				continue;
-			if (!logic_check_match(stl, buf + i, match)) {
-				match_found = FALSE;
-				break;
-			}
-		}
-		memcpy(stl->prev_sample, buf + i, stl->unitsize);
-		if (match_found) {
+		if (stage_match(stl, stage, buf, i)) {
 			/* Matched on the current stage. */
-			if (l_stage->next) {
+			if (stl->cur_stage + 1 < stl->num_stages) {
 				/* Advance to next stage. */
 				stl->cur_stage++;
 			} else {
-				/* Matched on last stage, send pre-trigger data. */
-				pre_trigger_append(stl, buf, i);
-				pre_trigger_send(stl, pre_trigger_samples);
-
-				/* Fire trigger. */
-				offset = i / stl->unitsize;
-
-				std_session_send_df_trigger(stl->sdi);
+				/* Matched on last stage. */
+				offset = i;
 				break;
 			}
 		} else if (stl->cur_stage > 0) {
@@ -226,18 +402,201 @@ SR_PRIV int soft_trigger_logic_check(struct soft_trigger_logic *stl,
 			 * seeing 00001, so we need to go back to stage 0 -- but
 			 * at the next sample from the one that matched originally,
 			 * which the counter increment at the end of the loop
-			 * takes care of.
+			 * takes care of. That sample can be in an earlier
+			 * buffer, the history holds it.
 			 */
-			i -= stl->cur_stage * stl->unitsize;
-			if (i < -1)
-				i = -1; /* Oops, went back past this buffer. */
+			i -= stl->cur_stage;
+			if (i < -1 - stl->history_fill)
+				i = -1 - stl->history_fill;
 			/* Reset trigger stage. */
 			stl->cur_stage = 0;
 		}
 	}
 
-	if (offset == -1)
+	history_update(stl, buf, offset >= 0 ? offset + 1 : num_samples);
+
+	return offset;
+}
+
+/* Returns the offset (in samples) within buf of where the trigger
+ * occurred, or -1 if not triggered. */
+SR_PRIV int soft_trigger_logic_check(struct soft_trigger_logic *stl,
+		uint8_t *buf, int len, int *pre_trigger_samples)
+{
+	int offset, num_samples;
+
+	num_samples = stl->unitsize ? len / stl->unitsize : 0;
+	offset = trigger_scan(stl, buf, num_samples);
+	if (offset == SR_ERR_ARG)
+		return offset;
+
+	if (offset == -1) {
 		pre_trigger_append(stl, buf, len);
+		return offset;
+	}
+
+	/* Matched on last stage, send pre-trigger data. */
+	pre_trigger_append(stl, buf, offset * stl->unitsize);
+	pre_trigger_send(stl, pre_trigger_samples);
+
+	/* Fire trigger. */
+	std_session_send_df_trigger(stl->sdi);
+
+	return offset;
+}
+
+/*
+ * Append the first num_samples samples of run-length encoded data to
+ * the pre-trigger buffer. Only the tail which fits into the buffer
+ * gets expanded.
+ */
+static void pre_trigger_append_rle(struct soft_trigger_logic *stl,
+		const struct sr_datafeed_logic_rle *rle, uint64_t num_samples)
+{
+	const uint8_t *value;
+	uint64_t run, skip, count, keep;
+
+	if (!stl->pre_trigger_size || !stl->unitsize)
+		return;
+
+	keep = stl->pre_trigger_size / stl->unitsize;
+	skip = num_samples > keep ? num_samples - keep : 0;
+	num_samples -= skip;
+	value = rle->values;
+	for (run = 0; run < rle->num_runs && num_samples; run++) {
+		count = rle->lengths[run];
+		if (skip >= count) {
+			skip -= count;
+		} else {
+			count -= skip;
+			skip = 0;
+			count = MIN(count, num_samples);
+			num_samples -= count;
+			while (count--)
+				pre_trigger_append(stl, (uint8_t *)value,
+					stl->unitsize);
+		}
+		value += rle->unitsize;
+	}
+}
+
+/*
+ * Translate the position of a match in the truncated samples of the
+ * runs [first, end) to the position in their expanded samples. A window
+ * which starts at the first or second sample of a truncated run lies
+ * within the run's leading samples. A window which starts later extends
+ * into the next run, and is taken from the run's trailing samples.
+ */
+static uint64_t rle_match_offset(const struct soft_trigger_logic *stl,
+		const struct sr_datafeed_logic_rle *rle,
+		uint64_t first, uint64_t end, int match)
+{
+	uint64_t cap, run, count, t_start, o_start, pos;
+	int window_start;
+
+	cap = stl->num_stages + 1;
+	window_start = match - (stl->num_stages - 1);
+	pos = window_start >= 0 ? window_start : match;
+	t_start = 0;
+	o_start = 0;
+	for (run = first; run < end; run++) {
+		count = MIN(rle->lengths[run], cap);
+		if (pos < t_start + count) {
+			pos -= t_start;
+			if (window_start >= 0 && pos > 1)
+				pos += rle->lengths[run] - count;
+			pos += o_start;
+			if (window_start >= 0)
+				pos += stl->num_stages - 1;
+			return pos;
+		}
+		t_start += count;
+		o_start += rle->lengths[run];
+	}
+
+	return o_start;
+}
+
+/* Runs which get checked at a time, bounds the truncated samples' size. */
+#define RLE_CHECK_RUNS 4096
+
+/*
+ * Check run-length encoded logic data for a trigger match. Returns the
+ * offset (in expanded samples) of where the trigger occurred, or -1 if
+ * not triggered.
+ *
+ * Within a run, samples after the first are identical, and carry no
+ * edges. A run longer than the number of stages plus one can't yield
+ * matches which shorter runs would not yield as well. So long runs get
+ * truncated, the resulting short sample sequence gets checked, and a
+ * match position gets translated back to the run-length encoded data.
+ * Identical results as the check of the expanded data are achieved at
+ * the cost of the number of runs. Runs get checked in batches, so the
+ * truncated samples' size is bounded for any number of runs, and their
+ * count fits the scan's sample count. Like with consecutive buffers, a
+ * partial match which fails in the next batch falls back into the
+ * previous batch's truncated samples.
+ */
+SR_PRIV int64_t soft_trigger_logic_check_rle(struct soft_trigger_logic *stl,
+		const struct sr_datafeed_logic_rle *rle, int *pre_trigger_samples)
+{
+	uint64_t cap, first, end, run, count, total, o_start;
+	int64_t offset;
+	uint8_t *buf, *wrptr;
+	const uint8_t *value;
+	int match;
+
+	if (rle->unitsize != stl->unitsize || !stl->unitsize)
+		return SR_ERR_ARG;
+	if (!rle->num_runs)
+		return -1;
+
+	cap = stl->num_stages + 1;
+	buf = g_try_malloc(MIN(rle->num_runs, RLE_CHECK_RUNS) * cap *
+		stl->unitsize);
+	if (!buf)
+		return SR_ERR_MALLOC;
+
+	offset = -1;
+	o_start = 0;
+	for (first = 0; first < rle->num_runs; first = end) {
+		end = MIN(first + RLE_CHECK_RUNS, rle->num_runs);
+		wrptr = buf;
+		value = (const uint8_t *)rle->values + first * rle->unitsize;
+		total = 0;
+		for (run = first; run < end; run++) {
+			count = MIN(rle->lengths[run], cap);
+			sr_samples_fill(wrptr, value, stl->unitsize, count);
+			wrptr += count * stl->unitsize;
+			value += rle->unitsize;
+			total += count;
+		}
+		match = trigger_scan(stl, buf, total);
+		if (match == SR_ERR_ARG) {
+			g_free(buf);
+			return match;
+		}
+		if (match >= 0) {
+			offset = o_start +
+				rle_match_offset(stl, rle, first, end, match);
+			break;
+		}
+		for (run = first; run < end; run++)
+			o_start += rle->lengths[run];
+	}
+	g_free(buf);
+
+	if (offset == -1) {
+		pre_trigger_append_rle(stl, rle, sr_logic_rle_num_samples(rle));
+		return -1;
+	}
+
+	/* Matched on last stage, send pre-trigger data. */
+	pre_trigger_append_rle(stl, rle, offset);
+	pre_trigger_send(stl, pre_trigger_samples);
+
+	/* Fire trigger. */
+	std_session_send_df_trigger(stl->sdi);
 
 	return offset;
 }
@@ -294,6 +294,91 @@ SR_PRIV int sr_atof(const char *str, float *ret)
 	return SR_OK;
 }
 
+/*
+ * Convert plain decimal text ([+-]digits[.digits][e[+-]digits]) when
+ * the mantissa and the power of ten are exactly representable. The
+ * result then is the correctly rounded quotient or product, identical
+ * to what strtod() returns. Other input is left to the slow path.
+ */
+static gboolean atod_fast_path(const char *str, double *ret)
+{
+	static const double pow10[] = {
+		1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10,
+		1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20,
+		1e21, 1e22,
+	};
+	const char *p;
+	uint64_t mant;
+	int digits, exp, exp_val;
+	gboolean neg, exp_neg, seen_digit;
+	double value;
+
+	p = str;
+	while (g_ascii_isspace(*p))
+		p++;
+	neg = *p == '-';
+	if (*p == '-' || *p == '+')
+		p++;
+
+	mant = 0;
+	digits = 0;
+	exp = 0;
+	seen_digit = FALSE;
+	while (g_ascii_isdigit(*p)) {
+		if (digits == 19)
+			return FALSE;
+		mant = mant * 10 + (*p++ - '0');
+		if (mant)
+			digits++;
+		seen_digit = TRUE;
+	}
+	if (*p == '.') {
+		p++;
+		while (g_ascii_isdigit(*p)) {
+			if (digits == 19)
+				return FALSE;
+			mant = mant * 10 + (*p++ - '0');
+			if (mant)
+				digits++;
+			exp--;
+			seen_digit = TRUE;
+		}
+	}
+	if (!seen_digit)
+		return FALSE;
+	if (*p == 'e' || *p == 'E') {
+		p++;
+		exp_neg = *p == '-';
+		if (*p == '-' || *p == '+')
+			p++;
+		if (!g_ascii_isdigit(*p))
+			return FALSE;
+		exp_val = 0;
+		while (g_ascii_isdigit(*p)) {
+			if (exp_val > 1000)
+				return FALSE;
+			exp_val = exp_val * 10 + (*p - '0');
+			p++;
+		}
+		exp += exp_neg ? -exp_val : exp_val;
+	}
+	if (*p)
+		return FALSE;
+
+	if (mant > ((uint64_t)1 << 53))
+		return FALSE;
+	if (exp < -22 || exp > 22)
+		return FALSE;
+	value = (double)mant;
+	if (exp < 0)
+		value /= pow10[-exp];
+	else
+		value *= pow10[exp];
+	*ret = neg ? -value : value;
+
+	return TRUE;
+}
+
 /**
  * Convert a string representation of a numeric value to a double. The
  * conversion is strict and will fail if the complete string does not represent
@@ -314,6 +399,8 @@ SR_PRIV int sr_atod_ascii(const char *str, double *ret)
 	char *endptr = NULL;
 
 	errno = 0;
+	if (atod_fast_path(str, ret))
+		return SR_OK;
 	tmp = g_ascii_strtod(str, &endptr);
 
 	if (!endptr || *endptr || errno) {
@@ -1804,7 +1891,7 @@ SR_API char *sr_text_next_line(char *s, size_t l, char **next, size_t *taken)
 		return NULL;
 
 	/* Search for the next line termination. NUL terminate. */
-	p = g_strstr_len(s, l, "\n");
+	p = memchr(s, '\n', l);
 	if (!p)
 		return NULL;
 	*p++ = '\0';
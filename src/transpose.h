@@ -0,0 +1,294 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * Copyright (C) 2026 The sigrok project developers
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Bit matrix transposition, for devices which send sample data in a
+ * channel-planar layout (one word holds several samples of a channel)
+ * or interleave the bits of several samples within a word.
+ *
+ * All transpositions follow the same convention: bit j of input row i
+ * becomes bit i of output row j. Rows are host order integers, the
+ * least significant bit is column 0.
+ *
+ * The routines are inline, and select SSE2 or NEON code at compile
+ * time. On x86, the 32x16 transposition uses AVX2 when the CPU
+ * supports it, like the analog conversion kernels. The portable
+ * fallback swaps blocks of bits within integers, see "Hacker's
+ * Delight", chapter 7.
+ */
+
+#ifndef LIBSIGROK_TRANSPOSE_H
+#define LIBSIGROK_TRANSPOSE_H
+
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__GNUC__) && \
+	(defined(__x86_64__) || (defined(__i386__) && defined(__SSE2__)))
+#include <immintrin.h>
+#define SR_TRANSPOSE_AVX2
+#endif
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define SR_TRANSPOSE_SSE2
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#define SR_TRANSPOSE_NEON
+#endif
+
+/*
+ * Swap the bits selected by mask with the bits shift positions above
+ * them ("delta swap").
+ */
+#define SR_DELTA_SWAP(x, mask, shift) do { \
+	__typeof__(x) t_ = ((x) ^ ((x) >> (shift))) & (mask); \
+	(x) ^= t_ ^ (t_ << (shift)); \
+} while (0)
+
+/**
+ * Transpose an 8x8 bit matrix.
+ *
+ * @param[out] dst Eight output rows.
+ * @param[in] src Eight input rows, may equal dst.
+ */
+static inline void sr_transpose_8x8(uint8_t *dst, const uint8_t *src)
+{
+	uint64_t x;
+	size_t i;
+
+	x = 0;
+	for (i = 0; i < 8; i++)
+		x |= (uint64_t)src[i] << (8 * i);
+
+	SR_DELTA_SWAP(x, 0x00aa00aa00aa00aaULL, 7);
+	SR_DELTA_SWAP(x, 0x0000cccc0000ccccULL, 14);
+	SR_DELTA_SWAP(x, 0x00000000f0f0f0f0ULL, 28);
+
+	for (i = 0; i < 8; i++)
+		dst[i] = x >> (8 * i);
+}
+
+#if defined(SR_TRANSPOSE_NEON)
+/* Collect the most significant bit of each byte, like SSE2 movemask. */
+static inline uint16_t sr_transpose_neon_movemask(uint8x16_t v)
+{
+	static const int8_t shifts[16] = {
+		-7, -6, -5, -4, -3, -2, -1, 0, -7, -6, -5, -4, -3, -2, -1, 0,
+	};
+	uint8x16_t bits;
+
+	bits = vandq_u8(v, vdupq_n_u8(0x80));
+	bits = vshlq_u8(bits, vld1q_s8(shifts));
+
+	return vaddv_u8(vget_low_u8(bits)) |
+		(vaddv_u8(vget_high_u8(bits)) << 8);
+}
+#endif
+
+/**
+ * Transpose a 16x16 bit matrix, portable version.
+ *
+ * This is what sr_transpose_16x16() uses when no SIMD code is
+ * available. It is always built, so that it gets tested in SIMD
+ * builds as well.
+ *
+ * @param[out] dst 16 output rows.
+ * @param[in] src 16 input rows, may equal dst.
+ */
+static inline void sr_transpose_16x16_swar(uint16_t *dst, const uint16_t *src)
+{
+	uint16_t rows[16], t;
+	unsigned int j, k, m;
+
+	memcpy(rows, src, sizeof(rows));
+	for (j = 8, m = 0x00ff; j; j >>= 1, m ^= m << j) {
+		for (k = 0; k < 16; k = ((k | j) + 1) & ~j) {
+			t = ((rows[k] >> j) ^ rows[k | j]) & m;
+			rows[k | j] ^= t;
+			rows[k] ^= t << j;
+		}
+	}
+	memcpy(dst, rows, sizeof(rows));
+}
+
+/**
+ * Transpose a 16x16 bit matrix.
+ *
+ * @param[out] dst 16 output rows.
+ * @param[in] src 16 input rows, may equal dst.
+ */
+static inline void sr_transpose_16x16(uint16_t *dst, const uint16_t *src)
+{
+#if defined(SR_TRANSPOSE_SSE2)
+	const __m128i low = _mm_set1_epi16(0x00ff);
+	__m128i a, b, lo, hi;
+	int i;
+
+	/* Gather the low and the high bytes of all rows. */
+	a = _mm_loadu_si128((const __m128i *)&src[0]);
+	b = _mm_loadu_si128((const __m128i *)&src[8]);
+	lo = _mm_packus_epi16(_mm_and_si128(a, low), _mm_and_si128(b, low));
+	hi = _mm_packus_epi16(_mm_srli_epi16(a, 8), _mm_srli_epi16(b, 8));
+
+	/* Each byte's top bit is one column's bit of a row. */
+	for (i = 7; i >= 0; i--) {
+		dst[i] = _mm_movemask_epi8(lo);
+		dst[i + 8] = _mm_movemask_epi8(hi);
+		lo = _mm_add_epi8(lo, lo);
+		hi = _mm_add_epi8(hi, hi);
+	}
+#elif defined(SR_TRANSPOSE_NEON)
+	uint8x16x2_t rows;
+	uint8x16_t lo, hi;
+	int i;
+
+	rows = vld2q_u8((const uint8_t *)src);
+	lo = rows.val[0];
+	hi = rows.val[1];
+	for (i = 7; i >= 0; i--) {
+		dst[i] = sr_transpose_neon_movemask(lo);
+		dst[i + 8] = sr_transpose_neon_movemask(hi);
+		lo = vshlq_n_u8(lo, 1);
+		hi = vshlq_n_u8(hi, 1);
+	}
+#else
+	sr_transpose_16x16_swar(dst, src);
+#endif
+}
+
+/**
+ * Transpose a matrix of 32 rows of 16 bits each, into 16 rows of
+ * 32 bits each, portable version. See sr_transpose_32x16().
+ *
+ * @param[out] dst 16 output rows.
+ * @param[in] src 32 input rows.
+ */
+static inline void sr_transpose_32x16_swar(uint32_t *dst, const uint16_t *src)
+{
+	uint16_t first[16], second[16];
+	int i;
+
+	sr_transpose_16x16_swar(first, &src[0]);
+	sr_transpose_16x16_swar(second, &src[16]);
+	for (i = 0; i < 16; i++)
+		dst[i] = first[i] | ((uint32_t)second[i] << 16);
+}
+
+/* The 32x16 transposition as two 16x16 transpositions. */
+static inline void sr_transpose_32x16_halves(uint32_t *dst,
+	const uint16_t *src)
+{
+	uint16_t first[16], second[16];
+	int i;
+
+	sr_transpose_16x16(first, &src[0]);
+	sr_transpose_16x16(second, &src[16]);
+	for (i = 0; i < 16; i++)
+		dst[i] = first[i] | ((uint32_t)second[i] << 16);
+}
+
+#if defined(SR_TRANSPOSE_AVX2)
+/* The 32x16 transposition for CPUs with AVX2, see sr_transpose_32x16(). */
+__attribute__((target("avx2")))
+static inline void sr_transpose_32x16_avx2(uint32_t *dst,
+	const uint16_t *src)
+{
+	const __m256i low = _mm256_set1_epi16(0x00ff);
+	__m256i a, b, lo, hi;
+	int i;
+
+	/* Pack per 128bit lane, then put the rows back into order. */
+	a = _mm256_loadu_si256((const __m256i *)&src[0]);
+	b = _mm256_loadu_si256((const __m256i *)&src[16]);
+	lo = _mm256_packus_epi16(_mm256_and_si256(a, low),
+		_mm256_and_si256(b, low));
+	hi = _mm256_packus_epi16(_mm256_srli_epi16(a, 8),
+		_mm256_srli_epi16(b, 8));
+	lo = _mm256_permute4x64_epi64(lo, 0xd8);
+	hi = _mm256_permute4x64_epi64(hi, 0xd8);
+
+	for (i = 7; i >= 0; i--) {
+		dst[i] = (uint32_t)_mm256_movemask_epi8(lo);
+		dst[i + 8] = (uint32_t)_mm256_movemask_epi8(hi);
+		lo = _mm256_add_epi8(lo, lo);
+		hi = _mm256_add_epi8(hi, hi);
+	}
+}
+#endif
+
+/**
+ * Transpose a matrix of 32 rows of 16 bits each, into 16 rows of
+ * 32 bits each.
+ *
+ * This is what channel-planar devices with up to 32 channels need:
+ * input row i holds 16 samples of channel i, output row j holds all
+ * channels' sample j.
+ *
+ * @param[out] dst 16 output rows.
+ * @param[in] src 32 input rows.
+ */
+static inline void sr_transpose_32x16(uint32_t *dst, const uint16_t *src)
+{
+#if defined(SR_TRANSPOSE_AVX2)
+	if (__builtin_cpu_supports("avx2")) {
+		sr_transpose_32x16_avx2(dst, src);
+		return;
+	}
+#endif
+	sr_transpose_32x16_halves(dst, src);
+}
+
+/**
+ * Split a 16bit word which interleaves the bits of two 8bit samples.
+ *
+ * Bit (2 * j + i) of the input is bit j of sample i. This transposes
+ * an 8x2 bit matrix.
+ *
+ * @param[in] word The interleaved samples.
+ *
+ * @return Sample 0 in the low byte, sample 1 in the high byte.
+ */
+static inline uint16_t sr_deinterleave_2x8(uint16_t word)
+{
+	SR_DELTA_SWAP(word, 0x2222, 1);
+	SR_DELTA_SWAP(word, 0x0c0c, 2);
+	SR_DELTA_SWAP(word, 0x00f0, 4);
+
+	return word;
+}
+
+/**
+ * Split a 16bit word which interleaves the bits of four 4bit samples.
+ *
+ * Bit (4 * j + i) of the input is bit j of sample i. This transposes
+ * a 4x4 bit matrix.
+ *
+ * @param[in] word The interleaved samples.
+ *
+ * @return Sample i in bits (4 * i) to (4 * i + 3).
+ */
+static inline uint16_t sr_deinterleave_4x4(uint16_t word)
+{
+	SR_DELTA_SWAP(word, 0x0a0a, 3);
+	SR_DELTA_SWAP(word, 0x00cc, 6);
+
+	return word;
+}
+
+#endif
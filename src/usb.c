@@ -20,6 +20,7 @@
  */
 
 #include <config.h>
+#include <inttypes.h>
 #include <stdlib.h>
 #include <memory.h>
 #include <glib.h>
@@ -516,6 +517,808 @@ SR_PRIV int usb_source_remove(struct sr_session *session, struct sr_context *ctx
 	return sr_session_source_remove_internal(session, ctx->libusb_ctx);
 }
 
+/* Poll interval of the USB event thread when it is not woken up. */
+#define USB_STREAM_POLL_US	(100 * 1000)
+
+/**
+ * Transfers handed from a USB event thread to the session thread.
+ *
+ * Completed transfers pass their buffer on to the filled ring, and get
+ * resubmitted right away with a buffer from the free ring. The session
+ * thread processes the filled buffers and returns them to the free
+ * ring. The stream is an event source of the session, which dispatches
+ * the filled buffers.
+ */
+struct sr_usb_stream {
+	GSource base;
+
+	struct sr_session *session;
+	const struct sr_dev_inst *sdi;
+	struct libusb_context *usb_ctx;
+	GMainContext *main_context;
+
+	sr_usb_stream_data_callback data_cb;
+	sr_usb_stream_end_callback end_cb;
+	void *cb_data;
+
+	struct sr_usb_ring filled;
+	struct sr_usb_ring free;
+
+	GThread *thread;
+	int stop;
+	gint finished;
+	gint in_flight;
+
+	struct sr_usb_stream_stats stats;
+};
+
+/**
+ * Set up a ring of at least @a size items.
+ *
+ * @private
+ */
+SR_PRIV void sr_usb_ring_init(struct sr_usb_ring *ring, size_t size)
+{
+	guint capacity;
+
+	capacity = 1;
+	while (capacity < size)
+		capacity <<= 1;
+	ring->items = g_malloc0(capacity * sizeof(*ring->items));
+	ring->mask = capacity - 1;
+	ring->head = 0;
+	ring->tail = 0;
+}
+
+/**
+ * Get the number of items in a ring, as seen by either side.
+ *
+ * @private
+ */
+SR_PRIV guint sr_usb_ring_count(struct sr_usb_ring *ring)
+{
+	return (guint)g_atomic_int_get(&ring->head) -
+		(guint)g_atomic_int_get(&ring->tail);
+}
+
+/**
+ * Append an item to a ring, from the producer thread.
+ *
+ * @retval TRUE The item was appended.
+ * @retval FALSE The ring is full.
+ *
+ * @private
+ */
+SR_PRIV gboolean sr_usb_ring_push(struct sr_usb_ring *ring,
+		uint8_t *buf, size_t len)
+{
+	guint head;
+
+	head = ring->head;
+	if (head - (guint)g_atomic_int_get(&ring->tail) > ring->mask)
+		return FALSE;
+	ring->items[head & ring->mask].buf = buf;
+	ring->items[head & ring->mask].len = len;
+	g_atomic_int_set(&ring->head, head + 1);
+
+	return TRUE;
+}
+
+/**
+ * Take the oldest item from a ring, from the consumer thread.
+ *
+ * @retval TRUE The item was taken.
+ * @retval FALSE The ring is empty.
+ *
+ * @private
+ */
+SR_PRIV gboolean sr_usb_ring_pop(struct sr_usb_ring *ring,
+		struct sr_usb_ring_item *item)
+{
+	guint tail;
+
+	tail = ring->tail;
+	if ((guint)g_atomic_int_get(&ring->head) == tail)
+		return FALSE;
+	*item = ring->items[tail & ring->mask];
+	g_atomic_int_set(&ring->tail, tail + 1);
+
+	return TRUE;
+}
+
+static gboolean usb_stream_pending(struct sr_usb_stream *stream)
+{
+	return sr_usb_ring_count(&stream->filled) > 0 ||
+		g_atomic_int_get(&stream->finished);
+}
+
+/** USB stream source prepare() method.
+ */
+static gboolean usb_stream_prepare(GSource *source, int *timeout)
+{
+	*timeout = -1;
+
+	return usb_stream_pending((struct sr_usb_stream *)source);
+}
+
+/** USB stream source check() method.
+ */
+static gboolean usb_stream_check(GSource *source)
+{
+	return usb_stream_pending((struct sr_usb_stream *)source);
+}
+
+/** USB stream source dispatch() method.
+ */
+static gboolean usb_stream_dispatch(GSource *source,
+		GSourceFunc callback, void *user_data)
+{
+	struct sr_usb_stream *stream;
+	struct sr_usb_ring_item item;
+	guint count;
+
+	(void)callback;
+	(void)user_data;
+
+	stream = (struct sr_usb_stream *)source;
+
+	/*
+	 * Only process the buffers which are queued now, so that a fast
+	 * device cannot starve the session's other event sources.
+	 */
+	count = sr_usb_ring_count(&stream->filled);
+	while (count--) {
+		if (!sr_usb_ring_pop(&stream->filled, &item))
+			break;
+		stream->data_cb(item.buf, item.len, stream->cb_data);
+		sr_usb_ring_push(&stream->free, item.buf, 0);
+		if (g_source_is_destroyed(source))
+			return G_SOURCE_REMOVE;
+	}
+
+	/* The end callback usually frees the stream. */
+	if (g_atomic_int_get(&stream->finished) &&
+			!sr_usb_ring_count(&stream->filled)) {
+		g_atomic_int_set(&stream->finished, FALSE);
+		stream->end_cb(stream->cb_data);
+	}
+
+	return G_SOURCE_CONTINUE;
+}
+
+/** USB stream source finalize() method.
+ */
+static void usb_stream_finalize(GSource *source)
+{
+	struct sr_usb_stream *stream;
+	struct sr_usb_ring_item item;
+
+	stream = (struct sr_usb_stream *)source;
+
+	while (sr_usb_ring_pop(&stream->filled, &item))
+		g_free(item.buf);
+	while (sr_usb_ring_pop(&stream->free, &item))
+		g_free(item.buf);
+	g_free(stream->filled.items);
+	g_free(stream->free.items);
+
+	sr_session_source_destroyed(stream->session, stream, source);
+}
+
+/* Handles libusb events until the stream gets stopped. */
+static gpointer usb_stream_thread(gpointer data)
+{
+	struct sr_usb_stream *stream;
+	struct timeval tv;
+
+	stream = data;
+
+	while (!g_atomic_int_get(&stream->stop)) {
+		tv.tv_sec = 0;
+		tv.tv_usec = USB_STREAM_POLL_US;
+		libusb_handle_events_timeout_completed(stream->usb_ctx,
+			&tv, &stream->stop);
+	}
+
+	return NULL;
+}
+
+/* Get the USB statistics of a device for the session's current run. */
+static struct sr_usb_stream_stats *usb_session_stats(
+		struct sr_session *session, const struct sr_dev_inst *sdi)
+{
+	struct sr_usb_stream_stats *stats;
+
+	if (!session->usb_stats)
+		session->usb_stats = g_hash_table_new_full(g_direct_hash,
+			g_direct_equal, NULL, g_free);
+	stats = g_hash_table_lookup(session->usb_stats, sdi);
+	if (!stats) {
+		stats = g_malloc0(sizeof(*stats));
+		g_hash_table_insert(session->usb_stats, (void *)sdi, stats);
+	}
+
+	return stats;
+}
+
+/**
+ * Create a stream which handles a device's USB transfers in a thread.
+ *
+ * The stream runs libusb's event handling in a thread of its own, so
+ * transfer completion callbacks run in that thread, and can resubmit
+ * transfers immediately. The received data gets passed to @a data_cb
+ * in the session's thread. After sr_usb_stream_finish() was called and
+ * all data was passed on, @a end_cb gets called in the session's thread.
+ *
+ * Streams are only created when the session was configured to use them,
+ * see sr_session_usb_event_thread_set(). Otherwise drivers handle USB
+ * events in the session's main loop, see usb_source_add().
+ *
+ * All USB devices share the libusb context, and the thread handles the
+ * events of all of them. So a stream is only created for the session's
+ * only USB device. The other devices' drivers expect their transfer
+ * callbacks in the session's thread. With other USB devices in the
+ * session, NULL is returned and the driver uses the main loop as well.
+ *
+ * @param sdi The device. Must not be NULL.
+ * @param ctx The libsigrok context which holds the libusb context.
+ * @param num_buffers Number of buffers which can wait for the session
+ *                    thread, in addition to the transfers' buffers.
+ * @param buffer_size Size of the transfers' buffers.
+ * @param data_cb Receives the data of completed transfers.
+ * @param end_cb Gets called when the stream has finished.
+ * @param cb_data Opaque data for the callbacks.
+ *
+ * @return The new stream, or NULL when no stream is used.
+ *
+ * @private
+ */
+SR_PRIV struct sr_usb_stream *sr_usb_stream_new(const struct sr_dev_inst *sdi,
+		struct sr_context *ctx, size_t num_buffers, size_t buffer_size,
+		sr_usb_stream_data_callback data_cb,
+		sr_usb_stream_end_callback end_cb, void *cb_data)
+{
+	static GSourceFuncs usb_stream_funcs = {
+		.prepare  = &usb_stream_prepare,
+		.check    = &usb_stream_check,
+		.dispatch = &usb_stream_dispatch,
+		.finalize = &usb_stream_finalize
+	};
+	struct sr_session *session;
+	struct sr_usb_stream *stream;
+	struct sr_dev_inst *other;
+	GSource *source;
+	GError *error;
+	GSList *l;
+	size_t i;
+
+	session = sdi->session;
+	if (!session || !session->usb_event_thread || !num_buffers)
+		return NULL;
+
+	for (l = session->devs; l; l = l->next) {
+		other = l->data;
+		if (other != sdi && other->inst_type == SR_INST_USB) {
+			sr_info("Other USB devices in the session, handling "
+				"USB events in the main loop.");
+			return NULL;
+		}
+	}
+
+	source = g_source_new(&usb_stream_funcs, sizeof(struct sr_usb_stream));
+	stream = (struct sr_usb_stream *)source;
+	g_source_set_name(source, "usb-stream");
+
+	stream->session = session;
+	stream->sdi = sdi;
+	stream->usb_ctx = ctx->libusb_ctx;
+	stream->main_context = session->main_context;
+	stream->data_cb = data_cb;
+	stream->end_cb = end_cb;
+	stream->cb_data = cb_data;
+
+	sr_usb_ring_init(&stream->filled, num_buffers);
+	sr_usb_ring_init(&stream->free, num_buffers);
+	for (i = 0; i < num_buffers; i++)
+		sr_usb_ring_push(&stream->free, g_malloc(buffer_size), 0);
+
+	if (sr_session_source_add_internal(session, stream, source) != SR_OK) {
+		g_source_unref(source);
+		return NULL;
+	}
+
+	error = NULL;
+	stream->thread = g_thread_try_new("usb-events",
+		usb_stream_thread, stream, &error);
+	if (!stream->thread) {
+		sr_err("Failed to create USB event thread: %s.",
+			error->message);
+		g_error_free(error);
+		sr_session_source_remove_internal(session, stream);
+		g_source_unref(source);
+		return NULL;
+	}
+
+	return stream;
+}
+
+/**
+ * Stop a stream's event thread, and release the stream.
+ *
+ * Must be called in the session's thread, after all of the stream's
+ * transfers have completed. The stream's statistics remain available,
+ * see sr_session_usb_stats_get().
+ *
+ * @param stream The stream, can be NULL.
+ *
+ * @private
+ */
+SR_PRIV void sr_usb_stream_free(struct sr_usb_stream *stream)
+{
+	struct sr_session *session;
+	struct sr_usb_stream_stats *stats;
+
+	if (!stream)
+		return;
+
+	g_atomic_int_set(&stream->stop, TRUE);
+#if (LIBUSB_API_VERSION >= 0x01000105)
+	libusb_interrupt_event_handler(stream->usb_ctx);
+#endif
+	g_thread_join(stream->thread);
+
+	session = stream->session;
+	stats = usb_session_stats(session, stream->sdi);
+	stats->transfers = stream->stats.transfers;
+	stats->bytes = stream->stats.bytes;
+	stats->overflows = stream->stats.overflows;
+	stats->underruns = stream->stats.underruns;
+	stats->max_depth = stream->stats.max_depth;
+
+	sr_info("USB stream: %" PRIu64 " transfers, %" PRIu64 " bytes, "
+		"%" PRIu64 " overflows, %" PRIu64 " underruns.",
+		stats->transfers, stats->bytes,
+		stats->overflows, stats->underruns);
+
+	sr_session_source_remove_internal(session, stream);
+	g_source_unref(&stream->base);
+}
+
+/**
+ * Submit a transfer of a stream.
+ *
+ * @param stream The stream, can be NULL to just submit the transfer.
+ * @param transfer The transfer.
+ *
+ * @return The libusb_submit_transfer() result.
+ *
+ * @private
+ */
+SR_PRIV int sr_usb_stream_submit(struct sr_usb_stream *stream,
+		struct libusb_transfer *transfer)
+{
+	int ret;
+
+	ret = libusb_submit_transfer(transfer);
+	if (stream && ret == LIBUSB_SUCCESS)
+		g_atomic_int_inc(&stream->in_flight);
+
+	return ret;
+}
+
+/**
+ * Pass a completed transfer's data on to the session thread.
+ *
+ * Must be called in the transfer's completion callback. When the data
+ * of a successful transfer can be queued, the transfer's buffer gets
+ * replaced by a free one, which the transfer can get resubmitted with.
+ * When all buffers are waiting for the session thread, the data gets
+ * dropped and counted as an overflow.
+ *
+ * @param stream The stream.
+ * @param transfer The completed transfer.
+ *
+ * @return TRUE when the data was queued, FALSE otherwise.
+ *
+ * @private
+ */
+SR_PRIV gboolean sr_usb_stream_complete(struct sr_usb_stream *stream,
+		struct libusb_transfer *transfer)
+{
+	struct sr_usb_ring_item item;
+	guint depth;
+
+	/*
+	 * No transfer was left to receive data, the device had to wait.
+	 * This is only meaningful while the acquisition runs, the last
+	 * transfers which complete when it ends get counted as well.
+	 * Cancelled transfers are not.
+	 */
+	if (g_atomic_int_dec_and_test(&stream->in_flight) &&
+			transfer->status != LIBUSB_TRANSFER_CANCELLED)
+		stream->stats.underruns++;
+
+	if (transfer->status != LIBUSB_TRANSFER_COMPLETED &&
+			transfer->status != LIBUSB_TRANSFER_TIMED_OUT)
+		return FALSE;
+	if (transfer->actual_length <= 0)
+		return FALSE;
+
+	stream->stats.transfers++;
+	stream->stats.bytes += transfer->actual_length;
+
+	if (!sr_usb_ring_pop(&stream->free, &item)) {
+		stream->stats.overflows++;
+		return FALSE;
+	}
+	sr_usb_ring_push(&stream->filled, transfer->buffer,
+		transfer->actual_length);
+	transfer->buffer = item.buf;
+
+	depth = sr_usb_ring_count(&stream->filled);
+	if (depth > stream->stats.max_depth)
+		stream->stats.max_depth = depth;
+
+	g_main_context_wakeup(stream->main_context);
+
+	return TRUE;
+}
+
+/**
+ * Have the stream's end callback run once all data was passed on.
+ *
+ * Gets called from a transfer completion callback, typically when the
+ * last transfer of an acquisition has completed.
+ *
+ * @param stream The stream.
+ *
+ * @private
+ */
+SR_PRIV void sr_usb_stream_finish(struct sr_usb_stream *stream)
+{
+	g_atomic_int_set(&stream->finished, TRUE);
+	g_main_context_wakeup(stream->main_context);
+}
+
+/**
+ * Get the number of transfers' data which waits for the session thread.
+ *
+ * @param stream The stream, can be NULL.
+ *
+ * @private
+ */
+SR_PRIV size_t sr_usb_stream_backlog(struct sr_usb_stream *stream)
+{
+	if (!stream)
+		return 0;
+
+	return sr_usb_ring_count(&stream->filled);
+}
+
+/* Completions between two adjustments of a tuner's transfers. */
+#define USB_TUNER_WINDOW	16
+/* Grow transfers which complete more often than this. */
+#define USB_TUNER_MIN_INTERVAL_US	(2 * 1000)
+/* Shrink transfers which complete less often than this. */
+#define USB_TUNER_MAX_INTERVAL_US	(50 * 1000)
+/* Lower bound of the transfers' timeout, libusb takes 0 as "none". */
+#define USB_TUNER_MIN_TIMEOUT_MS	10
+
+/** Submission of a transfer which a tuner watches. */
+struct usb_tuner_slot {
+	struct libusb_transfer *transfer;
+	int64_t submit_us;
+	int64_t complete_us;
+};
+
+static size_t usb_tuner_round(struct sr_usb_tuner *tuner, size_t size)
+{
+	size = (size + tuner->block_size - 1) / tuner->block_size;
+
+	return MAX(size, 1) * tuner->block_size;
+}
+
+/**
+ * Set up the transfer sizing of a streaming USB device.
+ *
+ * Transfers initially hold @a transfer_ms worth of data, and enough of
+ * them get submitted to hold @a queue_ms worth of data. Both can grow
+ * to twice as much, and shrink back, see sr_usb_tuner_complete().
+ * Transfers must have buffers of sr_usb_tuner.max_size bytes.
+ *
+ * @param bytes_per_ms Data rate of the device.
+ * @param block_size Transfer sizes are multiples of this.
+ * @param transfer_ms Time which a transfer's data should span.
+ * @param queue_ms Time which all transfers' data should span.
+ * @param max_depth Initial maximum number of transfers.
+ *
+ * @return The new tuner.
+ *
+ * @private
+ */
+SR_PRIV struct sr_usb_tuner *sr_usb_tuner_new(uint64_t bytes_per_ms,
+		size_t block_size, unsigned int transfer_ms,
+		unsigned int queue_ms, unsigned int max_depth)
+{
+	struct sr_usb_tuner *tuner;
+	uint64_t depth;
+
+	tuner = g_malloc0(sizeof(*tuner));
+	tuner->bytes_per_ms = MAX(bytes_per_ms, 1);
+	tuner->block_size = MAX(block_size, 1);
+
+	tuner->size = usb_tuner_round(tuner, transfer_ms * tuner->bytes_per_ms);
+	tuner->min_size = usb_tuner_round(tuner, tuner->size / 4);
+	tuner->max_size = 2 * tuner->size;
+
+	depth = (queue_ms * tuner->bytes_per_ms + tuner->size - 1) / tuner->size;
+	tuner->depth = CLAMP(depth, 1, max_depth);
+	tuner->min_depth = tuner->depth;
+	tuner->max_depth = 2 * max_depth;
+
+	tuner->clock = g_get_monotonic_time;
+
+	g_mutex_init(&tuner->mutex);
+	tuner->slots = g_malloc0(tuner->max_depth * sizeof(*tuner->slots));
+
+	return tuner;
+}
+
+/**
+ * Override a tuner's limits, typically from a device's configuration.
+ *
+ * Must be called before any transfer gets submitted.
+ *
+ * @param tuner The tuner.
+ * @param max_size Maximum transfer size in bytes, or 0 to keep.
+ * @param max_depth Maximum number of transfers, or 0 to keep.
+ *
+ * @private
+ */
+SR_PRIV void sr_usb_tuner_limit(struct sr_usb_tuner *tuner,
+		uint64_t max_size, uint64_t max_depth)
+{
+	if (max_size) {
+		tuner->max_size = usb_tuner_round(tuner, max_size);
+		tuner->size = MIN(tuner->size, tuner->max_size);
+		tuner->min_size = MIN(tuner->min_size, tuner->size);
+	}
+	if (max_depth) {
+		tuner->max_depth = max_depth;
+		tuner->depth = MIN(tuner->depth, tuner->max_depth);
+		tuner->min_depth = MIN(tuner->min_depth, tuner->depth);
+		tuner->slots = g_realloc(tuner->slots,
+			tuner->max_depth * sizeof(*tuner->slots));
+		memset(tuner->slots, 0,
+			tuner->max_depth * sizeof(*tuner->slots));
+	}
+}
+
+/**
+ * Get the timeout for a tuner's transfers.
+ *
+ * Covers the time which all transfers' data spans, with a headroom
+ * of 25%. Never less than USB_TUNER_MIN_TIMEOUT_MS, small transfers
+ * at high rates would round down to no timeout at all.
+ *
+ * @private
+ */
+SR_PRIV unsigned int sr_usb_tuner_timeout(struct sr_usb_tuner *tuner)
+{
+	uint64_t timeout;
+
+	timeout = tuner->depth * tuner->size / tuner->bytes_per_ms;
+	timeout += timeout / 4;
+
+	return MAX(timeout, USB_TUNER_MIN_TIMEOUT_MS);
+}
+
+/* Lookup the slot of a transfer, or a free slot. Needs the mutex. */
+static struct usb_tuner_slot *usb_tuner_slot(struct sr_usb_tuner *tuner,
+		struct libusb_transfer *transfer)
+{
+	struct usb_tuner_slot *slot;
+	unsigned int i;
+
+	slot = NULL;
+	for (i = 0; i < tuner->max_depth; i++) {
+		if (tuner->slots[i].transfer == transfer)
+			return &tuner->slots[i];
+		if (!slot && !tuner->slots[i].transfer)
+			slot = &tuner->slots[i];
+	}
+
+	return slot;
+}
+
+/**
+ * Prepare a transfer for (re)submission with the current size and
+ * timeout, and note the time of submission.
+ *
+ * @param tuner The tuner, can be NULL.
+ * @param transfer The transfer, its buffer must hold max_size bytes.
+ *
+ * @private
+ */
+SR_PRIV void sr_usb_tuner_submit(struct sr_usb_tuner *tuner,
+		struct libusb_transfer *transfer)
+{
+	struct usb_tuner_slot *slot;
+	int64_t now_us, turnaround_us;
+
+	if (!tuner)
+		return;
+
+	g_mutex_lock(&tuner->mutex);
+
+	transfer->length = tuner->size;
+	transfer->timeout = sr_usb_tuner_timeout(tuner);
+
+	now_us = tuner->clock();
+	slot = usb_tuner_slot(tuner, transfer);
+	if (slot) {
+		if (slot->transfer && slot->complete_us) {
+			turnaround_us = now_us - slot->complete_us;
+			if (turnaround_us > tuner->turnaround_max_us)
+				tuner->turnaround_max_us = turnaround_us;
+		}
+		slot->transfer = transfer;
+		slot->submit_us = now_us;
+		slot->complete_us = 0;
+	}
+
+	g_mutex_unlock(&tuner->mutex);
+}
+
+/* Adjust transfer size and depth after a window of completions. */
+static void usb_tuner_adjust(struct sr_usb_tuner *tuner, int64_t now_us,
+		size_t backlog)
+{
+	int64_t interval_us, queued_us;
+	size_t size;
+	unsigned int depth;
+
+	interval_us = (now_us - tuner->window_start_us) / USB_TUNER_WINDOW;
+	size = tuner->size;
+	depth = tuner->depth;
+
+	/*
+	 * Many small transfers waste time in completion handling, few
+	 * large transfers delay the data. Keep the completion interval
+	 * within bounds.
+	 */
+	if (interval_us < USB_TUNER_MIN_INTERVAL_US)
+		size = MIN(usb_tuner_round(tuner, 2 * size), tuner->max_size);
+	else if (interval_us > USB_TUNER_MAX_INTERVAL_US)
+		size = MAX(usb_tuner_round(tuner, size / 2), tuner->min_size);
+
+	/*
+	 * The queued transfers have to bridge the time in which the host
+	 * does not resubmit, and the time in which the consumer catches
+	 * up. Add transfers when either took half of the queued time.
+	 * Retire the added transfers again when the host resubmits well
+	 * within an eighth of the queued time and there is no backlog.
+	 */
+	queued_us = interval_us * depth;
+	if (2 * tuner->turnaround_max_us > queued_us || 2 * backlog > depth)
+		depth = MIN(depth + 1, tuner->max_depth);
+	else if (8 * tuner->turnaround_max_us < queued_us && !backlog)
+		depth = MAX(depth - 1, tuner->min_depth);
+
+	if (size != tuner->size || depth != tuner->depth) {
+		sr_dbg("USB transfers: %zu -> %zu bytes, %u -> %u in flight "
+			"(interval %" PRIi64 " us, turnaround %" PRIi64 " us, "
+			"backlog %zu).", tuner->size, size, tuner->depth, depth,
+			interval_us, tuner->turnaround_max_us, backlog);
+		tuner->size = size;
+		tuner->depth = depth;
+		tuner->adjustments++;
+	}
+
+	tuner->window_start_us = now_us;
+	tuner->turnaround_max_us = 0;
+}
+
+/**
+ * Account for a completed transfer, and adjust the transfer size and
+ * the number of transfers in flight.
+ *
+ * Drivers resubmit the transfer with sr_usb_tuner_submit(), which
+ * applies the new size, and submit additional transfers while they
+ * have less than sr_usb_tuner.depth in flight. With more than that in
+ * flight, they free the transfer instead of resubmitting it.
+ *
+ * @param tuner The tuner, can be NULL.
+ * @param transfer The completed transfer.
+ * @param backlog Number of transfers' data waiting for the consumer.
+ *
+ * @private
+ */
+SR_PRIV void sr_usb_tuner_complete(struct sr_usb_tuner *tuner,
+		struct libusb_transfer *transfer, size_t backlog)
+{
+	struct usb_tuner_slot *slot;
+	int64_t now_us, latency_ms;
+	unsigned int bin;
+
+	if (!tuner)
+		return;
+
+	g_mutex_lock(&tuner->mutex);
+
+	now_us = tuner->clock();
+	slot = usb_tuner_slot(tuner, transfer);
+	if (slot && slot->transfer && slot->submit_us) {
+		latency_ms = (now_us - slot->submit_us) / 1000;
+		bin = 0;
+		while (latency_ms && bin < SR_USB_LATENCY_BINS - 1) {
+			latency_ms >>= 1;
+			bin++;
+		}
+		tuner->latency_hist[bin]++;
+		slot->complete_us = now_us;
+	}
+
+	if (!tuner->window_start_us)
+		tuner->window_start_us = now_us;
+	else if (++tuner->completions % USB_TUNER_WINDOW == 0)
+		usb_tuner_adjust(tuner, now_us, backlog);
+
+	g_mutex_unlock(&tuner->mutex);
+}
+
+/**
+ * Stop watching a transfer, e.g. before it gets freed.
+ *
+ * @private
+ */
+SR_PRIV void sr_usb_tuner_remove(struct sr_usb_tuner *tuner,
+		struct libusb_transfer *transfer)
+{
+	struct usb_tuner_slot *slot;
+
+	if (!tuner)
+		return;
+
+	g_mutex_lock(&tuner->mutex);
+	slot = usb_tuner_slot(tuner, transfer);
+	if (slot && slot->transfer == transfer)
+		memset(slot, 0, sizeof(*slot));
+	g_mutex_unlock(&tuner->mutex);
+}
+
+/**
+ * Release a tuner, and keep its statistics for the device.
+ *
+ * @param tuner The tuner, can be NULL.
+ * @param sdi The device, see sr_session_usb_stats_get().
+ *
+ * @private
+ */
+SR_PRIV void sr_usb_tuner_free(struct sr_usb_tuner *tuner,
+		const struct sr_dev_inst *sdi)
+{
+	struct sr_usb_stream_stats *stats;
+
+	if (!tuner)
+		return;
+
+	if (sdi && sdi->session) {
+		stats = usb_session_stats(sdi->session, sdi);
+		stats->transfer_size = tuner->size;
+		stats->transfer_depth = tuner->depth;
+		memcpy(stats->latency_hist, tuner->latency_hist,
+			sizeof(stats->latency_hist));
+	}
+	sr_dbg("USB transfers: %zu bytes, %u in flight, %" PRIu64
+		" adjustments.", tuner->size, tuner->depth,
+		tuner->adjustments);
+
+	g_mutex_clear(&tuner->mutex);
+	g_free(tuner->slots);
+	g_free(tuner);
+}
+
 SR_PRIV int usb_get_port_path(libusb_device *dev, char *path, int path_len)
 {
 	uint8_t port_numbers[8];
@@ -428,6 +428,74 @@ START_TEST(test_analog_to_float_conv)
 }
 END_TEST
 
+/*
+ * Check sr_analog_to_double(), and that sr_analog_to_float() results
+ * are the double precision results trimmed to single precision. The
+ * odd length covers both the vectorized and the remainder code paths.
+ */
+START_TEST(test_analog_to_double)
+{
+	static const struct {
+		size_t unit;
+		int is_sign, is_be;
+	} types[] = {
+		{ sizeof(uint8_t), FALSE, FALSE, },
+		{ sizeof(int8_t), TRUE, FALSE, },
+		{ sizeof(uint16_t), FALSE, FALSE, },
+		{ sizeof(int16_t), TRUE, FALSE, },
+		{ sizeof(uint16_t), FALSE, TRUE, },
+		{ sizeof(int16_t), TRUE, TRUE, },
+		{ sizeof(uint32_t), FALSE, FALSE, },
+		{ sizeof(int32_t), TRUE, TRUE, },
+	};
+	const size_t num_samples = 37;
+	struct sr_channel ch;
+	struct sr_datafeed_analog analog;
+	struct sr_analog_encoding encoding;
+	struct sr_analog_meaning meaning;
+	struct sr_analog_spec spec;
+	uint8_t bytes[37 * sizeof(uint32_t)];
+	float f_out[37];
+	double d_out[37];
+	size_t type_idx, idx;
+	int ret;
+
+	for (idx = 0; idx < sizeof(bytes); idx++)
+		bytes[idx] = idx * 37 + 11;
+
+	for (type_idx = 0; type_idx < ARRAY_SIZE(types); type_idx++) {
+		sr_analog_init_(&analog, &encoding, &meaning, &spec, 3);
+		analog.num_samples = num_samples;
+		analog.data = bytes;
+		encoding.unitsize = types[type_idx].unit;
+		encoding.is_float = FALSE;
+		encoding.is_signed = types[type_idx].is_sign;
+		encoding.is_bigendian = types[type_idx].is_be;
+		encoding.scale.p = 3;
+		encoding.scale.q = 7;
+		encoding.offset.p = -5;
+		encoding.offset.q = 3;
+		meaning.channels = g_slist_append(NULL, &ch);
+
+		ret = sr_analog_to_double(&analog, d_out);
+		fail_unless(ret == SR_OK, "sr_analog_to_double() failed: %d", ret);
+		ret = sr_analog_to_float(&analog, f_out);
+		fail_unless(ret == SR_OK, "sr_analog_to_float() failed: %d", ret);
+		for (idx = 0; idx < num_samples; idx++) {
+			fail_unless(f_out[idx] == (float)d_out[idx],
+				"type %zu, sample %zu: %f != %f",
+				type_idx, idx, f_out[idx], d_out[idx]);
+		}
+		g_slist_free(meaning.channels);
+	}
+
+	ret = sr_analog_to_double(NULL, d_out);
+	fail_unless(ret == SR_ERR_ARG);
+	ret = sr_analog_to_double(&analog, NULL);
+	fail_unless(ret == SR_ERR_ARG);
+}
+END_TEST
+
 START_TEST(test_analog_si_prefix)
 {
 	struct {
@@ -697,6 +765,7 @@ Suite *suite_analog(void)
 	tcase_add_test(tc, test_analog_to_float);
 	tcase_add_test(tc, test_analog_to_float_null);
 	tcase_add_test(tc, test_analog_to_float_conv);
+	tcase_add_test(tc, test_analog_to_double);
 	suite_add_tcase(s, tc);
 
 	tc = tcase_create("analog_si_unit");
@@ -0,0 +1,912 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * Copyright (C) 2026 The sigrok project developers
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Throughput benchmarks for the datafeed pipeline ("make bench").
+ *
+ * Every benchmark runs on generated data with a fixed seed, so that
+ * results of different builds can be compared. Each one is repeated,
+ * and the fastest run is reported, in a JSON document which lists
+ * samples/s and bytes/s per benchmark.
+ *
+ * Like the other tests this program is limited to the public API.
+ * Session fan-out and soft-trigger cost are measured by running the
+ * demo driver in its "benchmark" test mode, which generates data as
+ * fast as the session can take it.
+ */
+
+#include <config.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <libsigrok/libsigrok.h>
+
+#define ARRAY_SIZE(a) (sizeof(a) / sizeof((a)[0]))
+
+#define BENCH_SAMPLERATE SR_MHZ(1)
+#define BENCH_LOGIC_CHANNELS 8
+/* Samples per logic or analog packet which outputs get fed with. */
+#define BENCH_CHUNK_SAMPLES (64 * 1024)
+/* Block size for input modules, like sigrok-cli reads files. */
+#define BENCH_INPUT_CHUNK (4 * 1024 * 1024)
+
+struct bench_result {
+	uint64_t samples;
+	uint64_t bytes;
+	double seconds;
+};
+
+struct bench_case;
+typedef int (*bench_run)(const struct bench_case *bc, uint64_t samples,
+		struct bench_result *res);
+typedef GString *(*bench_generate)(uint64_t samples, GHashTable *options);
+
+struct bench_case {
+	const char *name;
+	/* Workload at scale 1.0, in samples. */
+	uint64_t samples;
+	bench_run run;
+	/* Module ID or sample encoding. */
+	const char *id;
+	/* Datafeed callback count, logic channel count or channel type. */
+	int arg;
+	bench_generate generate;
+	/* Boolean output module option to enable. */
+	const char *option;
+};
+
+static struct sr_context *ctx;
+/* Demo devices, by logic unit size. */
+static struct sr_dev_inst *demo_sdi[9];
+static struct sr_dev_inst *logic_sdi, *analog_sdi;
+static char *tmpdir;
+static uint64_t rnd_state;
+static gint64 start_us;
+
+/* Reproducible pseudo random data (xorshift64*). */
+static uint64_t rnd(void)
+{
+	rnd_state ^= rnd_state >> 12;
+	rnd_state ^= rnd_state << 25;
+	rnd_state ^= rnd_state >> 27;
+
+	return rnd_state * 0x2545f4914f6cdd1dULL;
+}
+
+static void bench_start(void)
+{
+	start_us = g_get_monotonic_time();
+}
+
+static void bench_stop(struct bench_result *res)
+{
+	res->seconds = (g_get_monotonic_time() - start_us) / 1e6;
+}
+
+static GHashTable *options_new(void)
+{
+	return g_hash_table_new_full(g_str_hash, g_str_equal, g_free,
+			(GDestroyNotify)g_variant_unref);
+}
+
+static void options_add(GHashTable *options, const char *key, GVariant *gvar)
+{
+	g_hash_table_insert(options, g_strdup(key), g_variant_ref_sink(gvar));
+}
+
+/*
+ * Generate 8 channels of logic data. Every channel toggles with a
+ * probability of 1/8 per sample, which keeps change based formats
+ * like VCD from degenerating into a dump of every sample.
+ */
+static void generate_logic(uint8_t *data, uint64_t samples)
+{
+	uint64_t i, r;
+	uint8_t value;
+
+	value = 0;
+	for (i = 0; i < samples; i++) {
+		r = rnd();
+		value ^= r & (r >> 8) & (r >> 16);
+		data[i] = value;
+	}
+}
+
+/* Count the samples which an input module sends to the session. */
+static void datafeed_count(const struct sr_dev_inst *sdi,
+	const struct sr_datafeed_packet *packet, void *cb_data)
+{
+	const struct sr_datafeed_logic *logic;
+	const struct sr_datafeed_analog *analog;
+	struct bench_result *res;
+
+	(void)sdi;
+
+	res = cb_data;
+	switch (packet->type) {
+	case SR_DF_LOGIC:
+		logic = packet->payload;
+		res->samples += logic->length / logic->unitsize;
+		break;
+	case SR_DF_ANALOG:
+		analog = packet->payload;
+		res->samples += analog->num_samples;
+		break;
+	default:
+		break;
+	}
+}
+
+/* A datafeed callback which does as little as a callback can. */
+static void datafeed_touch(const struct sr_dev_inst *sdi,
+	const struct sr_datafeed_packet *packet, void *cb_data)
+{
+	const struct sr_datafeed_logic *logic;
+	uint64_t *bytes;
+
+	(void)sdi;
+
+	bytes = cb_data;
+	if (packet->type == SR_DF_LOGIC) {
+		logic = packet->payload;
+		*bytes += logic->length;
+	}
+}
+
+/*
+ * Get the demo device with 8 logic channels and no analog channels,
+ * set up for unpaced generation of an all-low pattern.
+ */
+static struct sr_dev_inst *demo_get(int num_channels)
+{
+	struct sr_dev_driver **drivers, *driver;
+	struct sr_config src_logic, src_analog;
+	struct sr_channel_group *cg;
+	GSList *options, *devices, *l;
+	struct sr_dev_inst *sdi;
+	int unitsize, i, ret;
+
+	unitsize = (num_channels + 7) / 8;
+	if (demo_sdi[unitsize])
+		return demo_sdi[unitsize];
+
+	driver = NULL;
+	drivers = sr_driver_list(ctx);
+	for (i = 0; drivers && drivers[i]; i++) {
+		if (strcmp(drivers[i]->name, "demo") == 0)
+			driver = drivers[i];
+	}
+	if (!driver || sr_driver_init(ctx, driver) != SR_OK)
+		return NULL;
+
+	src_logic.key = SR_CONF_NUM_LOGIC_CHANNELS;
+	src_logic.data = g_variant_new_int32(num_channels);
+	src_analog.key = SR_CONF_NUM_ANALOG_CHANNELS;
+	src_analog.data = g_variant_new_int32(0);
+	options = g_slist_append(NULL, &src_logic);
+	options = g_slist_append(options, &src_analog);
+	devices = sr_driver_scan(driver, options);
+	g_slist_free(options);
+	g_variant_unref(g_variant_ref_sink(src_logic.data));
+	g_variant_unref(g_variant_ref_sink(src_analog.data));
+	if (!devices)
+		return NULL;
+	sdi = devices->data;
+	g_slist_free(devices);
+
+	ret = sr_dev_open(sdi);
+	if (ret == SR_OK)
+		ret = sr_config_set(sdi, NULL, SR_CONF_TEST_MODE,
+			g_variant_new_string("benchmark"));
+	for (l = sr_dev_inst_channel_groups_get(sdi); l; l = l->next) {
+		cg = l->data;
+		if (ret == SR_OK && strcmp(cg->name, "Logic") == 0)
+			ret = sr_config_set(sdi, cg, SR_CONF_PATTERN_MODE,
+				g_variant_new_string("all-low"));
+	}
+	if (ret != SR_OK) {
+		sr_dev_close(sdi);
+		return NULL;
+	}
+
+	demo_sdi[unitsize] = sdi;
+
+	return sdi;
+}
+
+static int demo_run(uint64_t samples, int num_channels, int callbacks,
+		struct sr_trigger *trigger, struct bench_result *res)
+{
+	struct sr_dev_inst *sdi;
+	struct sr_session *session;
+	uint64_t *bytes;
+	int i, ret;
+
+	if (!(sdi = demo_get(num_channels)))
+		return SR_ERR_NA;
+
+	ret = sr_config_set(sdi, NULL, SR_CONF_LIMIT_SAMPLES,
+		g_variant_new_uint64(samples));
+	if (ret != SR_OK)
+		return ret;
+
+	bytes = g_malloc0(callbacks * sizeof(*bytes));
+	sr_session_new(ctx, &session);
+	sr_session_dev_add(session, sdi);
+	sr_session_datafeed_callback_add(session, datafeed_count, res);
+	for (i = 1; i < callbacks; i++)
+		sr_session_datafeed_callback_add(session, datafeed_touch, &bytes[i]);
+	if (trigger)
+		sr_session_trigger_set(session, trigger);
+
+	bench_start();
+	ret = sr_session_start(session);
+	if (ret == SR_OK)
+		ret = sr_session_run(session);
+	bench_stop(res);
+
+	sr_session_destroy(session);
+	g_free(bytes);
+
+	/* A trigger which never matches gets all samples checked. */
+	if (trigger)
+		res->samples = samples;
+	res->bytes = res->samples * ((num_channels + 7) / 8);
+
+	return ret;
+}
+
+/*
+ * Cost of sr_session_send() with several datafeed callbacks. The
+ * callbacks don't look at the data, so this is per-packet overhead
+ * spread over the samples in each demo packet.
+ */
+static int bench_fanout(const struct bench_case *bc, uint64_t samples,
+		struct bench_result *res)
+{
+	return demo_run(samples, BENCH_LOGIC_CHANNELS, bc->arg, NULL, res);
+}
+
+/* Soft-trigger throughput, with a trigger which never matches. */
+static int bench_soft_trigger(const struct bench_case *bc, uint64_t samples,
+		struct bench_result *res)
+{
+	struct sr_dev_inst *sdi;
+	struct sr_trigger *trigger;
+	struct sr_trigger_stage *stage;
+	struct sr_channel *ch;
+	int ret;
+
+	if (!(sdi = demo_get(bc->arg)))
+		return SR_ERR_NA;
+
+	/* On the last channel, so that the whole unit gets checked. */
+	trigger = sr_trigger_new(NULL);
+	stage = sr_trigger_stage_add(trigger);
+	ch = g_slist_last(sr_dev_inst_channels_get(sdi))->data;
+	sr_trigger_match_add(stage, ch, SR_TRIGGER_ONE, 0);
+
+	ret = demo_run(samples, bc->arg, 1, trigger, res);
+
+	sr_trigger_free(trigger);
+
+	return ret;
+}
+
+/* sr_analog_to_float() for an encoding like "u16le" or "f32be". */
+static int bench_analog(const struct bench_case *bc, uint64_t samples,
+		struct bench_result *res)
+{
+	struct sr_channel ch;
+	struct sr_datafeed_analog analog;
+	struct sr_analog_encoding encoding;
+	struct sr_analog_meaning meaning;
+	struct sr_analog_spec spec;
+	uint8_t *data, *p;
+	float *out;
+	uint64_t i, done, bits, r;
+	unsigned int width, b;
+	char type, order[3];
+	double value;
+	float fvalue;
+	uint32_t u32;
+	int ret;
+
+	if (sscanf(bc->id, "%c%u%2s", &type, &width, order) < 2)
+		return SR_ERR_ARG;
+
+	memset(&analog, 0, sizeof(analog));
+	memset(&encoding, 0, sizeof(encoding));
+	memset(&meaning, 0, sizeof(meaning));
+	memset(&spec, 0, sizeof(spec));
+	analog.encoding = &encoding;
+	analog.meaning = &meaning;
+	analog.spec = &spec;
+	encoding.unitsize = width / 8;
+	encoding.is_signed = type != 'u';
+	encoding.is_float = type == 'f';
+	encoding.is_bigendian = width > 8 && strcmp(order, "be") == 0;
+	encoding.digits = 3;
+	encoding.is_digits_decimal = TRUE;
+	encoding.scale.p = 1;
+	encoding.scale.q = 1;
+	encoding.offset.p = 0;
+	encoding.offset.q = 1;
+	meaning.channels = g_slist_append(NULL, &ch);
+
+	/* Values in the file's byte order, floats within [-1, 1). */
+	data = g_malloc(BENCH_CHUNK_SAMPLES * encoding.unitsize);
+	out = g_malloc(BENCH_CHUNK_SAMPLES * sizeof(*out));
+	for (i = 0, p = data; i < BENCH_CHUNK_SAMPLES; i++) {
+		r = rnd();
+		value = (int64_t)r / 9223372036854775808.0;
+		if (encoding.is_float && width == 32) {
+			fvalue = value;
+			memcpy(&u32, &fvalue, sizeof(u32));
+			bits = u32;
+		} else if (encoding.is_float) {
+			memcpy(&bits, &value, sizeof(bits));
+		} else {
+			bits = r;
+		}
+		for (b = 0; b < encoding.unitsize; b++) {
+			if (encoding.is_bigendian)
+				p[encoding.unitsize - 1 - b] = bits >> (8 * b);
+			else
+				p[b] = bits >> (8 * b);
+		}
+		p += encoding.unitsize;
+	}
+
+	ret = SR_OK;
+	bench_start();
+	for (done = 0; done < samples && ret == SR_OK; done += analog.num_samples) {
+		analog.data = data;
+		analog.num_samples = MIN(samples - done, BENCH_CHUNK_SAMPLES);
+		ret = sr_analog_to_float(&analog, out);
+	}
+	bench_stop(res);
+
+	res->samples = done;
+	res->bytes = done * encoding.unitsize;
+
+	g_slist_free(meaning.channels);
+	g_free(out);
+	g_free(data);
+
+	return ret;
+}
+
+static GString *generate_binary(uint64_t samples, GHashTable *options)
+{
+	GString *s;
+
+	options_add(options, "numchannels",
+		g_variant_new_int32(BENCH_LOGIC_CHANNELS));
+	options_add(options, "samplerate",
+		g_variant_new_uint64(BENCH_SAMPLERATE));
+
+	s = g_string_sized_new(samples);
+	g_string_set_size(s, samples);
+	generate_logic((uint8_t *)s->str, samples);
+
+	return s;
+}
+
+/* The Saleae Logic1 export of every sample, one byte per sample. */
+static GString *generate_saleae(uint64_t samples, GHashTable *options)
+{
+	GString *s;
+
+	options_add(options, "format", g_variant_new_string("logic1-digital"));
+	options_add(options, "wordsize", g_variant_new_uint32(1));
+	options_add(options, "samplerate",
+		g_variant_new_uint64(BENCH_SAMPLERATE));
+
+	s = g_string_sized_new(samples);
+	g_string_set_size(s, samples);
+	generate_logic((uint8_t *)s->str, samples);
+
+	return s;
+}
+
+/* One line per sample, one column per channel. */
+static GString *generate_csv(uint64_t samples, GHashTable *options)
+{
+	GString *s;
+	uint8_t *data;
+	uint64_t i;
+	int ch;
+
+	options_add(options, "column_formats", g_variant_new_string("8l"));
+	options_add(options, "header", g_variant_new_boolean(FALSE));
+	options_add(options, "samplerate",
+		g_variant_new_uint64(BENCH_SAMPLERATE));
+
+	data = g_malloc(samples);
+	generate_logic(data, samples);
+	s = g_string_sized_new(samples * 2 * BENCH_LOGIC_CHANNELS);
+	for (i = 0; i < samples; i++) {
+		for (ch = 0; ch < BENCH_LOGIC_CHANNELS; ch++) {
+			g_string_append_c(s, data[i] & (1 << ch) ? '1' : '0');
+			g_string_append_c(s, ch + 1 < BENCH_LOGIC_CHANNELS ? ',' : '\n');
+		}
+	}
+	g_free(data);
+
+	return s;
+}
+
+/* Value changes with a timescale of one sample. */
+static GString *generate_vcd(uint64_t samples, GHashTable *options)
+{
+	GString *s;
+	uint8_t *data, changed;
+	uint64_t i;
+	int ch;
+
+	(void)options;
+
+	s = g_string_new("$timescale 1 us $end\n$scope module bench $end\n");
+	for (ch = 0; ch < BENCH_LOGIC_CHANNELS; ch++)
+		g_string_append_printf(s, "$var wire 1 %c D%d $end\n", '!' + ch, ch);
+	g_string_append(s, "$upscope $end\n$enddefinitions $end\n");
+
+	data = g_malloc(samples);
+	generate_logic(data, samples);
+	for (i = 0; i < samples; i++) {
+		changed = i ? data[i] ^ data[i - 1] : 0xff;
+		if (!changed)
+			continue;
+		g_string_append_printf(s, "#%" PRIu64 "\n", i);
+		for (ch = 0; ch < BENCH_LOGIC_CHANNELS; ch++) {
+			if (!(changed & (1 << ch)))
+				continue;
+			g_string_append_c(s, data[i] & (1 << ch) ? '1' : '0');
+			g_string_append_c(s, '!' + ch);
+			g_string_append_c(s, '\n');
+		}
+	}
+	g_string_append_printf(s, "#%" PRIu64 "\n", samples);
+	g_free(data);
+
+	return s;
+}
+
+static void append_le(GString *s, uint64_t value, size_t size)
+{
+	while (size--) {
+		g_string_append_c(s, value & 0xff);
+		value >>= 8;
+	}
+}
+
+/* Mono 16bit PCM. */
+static GString *generate_wav(uint64_t samples, GHashTable *options)
+{
+	GString *s;
+	uint64_t i;
+
+	(void)options;
+
+	s = g_string_sized_new(44 + samples * 2);
+	g_string_append(s, "RIFF");
+	append_le(s, 36 + samples * 2, 4);
+	g_string_append(s, "WAVEfmt ");
+	append_le(s, 16, 4);
+	append_le(s, 1, 2);
+	append_le(s, 1, 2);
+	append_le(s, BENCH_SAMPLERATE, 4);
+	append_le(s, BENCH_SAMPLERATE * 2, 4);
+	append_le(s, 2, 2);
+	append_le(s, 16, 2);
+	g_string_append(s, "data");
+	append_le(s, samples * 2, 4);
+	for (i = 0; i < samples; i++)
+		append_le(s, rnd() >> 48, 2);
+
+	return s;
+}
+
+/* An input module parsing a generated file, in blocks. */
+static int bench_input(const struct bench_case *bc, uint64_t samples,
+		struct bench_result *res)
+{
+	const struct sr_input_module *imod;
+	struct sr_input *in;
+	struct sr_session *session;
+	struct sr_dev_inst *sdi;
+	GHashTable *options;
+	GString *file;
+	size_t pos, len;
+	gboolean added;
+	int ret;
+
+	if (!(imod = sr_input_find(bc->id)))
+		return SR_ERR_NA;
+
+	options = options_new();
+	file = bc->generate(samples, options);
+
+	bench_start();
+	in = sr_input_new(imod, options);
+	if (!in) {
+		g_hash_table_destroy(options);
+		g_string_free(file, TRUE);
+		return SR_ERR_ARG;
+	}
+	sr_session_new(ctx, &session);
+	sr_session_datafeed_callback_add(session, datafeed_count, res);
+	/*
+	 * The device instance only becomes available once the module
+	 * has seen enough of the file. Modules return from receive()
+	 * right after that, before sending any data.
+	 */
+	added = FALSE;
+	ret = SR_OK;
+	for (pos = 0; pos < file->len && ret == SR_OK; pos += len) {
+		len = MIN(file->len - pos, BENCH_INPUT_CHUNK);
+		ret = sr_input_send_data(in, file->str + pos, len);
+		if (!added && (sdi = sr_input_dev_inst_get(in))) {
+			sr_session_dev_add(session, sdi);
+			added = TRUE;
+		}
+	}
+	if (ret == SR_OK && !added && (sdi = sr_input_dev_inst_get(in))) {
+		sr_session_dev_add(session, sdi);
+		added = TRUE;
+	}
+	if (ret == SR_OK)
+		ret = sr_input_end(in);
+	bench_stop(res);
+
+	res->bytes = file->len;
+
+	sr_input_free(in);
+	sr_session_destroy(session);
+	g_hash_table_destroy(options);
+	g_string_free(file, TRUE);
+
+	return ret;
+}
+
+static int output_send(const struct sr_output *o, int type,
+		const void *payload)
+{
+	struct sr_datafeed_packet packet;
+	GString *out;
+	int ret;
+
+	packet.type = type;
+	packet.payload = payload;
+	out = NULL;
+	ret = sr_output_send(o, &packet, &out);
+	if (out)
+		g_string_free(out, TRUE);
+
+	return ret;
+}
+
+/* The device which output modules get to see, created once. */
+static struct sr_dev_inst *output_sdi_get(int type)
+{
+	char name[16];
+	int ch;
+
+	if (type == SR_CHANNEL_ANALOG) {
+		if (!analog_sdi) {
+			analog_sdi = sr_dev_inst_user_new("sigrok", "bench", NULL);
+			sr_dev_inst_channel_add(analog_sdi, 0, SR_CHANNEL_ANALOG, "A0");
+		}
+		return analog_sdi;
+	}
+
+	if (!logic_sdi) {
+		logic_sdi = sr_dev_inst_user_new("sigrok", "bench", NULL);
+		for (ch = 0; ch < BENCH_LOGIC_CHANNELS; ch++) {
+			snprintf(name, sizeof(name), "D%d", ch);
+			sr_dev_inst_channel_add(logic_sdi, ch, SR_CHANNEL_LOGIC, name);
+		}
+	}
+	return logic_sdi;
+}
+
+/*
+ * An output module consuming a logic stream with 8 channels, or a
+ * stream of single channel float analog data.
+ */
+static int bench_output(const struct bench_case *bc, uint64_t samples,
+		struct bench_result *res)
+{
+	const struct sr_output_module *omod;
+	const struct sr_output *o;
+	struct sr_dev_inst *sdi;
+	struct sr_datafeed_header header;
+	struct sr_datafeed_meta meta;
+	struct sr_datafeed_logic logic;
+	struct sr_datafeed_analog analog;
+	struct sr_analog_encoding encoding;
+	struct sr_analog_meaning meaning;
+	struct sr_analog_spec spec;
+	struct sr_config src;
+	GHashTable *options;
+	char *filename;
+	float *values;
+	uint8_t *data;
+	uint64_t i, done, count;
+	int ret;
+
+	if (!(omod = sr_output_find((char *)bc->id)))
+		return SR_ERR_NA;
+
+	options = NULL;
+	if (bc->option) {
+		options = options_new();
+		options_add(options, bc->option, g_variant_new_boolean(TRUE));
+	}
+
+	sdi = output_sdi_get(bc->arg);
+
+	data = NULL;
+	values = NULL;
+	if (bc->arg == SR_CHANNEL_ANALOG) {
+		values = g_malloc(samples * sizeof(*values));
+		for (i = 0; i < samples; i++)
+			values[i] = (int64_t)rnd() / 9223372036854775808.0;
+	} else {
+		data = g_malloc(samples);
+		generate_logic(data, samples);
+	}
+
+	filename = NULL;
+	if (sr_output_test_flag(omod, SR_OUTPUT_INTERNAL_IO_HANDLING))
+		filename = g_build_filename(tmpdir, "bench.out", NULL);
+
+	memset(&analog, 0, sizeof(analog));
+	memset(&encoding, 0, sizeof(encoding));
+	memset(&meaning, 0, sizeof(meaning));
+	memset(&spec, 0, sizeof(spec));
+	analog.encoding = &encoding;
+	analog.meaning = &meaning;
+	analog.spec = &spec;
+	encoding.unitsize = sizeof(float);
+	encoding.is_signed = TRUE;
+	encoding.is_float = TRUE;
+#ifdef WORDS_BIGENDIAN
+	encoding.is_bigendian = TRUE;
+#endif
+	encoding.digits = 3;
+	encoding.is_digits_decimal = TRUE;
+	encoding.scale.p = 1;
+	encoding.scale.q = 1;
+	encoding.offset.p = 0;
+	encoding.offset.q = 1;
+	meaning.mq = SR_MQ_VOLTAGE;
+	meaning.unit = SR_UNIT_VOLT;
+	meaning.channels = sr_dev_inst_channels_get(sdi);
+
+	header.feed_version = 1;
+	header.starttime.tv_sec = 0;
+	header.starttime.tv_usec = 0;
+	src.key = SR_CONF_SAMPLERATE;
+	src.data = g_variant_ref_sink(g_variant_new_uint64(BENCH_SAMPLERATE));
+	meta.config = g_slist_append(NULL, &src);
+
+	bench_start();
+	o = sr_output_new(omod, options, sdi, filename);
+	ret = o ? SR_OK : SR_ERR_ARG;
+	if (ret == SR_OK)
+		ret = output_send(o, SR_DF_HEADER, &header);
+	if (ret == SR_OK)
+		ret = output_send(o, SR_DF_META, &meta);
+	for (done = 0; done < samples && ret == SR_OK; done += count) {
+		count = MIN(samples - done, BENCH_CHUNK_SAMPLES);
+		if (bc->arg == SR_CHANNEL_ANALOG) {
+			analog.data = &values[done];
+			analog.num_samples = count;
+			ret = output_send(o, SR_DF_ANALOG, &analog);
+		} else {
+			logic.length = count;
+			logic.unitsize = 1;
+			logic.data = &data[done];
+			ret = output_send(o, SR_DF_LOGIC, &logic);
+		}
+	}
+	if (ret == SR_OK)
+		ret = output_send(o, SR_DF_END, NULL);
+	if (o)
+		sr_output_free(o);
+	bench_stop(res);
+
+	res->samples = done;
+	res->bytes = done * (values ? sizeof(*values) : 1);
+
+	if (filename)
+		g_unlink(filename);
+	g_free(filename);
+	g_slist_free(meta.config);
+	g_variant_unref(src.data);
+	if (options)
+		g_hash_table_destroy(options);
+	g_free(values);
+	g_free(data);
+
+	return ret;
+}
+
+static const struct bench_case cases[] = {
+	{ "session/fanout-1", 1024 << 20, bench_fanout, NULL, 1, NULL },
+	{ "session/fanout-4", 1024 << 20, bench_fanout, NULL, 4, NULL },
+	{ "session/fanout-16", 1024 << 20, bench_fanout, NULL, 16, NULL },
+	{ "session/soft-trigger-8", 16 << 20, bench_soft_trigger, NULL, 8, NULL },
+	{ "session/soft-trigger-16", 16 << 20, bench_soft_trigger, NULL, 16, NULL },
+	{ "session/soft-trigger-32", 16 << 20, bench_soft_trigger, NULL, 32, NULL },
+	{ "session/soft-trigger-64", 16 << 20, bench_soft_trigger, NULL, 64, NULL },
+	{ "analog/u8", 256 << 20, bench_analog, "u8", 0, NULL },
+	{ "analog/i8", 256 << 20, bench_analog, "i8", 0, NULL },
+	{ "analog/u16le", 256 << 20, bench_analog, "u16le", 0, NULL },
+	{ "analog/u16be", 256 << 20, bench_analog, "u16be", 0, NULL },
+	{ "analog/i16le", 256 << 20, bench_analog, "i16le", 0, NULL },
+	{ "analog/i16be", 256 << 20, bench_analog, "i16be", 0, NULL },
+	{ "analog/u32le", 256 << 20, bench_analog, "u32le", 0, NULL },
+	{ "analog/i32le", 256 << 20, bench_analog, "i32le", 0, NULL },
+	{ "analog/f32le", 256 << 20, bench_analog, "f32le", 0, NULL },
+	{ "analog/f32be", 256 << 20, bench_analog, "f32be", 0, NULL },
+	{ "analog/f64le", 256 << 20, bench_analog, "f64le", 0, NULL },
+	{ "input/binary", 16 << 20, bench_input, "binary", 0, generate_binary },
+	{ "input/csv", 1 << 20, bench_input, "csv", 0, generate_csv },
+	{ "input/vcd", 4 << 20, bench_input, "vcd", 0, generate_vcd },
+	{ "input/wav", 4 << 20, bench_input, "wav", 0, generate_wav },
+	{ "input/saleae", 16 << 20, bench_input, "saleae", 0, generate_saleae },
+	{ "output/vcd", 4 << 20, bench_output, "vcd", SR_CHANNEL_LOGIC, NULL },
+	{ "output/csv", 1 << 20, bench_output, "csv", SR_CHANNEL_LOGIC, NULL },
+	{ "output/srzip", 16 << 20, bench_output, "srzip", SR_CHANNEL_LOGIC, NULL },
+	{ "output/srzip-overview", 16 << 20, bench_output, "srzip", SR_CHANNEL_LOGIC, NULL, "overview" },
+	{ "output/ascii", 256 << 10, bench_output, "ascii", SR_CHANNEL_LOGIC, NULL },
+	{ "output/bits", 256 << 10, bench_output, "bits", SR_CHANNEL_LOGIC, NULL },
+	{ "output/hex", 256 << 10, bench_output, "hex", SR_CHANNEL_LOGIC, NULL },
+	{ "output/wav", 4 << 20, bench_output, "wav", SR_CHANNEL_ANALOG, NULL },
+};
+
+int main(int argc, char **argv)
+{
+	static int repeat = 3;
+	static double scale = 1.0;
+	static char *filter = NULL, *output = NULL;
+	static const GOptionEntry entries[] = {
+		{ "repeat", 'r', 0, G_OPTION_ARG_INT, &repeat,
+			"Runs per benchmark, the fastest is reported", "N" },
+		{ "scale", 's', 0, G_OPTION_ARG_DOUBLE, &scale,
+			"Scale the amount of data per run", "FACTOR" },
+		{ "filter", 'f', 0, G_OPTION_ARG_STRING, &filter,
+			"Only run benchmarks with names containing TEXT", "TEXT" },
+		{ "output", 'o', 0, G_OPTION_ARG_FILENAME, &output,
+			"Write the JSON results to FILE", "FILE" },
+		{ NULL, 0, 0, 0, NULL, NULL, NULL },
+	};
+	const struct bench_case *bc;
+	struct bench_result res, best;
+	GOptionContext *context;
+	GError *error;
+	GString *json;
+	uint64_t samples;
+	size_t i;
+	int r, ret, failed;
+	gboolean first;
+
+	error = NULL;
+	context = g_option_context_new("- libsigrok pipeline benchmarks");
+	g_option_context_add_main_entries(context, entries, NULL);
+	if (!g_option_context_parse(context, &argc, &argv, &error)) {
+		fprintf(stderr, "%s\n", error->message);
+		g_error_free(error);
+		g_option_context_free(context);
+		return 1;
+	}
+	g_option_context_free(context);
+	if (repeat < 1)
+		repeat = 1;
+
+	sr_log_loglevel_set(SR_LOG_WARN);
+	if ((ret = sr_init(&ctx)) != SR_OK) {
+		fprintf(stderr, "sr_init() failed: %s.\n", sr_strerror(ret));
+		return 1;
+	}
+	if (!(tmpdir = g_dir_make_tmp("sigrok-bench-XXXXXX", &error))) {
+		fprintf(stderr, "%s\n", error->message);
+		g_error_free(error);
+		sr_exit(ctx);
+		return 1;
+	}
+
+	json = g_string_new("{\n");
+	g_string_append_printf(json, "\t\"libsigrok\": \"%s\",\n",
+		sr_lib_version_string_get());
+	g_string_append_printf(json, "\t\"repeat\": %d,\n", repeat);
+	g_string_append(json, "\t\"benchmarks\": [");
+
+	failed = 0;
+	first = TRUE;
+	for (i = 0; i < ARRAY_SIZE(cases); i++) {
+		bc = &cases[i];
+		if (filter && !strstr(bc->name, filter))
+			continue;
+		samples = MAX(bc->samples * scale, 1);
+
+		ret = SR_OK;
+		memset(&best, 0, sizeof(best));
+		for (r = 0; r < repeat && ret == SR_OK; r++) {
+			/* Every run sees the same data. */
+			rnd_state = 0x5eed0000 + i;
+			memset(&res, 0, sizeof(res));
+			ret = bc->run(bc, samples, &res);
+			if (r == 0 || res.seconds < best.seconds)
+				best = res;
+		}
+		if (ret == SR_ERR_NA) {
+			fprintf(stderr, "%-24s not available, skipped\n", bc->name);
+			continue;
+		}
+		if (ret != SR_OK) {
+			fprintf(stderr, "%-24s failed: %s\n", bc->name,
+				sr_strerror(ret));
+			failed++;
+			continue;
+		}
+		best.seconds = MAX(best.seconds, 1e-6);
+
+		fprintf(stderr, "%-24s %10.3f Msamples/s %10.3f MB/s\n",
+			bc->name, best.samples / best.seconds / 1e6,
+			best.bytes / best.seconds / 1e6);
+		g_string_append_printf(json, "%s\n\t\t{ \"name\": \"%s\", "
+			"\"samples\": %" PRIu64 ", \"bytes\": %" PRIu64 ", "
+			"\"seconds\": %.6f, \"samples_per_sec\": %.0f, "
+			"\"bytes_per_sec\": %.0f }",
+			first ? "" : ",", bc->name, best.samples, best.bytes,
+			best.seconds, best.samples / best.seconds,
+			best.bytes / best.seconds);
+		first = FALSE;
+	}
+	g_string_append(json, "\n\t]\n}\n");
+
+	if (output) {
+		if (!g_file_set_contents(output, json->str, json->len, &error)) {
+			fprintf(stderr, "%s\n", error->message);
+			g_error_free(error);
+			failed++;
+		}
+	} else {
+		fputs(json->str, stdout);
+	}
+	g_string_free(json, TRUE);
+
+	for (i = 0; i < ARRAY_SIZE(demo_sdi); i++) {
+		if (demo_sdi[i])
+			sr_dev_close(demo_sdi[i]);
+	}
+	g_rmdir(tmpdir);
+	g_free(tmpdir);
+	g_free(filter);
+	g_free(output);
+	sr_exit(ctx);
+
+	return failed ? 1 : 0;
+}
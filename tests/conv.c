@@ -268,6 +268,175 @@ START_TEST(test_endian_write_inc)
 }
 END_TEST
 
+/*
+ * Check the analog-to-logic conversion of integer encoded input (raw
+ * compares) against float input of the same values, and the storage
+ * in a single bit of logic data.
+ */
+START_TEST(test_a2l_threshold)
+{
+	const size_t num_samples = 45;
+	struct sr_channel ch;
+	struct sr_datafeed_analog analog;
+	struct sr_analog_encoding encoding;
+	struct sr_analog_meaning meaning;
+	struct sr_datafeed_logic logic;
+	uint8_t raw[45 * sizeof(int16_t)];
+	float values[45];
+	uint8_t levels[45], expect[45], data[45 * 2], state;
+	size_t idx;
+	int value, ret;
+
+	for (idx = 0; idx < num_samples; idx++) {
+		value = (int)idx * 1234 - 27000;
+		WL16(&raw[2 * idx], value);
+		values[idx] = value / 100.0;
+	}
+
+	memset(&analog, 0, sizeof(analog));
+	memset(&encoding, 0, sizeof(encoding));
+	memset(&meaning, 0, sizeof(meaning));
+	analog.encoding = &encoding;
+	analog.meaning = &meaning;
+	analog.num_samples = num_samples;
+	analog.data = raw;
+	meaning.channels = g_slist_append(NULL, &ch);
+	encoding.unitsize = sizeof(int16_t);
+	encoding.is_signed = TRUE;
+	encoding.scale.p = 1;
+	encoding.scale.q = 100;
+	encoding.offset.q = 1;
+
+	for (idx = 0; idx < num_samples; idx++)
+		expect[idx] = values[idx] >= 12.34f;
+	ret = sr_a2l_threshold(&analog, 12.34, levels, num_samples);
+	fail_unless(ret == SR_OK, "sr_a2l_threshold() failed: %d", ret);
+	fail_unless(memcmp(levels, expect, num_samples) == 0);
+
+	memset(data, 0x5a, sizeof(data));
+	logic.length = sizeof(data);
+	logic.unitsize = 2;
+	logic.data = data;
+	ret = sr_a2l_threshold_logic(&analog, 12.34, &logic, 9, num_samples);
+	fail_unless(ret == SR_OK, "sr_a2l_threshold_logic() failed: %d", ret);
+	for (idx = 0; idx < num_samples; idx++) {
+		fail_unless(data[2 * idx] == 0x5a);
+		fail_unless(data[2 * idx + 1] == (expect[idx] ? 0x5a : 0x58),
+			"sample %zu: 0x%02x", idx, data[2 * idx + 1]);
+	}
+	ret = sr_a2l_threshold_logic(&analog, 12.34, &logic, 16, num_samples);
+	fail_unless(ret == SR_ERR_ARG);
+
+	state = 1;
+	for (idx = 0; idx < num_samples; idx++) {
+		if (values[idx] < -100.0f)
+			state = 0;
+		else if (values[idx] > 100.0f)
+			state = 1;
+		expect[idx] = state;
+	}
+	state = 1;
+	ret = sr_a2l_schmitt_trigger(&analog, -100.0, 100.0, &state,
+		levels, num_samples);
+	fail_unless(ret == SR_OK, "sr_a2l_schmitt_trigger() failed: %d", ret);
+	fail_unless(memcmp(levels, expect, num_samples) == 0);
+	fail_unless(state == expect[num_samples - 1]);
+
+	/* Same values in float encoding take the non-raw code path. */
+	analog.data = values;
+	encoding.unitsize = sizeof(float);
+	encoding.is_float = TRUE;
+#ifdef WORDS_BIGENDIAN
+	encoding.is_bigendian = TRUE;
+#endif
+	encoding.scale.q = 1;
+	state = 1;
+	ret = sr_a2l_schmitt_trigger(&analog, -100.0, 100.0, &state,
+		levels, num_samples);
+	fail_unless(ret == SR_OK, "sr_a2l_schmitt_trigger() failed: %d", ret);
+	fail_unless(memcmp(levels, expect, num_samples) == 0);
+
+	g_slist_free(meaning.channels);
+}
+END_TEST
+
+/* Find the first sample which differs from its predecessor, bit by bit. */
+static size_t ref_find_change(const uint8_t *data, size_t count,
+		size_t unitsize, const uint8_t *prev)
+{
+	size_t i;
+
+	if (!prev || memcmp(data, prev, unitsize))
+		return 0;
+	for (i = 1; i < count; i++) {
+		if (memcmp(&data[i * unitsize], &data[(i - 1) * unitsize],
+				unitsize))
+			return i;
+	}
+
+	return count;
+}
+
+#define FIND_CHANGE_BYTES	160
+
+/*
+ * Check the search for changed logic samples at every alignment of the
+ * data, for unit sizes up to 16 bytes, with the change at every sample
+ * and in every byte of the sample. The data spans several blocks of
+ * the 32-byte vector and the 8-byte word comparisons, and their tails.
+ */
+START_TEST(test_logic_find_change)
+{
+	static const size_t unitsizes[] = { 1, 2, 3, 4, 5, 6, 7, 8, 9, 16 };
+	uint8_t buf[FIND_CHANGE_BYTES + 16 + 16], *data, base[16], xor[16];
+	size_t u, unitsize, align, count, change, i, idx, expect;
+
+	for (i = 0; i < sizeof(base); i++)
+		base[i] = 0x5a + 17 * i;
+	for (u = 0; u < ARRAY_SIZE(unitsizes); u++) {
+		unitsize = unitsizes[u];
+		for (align = 0; align < 16; align++) {
+			data = &buf[align];
+			for (count = 1; count * unitsize <= FIND_CHANGE_BYTES; count++) {
+				for (change = 0; change <= count; change++) {
+					for (i = 0; i < count; i++)
+						memcpy(&data[i * unitsize], base, unitsize);
+					/* Bytes after the data must not matter. */
+					memset(&data[count * unitsize], 0xff, 16);
+					if (change < count) {
+						for (i = change; i < count; i++)
+							data[i * unitsize + change % unitsize] ^=
+								1 << (change % 8);
+					}
+					expect = ref_find_change(data, count, unitsize, base);
+					fail_unless(expect == change);
+
+					memset(xor, 0, sizeof(xor));
+					idx = sr_logic_find_change(data, count, unitsize,
+						base, xor);
+					fail_unless(idx == expect, "Unit size %zu, "
+						"offset %zu, %zu samples: change at "
+						"%zu, not %zu.", unitsize, align,
+						count, idx, expect);
+					for (i = 0; i < unitsize; i++) {
+						fail_unless(xor[i] == (change < count &&
+							i == change % unitsize ?
+							1 << (change % 8) : 0));
+					}
+
+					/* Without a previous sample, the first one changed. */
+					idx = sr_logic_find_change(data, count, unitsize,
+						NULL, NULL);
+					fail_unless(idx == 0);
+				}
+			}
+		}
+	}
+
+	fail_unless(sr_logic_find_change(buf, 0, 1, base, NULL) == 0);
+}
+END_TEST
+
 Suite *suite_conv(void)
 {
 	Suite *s;
@@ -284,5 +453,14 @@ Suite *suite_conv(void)
 	tcase_add_test(tc, test_endian_write_inc);
 	suite_add_tcase(s, tc);
 
+	tc = tcase_create("a2l");
+	tcase_add_test(tc, test_a2l_threshold);
+	suite_add_tcase(s, tc);
+
+	tc = tcase_create("logic");
+	tcase_set_timeout(tc, 0);
+	tcase_add_test(tc, test_logic_find_change);
+	suite_add_tcase(s, tc);
+
 	return s;
 }
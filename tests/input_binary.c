@@ -18,6 +18,7 @@
  */
 
 #include <config.h>
+#include <string.h>
 #include <check.h>
 #include <glib/gstdio.h>
 #include <libsigrok/libsigrok.h>
@@ -29,6 +30,7 @@ enum {
 	CHECK_ALL_LOW,
 	CHECK_ALL_HIGH,
 	CHECK_HELLO_WORLD,
+	CHECK_DATA,
 };
 
 static uint64_t df_packet_counter = 0, sample_counter = 0;
@@ -37,6 +39,7 @@ static GArray *logic_channellist = NULL;
 static int check_to_perform;
 static uint64_t expected_samples;
 static uint64_t *expected_samplerate;
+static const uint8_t *expected_data;
 
 static void check_all_low(const struct sr_datafeed_logic *logic)
 {
@@ -76,6 +79,17 @@ static void check_hello_world(const struct sr_datafeed_logic *logic)
 	}
 }
 
+/* Compare the samples against the data which was sent. */
+static void check_data(const struct sr_datafeed_logic *logic)
+{
+	const uint8_t *data;
+
+	data = expected_data + sample_counter * logic->unitsize;
+	if (memcmp(logic->data, data, logic->length))
+		fail("Logic data at sample %" PRIu64 " differs.",
+			sample_counter);
+}
+
 static void datafeed_in(const struct sr_dev_inst *sdi,
 	const struct sr_datafeed_packet *packet, void *cb_data)
 {
@@ -158,6 +172,8 @@ static void datafeed_in(const struct sr_dev_inst *sdi,
 			check_all_high(logic);
 		else if (check_to_perform == CHECK_HELLO_WORLD)
 			check_hello_world(logic);
+		else if (check_to_perform == CHECK_DATA)
+			check_data(logic);
 
 		sample_counter += logic->length / logic->unitsize;
 
@@ -308,6 +324,70 @@ START_TEST(test_input_binary_hello_world)
 }
 END_TEST
 
+/*
+ * Feed borrowed data in blocks of varying size, which split samples
+ * of more than one byte, see sr_input_send_data().
+ */
+START_TEST(test_input_binary_send_data)
+{
+	static const int numchannels[] = { 16, 24 };
+	int ret;
+	struct sr_input *in;
+	struct sr_session *session;
+	struct sr_dev_inst *sdi;
+	GHashTable *options;
+	uint8_t *buf;
+	size_t offset, len, idx, unitsize;
+
+	buf = g_malloc(BUFSIZE);
+	for (offset = 0; offset < BUFSIZE; offset++)
+		buf[offset] = offset * 7 + offset / 251;
+
+	for (idx = 0; idx < ARRAY_SIZE(numchannels); idx++) {
+		unitsize = (numchannels[idx] + 7) / 8;
+		df_packet_counter = sample_counter = 0;
+		have_seen_df_end = FALSE;
+		logic_channellist = NULL;
+		check_to_perform = CHECK_DATA;
+		expected_samples = BUFSIZE / unitsize;
+		expected_samplerate = NULL;
+		expected_data = buf;
+
+		options = g_hash_table_new_full(g_str_hash, g_str_equal,
+			g_free, (GDestroyNotify)g_variant_unref);
+		g_hash_table_insert(options, g_strdup("numchannels"),
+			g_variant_ref_sink(g_variant_new_int32(numchannels[idx])));
+		in = sr_input_new(sr_input_find("binary"), options);
+		g_hash_table_destroy(options);
+		fail_unless(in != NULL, "Failed to create input instance.");
+
+		sr_session_new(srtest_ctx, &session);
+		sr_session_datafeed_callback_add(session, datafeed_in, NULL);
+
+		sdi = NULL;
+		for (offset = 0, len = 1; offset < BUFSIZE;
+				offset += len, len *= 7) {
+			len = MIN(len, BUFSIZE - offset);
+			ret = sr_input_send_data(in, buf + offset, len);
+			fail_unless(ret == SR_OK,
+				"sr_input_send_data() error: %d", ret);
+			if (!sdi && (sdi = sr_input_dev_inst_get(in)))
+				sr_session_dev_add(session, sdi);
+		}
+		ret = sr_input_end(in);
+		fail_unless(ret == SR_OK, "sr_input_end() error: %d", ret);
+		fail_unless(have_seen_df_end,
+			"No SR_DF_END packet was received.");
+		fail_unless(sample_counter == expected_samples);
+
+		sr_input_free(in);
+		sr_session_destroy(session);
+	}
+
+	g_free(buf);
+}
+END_TEST
+
 Suite *suite_input_binary(void)
 {
 	Suite *s;
@@ -321,6 +401,7 @@ Suite *suite_input_binary(void)
 	tcase_add_test(tc, test_input_binary_all_high);
 	tcase_add_loop_test(tc, test_input_binary_all_high_loop, 1, 10);
 	tcase_add_test(tc, test_input_binary_hello_world);
+	tcase_add_test(tc, test_input_binary_send_data);
 	suite_add_tcase(s, tc);
 
 	return s;
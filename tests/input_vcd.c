@@ -0,0 +1,226 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * Copyright (C) 2026 The sigrok project developers
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+#include <check.h>
+#include <libsigrok/libsigrok.h>
+#include <string.h>
+#include "lib.h"
+
+struct vcd_feed {
+	GByteArray *data;
+	unsigned int unitsize;
+	gboolean seen_end;
+};
+
+static void vcd_feed_cb(const struct sr_dev_inst *sdi,
+		const struct sr_datafeed_packet *packet, void *cb_data)
+{
+	struct vcd_feed *feed;
+	const struct sr_datafeed_logic *logic;
+
+	(void)sdi;
+
+	feed = cb_data;
+	fail_unless(!feed->seen_end, "Packet after SR_DF_END.");
+	if (packet->type == SR_DF_END) {
+		feed->seen_end = TRUE;
+		return;
+	}
+	if (packet->type != SR_DF_LOGIC)
+		return;
+
+	logic = packet->payload;
+	fail_unless(!feed->unitsize || feed->unitsize == logic->unitsize);
+	feed->unitsize = logic->unitsize;
+	g_byte_array_append(feed->data, logic->data, logic->length);
+}
+
+/*
+ * Import one single-bit signal per identifier, named "s<index>". Extra
+ * string signals get ignored, values for undeclared identifiers must
+ * not change any channel. Timestamp #0 sets all signals low, timestamp
+ * #N sets signal N-1 high and the previous signal low. This results in
+ * one sample per timestamp, with every signal that shares the recent
+ * identifier high.
+ */
+static void vcd_check(const char **ids, size_t count,
+		const char **ignored, size_t ignored_count,
+		const char **undeclared, size_t undeclared_count)
+{
+	struct sr_input *in;
+	struct sr_session *session;
+	struct sr_dev_inst *sdi;
+	struct sr_channel *ch;
+	struct vcd_feed feed;
+	GString *text;
+	GSList *l;
+	const uint8_t *sample;
+	char *name;
+	size_t idx, t, unitsize;
+	gboolean bit, expected;
+	int ret;
+
+	text = g_string_new("$timescale 1 ns $end\n$scope module top $end\n");
+	for (idx = 0; idx < count; idx++)
+		g_string_append_printf(text, "$var wire 1 %s s%zu $end\n",
+			ids[idx], idx);
+	for (idx = 0; idx < ignored_count; idx++)
+		g_string_append_printf(text, "$var string 1 %s str%zu $end\n",
+			ignored[idx], idx);
+	g_string_append(text, "$upscope $end\n$enddefinitions $end\n#0\n");
+	for (idx = 0; idx < count; idx++)
+		g_string_append_printf(text, "0%s\n", ids[idx]);
+	for (idx = 0; idx < ignored_count; idx++)
+		g_string_append_printf(text, "stext %s\n", ignored[idx]);
+	for (idx = 0; idx < undeclared_count; idx++)
+		g_string_append_printf(text, "1%s\n", undeclared[idx]);
+	for (t = 1; t <= count; t++) {
+		g_string_append_printf(text, "#%zu\n", t);
+		if (t > 1)
+			g_string_append_printf(text, "0%s\n", ids[t - 2]);
+		g_string_append_printf(text, "1%s\n", ids[t - 1]);
+	}
+
+	in = sr_input_new(sr_input_find("vcd"), NULL);
+	fail_unless(in != NULL, "Failed to create input instance.");
+	feed.data = g_byte_array_new();
+	feed.unitsize = 0;
+	feed.seen_end = FALSE;
+	sr_session_new(srtest_ctx, &session);
+	sr_session_datafeed_callback_add(session, vcd_feed_cb, &feed);
+
+	ret = sr_input_send(in, text);
+	fail_unless(ret == SR_OK, "sr_input_send() error: %d", ret);
+	sdi = sr_input_dev_inst_get(in);
+	fail_unless(sdi != NULL, "VCD header not accepted.");
+	sr_session_dev_add(session, sdi);
+	ret = sr_input_end(in);
+	fail_unless(ret == SR_OK, "sr_input_end() error: %d", ret);
+	fail_unless(feed.seen_end, "No SR_DF_END packet was received.");
+
+	/* Logic channels in the order of declaration, strings ignored. */
+	idx = 0;
+	for (l = sr_dev_inst_channels_get(sdi); l; l = l->next) {
+		ch = l->data;
+		fail_unless(idx < count, "Unexpected channel %s.", ch->name);
+		name = g_strdup_printf("top.s%zu", idx);
+		fail_unless(ch->type == SR_CHANNEL_LOGIC);
+		fail_unless(ch->index == (int)idx);
+		fail_unless(strcmp(ch->name, name) == 0,
+			"Channel %zu: expected %s, got %s.",
+			idx, name, ch->name);
+		g_free(name);
+		idx++;
+	}
+	fail_unless(idx == count, "Expected %zu channels, got %zu.",
+		count, idx);
+
+	unitsize = (count + 7) / 8;
+	fail_unless(feed.unitsize == unitsize);
+	fail_unless(feed.data->len == (count + 1) * unitsize,
+		"Expected %zu samples, got %u bytes.",
+		count + 1, feed.data->len);
+	for (t = 0; t <= count; t++) {
+		sample = feed.data->data + t * unitsize;
+		for (idx = 0; idx < count; idx++) {
+			bit = (sample[idx / 8] >> (idx % 8)) & 1;
+			expected = t && strcmp(ids[idx], ids[t - 1]) == 0;
+			fail_unless(bit == expected,
+				"Sample %zu, identifier '%s': %d, expected %d.",
+				t, ids[idx], bit, expected);
+		}
+	}
+
+	sr_input_free(in);
+	sr_session_destroy(session);
+	g_byte_array_free(feed.data, TRUE);
+	g_string_free(text, TRUE);
+}
+
+/*
+ * Codes of up to three chars directly index the identifier table, the
+ * '!' and '~' chars are the first and last digits. Four and more chars
+ * get looked up by name. "!!" is shared by two signals.
+ */
+START_TEST(test_input_vcd_ident_edges)
+{
+	static const char *ids[] = {
+		"!", "~", "!!", "~~", "!~", "~!", "!!!", "~~~", "~!~",
+		"!!!!", "~~~~", "!!!~", "!!",
+	};
+	static const char *ignored[] = { "~~!", "!!~!" };
+	static const char *undeclared[] = { "#", "!!#", "~~}", "!!!!!", "~!!!" };
+
+	vcd_check(ids, ARRAY_SIZE(ids), ignored, ARRAY_SIZE(ignored),
+		undeclared, ARRAY_SIZE(undeclared));
+}
+END_TEST
+
+/*
+ * Generators typically assign identifiers in ascending order, starting
+ * at '!'. Counting up in bijective base 94 carries from "~" to "!!".
+ */
+START_TEST(test_input_vcd_ident_ascending)
+{
+	const char **ids;
+	char *id;
+	size_t count, idx, code, len;
+
+	count = 94 + 94 * 3;
+	ids = g_malloc0_n(count, sizeof(*ids));
+	for (idx = 0; idx < count; idx++) {
+		id = g_malloc0(4);
+		code = idx + 1;
+		len = 0;
+		while (code) {
+			code--;
+			memmove(id + 1, id, len++);
+			id[0] = '!' + code % 94;
+			code /= 94;
+		}
+		ids[idx] = id;
+	}
+	fail_unless(strcmp(ids[93], "~") == 0);
+	fail_unless(strcmp(ids[94], "!!") == 0);
+	fail_unless(strcmp(ids[95], "!\"") == 0);
+
+	vcd_check(ids, count, NULL, 0, NULL, 0);
+
+	for (idx = 0; idx < count; idx++)
+		g_free((char *)ids[idx]);
+	g_free(ids);
+}
+END_TEST
+
+Suite *suite_input_vcd(void)
+{
+	Suite *s;
+	TCase *tc;
+
+	s = suite_create("input-vcd");
+
+	tc = tcase_create("ident");
+	tcase_add_checked_fixture(tc, srtest_setup, srtest_teardown);
+	tcase_add_test(tc, test_input_vcd_ident_edges);
+	tcase_add_test(tc, test_input_vcd_ident_ascending);
+	suite_add_tcase(s, tc);
+
+	return s;
+}
@@ -160,3 +160,53 @@ GArray *srtest_get_enabled_logic_channels(const struct sr_dev_inst *sdi)
 
 	return channels;
 }
+
+/*
+ * Get an opened demo device with the given numbers of channels, which
+ * generates all-high logic data and analog square waves, unpaced.
+ */
+struct sr_dev_inst *srtest_demo_get(int num_logic, int num_analog)
+{
+	struct sr_dev_driver *driver;
+	struct sr_config src_logic, src_analog;
+	struct sr_channel_group *cg;
+	struct sr_dev_inst *sdi;
+	GSList *options, *devices, *l;
+	int ret;
+
+	driver = srtest_driver_get("demo");
+	srtest_driver_init(srtest_ctx, driver);
+
+	src_logic.key = SR_CONF_NUM_LOGIC_CHANNELS;
+	src_logic.data = g_variant_new_int32(num_logic);
+	src_analog.key = SR_CONF_NUM_ANALOG_CHANNELS;
+	src_analog.data = g_variant_new_int32(num_analog);
+	options = g_slist_append(NULL, &src_logic);
+	options = g_slist_append(options, &src_analog);
+	devices = sr_driver_scan(driver, options);
+	g_slist_free(options);
+	g_variant_unref(g_variant_ref_sink(src_logic.data));
+	g_variant_unref(g_variant_ref_sink(src_analog.data));
+	fail_unless(devices != NULL, "No demo device found.");
+	sdi = devices->data;
+	g_slist_free(devices);
+
+	ret = sr_dev_open(sdi);
+	fail_unless(ret == SR_OK, "Cannot open demo device: %d.", ret);
+	ret = sr_config_set(sdi, NULL, SR_CONF_TEST_MODE,
+		g_variant_new_string("benchmark"));
+	fail_unless(ret == SR_OK);
+	for (l = sr_dev_inst_channel_groups_get(sdi); l; l = l->next) {
+		cg = l->data;
+		if (!strcmp(cg->name, "Logic"))
+			ret = sr_config_set(sdi, cg, SR_CONF_PATTERN_MODE,
+				g_variant_new_string("all-high"));
+		else if (g_str_has_prefix(cg->name, "A"))
+			ret = sr_config_set(sdi, cg, SR_CONF_PATTERN_MODE,
+				g_variant_new_string("square"));
+		fail_unless(ret == SR_OK, "Cannot set %s pattern: %d.",
+			cg->name, ret);
+	}
+
+	return sdi;
+}
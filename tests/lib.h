@@ -41,10 +41,13 @@ void srtest_check_samplerate(struct sr_context *sr_ctx, const char *drivername,
 
 GArray *srtest_get_enabled_logic_channels(const struct sr_dev_inst *sdi);
 
+struct sr_dev_inst *srtest_demo_get(int num_logic, int num_analog);
+
 Suite *suite_core(void);
 Suite *suite_driver_all(void);
 Suite *suite_input_all(void);
 Suite *suite_input_binary(void);
+Suite *suite_input_vcd(void);
 Suite *suite_output_all(void);
 Suite *suite_transform_all(void);
 Suite *suite_session(void);
@@ -54,5 +57,10 @@ Suite *suite_device(void);
 Suite *suite_trigger(void);
 Suite *suite_analog(void);
 Suite *suite_conv(void);
+Suite *suite_transpose(void);
+Suite *suite_overview(void);
+Suite *suite_packet_pool(void);
+Suite *suite_usb(void);
+Suite *suite_scpi(void);
 
 #endif
@@ -19,9 +19,14 @@
 
 #include <config.h>
 #include <stdlib.h>
+#include <string.h>
+#include <math.h>
 #include <check.h>
+#include <zip.h>
+#include <glib/gstdio.h>
 #include <libsigrok/libsigrok.h>
 #include "lib.h"
+#include "libsigrok-internal.h"
 
 /* Check whether at least one output module is available. */
 START_TEST(test_output_available)
@@ -96,6 +101,795 @@ START_TEST(test_output_options)
 }
 END_TEST
 
+/* Append an output module's text for a packet. */
+static void output_append(const struct sr_output *o,
+		const struct sr_datafeed_packet *packet, GString *text)
+{
+	GString *out;
+	int ret;
+
+	ret = sr_output_send(o, packet, &out);
+	fail_unless(ret == SR_OK, "'%s' output failed: %d.",
+		sr_output_id_get(o->module), ret);
+	if (out) {
+		g_string_append_len(text, out->str, out->len);
+		g_string_free(out, TRUE);
+	}
+}
+
+/* Collect an output module's text for a data packet and the end of the feed. */
+static GString *output_collect(const char *id, GHashTable *params,
+		const struct sr_dev_inst *sdi,
+		const struct sr_datafeed_packet *packet)
+{
+	const struct sr_output *o;
+	struct sr_datafeed_packet end;
+	GString *text;
+
+	o = sr_output_new(sr_output_find((char *)id), params, sdi, NULL);
+	fail_unless(o != NULL, "Cannot create '%s' output.", id);
+
+	text = g_string_new(NULL);
+	output_append(o, packet, text);
+	end.type = SR_DF_END;
+	end.payload = NULL;
+	output_append(o, &end, text);
+	sr_output_free(o);
+
+	return text;
+}
+
+/*
+ * Check that run-length encoded logic data yields the same output as
+ * the expanded data, for output modules which leave the expansion to
+ * the output framework.
+ */
+START_TEST(test_output_logic_rle)
+{
+	static const char *ids[] = { "bits", "csv", };
+	uint8_t values[] = { 0x01, 0x02, 0x02, 0x00, 0x03, };
+	uint64_t lengths[] = { 3, 1, 4, 0, 9, };
+	uint8_t samples[3 + 1 + 4 + 9];
+	struct sr_datafeed_packet packet;
+	struct sr_datafeed_logic logic;
+	struct sr_datafeed_logic_rle rle;
+	struct sr_dev_inst *sdi;
+	GHashTable *params;
+	GString *text_logic, *text_rle;
+	size_t idx, run, pos;
+
+	sdi = sr_dev_inst_user_new("Vendor", "Model", "Version");
+	sr_dev_inst_channel_add(sdi, 0, SR_CHANNEL_LOGIC, "D0");
+	sr_dev_inst_channel_add(sdi, 1, SR_CHANNEL_LOGIC, "D1");
+	params = g_hash_table_new_full(g_str_hash, g_str_equal, NULL,
+		(GDestroyNotify)g_variant_unref);
+
+	pos = 0;
+	for (run = 0; run < ARRAY_SIZE(values); run++) {
+		for (idx = 0; idx < lengths[run]; idx++)
+			samples[pos++] = values[run];
+	}
+	logic.length = sizeof(samples);
+	logic.unitsize = 1;
+	logic.data = samples;
+	rle.num_runs = ARRAY_SIZE(values);
+	rle.unitsize = 1;
+	rle.values = values;
+	rle.lengths = lengths;
+
+	for (idx = 0; idx < ARRAY_SIZE(ids); idx++) {
+		g_hash_table_remove_all(params);
+		if (!strcmp(ids[idx], "csv"))
+			g_hash_table_insert(params, "header",
+				g_variant_ref_sink(g_variant_new_boolean(FALSE)));
+		packet.type = SR_DF_LOGIC;
+		packet.payload = &logic;
+		text_logic = output_collect(ids[idx], params, sdi, &packet);
+		packet.type = SR_DF_LOGIC_RLE;
+		packet.payload = &rle;
+		text_rle = output_collect(ids[idx], params, sdi, &packet);
+		fail_unless(text_logic->len > 0, "No '%s' output.", ids[idx]);
+		fail_unless(g_string_equal(text_logic, text_rle),
+			"'%s' output differs:\n%s\n%s", ids[idx],
+			text_logic->str, text_rle->str);
+		g_string_free(text_logic, TRUE);
+		g_string_free(text_rle, TRUE);
+	}
+
+	g_hash_table_destroy(params);
+}
+END_TEST
+
+/*
+ * VCD text for vcd_feed(), after the header's date and version. Logic
+ * changes and the changes of both analog channels are merged by sample
+ * number. The logic-only output is written without the queue.
+ */
+static const char *vcd_expected_mixed =
+	"$timescale 1 us $end\n"
+	"$scope module libsigrok $end\n"
+	"$var wire 1 ! D0 $end\n"
+	"$var wire 1 \" D1 $end\n"
+	"$var wire 1 # D2 $end\n"
+	"$var real 64 $ A0 $end\n"
+	"$var real 64 % A1 $end\n"
+	"$upscope $end\n"
+	"$enddefinitions $end\n"
+	"\n#0 0! 0\" 0# r0.5 $ r1 %"
+	"\n#2 1! r1.25 $"
+	"\n#3 r-2 $ r2 %"
+	"\n#4 1\""
+	"\n#5 r3 %"
+	"\n#7 0! 0\" 1# r0.1000000014901161 $"
+	"\n#10 1! r7 $"
+	"\n#13 0! 0#"
+	"\n#14 1! 1\" 1#"
+	"\n#15 r9.999999717180685e-10 $"
+	"\n#18 r3 $"
+	"\n#26\n";
+
+static const char *vcd_expected_logic =
+	"$timescale 1 us $end\n"
+	"$scope module libsigrok $end\n"
+	"$var wire 1 ! D0 $end\n"
+	"$var wire 1 \" D1 $end\n"
+	"$var wire 1 # D2 $end\n"
+	"$upscope $end\n"
+	"$enddefinitions $end\n"
+	"\n#0  0! 0\" 0#"
+	"\n#2  1!"
+	"\n#4  1\""
+	"\n#7  0! 0\" 1#"
+	"\n#10  1!"
+	"\n#13  0! 0#"
+	"\n#14  1! 1\" 1#"
+	"\n#18\n";
+
+static void vcd_analog(const struct sr_output *o, struct sr_channel *ch,
+		const float *values, size_t num_samples, GString *text)
+{
+	struct sr_datafeed_packet packet;
+	struct sr_datafeed_analog analog;
+	struct sr_analog_encoding encoding;
+	struct sr_analog_meaning meaning;
+	struct sr_analog_spec spec;
+
+	sr_analog_init(&analog, &encoding, &meaning, &spec, 3);
+	analog.data = (float *)values;
+	analog.num_samples = num_samples;
+	meaning.channels = g_slist_append(NULL, ch);
+	packet.type = SR_DF_ANALOG;
+	packet.payload = &analog;
+	output_append(o, &packet, text);
+	g_slist_free(meaning.channels);
+}
+
+/*
+ * Send logic, run-length encoded logic, and (when enabled) analog data
+ * of two channels with different packet sizes to the VCD output.
+ */
+static GString *vcd_feed(const struct sr_dev_inst *sdi, gboolean with_analog)
+{
+	static const uint8_t logic_data[] = { 0, 0, 1, 1, 3, 3, 3, 4, };
+	static const uint8_t rle_values[] = { 4, 2, 5, 0, 7, };
+	static const uint64_t rle_lengths[] = { 2, 0, 3, 1, 4, };
+	static const float a0_first[] = { 0.5, 0.5, 1.25, -2, };
+	static const float a1_first[] = { 1, 1, 1, 2, 2, 3, };
+	static const float a0_second[] = {
+		-2, -2, -2, 0.1f, 0.1f, 0.1f, 7, 7, 7, 7, 7,
+		1e-9f, 1e-9f, 1e-9f, 3,
+	};
+	float a1_second[20];
+	const struct sr_output *o;
+	struct sr_datafeed_packet packet;
+	struct sr_datafeed_meta meta;
+	struct sr_datafeed_logic logic;
+	struct sr_datafeed_logic_rle rle;
+	struct sr_config src;
+	struct sr_channel *a0, *a1;
+	GString *text;
+	size_t i;
+
+	a0 = g_slist_nth_data(sr_dev_inst_channels_get(sdi), 3);
+	a1 = g_slist_nth_data(sr_dev_inst_channels_get(sdi), 4);
+	for (i = 0; i < ARRAY_SIZE(a1_second); i++)
+		a1_second[i] = 3;
+
+	o = sr_output_new(sr_output_find("vcd"), NULL, sdi, NULL);
+	fail_unless(o != NULL, "Cannot create 'vcd' output.");
+	text = g_string_new(NULL);
+
+	src.key = SR_CONF_SAMPLERATE;
+	src.data = g_variant_new_uint64(SR_MHZ(1));
+	meta.config = g_slist_append(NULL, &src);
+	packet.type = SR_DF_META;
+	packet.payload = &meta;
+	output_append(o, &packet, text);
+	g_slist_free(meta.config);
+	g_variant_unref(g_variant_ref_sink(src.data));
+
+	logic.length = sizeof(logic_data);
+	logic.unitsize = 1;
+	logic.data = (uint8_t *)logic_data;
+	packet.type = SR_DF_LOGIC;
+	packet.payload = &logic;
+	output_append(o, &packet, text);
+	if (with_analog) {
+		vcd_analog(o, a0, a0_first, ARRAY_SIZE(a0_first), text);
+		vcd_analog(o, a1, a1_first, ARRAY_SIZE(a1_first), text);
+	}
+
+	rle.num_runs = ARRAY_SIZE(rle_values);
+	rle.unitsize = 1;
+	rle.values = rle_values;
+	rle.lengths = rle_lengths;
+	packet.type = SR_DF_LOGIC_RLE;
+	packet.payload = &rle;
+	output_append(o, &packet, text);
+	if (with_analog) {
+		vcd_analog(o, a0, a0_second, ARRAY_SIZE(a0_second), text);
+		vcd_analog(o, a1, a1_second, ARRAY_SIZE(a1_second), text);
+	}
+
+	packet.type = SR_DF_END;
+	packet.payload = NULL;
+	output_append(o, &packet, text);
+	sr_output_free(o);
+
+	return text;
+}
+
+/*
+ * Check the VCD output text for mixed signal data and run-length
+ * encoded logic data, and for logic data only.
+ */
+START_TEST(test_output_vcd)
+{
+	struct sr_dev_inst *sdi;
+	struct sr_channel *ch;
+	GString *text;
+	const char *body;
+	GSList *l;
+
+	sdi = sr_dev_inst_user_new("Vendor", "Model", "Version");
+	sr_dev_inst_channel_add(sdi, 0, SR_CHANNEL_LOGIC, "D0");
+	sr_dev_inst_channel_add(sdi, 1, SR_CHANNEL_LOGIC, "D1");
+	sr_dev_inst_channel_add(sdi, 2, SR_CHANNEL_LOGIC, "D2");
+	sr_dev_inst_channel_add(sdi, 3, SR_CHANNEL_ANALOG, "A0");
+	sr_dev_inst_channel_add(sdi, 4, SR_CHANNEL_ANALOG, "A1");
+
+	text = vcd_feed(sdi, TRUE);
+	body = strstr(text->str, "$timescale");
+	fail_unless(body != NULL, "No VCD header:\n%s", text->str);
+	fail_unless(!strcmp(body, vcd_expected_mixed),
+		"Mixed signal VCD differs:\n%s", body);
+	g_string_free(text, TRUE);
+
+	for (l = sr_dev_inst_channels_get(sdi); l; l = l->next) {
+		ch = l->data;
+		if (ch->type == SR_CHANNEL_ANALOG)
+			sr_dev_channel_enable(ch, FALSE);
+	}
+	text = vcd_feed(sdi, FALSE);
+	body = strstr(text->str, "$timescale");
+	fail_unless(body != NULL, "No VCD header:\n%s", text->str);
+	fail_unless(!strcmp(body, vcd_expected_logic),
+		"Logic VCD differs:\n%s", body);
+	g_string_free(text, TRUE);
+
+	sr_dev_inst_free(sdi);
+}
+END_TEST
+
+/*
+ * ASCII text of ascii_feed() after the header, 16 samples per line, with
+ * the characters for low, high, falling and rising.
+ */
+static const char *ascii_expected =
+	"D0:00000r1111111111\n"
+	"D1:0000000000000000\n"
+	"D2:0000000000000000\n"
+	"D4:0000000000000000\n"
+	"D5:0000000000000000\n"
+	"D6:0000000000000000\n"
+	"D7:0000000000000000\n"
+	"D8:00000r1111111111\n"
+	"D9:00000r1111111111\n"
+	"D0:1111111111111111\n"
+	"D1:0000000000000000\n"
+	"D2:0000000000000000\n"
+	"D4:0000000000000000\n"
+	"D5:0000000000000000\n"
+	"D6:0000000000000000\n"
+	"D7:0000000000000000\n"
+	"D8:1111111111111111\n"
+	"D9:1111111111111111\n"
+	" T:    ^ 4\n"
+	"D0:1111111111f00000\n"
+	"D1:0000000000000000\n"
+	"D2:0000000000r11111\n"
+	"D4:0000000000000000\n"
+	"D5:0000000000000000\n"
+	"D6:0000000000000000\n"
+	"D7:0000000000000000\n"
+	"D8:1111111111f00000\n"
+	"D9:1111111111111111\n"
+	"D0:000000000000rfrf\n"
+	"D1:0000000000000000\n"
+	"D2:111111111111f000\n"
+	"D4:0000000000000000\n"
+	"D5:0000000000000000\n"
+	"D6:0000000000000000\n"
+	"D7:0000000000000rfr\n"
+	"D8:0000000000000000\n"
+	"D9:1111111111111frf\n"
+	"D0:1frfrfrfrfrfrf\n"
+	"D1:00000000000000\n"
+	"D2:00000000000000\n"
+	"D4:00000000000000\n"
+	"D5:00000000000000\n"
+	"D6:00000000000000\n"
+	"D7:0rfrfrfrfrfrfr\n"
+	"D8:00000000000000\n"
+	"D9:1frfrfrfrfrfrf\n";
+
+/*
+ * Send runs of unchanged samples which span line breaks, packets and a
+ * trigger, and samples which change all the time, to the ASCII output.
+ * D3 is disabled.
+ */
+static GString *ascii_feed(const struct sr_dev_inst *sdi)
+{
+	uint16_t first[48], second[30];
+	const struct sr_output *o;
+	struct sr_datafeed_packet packet;
+	struct sr_datafeed_logic logic;
+	GHashTable *params;
+	GString *text;
+	size_t i;
+
+	for (i = 0; i < ARRAY_SIZE(first); i++)
+		first[i] = i < 5 ? 0x0000 : i < 42 ? 0x0301 : 0x020c;
+	for (i = 0; i < ARRAY_SIZE(second); i++)
+		second[i] = i < 12 ? 0x020c : (i & 1) ? 0x0080 : 0x0201;
+
+	params = g_hash_table_new_full(g_str_hash, g_str_equal, NULL,
+		(GDestroyNotify)g_variant_unref);
+	g_hash_table_insert(params, "width",
+		g_variant_ref_sink(g_variant_new_uint32(16)));
+	g_hash_table_insert(params, "charset",
+		g_variant_ref_sink(g_variant_new_string("01fr")));
+	o = sr_output_new(sr_output_find("ascii"), params, sdi, NULL);
+	fail_unless(o != NULL, "Cannot create 'ascii' output.");
+	g_hash_table_destroy(params);
+	text = g_string_new(NULL);
+
+	logic.unitsize = sizeof(first[0]);
+	packet.type = SR_DF_LOGIC;
+	packet.payload = &logic;
+	logic.length = 20 * sizeof(first[0]);
+	logic.data = first;
+	output_append(o, &packet, text);
+	packet.type = SR_DF_TRIGGER;
+	output_append(o, &packet, text);
+	packet.type = SR_DF_LOGIC;
+	logic.length = sizeof(first) - 20 * sizeof(first[0]);
+	logic.data = &first[20];
+	output_append(o, &packet, text);
+	logic.length = sizeof(second);
+	logic.data = second;
+	output_append(o, &packet, text);
+	packet.type = SR_DF_END;
+	packet.payload = NULL;
+	output_append(o, &packet, text);
+	sr_output_free(o);
+
+	return text;
+}
+
+/* Check the ASCII output's skipping of unchanged samples. */
+START_TEST(test_output_ascii)
+{
+	struct sr_dev_inst *sdi;
+	GString *text;
+	const char *body;
+	char name[4];
+	int i;
+
+	sdi = sr_dev_inst_user_new("Vendor", "Model", "Version");
+	for (i = 0; i < 10; i++) {
+		snprintf(name, sizeof(name), "D%d", i);
+		sr_dev_inst_channel_add(sdi, i, SR_CHANNEL_LOGIC, name);
+	}
+	sr_dev_channel_enable(g_slist_nth_data(sr_dev_inst_channels_get(sdi), 3),
+		FALSE);
+
+	text = ascii_feed(sdi);
+	body = strstr(text->str, "D0:");
+	fail_unless(body != NULL, "No ASCII data:\n%s", text->str);
+	fail_unless(!strcmp(body, ascii_expected),
+		"ASCII output differs:\n%s", body);
+	g_string_free(text, TRUE);
+
+	sr_dev_inst_free(sdi);
+}
+END_TEST
+
+/* Packet sizes of the srzip tests' captures. */
+static const size_t srzip_lengths[] = { 1000, 1, 25000, 7 };
+
+static size_t srzip_total(void)
+{
+	size_t idx, total;
+
+	total = 0;
+	for (idx = 0; idx < ARRAY_SIZE(srzip_lengths); idx++)
+		total += srzip_lengths[idx];
+
+	return total;
+}
+
+/* Logic samples which only use the lower seven channels. */
+static uint8_t *srzip_logic_samples(size_t total)
+{
+	uint8_t *samples;
+	size_t pos;
+
+	samples = g_malloc(total);
+	for (pos = 0; pos < total; pos++)
+		samples[pos] = (pos * 7 + pos / 100) & 0x7f;
+
+	return samples;
+}
+
+/* Analog samples with a range of NaN values, which overviews ignore. */
+static float *srzip_analog_samples(size_t total)
+{
+	float *values;
+	size_t pos;
+
+	values = g_malloc(total * sizeof(*values));
+	for (pos = 0; pos < total; pos++) {
+		values[pos] = (float)((pos * 13) % 1000) / 10 - 50;
+		if (pos >= 200 && pos < 300)
+			values[pos] = NAN;
+	}
+
+	return values;
+}
+
+/*
+ * Write a session file with eight logic channels and one analog
+ * channel, using the srzip output module. Optionally store an overview.
+ */
+static void srzip_write(const char *filename, const uint8_t *samples,
+		const float *values, gboolean overview)
+{
+	struct sr_datafeed_packet packet;
+	struct sr_datafeed_meta meta;
+	struct sr_datafeed_logic logic;
+	struct sr_datafeed_analog analog;
+	struct sr_analog_encoding encoding;
+	struct sr_analog_meaning meaning;
+	struct sr_analog_spec spec;
+	struct sr_config src;
+	const struct sr_output *o;
+	struct sr_dev_inst *sdi;
+	GHashTable *params;
+	GString *out;
+	char *name;
+	size_t idx, pos;
+
+	sdi = sr_dev_inst_user_new("Vendor", "Model", "Version");
+	for (idx = 0; idx < 8; idx++) {
+		name = g_strdup_printf("D%zu", idx);
+		sr_dev_inst_channel_add(sdi, idx, SR_CHANNEL_LOGIC, name);
+		g_free(name);
+	}
+	sr_dev_inst_channel_add(sdi, 8, SR_CHANNEL_ANALOG, "A0");
+
+	memset(&analog, 0, sizeof(analog));
+	memset(&encoding, 0, sizeof(encoding));
+	memset(&meaning, 0, sizeof(meaning));
+	memset(&spec, 0, sizeof(spec));
+	analog.encoding = &encoding;
+	analog.meaning = &meaning;
+	analog.spec = &spec;
+	encoding.unitsize = sizeof(float);
+	encoding.is_float = TRUE;
+#ifdef WORDS_BIGENDIAN
+	encoding.is_bigendian = TRUE;
+#endif
+	encoding.is_signed = TRUE;
+	encoding.scale.p = encoding.scale.q = 1;
+	encoding.offset.q = 1;
+	meaning.channels = g_slist_append(NULL,
+		g_slist_last(sr_dev_inst_channels_get(sdi))->data);
+
+	params = g_hash_table_new_full(g_str_hash, g_str_equal, NULL,
+		(GDestroyNotify)g_variant_unref);
+	g_hash_table_insert(params, "overview",
+		g_variant_ref_sink(g_variant_new_boolean(overview)));
+	o = sr_output_new(sr_output_find("srzip"), params, sdi, filename);
+	g_hash_table_destroy(params);
+	fail_unless(o != NULL, "Cannot create 'srzip' output.");
+	src.key = SR_CONF_SAMPLERATE;
+	src.data = g_variant_ref_sink(g_variant_new_uint64(SR_MHZ(1)));
+	meta.config = g_slist_append(NULL, &src);
+	packet.type = SR_DF_META;
+	packet.payload = &meta;
+	fail_unless(sr_output_send(o, &packet, &out) == SR_OK);
+	g_slist_free(meta.config);
+	g_variant_unref(src.data);
+	pos = 0;
+	for (idx = 0; idx < ARRAY_SIZE(srzip_lengths); idx++) {
+		logic.length = srzip_lengths[idx];
+		logic.unitsize = 1;
+		logic.data = (uint8_t *)samples + pos;
+		packet.type = SR_DF_LOGIC;
+		packet.payload = &logic;
+		fail_unless(sr_output_send(o, &packet, &out) == SR_OK);
+		analog.num_samples = srzip_lengths[idx];
+		analog.data = (float *)values + pos;
+		packet.type = SR_DF_ANALOG;
+		packet.payload = &analog;
+		fail_unless(sr_output_send(o, &packet, &out) == SR_OK);
+		pos += srzip_lengths[idx];
+	}
+	packet.type = SR_DF_END;
+	packet.payload = NULL;
+	fail_unless(sr_output_send(o, &packet, &out) == SR_OK);
+	sr_output_free(o);
+	g_slist_free(meaning.channels);
+}
+
+static gboolean same_value(float a, float b)
+{
+	return a == b || (isnan(a) && isnan(b));
+}
+
+/*
+ * Check random access reads and overviews of a session file which
+ * srzip_write() wrote, against the samples.
+ */
+static void srzip_check(struct sr_session_file *sf, const uint8_t *samples,
+		const float *values, size_t total)
+{
+	static const size_t bin_counts[] = { 1, 7, 100 };
+	uint8_t buf[100], bits_or[100], bits_and[100];
+	float fbuf[100], min[100], max[100], ref_min, ref_max;
+	uint64_t samplerate, count, num_read, pos, first, end, s;
+	unsigned int unitsize, num_analog;
+	size_t idx, bin, num_bins;
+	int ret;
+
+	sr_session_file_get_info(sf, &samplerate, &unitsize, &num_analog);
+	fail_unless(samplerate == SR_MHZ(1) && unitsize == 1 && num_analog == 1);
+	ret = sr_session_file_get_num_samples(sf, SR_CHANNEL_LOGIC, 0, &count);
+	fail_unless(ret == SR_OK && count == total);
+	ret = sr_session_file_get_num_samples(sf, SR_CHANNEL_ANALOG, 0, &count);
+	fail_unless(ret == SR_OK && count == total);
+	ret = sr_session_file_get_num_samples(sf, SR_CHANNEL_ANALOG, 1, &count);
+	fail_unless(ret == SR_ERR_ARG);
+
+	/* Reads near the end get truncated. */
+	for (pos = 0; pos < total; pos += 997) {
+		ret = sr_session_file_read_logic(sf, pos, sizeof(buf),
+			buf, &num_read);
+		fail_unless(ret == SR_OK);
+		fail_unless(num_read == MIN(sizeof(buf), total - pos));
+		fail_unless(!memcmp(buf, samples + pos, num_read),
+			"Wrong samples read at %" PRIu64 ".", pos);
+		ret = sr_session_file_read_analog(sf, 0, pos,
+			ARRAY_SIZE(fbuf), fbuf, &num_read);
+		fail_unless(ret == SR_OK);
+		fail_unless(num_read == MIN(ARRAY_SIZE(fbuf), total - pos));
+		for (idx = 0; idx < num_read; idx++)
+			fail_unless(same_value(fbuf[idx], values[pos + idx]),
+				"Wrong analog sample read at %" PRIu64 ".",
+				pos + idx);
+	}
+	ret = sr_session_file_read_analog(sf, 1, 0, ARRAY_SIZE(fbuf),
+		fbuf, &num_read);
+	fail_unless(ret == SR_ERR_ARG);
+
+	ret = sr_session_file_logic_overview(sf, 0, total, 1,
+		bits_or, bits_and);
+	fail_unless(ret == SR_OK && bits_or[0] == 0x7f && bits_and[0] == 0x00);
+	ret = sr_session_file_logic_overview(sf, 3, 4, 4, bits_or, bits_and);
+	fail_unless(ret == SR_OK);
+	for (idx = 0; idx < 4; idx++) {
+		fail_unless(bits_or[idx] == samples[3 + idx]);
+		fail_unless(bits_and[idx] == samples[3 + idx]);
+	}
+	ret = sr_session_file_logic_overview(sf, total - 1, 2, 1,
+		bits_or, bits_and);
+	fail_unless(ret == SR_ERR_ARG);
+
+	/* Analog bins of (nearly) equal size, ignoring NaN values. */
+	for (idx = 0; idx < ARRAY_SIZE(bin_counts); idx++) {
+		num_bins = bin_counts[idx];
+		ret = sr_session_file_analog_overview(sf, 0, 0, total,
+			num_bins, min, max);
+		fail_unless(ret == SR_OK);
+		for (bin = 0; bin < num_bins; bin++) {
+			first = total / num_bins * bin +
+				total % num_bins * bin / num_bins;
+			end = total / num_bins * (bin + 1) +
+				total % num_bins * (bin + 1) / num_bins;
+			ref_min = INFINITY;
+			ref_max = -INFINITY;
+			for (s = first; s < end; s++) {
+				if (isnan(values[s]))
+					continue;
+				ref_min = MIN(ref_min, values[s]);
+				ref_max = MAX(ref_max, values[s]);
+			}
+			fail_unless(min[bin] == ref_min && max[bin] == ref_max,
+				"%zu bins, bin %zu: %f..%f, not %f..%f.",
+				num_bins, bin, min[bin], max[bin],
+				ref_min, ref_max);
+		}
+	}
+	ret = sr_session_file_analog_overview(sf, 0, 200, 100, 2, min, max);
+	fail_unless(ret == SR_OK);
+	fail_unless(isnan(min[0]) && isnan(max[0]));
+	fail_unless(isnan(min[1]) && isnan(max[1]));
+	ret = sr_session_file_analog_overview(sf, 1, 0, total, 1, min, max);
+	fail_unless(ret == SR_ERR_ARG);
+	ret = sr_session_file_analog_overview(sf, 0, total - 1, 2, 1, min, max);
+	fail_unless(ret == SR_ERR_ARG);
+}
+
+/*
+ * Check that session files written by the srzip output module can be
+ * read at random positions, and that overviews match the samples. The
+ * overview is either stored in the file, or created when requested.
+ */
+START_TEST(test_output_srzip_random_access)
+{
+	static const gboolean with_overview[] = { TRUE, FALSE };
+	struct sr_session_file *sf;
+	struct sr_overview *ov;
+	struct zip *archive;
+	uint8_t *samples, bits_or[1], bits_and[1], bits_changed[1];
+	float *values;
+	uint64_t count;
+	char *filename;
+	size_t total, idx;
+	int ret;
+
+	filename = g_build_filename(g_get_tmp_dir(),
+		"libsigrok-test-srzip.sr", NULL);
+	total = srzip_total();
+	samples = srzip_logic_samples(total);
+	values = srzip_analog_samples(total);
+	for (idx = 0; idx < ARRAY_SIZE(with_overview); idx++) {
+		srzip_write(filename, samples, values, with_overview[idx]);
+
+		archive = zip_open(filename, 0, NULL);
+		fail_unless(archive != NULL);
+		fail_unless((zip_name_locate(archive, "overview", 0) >= 0) ==
+			with_overview[idx]);
+		zip_discard(archive);
+
+		ret = sr_session_file_open(filename, &sf);
+		fail_unless(ret == SR_OK, "Cannot open session file: %d.", ret);
+		srzip_check(sf, samples, values, total);
+
+		ret = sr_session_file_get_overview(sf, &ov);
+		fail_unless(ret == SR_OK, "Cannot get overview: %d.", ret);
+		ret = sr_overview_get_num_samples(ov, SR_CHANNEL_LOGIC, 0,
+			&count);
+		fail_unless(ret == SR_OK && count == total);
+		ret = sr_overview_logic_get(ov, 0, total, 1,
+			bits_or, bits_and, bits_changed);
+		fail_unless(ret == SR_OK);
+		fail_unless(bits_or[0] == 0x7f && bits_and[0] == 0x00);
+		fail_unless(bits_changed[0] == 0x7f);
+
+		sr_session_file_close(sf);
+		g_unlink(filename);
+	}
+	g_free(filename);
+	g_free(values);
+	g_free(samples);
+}
+END_TEST
+
+/*
+ * The cached index of a session file without an "index" entry, see
+ * sr_session_file_open().
+ */
+static char *srzip_index_cache_path(const char *filename)
+{
+	char *sum, *name, *path;
+
+	sum = g_compute_checksum_for_string(G_CHECKSUM_SHA256, filename, -1);
+	name = g_strdup_printf("%s.index", sum);
+	path = g_build_filename(g_get_user_cache_dir(), "libsigrok", name,
+		NULL);
+	g_free(name);
+	g_free(sum);
+
+	return path;
+}
+
+/*
+ * Check that session files without an "index" entry get indexed when
+ * they get opened, and that later opens use the cached index.
+ */
+START_TEST(test_output_srzip_index_cache)
+{
+	struct sr_session_file *sf;
+	struct zip *archive;
+	zip_int64_t entry;
+	GKeyFile *kf;
+	uint8_t *samples;
+	float *values, min[1], max[1];
+	double *list;
+	gsize len, idx;
+	char *filename, *cache_path, *data;
+	size_t total;
+	int ret;
+
+	filename = g_build_filename(g_get_tmp_dir(),
+		"libsigrok-test-srzip-noindex.sr", NULL);
+	cache_path = srzip_index_cache_path(filename);
+	g_unlink(cache_path);
+	total = srzip_total();
+	samples = srzip_logic_samples(total);
+	values = srzip_analog_samples(total);
+	srzip_write(filename, samples, values, FALSE);
+
+	/* Files of older versions don't have the index. */
+	archive = zip_open(filename, 0, NULL);
+	fail_unless(archive != NULL);
+	entry = zip_name_locate(archive, "index", 0);
+	fail_unless(entry >= 0, "No index in the session file.");
+	fail_unless(zip_delete(archive, entry) == 0);
+	fail_unless(zip_close(archive) == 0);
+
+	ret = sr_session_file_open(filename, &sf);
+	fail_unless(ret == SR_OK, "Cannot open session file: %d.", ret);
+	srzip_check(sf, samples, values, total);
+	sr_session_file_close(sf);
+
+	/*
+	 * Mark the cached index, its analog chunk summaries make the
+	 * overview of the whole capture, which reveals whether the
+	 * next open uses the cached index or indexes the file again.
+	 */
+	kf = g_key_file_new();
+	fail_unless(g_key_file_load_from_file(kf, cache_path,
+		G_KEY_FILE_NONE, NULL), "No cached index in '%s'.", cache_path);
+	list = g_key_file_get_double_list(kf, "analog-1-9", "max", &len, NULL);
+	fail_unless(list != NULL && len > 0);
+	for (idx = 0; idx < len; idx++)
+		list[idx] = 1000;
+	g_key_file_set_double_list(kf, "analog-1-9", "max", list, len);
+	data = g_key_file_to_data(kf, &len, NULL);
+	fail_unless(g_file_set_contents(cache_path, data, len, NULL));
+	g_free(data);
+	g_free(list);
+	g_key_file_free(kf);
+
+	ret = sr_session_file_open(filename, &sf);
+	fail_unless(ret == SR_OK, "Cannot open session file: %d.", ret);
+	ret = sr_session_file_analog_overview(sf, 0, 0, total, 1, min, max);
+	fail_unless(ret == SR_OK && max[0] == 1000,
+		"The cached index was not used.");
+	sr_session_file_close(sf);
+
+	g_unlink(cache_path);
+	g_unlink(filename);
+	g_free(cache_path);
+	g_free(filename);
+	g_free(values);
+	g_free(samples);
+}
+END_TEST
+
 Suite *suite_output_all(void)
 {
 	Suite *s;
@@ -110,6 +904,11 @@ Suite *suite_output_all(void)
 	tcase_add_test(tc, test_output_desc);
 	tcase_add_test(tc, test_output_find);
 	tcase_add_test(tc, test_output_options);
+	tcase_add_test(tc, test_output_logic_rle);
+	tcase_add_test(tc, test_output_vcd);
+	tcase_add_test(tc, test_output_ascii);
+	tcase_add_test(tc, test_output_srzip_random_access);
+	tcase_add_test(tc, test_output_srzip_index_cache);
 	suite_add_tcase(s, tc);
 
 	return s;
@@ -0,0 +1,462 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * Copyright (C) 2026 The sigrok project developers
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+#include <check.h>
+#include <libsigrok/libsigrok.h>
+#include <math.h>
+#include <string.h>
+#include "lib.h"
+#include "libsigrok-internal.h"
+
+/* Small blocks, so that a few thousand samples span several levels. */
+#define RESOLUTION 16
+#define NUM_SAMPLES (RESOLUTION * 16 * 16 * 2 + 37)
+
+/* Ranges to query: start, count, number of bins. */
+static const uint64_t queries[][3] = {
+	{ 0, NUM_SAMPLES, 1 },
+	{ 0, NUM_SAMPLES, 7 },
+	{ 0, NUM_SAMPLES, 100 },
+	{ 4096, 4096, 1 },
+	{ 4096, 4096, 16 },
+	{ 100, 3000, 5 },
+	{ 1, 31, 31 },
+	{ NUM_SAMPLES - 20, 20, 3 },
+};
+
+/* A counter, with a glitch which only shows up in the bins around it. */
+static uint16_t logic_value(uint64_t i)
+{
+	return (i >> 3) ^ (i == 1234 ? 0x8000 : 0);
+}
+
+/* The samples which a bin covers, extended to block boundaries. */
+static void bin_range(uint64_t start, uint64_t count, size_t num_bins,
+		size_t bin, uint64_t total, uint64_t *first, uint64_t *end)
+{
+	uint64_t bin_start, bin_end;
+
+	bin_start = start + count / num_bins * bin +
+		count % num_bins * bin / num_bins;
+	bin_end = start + count / num_bins * (bin + 1) +
+		count % num_bins * (bin + 1) / num_bins;
+	*first = bin_start / RESOLUTION * RESOLUTION;
+	*end = MIN((bin_end + RESOLUTION - 1) / RESOLUTION * RESOLUTION, total);
+}
+
+static void check_logic(struct sr_overview *ov, const uint16_t *data,
+		uint64_t total)
+{
+	uint16_t bits_or[100], bits_and[100], bits_changed[100];
+	uint16_t ref_or, ref_and, ref_changed;
+	uint64_t first, end, s;
+	size_t q, bin, num_bins;
+	int ret;
+
+	for (q = 0; q < ARRAY_SIZE(queries); q++) {
+		num_bins = queries[q][2];
+		ret = sr_overview_logic_get(ov, queries[q][0], queries[q][1],
+			num_bins, (uint8_t *)bits_or, (uint8_t *)bits_and,
+			(uint8_t *)bits_changed);
+		fail_unless(ret == SR_OK, "Query %zu failed: %d.", q, ret);
+		for (bin = 0; bin < num_bins; bin++) {
+			bin_range(queries[q][0], queries[q][1], num_bins, bin,
+				total, &first, &end);
+			ref_or = ref_changed = 0x0000;
+			ref_and = 0xffff;
+			for (s = first; s < end; s++) {
+				ref_or |= data[s];
+				ref_and &= data[s];
+				if (s)
+					ref_changed |= data[s] ^ data[s - 1];
+			}
+			fail_unless(GUINT16_FROM_LE(bits_or[bin]) == ref_or,
+				"Query %zu bin %zu: OR 0x%04x, not 0x%04x.", q,
+				bin, GUINT16_FROM_LE(bits_or[bin]), ref_or);
+			fail_unless(GUINT16_FROM_LE(bits_and[bin]) == ref_and,
+				"Query %zu bin %zu: AND 0x%04x, not 0x%04x.", q,
+				bin, GUINT16_FROM_LE(bits_and[bin]), ref_and);
+			fail_unless(GUINT16_FROM_LE(bits_changed[bin]) == ref_changed,
+				"Query %zu bin %zu: changed 0x%04x, not 0x%04x.",
+				q, bin, GUINT16_FROM_LE(bits_changed[bin]),
+				ref_changed);
+		}
+	}
+}
+
+/*
+ * The session feed as a datafeed callback without RLE support sees it:
+ * the logic samples, and the analog samples per channel.
+ */
+struct capture {
+	GByteArray *logic;
+	unsigned int unitsize;
+	GArray *analog[2];
+};
+
+static void capture_cb(const struct sr_dev_inst *sdi,
+		const struct sr_datafeed_packet *packet, void *cb_data)
+{
+	struct capture *cap;
+	const struct sr_datafeed_logic *logic;
+	const struct sr_datafeed_analog *analog;
+	struct sr_channel *ch;
+	float *values;
+	int ret;
+
+	(void)sdi;
+
+	cap = cb_data;
+	switch (packet->type) {
+	case SR_DF_LOGIC:
+		logic = packet->payload;
+		cap->unitsize = logic->unitsize;
+		g_byte_array_append(cap->logic, logic->data, logic->length);
+		break;
+	case SR_DF_ANALOG:
+		analog = packet->payload;
+		fail_unless(g_slist_length(analog->meaning->channels) == 1);
+		ch = analog->meaning->channels->data;
+		fail_unless(ch->name[0] == 'A' && ch->name[1] - '0' < 2);
+		values = g_malloc(analog->num_samples * sizeof(*values));
+		ret = sr_analog_to_float(analog, values);
+		fail_unless(ret == SR_OK);
+		g_array_append_vals(cap->analog[ch->name[1] - '0'], values,
+			analog->num_samples);
+		g_free(values);
+		break;
+	default:
+		break;
+	}
+}
+
+/*
+ * Start a session with overviews of the device, and the feed capture.
+ * The demo device adds a single sample of its own when the session
+ * runs, the test's data gets sent before that.
+ */
+static struct sr_session *session_start(struct sr_dev_inst *sdi,
+		struct capture *cap)
+{
+	struct sr_session *sess;
+	int ret;
+
+	ret = sr_config_set(sdi, NULL, SR_CONF_LIMIT_SAMPLES,
+		g_variant_new_uint64(1));
+	fail_unless(ret == SR_OK);
+
+	cap->logic = g_byte_array_new();
+	cap->analog[0] = g_array_new(FALSE, FALSE, sizeof(float));
+	cap->analog[1] = g_array_new(FALSE, FALSE, sizeof(float));
+
+	sr_session_new(srtest_ctx, &sess);
+	sr_session_dev_add(sess, sdi);
+	ret = sr_session_overview_enable(sess, RESOLUTION);
+	fail_unless(ret == SR_OK);
+	ret = sr_session_datafeed_callback_add(sess, capture_cb, cap);
+	fail_unless(ret == SR_OK);
+	ret = sr_session_start(sess);
+	fail_unless(ret == SR_OK, "Cannot start session: %d.", ret);
+
+	return sess;
+}
+
+/* Run the session to its end, and get the device's overview. */
+static struct sr_overview *session_finish(struct sr_session *sess,
+		const struct sr_dev_inst *sdi)
+{
+	struct sr_overview *ov;
+	int ret;
+
+	ret = sr_session_run(sess);
+	fail_unless(ret == SR_OK, "Cannot run session: %d.", ret);
+	ov = sr_session_overview_get(sess, sdi);
+	fail_unless(ov != NULL, "No overview.");
+
+	return ov;
+}
+
+static void capture_free(struct capture *cap)
+{
+	g_byte_array_free(cap->logic, TRUE);
+	g_array_free(cap->analog[0], TRUE);
+	g_array_free(cap->analog[1], TRUE);
+}
+
+/* The captured 16bit logic samples, in host byte order. */
+static uint16_t *capture_logic(const struct capture *cap, uint64_t *total)
+{
+	uint16_t *data;
+	uint64_t i;
+
+	fail_unless(cap->unitsize == sizeof(*data));
+	*total = cap->logic->len / sizeof(*data);
+	data = g_malloc(*total * sizeof(*data));
+	for (i = 0; i < *total; i++)
+		data[i] = RL16(&cap->logic->data[i * sizeof(*data)]);
+
+	return data;
+}
+
+/*
+ * Check logic queries over multiple bins, which combine blocks of
+ * several levels and the block in progress, for data which gets
+ * sent in packets of arbitrary size.
+ */
+START_TEST(test_overview_logic)
+{
+	static const uint64_t chunks[] = { 1, 7, 16, 100, 999, 4096 };
+	struct sr_session *sess;
+	struct sr_dev_inst *sdi;
+	struct sr_overview *ov;
+	struct feed_queue_logic *q;
+	struct capture cap;
+	uint16_t *data, *raw;
+	uint64_t i, done, len, count, total;
+	unsigned int unitsize;
+	size_t c;
+	int ret;
+
+	raw = g_malloc(NUM_SAMPLES * sizeof(*raw));
+	for (i = 0; i < NUM_SAMPLES; i++)
+		raw[i] = GUINT16_TO_LE(logic_value(i));
+
+	sdi = srtest_demo_get(16, 0);
+	sess = session_start(sdi, &cap);
+	/* An odd queue size, so that packets don't end on blocks. */
+	q = feed_queue_logic_alloc(sdi, 999, sizeof(*raw));
+	fail_unless(q != NULL);
+	for (done = 0, c = 0; done < NUM_SAMPLES; done += len) {
+		len = MIN(chunks[c++ % ARRAY_SIZE(chunks)], NUM_SAMPLES - done);
+		ret = feed_queue_logic_submit_many(q, (uint8_t *)(raw + done),
+			len);
+		fail_unless(ret == SR_OK);
+	}
+	ret = feed_queue_logic_flush(q);
+	fail_unless(ret == SR_OK);
+	feed_queue_logic_free(q);
+	ov = session_finish(sess, sdi);
+
+	data = capture_logic(&cap, &total);
+	fail_unless(total > NUM_SAMPLES);
+	fail_unless(memcmp(cap.logic->data, raw, sizeof(*raw) * NUM_SAMPLES) == 0);
+	ret = sr_overview_get_info(ov, NULL, &unitsize, NULL);
+	fail_unless(ret == SR_OK && unitsize == sizeof(*data));
+	ret = sr_overview_get_num_samples(ov, SR_CHANNEL_LOGIC, 0, &count);
+	fail_unless(ret == SR_OK && count == total);
+	check_logic(ov, data, total);
+
+	/* Ranges beyond the data, and more bins than samples. */
+	ret = sr_overview_logic_get(ov, 1, total, 1,
+		(uint8_t *)raw, (uint8_t *)raw, NULL);
+	fail_unless(ret == SR_ERR_ARG);
+	ret = sr_overview_logic_get(ov, 0, 2, 3,
+		(uint8_t *)raw, (uint8_t *)raw, NULL);
+	fail_unless(ret == SR_ERR_ARG);
+
+	sr_session_destroy(sess);
+	sr_dev_close(sdi);
+	capture_free(&cap);
+	g_free(raw);
+	g_free(data);
+}
+END_TEST
+
+/*
+ * Check that run-length encoded data gets summarized like the same
+ * data in plain form, which callbacks without RLE support receive,
+ * with runs which span blocks, and runs which span packets.
+ */
+START_TEST(test_overview_logic_rle)
+{
+	struct sr_session *sess;
+	struct sr_dev_inst *sdi;
+	struct sr_overview *ov;
+	struct feed_queue_logic *q;
+	struct capture cap;
+	uint16_t *data, value;
+	uint64_t total, count, len;
+	size_t run;
+	int ret;
+
+	sdi = srtest_demo_get(16, 0);
+	sess = session_start(sdi, &cap);
+	/* A small queue, so that the runs span several packets. */
+	q = feed_queue_logic_alloc(sdi, 64, sizeof(value));
+	fail_unless(q != NULL);
+	ret = feed_queue_logic_set_rle(q, TRUE);
+	fail_unless(ret == SR_OK);
+	total = 0;
+	for (run = 0; run < 200; run++) {
+		value = GUINT16_TO_LE(run * 0x0123 & 0x0fff);
+		len = (run % 17 == 3) ? 0 : (run * 37) % 101 + 1;
+		ret = feed_queue_logic_submit_one(q, (uint8_t *)&value, len);
+		fail_unless(ret == SR_OK);
+		total += len;
+		/* A run which continues after a flush. */
+		if (run == 77) {
+			ret = feed_queue_logic_flush(q);
+			fail_unless(ret == SR_OK);
+			ret = feed_queue_logic_submit_one(q,
+				(uint8_t *)&value, 5);
+			fail_unless(ret == SR_OK);
+			total += 5;
+		}
+	}
+	ret = feed_queue_logic_flush(q);
+	fail_unless(ret == SR_OK);
+	feed_queue_logic_free(q);
+	ov = session_finish(sess, sdi);
+
+	fail_unless(total >= NUM_SAMPLES, "Too few RLE samples: %" PRIu64 ".",
+		total);
+	data = capture_logic(&cap, &count);
+	fail_unless(count > total);
+	ret = sr_overview_get_num_samples(ov, SR_CHANNEL_LOGIC, 0, &total);
+	fail_unless(ret == SR_OK && total == count);
+	check_logic(ov, data, total);
+
+	sr_session_destroy(sess);
+	sr_dev_close(sdi);
+	capture_free(&cap);
+	g_free(data);
+}
+END_TEST
+
+/*
+ * Check analog minimum and maximum over multiple bins and levels, for
+ * two channels, and NaN values which get ignored.
+ */
+START_TEST(test_overview_analog)
+{
+	struct sr_session *sess;
+	struct sr_dev_inst *sdi;
+	struct sr_overview *ov;
+	struct sr_channel *ch[2];
+	struct feed_queue_analog *q;
+	struct capture cap;
+	const float *values;
+	float min[100], max[100], ref_min, ref_max, value;
+	uint64_t i, first, end, s, count, total;
+	unsigned int num_analog;
+	size_t q_idx, bin, num_bins;
+	GSList *l;
+	int ret;
+
+	sdi = srtest_demo_get(8, 2);
+	for (l = sr_dev_inst_channels_get(sdi), i = 0; l; l = l->next) {
+		if (((struct sr_channel *)l->data)->type == SR_CHANNEL_ANALOG)
+			ch[i++] = l->data;
+	}
+	fail_unless(i == 2);
+	sess = session_start(sdi, &cap);
+
+	/* The first channel's data gets sent in two parts. */
+	q = feed_queue_analog_alloc(sdi, 1000, 3, ch[0]);
+	fail_unless(q != NULL);
+	for (i = 0; i < NUM_SAMPLES; i++) {
+		value = sinf(i * 0.01f) * (1.0f + i * 0.001f);
+		if (i >= 2 * RESOLUTION && i < 4 * RESOLUTION)
+			value = NAN;
+		ret = feed_queue_analog_submit_one(q, value, 1);
+		fail_unless(ret == SR_OK);
+	}
+	ret = feed_queue_analog_flush(q);
+	fail_unless(ret == SR_OK);
+	feed_queue_analog_free(q);
+	q = feed_queue_analog_alloc(sdi, 4096, 3, ch[1]);
+	fail_unless(q != NULL);
+	ret = feed_queue_analog_submit_one(q, 42.0f, NUM_SAMPLES);
+	fail_unless(ret == SR_OK);
+	ret = feed_queue_analog_flush(q);
+	fail_unless(ret == SR_OK);
+	feed_queue_analog_free(q);
+	ov = session_finish(sess, sdi);
+
+	ret = sr_overview_get_info(ov, NULL, NULL, &num_analog);
+	fail_unless(ret == SR_OK && num_analog == 2);
+	total = cap.analog[0]->len;
+	fail_unless(total > NUM_SAMPLES);
+	ret = sr_overview_get_num_samples(ov, SR_CHANNEL_ANALOG, 0, &count);
+	fail_unless(ret == SR_OK && count == total);
+	values = (const float *)cap.analog[0]->data;
+
+	for (q_idx = 0; q_idx < ARRAY_SIZE(queries); q_idx++) {
+		num_bins = queries[q_idx][2];
+		ret = sr_overview_analog_get(ov, 0, queries[q_idx][0],
+			queries[q_idx][1], num_bins, min, max);
+		fail_unless(ret == SR_OK, "Query %zu failed: %d.", q_idx, ret);
+		for (bin = 0; bin < num_bins; bin++) {
+			bin_range(queries[q_idx][0], queries[q_idx][1],
+				num_bins, bin, total, &first, &end);
+			ref_min = INFINITY;
+			ref_max = -INFINITY;
+			for (s = first; s < end; s++) {
+				if (isnan(values[s]))
+					continue;
+				ref_min = MIN(ref_min, values[s]);
+				ref_max = MAX(ref_max, values[s]);
+			}
+			fail_unless(min[bin] == ref_min && max[bin] == ref_max,
+				"Query %zu bin %zu: %f..%f, not %f..%f.", q_idx,
+				bin, min[bin], max[bin], ref_min, ref_max);
+		}
+	}
+
+	/* Bins which only hold NaN values. */
+	ret = sr_overview_analog_get(ov, 0, 2 * RESOLUTION, 2 * RESOLUTION,
+		2, min, max);
+	fail_unless(ret == SR_OK);
+	fail_unless(isnan(min[0]) && isnan(max[0]));
+	fail_unless(isnan(min[1]) && isnan(max[1]));
+
+	/* The second channel's blocks before the demo device's sample. */
+	ret = sr_overview_analog_get(ov, 1, 0, RESOLUTION * 16 * 16 * 2, 3,
+		min, max);
+	fail_unless(ret == SR_OK);
+	for (bin = 0; bin < 3; bin++)
+		fail_unless(min[bin] == 42.0f && max[bin] == 42.0f);
+
+	/* There is no third track. */
+	ret = sr_overview_analog_get(ov, 2, 0, NUM_SAMPLES, 3, min, max);
+	fail_unless(ret == SR_ERR_ARG);
+
+	sr_session_destroy(sess);
+	sr_dev_close(sdi);
+	capture_free(&cap);
+}
+END_TEST
+
+Suite *suite_overview(void)
+{
+	Suite *s;
+	TCase *tc;
+
+	s = suite_create("overview");
+
+	tc = tcase_create("query");
+	tcase_add_checked_fixture(tc, srtest_setup, srtest_teardown);
+	tcase_add_test(tc, test_overview_logic);
+	tcase_add_test(tc, test_overview_logic_rle);
+	tcase_add_test(tc, test_overview_analog);
+	suite_add_tcase(s, tc);
+
+	return s;
+}
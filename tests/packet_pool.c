@@ -0,0 +1,305 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * Copyright (C) 2026 The sigrok project developers
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+#include <check.h>
+#include <libsigrok/libsigrok.h>
+#include <string.h>
+#include "lib.h"
+#include "libsigrok-internal.h"
+
+/* Beyond the largest size class, served by blocks which are not kept. */
+#define OVERSIZE ((64 << 20) + 1)
+
+static struct sr_datafeed_logic *logic_of(struct sr_datafeed_packet *packet)
+{
+	return (struct sr_datafeed_logic *)packet->payload;
+}
+
+/* Check that released blocks get re-used, within their size class. */
+START_TEST(test_pool_size_classes)
+{
+	static const size_t lengths[] = { 1, 255, 256, 257, 4096, 65537 };
+	struct sr_packet_pool *pool;
+	struct sr_datafeed_packet *p, *q;
+	struct sr_datafeed_logic *logic;
+	unsigned int i;
+
+	pool = sr_packet_pool_new();
+	for (i = 0; i < ARRAY_SIZE(lengths); i++) {
+		p = sr_packet_pool_logic_new(pool, lengths[i], 1);
+		fail_unless(p != NULL);
+		fail_unless(p->type == SR_DF_LOGIC);
+		logic = logic_of(p);
+		fail_unless(logic->length == lengths[i]);
+		fail_unless(logic->unitsize == 1);
+		fail_unless((uintptr_t)logic->data % 64 == 0);
+		memset(logic->data, 0xa5, lengths[i]);
+
+		/* Callers may advance the data pointer and shorten it. */
+		logic->data = (uint8_t *)logic->data + 1;
+		logic->length = 0;
+		sr_packet_unref(p);
+
+		q = sr_packet_pool_logic_new(pool, lengths[i], 2);
+		fail_unless(q == p, "Length %zu: block not re-used.",
+			lengths[i]);
+		logic = logic_of(q);
+		fail_unless(logic->length == lengths[i]);
+		fail_unless(logic->unitsize == 2);
+		fail_unless((uintptr_t)logic->data % 64 == 0);
+		sr_packet_unref(q);
+	}
+
+	/* 256 and 257 bytes are in different classes. */
+	p = sr_packet_pool_logic_new(pool, 256, 1);
+	sr_packet_unref(p);
+	q = sr_packet_pool_logic_new(pool, 257, 1);
+	fail_unless(q != p);
+	sr_packet_unref(q);
+
+	sr_packet_pool_unref(pool);
+}
+END_TEST
+
+/* Check that only the last reference returns a block to its pool. */
+START_TEST(test_pool_refcount)
+{
+	struct sr_packet_pool *pool;
+	struct sr_datafeed_packet *p, *q, *r;
+	struct sr_datafeed_analog *analog;
+	struct sr_channel ch;
+
+	pool = sr_packet_pool_new();
+	p = sr_packet_pool_analog_new(pool, 100, &ch);
+	fail_unless(p != NULL && p->type == SR_DF_ANALOG);
+	analog = (struct sr_datafeed_analog *)p->payload;
+	fail_unless(analog->num_samples == 100);
+	fail_unless(analog->encoding->unitsize == sizeof(float));
+	fail_unless(analog->meaning->channels->data == &ch);
+	fail_unless(!analog->meaning->channels->next);
+
+	q = sr_packet_ref(p);
+	fail_unless(q == p);
+	sr_packet_unref(p);
+	r = sr_packet_pool_analog_new(pool, 100, NULL);
+	fail_unless(r != p, "Block re-used while still referenced.");
+	analog = (struct sr_datafeed_analog *)r->payload;
+	fail_unless(!analog->meaning->channels);
+	sr_packet_unref(r);
+
+	sr_packet_unref(q);
+	r = sr_packet_pool_analog_new(pool, 100, NULL);
+	fail_unless(r == p, "Released block not re-used.");
+	sr_packet_unref(r);
+
+	sr_packet_pool_unref(pool);
+}
+END_TEST
+
+/* Check that packets keep their pool alive, also a session's pool. */
+START_TEST(test_pool_outlives_owner)
+{
+	struct sr_packet_pool *pool;
+	struct sr_session *sess;
+	struct sr_dev_inst *sdi;
+	struct sr_datafeed_packet *p, *q;
+
+	pool = sr_packet_pool_new();
+	p = sr_packet_pool_logic_new(pool, 1000, 1);
+	sr_packet_pool_unref(pool);
+	memset(logic_of(p)->data, 0, 1000);
+	sr_packet_unref(p);
+
+	sr_session_new(srtest_ctx, &sess);
+	sdi = sr_dev_inst_user_new("Vendor", "Model", "Version");
+	sr_session_dev_add(sess, sdi);
+	pool = sr_session_packet_pool(sdi);
+	fail_unless(pool != NULL);
+	p = sr_packet_pool_logic_new(pool, 1000, 1);
+	q = sr_packet_ref(p);
+	sr_session_destroy(sess);
+	sr_dev_inst_free(sdi);
+	memset(logic_of(p)->data, 0, 1000);
+	sr_packet_unref(p);
+	sr_packet_unref(q);
+}
+END_TEST
+
+/* Check blocks beyond the largest size class. */
+START_TEST(test_pool_oversize)
+{
+	struct sr_packet_pool *pool;
+	struct sr_datafeed_packet *p;
+	struct sr_datafeed_logic *logic;
+
+	pool = sr_packet_pool_new();
+	p = sr_packet_pool_logic_new(pool, OVERSIZE, 1);
+	fail_unless(p != NULL);
+	fail_unless(sr_packet_is_pooled(p));
+	logic = logic_of(p);
+	fail_unless(logic->length == OVERSIZE);
+	((uint8_t *)logic->data)[0] = 1;
+	((uint8_t *)logic->data)[OVERSIZE - 1] = 1;
+	sr_packet_pool_unref(pool);
+	sr_packet_unref(p);
+}
+END_TEST
+
+/* Check that caller owned packets are not taken for pooled ones. */
+START_TEST(test_pool_is_pooled)
+{
+	struct sr_packet_pool *pool;
+	struct sr_datafeed_packet *p, packet, *copy;
+	struct sr_datafeed_logic logic, *logic_copy;
+	uint8_t data[4] = { 1, 2, 3, 4 };
+
+	logic.length = sizeof(data);
+	logic.unitsize = 1;
+	logic.data = data;
+	packet.type = SR_DF_LOGIC;
+	packet.payload = &logic;
+	fail_unless(!sr_packet_is_pooled(&packet));
+
+	pool = sr_packet_pool_new();
+	p = sr_packet_pool_logic_new(pool, sizeof(data), 1);
+	fail_unless(sr_packet_is_pooled(p));
+	memcpy(logic_of(p)->data, data, sizeof(data));
+
+	/* A copy of the packet struct points to the block's payload. */
+	packet = *p;
+	fail_unless(!sr_packet_is_pooled(&packet));
+
+	/* Copies of pooled packets are the caller's to modify. */
+	fail_unless(sr_packet_copy(p, &copy) == SR_OK);
+	fail_unless(copy != p && !sr_packet_is_pooled(copy));
+	logic_copy = (struct sr_datafeed_logic *)copy->payload;
+	fail_unless(logic_copy->data != logic_of(p)->data);
+	fail_unless(memcmp(logic_copy->data, data, sizeof(data)) == 0);
+	memset(logic_copy->data, 0, sizeof(data));
+	fail_unless(memcmp(logic_of(p)->data, data, sizeof(data)) == 0);
+	sr_packet_free(copy);
+
+	sr_packet_unref(p);
+	sr_packet_pool_unref(pool);
+}
+END_TEST
+
+struct pool_feed {
+	GMutex mutex;
+	GHashTable *packets;
+	uint64_t bytes;
+};
+
+static void pool_feed_cb(const struct sr_dev_inst *sdi,
+		const struct sr_datafeed_packet *packet, void *cb_data)
+{
+	struct pool_feed *feed;
+	const struct sr_datafeed_logic *logic;
+
+	(void)sdi;
+
+	if (packet->type != SR_DF_LOGIC)
+		return;
+
+	feed = cb_data;
+	logic = packet->payload;
+	g_mutex_lock(&feed->mutex);
+	g_hash_table_add(feed->packets, (gpointer)packet);
+	feed->bytes += logic->length;
+	g_mutex_unlock(&feed->mutex);
+}
+
+/*
+ * Check that the demo driver's logic data only ever takes a few blocks
+ * from the session's pool, which get recycled. Once the pool is warm no
+ * block gets allocated, however many packets get sent. Threaded
+ * callbacks keep up to their queue's length of packets.
+ */
+START_TEST(test_pool_steady_state)
+{
+	static const size_t high_water[] = { 0, 4 };
+	struct sr_session *sess;
+	struct sr_dev_inst *sdi;
+	struct pool_feed feed;
+	uint64_t limit;
+	unsigned int i, num_packets;
+	int ret;
+
+	/* 256 packets of 64 KiB. */
+	limit = 16 << 20;
+	sdi = srtest_demo_get(8, 0);
+	ret = sr_config_set(sdi, NULL, SR_CONF_LIMIT_SAMPLES,
+		g_variant_new_uint64(limit));
+	fail_unless(ret == SR_OK);
+
+	g_mutex_init(&feed.mutex);
+	for (i = 0; i < ARRAY_SIZE(high_water); i++) {
+		feed.packets = g_hash_table_new(NULL, NULL);
+		feed.bytes = 0;
+		sr_session_new(srtest_ctx, &sess);
+		sr_session_dev_add(sess, sdi);
+		ret = sr_session_datafeed_threads_set(sess, high_water[i],
+			SR_DATAFEED_QUEUE_BLOCK);
+		fail_unless(ret == SR_OK);
+		sr_session_datafeed_callback_add(sess, pool_feed_cb, &feed);
+
+		ret = sr_session_start(sess);
+		fail_unless(ret == SR_OK, "Cannot start session: %d.", ret);
+		ret = sr_session_run(sess);
+		fail_unless(ret == SR_OK, "Cannot run session: %d.", ret);
+		sr_session_destroy(sess);
+
+		fail_unless(feed.bytes == limit);
+		num_packets = g_hash_table_size(feed.packets);
+		fail_unless(num_packets <= high_water[i] + 2,
+			"Queue of %zu: %u blocks.", high_water[i],
+			num_packets);
+		g_hash_table_destroy(feed.packets);
+	}
+	g_mutex_clear(&feed.mutex);
+
+	sr_dev_close(sdi);
+}
+END_TEST
+
+Suite *suite_packet_pool(void)
+{
+	Suite *s;
+	TCase *tc;
+
+	s = suite_create("packet_pool");
+
+	tc = tcase_create("pool");
+	tcase_add_checked_fixture(tc, srtest_setup, srtest_teardown);
+	tcase_add_test(tc, test_pool_size_classes);
+	tcase_add_test(tc, test_pool_refcount);
+	tcase_add_test(tc, test_pool_outlives_owner);
+	tcase_add_test(tc, test_pool_oversize);
+	tcase_add_test(tc, test_pool_is_pooled);
+	suite_add_tcase(s, tc);
+
+	tc = tcase_create("steady_state");
+	tcase_set_timeout(tc, 0);
+	tcase_add_checked_fixture(tc, srtest_setup, srtest_teardown);
+	tcase_add_test(tc, test_pool_steady_state);
+	suite_add_tcase(s, tc);
+
+	return s;
+}
@@ -0,0 +1,491 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * Copyright (C) 2026 The sigrok project developers
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+#include <check.h>
+#include <libsigrok/libsigrok.h>
+#include <string.h>
+#include "lib.h"
+#include "libsigrok-internal.h"
+#include "scpi.h"
+
+/* Read timeout of the fake transport, expires when input runs dry. */
+#define FAKE_TIMEOUT_US 10000
+
+/*
+ * A fake SCPI transport which replays a byte stream, in pieces of
+ * at most 'chunk' bytes per read. Reads beyond the stream's end
+ * return no data, reads at 'fail_at' return an error.
+ */
+struct fake_scpi {
+	const uint8_t *data;
+	size_t len;
+	size_t pos;
+	size_t chunk;
+	size_t fail_at;
+	GString *sent;
+};
+
+static int fake_send(void *priv, const char *command)
+{
+	struct fake_scpi *fake;
+
+	fake = priv;
+	g_string_append(fake->sent, command);
+
+	return SR_OK;
+}
+
+static int fake_read_begin(void *priv)
+{
+	(void)priv;
+
+	return SR_OK;
+}
+
+static int fake_read_data(void *priv, char *buf, int maxlen)
+{
+	struct fake_scpi *fake;
+	size_t len;
+
+	fake = priv;
+	if (fake->pos == fake->fail_at)
+		return SR_ERR;
+	len = MIN((size_t)maxlen, fake->len - fake->pos);
+	len = MIN(len, fake->chunk);
+	if (fake->fail_at > fake->pos)
+		len = MIN(len, fake->fail_at - fake->pos);
+	memcpy(buf, fake->data + fake->pos, len);
+	fake->pos += len;
+
+	return len;
+}
+
+static int fake_read_complete(void *priv)
+{
+	struct fake_scpi *fake;
+
+	fake = priv;
+
+	return fake->pos == fake->len;
+}
+
+static void fake_init(struct sr_scpi_dev_inst *scpi, struct fake_scpi *fake,
+		enum scpi_transport_layer transport,
+		const void *data, size_t len, size_t chunk)
+{
+	memset(fake, 0, sizeof(*fake));
+	fake->data = data;
+	fake->len = len;
+	fake->chunk = chunk;
+	fake->fail_at = SIZE_MAX;
+	fake->sent = g_string_new(NULL);
+
+	memset(scpi, 0, sizeof(*scpi));
+	scpi->name = "fake";
+	scpi->transport = transport;
+	scpi->send = fake_send;
+	scpi->read_begin = fake_read_begin;
+	scpi->read_data = fake_read_data;
+	scpi->read_complete = fake_read_complete;
+	scpi->read_timeout_us = FAKE_TIMEOUT_US;
+	scpi->priv = fake;
+	g_mutex_init(&scpi->scpi_mutex);
+}
+
+static void fake_free(struct sr_scpi_dev_inst *scpi, struct fake_scpi *fake)
+{
+	g_mutex_clear(&scpi->scpi_mutex);
+	g_string_free(fake->sent, TRUE);
+}
+
+/*
+ * Block data consumer, which takes whole units of 'unitsize' bytes
+ * (like the samples of a waveform), and optionally aborts.
+ */
+struct block_sink {
+	GByteArray *data;
+	size_t unitsize;
+	size_t max_len;
+	unsigned int calls;
+	int ret;
+};
+
+static int block_sink_cb(const uint8_t *data, size_t len, void *cb_data)
+{
+	struct block_sink *sink;
+
+	sink = cb_data;
+	sink->calls++;
+	sink->max_len = MAX(sink->max_len, len);
+	if (sink->ret)
+		return sink->ret;
+	len -= len % sink->unitsize;
+	g_byte_array_append(sink->data, data, len);
+
+	return len;
+}
+
+static void block_sink_init(struct block_sink *sink, size_t unitsize)
+{
+	memset(sink, 0, sizeof(*sink));
+	sink->data = g_byte_array_new();
+	sink->unitsize = unitsize;
+}
+
+/* Build "#<n><len><data><trailer>", with 'len' bytes of a pattern. */
+static GByteArray *block_new(size_t len, const char *trailer)
+{
+	GByteArray *block;
+	char *header;
+	size_t i;
+	uint8_t b;
+
+	header = g_strdup_printf("%zu", len);
+	block = g_byte_array_new();
+	b = '#';
+	g_byte_array_append(block, &b, 1);
+	b = '0' + strlen(header);
+	g_byte_array_append(block, &b, 1);
+	g_byte_array_append(block, (uint8_t *)header, strlen(header));
+	for (i = 0; i < len; i++) {
+		b = i * 7 + (i >> 8);
+		g_byte_array_append(block, &b, 1);
+	}
+	g_byte_array_append(block, (const uint8_t *)trailer, strlen(trailer));
+	g_free(header);
+
+	return block;
+}
+
+/* Check a complete block which gets stored in the caller's buffer. */
+START_TEST(test_scpi_block_buffer)
+{
+	static const size_t chunks[] = { 1, 2, 3, 64 };
+	struct sr_scpi_dev_inst scpi;
+	struct fake_scpi fake;
+	uint8_t buf[16];
+	size_t datalen;
+	unsigned int i;
+	int ret;
+
+	for (i = 0; i < ARRAY_SIZE(chunks); i++) {
+		fake_init(&scpi, &fake, SCPI_TRANSPORT_USBTMC,
+			"#15hello\n", 9, chunks[i]);
+		memset(buf, 0, sizeof(buf));
+		ret = sr_scpi_read_block(&scpi, "DATA?", buf, sizeof(buf),
+			&datalen, NULL, NULL);
+		fail_unless(ret == SR_OK, "Chunks of %zu: error %d.",
+			chunks[i], ret);
+		fail_unless(strcmp(fake.sent->str, "DATA?\n") == 0);
+		fail_unless(datalen == 5);
+		fail_unless(memcmp(buf, "hello", 5) == 0);
+		fail_unless(buf[5] == 0, "Wrote beyond the data block.");
+		fail_unless(fake.pos == fake.len, "Trailer not consumed.");
+		fake_free(&scpi, &fake);
+	}
+}
+END_TEST
+
+/*
+ * Check that a consumer gets all the data in order through a small
+ * window, also when it leaves partial units for its next invocation.
+ */
+START_TEST(test_scpi_block_window)
+{
+	static const size_t lengths[] = { 1, 4, 15, 1000, 65536 };
+	static const size_t chunks[] = { 1, 7, 4096 };
+	struct sr_scpi_dev_inst scpi;
+	struct fake_scpi fake;
+	struct block_sink sink;
+	GByteArray *block;
+	uint8_t buf[16];
+	size_t datalen, hdrlen;
+	unsigned int i, j;
+	int ret;
+
+	for (i = 0; i < ARRAY_SIZE(lengths); i++) {
+		block = block_new(lengths[i], "\r\n");
+		hdrlen = block->len - lengths[i] - 2;
+		for (j = 0; j < ARRAY_SIZE(chunks); j++) {
+			fake_init(&scpi, &fake, SCPI_TRANSPORT_USBTMC,
+				block->data, block->len, chunks[j]);
+			block_sink_init(&sink, 4);
+			ret = sr_scpi_read_block(&scpi, NULL, buf, sizeof(buf),
+				&datalen, block_sink_cb, &sink);
+			fail_unless(ret == SR_OK,
+				"Length %zu, chunks of %zu: error %d.",
+				lengths[i], chunks[j], ret);
+			fail_unless(datalen == lengths[i]);
+			fail_unless(sink.max_len <= sizeof(buf));
+			/* A trailing partial unit is never consumed. */
+			fail_unless(sink.data->len ==
+				lengths[i] - lengths[i] % 4);
+			fail_unless(memcmp(sink.data->data,
+				block->data + hdrlen, sink.data->len) == 0,
+				"Length %zu, chunks of %zu: data mismatch.",
+				lengths[i], chunks[j]);
+			fail_unless(fake.pos == fake.len);
+			g_byte_array_free(sink.data, TRUE);
+			fake_free(&scpi, &fake);
+		}
+		g_byte_array_free(block, TRUE);
+	}
+}
+END_TEST
+
+/*
+ * Check "#10", an empty block. On stream transports its terminator
+ * may only arrive with the next response, and must not get in the
+ * way of the next block's header.
+ */
+START_TEST(test_scpi_block_empty)
+{
+	static const char stream[] = "#10\r\n#13abc\n";
+	struct sr_scpi_dev_inst scpi;
+	struct fake_scpi fake;
+	struct block_sink sink;
+	uint8_t buf[16];
+	size_t datalen;
+	int ret;
+
+	fake_init(&scpi, &fake, SCPI_TRANSPORT_USBTMC, "#10\n", 4, 64);
+	block_sink_init(&sink, 1);
+	ret = sr_scpi_read_block(&scpi, NULL, buf, sizeof(buf), &datalen,
+		block_sink_cb, &sink);
+	fail_unless(ret == SR_OK);
+	fail_unless(datalen == 0);
+	fail_unless(sink.calls == 0);
+	fail_unless(fake.pos == fake.len);
+	g_byte_array_free(sink.data, TRUE);
+	fake_free(&scpi, &fake);
+
+	/* Only "#10" is pending when the first block gets read. */
+	fake_init(&scpi, &fake, SCPI_TRANSPORT_RAW_TCP,
+		stream, strlen(stream), 64);
+	fake.len = 3;
+	ret = sr_scpi_read_block(&scpi, NULL, buf, sizeof(buf), &datalen,
+		NULL, NULL);
+	fail_unless(ret == SR_OK);
+	fail_unless(datalen == 0);
+	fake.len = strlen(stream);
+	ret = sr_scpi_read_block(&scpi, NULL, buf, sizeof(buf), &datalen,
+		NULL, NULL);
+	fail_unless(ret == SR_OK, "Block after empty block: error %d.", ret);
+	fail_unless(datalen == 3);
+	fail_unless(memcmp(buf, "abc", 3) == 0);
+	fail_unless(fake.pos == fake.len);
+	fake_free(&scpi, &fake);
+}
+END_TEST
+
+/* Check malformed and unsupported length specs. */
+START_TEST(test_scpi_block_header)
+{
+	static const struct {
+		const char *response;
+		int ret;
+	} cases[] = {
+		{ "15hello\n", SR_ERR_DATA },
+		{ "#x5hello\n", SR_ERR_DATA },
+		{ "#2x5hello\n", SR_ERR_DATA },
+		{ "#2-5hello\n", SR_ERR_DATA },
+		{ "#0hello\n", SR_ERR_NA },
+		{ "#", SR_ERR_TIMEOUT },
+		{ "#3", SR_ERR_TIMEOUT },
+		{ "#31", SR_ERR_TIMEOUT },
+		{ "", SR_ERR_TIMEOUT },
+	};
+	struct sr_scpi_dev_inst scpi;
+	struct fake_scpi fake;
+	uint8_t buf[16];
+	size_t datalen;
+	unsigned int i;
+	int ret;
+
+	for (i = 0; i < ARRAY_SIZE(cases); i++) {
+		fake_init(&scpi, &fake, SCPI_TRANSPORT_USBTMC,
+			cases[i].response, strlen(cases[i].response), 64);
+		ret = sr_scpi_read_block(&scpi, NULL, buf, sizeof(buf),
+			&datalen, NULL, NULL);
+		fail_unless(ret == cases[i].ret, "'%s': %d, expected %d.",
+			cases[i].response, ret, cases[i].ret);
+		fail_unless(datalen == 0);
+		fake_free(&scpi, &fake);
+	}
+}
+END_TEST
+
+/*
+ * Check the response terminator: CR+NL, a missing one, and unexpected
+ * bytes before it, which all leave the block's data intact.
+ */
+START_TEST(test_scpi_block_trailer)
+{
+	static const char *responses[] = {
+		"#13abc\r\n", "#13abc", "#13abcXY\n", "#13abc\n\n",
+	};
+	static const enum scpi_transport_layer transports[] = {
+		SCPI_TRANSPORT_USBTMC, SCPI_TRANSPORT_SERIAL,
+	};
+	struct sr_scpi_dev_inst scpi;
+	struct fake_scpi fake;
+	uint8_t buf[16];
+	size_t datalen, expected;
+	unsigned int i, j;
+	int ret;
+
+	for (i = 0; i < ARRAY_SIZE(responses); i++) {
+		for (j = 0; j < ARRAY_SIZE(transports); j++) {
+			fake_init(&scpi, &fake, transports[j], responses[i],
+				strlen(responses[i]), 1);
+			ret = sr_scpi_read_block(&scpi, NULL, buf, sizeof(buf),
+				&datalen, NULL, NULL);
+			fail_unless(ret == SR_OK, "'%s': error %d.",
+				responses[i], ret);
+			fail_unless(datalen == 3);
+			fail_unless(memcmp(buf, "abc", 3) == 0);
+			/* Reading stops at the first NL. */
+			expected = strchr(responses[i], '\n') ?
+				(size_t)(strchr(responses[i], '\n') -
+				responses[i] + 1) : fake.len;
+			fail_unless(fake.pos == expected, "'%s': at %zu.",
+				responses[i], fake.pos);
+			fake_free(&scpi, &fake);
+		}
+	}
+}
+END_TEST
+
+/*
+ * Check that blocks which exceed the buffer get drained, and are not
+ * returned partially.
+ */
+START_TEST(test_scpi_block_oversize)
+{
+	struct sr_scpi_dev_inst scpi;
+	struct fake_scpi fake;
+	GByteArray *block;
+	uint8_t buf[8];
+	size_t datalen;
+	int ret;
+
+	block = block_new(100, "\n");
+	fake_init(&scpi, &fake, SCPI_TRANSPORT_USBTMC,
+		block->data, block->len, 5);
+	ret = sr_scpi_read_block(&scpi, NULL, buf, sizeof(buf), &datalen,
+		NULL, NULL);
+	fail_unless(ret == SR_ERR_DATA);
+	fail_unless(datalen == 0);
+	fail_unless(fake.pos == fake.len, "Block not drained.");
+	fake_free(&scpi, &fake);
+	g_byte_array_free(block, TRUE);
+}
+END_TEST
+
+/*
+ * Check incomplete blocks: the consumer has seen the data which was
+ * received, and the length reflects it. Timeouts are told apart from
+ * transport errors, and consumers can abort the reception.
+ */
+START_TEST(test_scpi_block_incomplete)
+{
+	struct sr_scpi_dev_inst scpi;
+	struct fake_scpi fake;
+	struct block_sink sink;
+	GByteArray *block;
+	uint8_t buf[16];
+	size_t datalen;
+	int ret;
+
+	block = block_new(100, "\n");
+
+	/* Data stops after 40 bytes of the block. */
+	fake_init(&scpi, &fake, SCPI_TRANSPORT_USBTMC,
+		block->data, 5 + 40, 8);
+	block_sink_init(&sink, 4);
+	ret = sr_scpi_read_block(&scpi, NULL, buf, sizeof(buf), &datalen,
+		block_sink_cb, &sink);
+	fail_unless(ret == SR_ERR_TIMEOUT, "Error %d.", ret);
+	fail_unless(datalen == 40);
+	fail_unless(sink.data->len == 40);
+	fail_unless(memcmp(sink.data->data, block->data + 5, 40) == 0);
+	g_byte_array_free(sink.data, TRUE);
+	fake_free(&scpi, &fake);
+
+	/* Transport error after 40 bytes of the block. */
+	fake_init(&scpi, &fake, SCPI_TRANSPORT_USBTMC,
+		block->data, block->len, 8);
+	fake.fail_at = 5 + 40;
+	block_sink_init(&sink, 4);
+	ret = sr_scpi_read_block(&scpi, NULL, buf, sizeof(buf), &datalen,
+		block_sink_cb, &sink);
+	fail_unless(ret != SR_OK && ret != SR_ERR_TIMEOUT, "Error %d.", ret);
+	fail_unless(datalen == 40);
+	fail_unless(sink.data->len == 40);
+	g_byte_array_free(sink.data, TRUE);
+	fake_free(&scpi, &fake);
+
+	/* The consumer aborts. */
+	fake_init(&scpi, &fake, SCPI_TRANSPORT_USBTMC,
+		block->data, block->len, 8);
+	block_sink_init(&sink, 4);
+	sink.ret = SR_ERR_IO;
+	ret = sr_scpi_read_block(&scpi, NULL, buf, sizeof(buf), &datalen,
+		block_sink_cb, &sink);
+	fail_unless(ret == SR_ERR_IO, "Error %d.", ret);
+	fail_unless(sink.calls == 1);
+	g_byte_array_free(sink.data, TRUE);
+	fake_free(&scpi, &fake);
+
+	/* The consumer stalls, with units larger than the window. */
+	fake_init(&scpi, &fake, SCPI_TRANSPORT_USBTMC,
+		block->data, block->len, 8);
+	block_sink_init(&sink, 32);
+	ret = sr_scpi_read_block(&scpi, NULL, buf, sizeof(buf), &datalen,
+		block_sink_cb, &sink);
+	fail_unless(ret == SR_ERR_DATA, "Error %d.", ret);
+	fail_unless(sink.data->len == 0);
+	g_byte_array_free(sink.data, TRUE);
+	fake_free(&scpi, &fake);
+
+	g_byte_array_free(block, TRUE);
+}
+END_TEST
+
+Suite *suite_scpi(void)
+{
+	Suite *s;
+	TCase *tc;
+
+	s = suite_create("scpi");
+
+	tc = tcase_create("block");
+	tcase_add_checked_fixture(tc, srtest_setup, srtest_teardown);
+	tcase_add_test(tc, test_scpi_block_buffer);
+	tcase_add_test(tc, test_scpi_block_window);
+	tcase_add_test(tc, test_scpi_block_empty);
+	tcase_add_test(tc, test_scpi_block_header);
+	tcase_add_test(tc, test_scpi_block_trailer);
+	tcase_add_test(tc, test_scpi_block_oversize);
+	tcase_add_test(tc, test_scpi_block_incomplete);
+	suite_add_tcase(s, tc);
+
+	return s;
+}
@@ -19,9 +19,13 @@
 
 #include <config.h>
 #include <stdlib.h>
+#include <string.h>
 #include <check.h>
+#include <zip.h>
+#include <glib/gstdio.h>
 #include <libsigrok/libsigrok.h>
 #include "lib.h"
+#include "libsigrok-internal.h"
 
 /*
  * Check whether sr_session_new() works.
@@ -185,6 +189,345 @@ START_TEST(test_session_trigger_get_null)
 }
 END_TEST
 
+static void datafeed_cb(const struct sr_dev_inst *sdi,
+		const struct sr_datafeed_packet *packet, void *cb_data)
+{
+	(void)sdi;
+	(void)packet;
+	(void)cb_data;
+}
+
+/*
+ * Check the threaded datafeed configuration and statistics for
+ * sessions which have not run yet.
+ */
+START_TEST(test_session_datafeed_threads)
+{
+	int ret, data;
+	struct sr_session *sess;
+	struct sr_datafeed_queue_stats stats;
+
+	sr_session_new(srtest_ctx, &sess);
+
+	ret = sr_session_datafeed_threads_set(NULL, 16,
+		SR_DATAFEED_QUEUE_BLOCK);
+	fail_unless(ret == SR_ERR_ARG);
+	ret = sr_session_datafeed_threads_set(sess, 16, 1234);
+	fail_unless(ret == SR_ERR_ARG);
+	ret = sr_session_datafeed_threads_set(sess, 16,
+		SR_DATAFEED_QUEUE_DROP);
+	fail_unless(ret == SR_OK);
+
+	/* Unknown callbacks have no statistics. */
+	ret = sr_session_datafeed_stats_get(sess, datafeed_cb, &data, &stats);
+	fail_unless(ret == SR_ERR_ARG);
+
+	sr_session_datafeed_callback_add(sess, datafeed_cb, &data);
+	ret = sr_session_datafeed_stats_get(sess, datafeed_cb, NULL, &stats);
+	fail_unless(ret == SR_ERR_ARG);
+	memset(&stats, 0xff, sizeof(stats));
+	ret = sr_session_datafeed_stats_get(sess, datafeed_cb, &data, &stats);
+	fail_unless(ret == SR_OK);
+	fail_unless(stats.packets == 0 && stats.dropped == 0);
+	fail_unless(stats.depth == 0 && stats.max_depth == 0);
+	fail_unless(stats.latency_avg_us == 0 && stats.latency_max_us == 0);
+
+	sr_session_destroy(sess);
+}
+END_TEST
+
+/* A packet type which sr_packet_copy() doesn't know. */
+#define BOGUS_PACKET_TYPE 0x7fff
+
+static void bogus_cb(const struct sr_dev_inst *sdi,
+		const struct sr_datafeed_packet *packet, void *cb_data)
+{
+	int *count;
+
+	(void)sdi;
+
+	count = cb_data;
+	if ((int)packet->type == BOGUS_PACKET_TYPE)
+		(*count)++;
+}
+
+/*
+ * Check that a packet which cannot get queued for threaded callbacks
+ * still reaches the synchronous callbacks after them.
+ */
+START_TEST(test_session_datafeed_queue_error)
+{
+	struct sr_session *sess;
+	struct sr_dev_inst *sdi;
+	struct sr_datafeed_packet packet;
+	int ret, threaded, synchronous;
+
+	sdi = srtest_demo_get(8, 0);
+	ret = sr_config_set(sdi, NULL, SR_CONF_LIMIT_SAMPLES,
+		g_variant_new_uint64(1000));
+	fail_unless(ret == SR_OK);
+
+	sr_session_new(srtest_ctx, &sess);
+	sr_session_dev_add(sess, sdi);
+	ret = sr_session_datafeed_threads_set(sess, 4,
+		SR_DATAFEED_QUEUE_BLOCK);
+	fail_unless(ret == SR_OK);
+	threaded = synchronous = 0;
+	sr_session_datafeed_callback_add(sess, bogus_cb, &threaded);
+	ret = sr_session_start(sess);
+	fail_unless(ret == SR_OK, "Cannot start session: %d.", ret);
+
+	/* Callbacks which get added to a running session are synchronous. */
+	sr_session_datafeed_callback_add(sess, bogus_cb, &synchronous);
+	packet.type = BOGUS_PACKET_TYPE;
+	packet.payload = NULL;
+	ret = sr_session_send(sdi, &packet);
+	fail_unless(ret != SR_OK, "Bogus packet was queued.");
+	fail_unless(synchronous == 1, "Synchronous callback was skipped.");
+
+	ret = sr_session_run(sess);
+	fail_unless(ret == SR_OK, "Cannot run session: %d.", ret);
+	fail_unless(threaded == 0);
+	sr_session_destroy(sess);
+	sr_dev_close(sdi);
+}
+END_TEST
+
+/* Check enabling overviews, before the session runs. */
+START_TEST(test_session_overview_enable)
+{
+	int ret;
+	struct sr_session *sess;
+	struct sr_dev_inst *sdi;
+
+	sr_session_new(srtest_ctx, &sess);
+	sdi = sr_dev_inst_user_new("Vendor", "Model", "Version");
+	sr_session_dev_add(sess, sdi);
+
+	ret = sr_session_overview_enable(NULL, 0);
+	fail_unless(ret == SR_ERR_ARG);
+	ret = sr_session_overview_enable(sess, 1000);
+	fail_unless(ret == SR_ERR_ARG);
+	ret = sr_session_overview_enable(sess, 0);
+	fail_unless(ret == SR_OK);
+	ret = sr_session_overview_enable(sess, 4096);
+	fail_unless(ret == SR_OK);
+
+	/* Overviews get created when the session starts. */
+	fail_unless(sr_session_overview_get(sess, sdi) == NULL);
+	fail_unless(sr_overview_get_info(NULL, NULL, NULL, NULL) == SR_ERR_ARG);
+
+	sr_session_destroy(sess);
+}
+END_TEST
+
+/*
+ * Check that overviews which sr_session_datafeed_callback_remove_all()
+ * disabled get built again after re-enabling them, over multiple bins
+ * and levels, for logic and analog data.
+ */
+START_TEST(test_session_overview_run)
+{
+	struct sr_session *sess;
+	struct sr_dev_inst *sdi;
+	struct sr_overview *ov;
+	uint8_t bits_or[8], bits_and[8], bits_changed[8];
+	float min[8], max[8];
+	uint64_t limit, count;
+	unsigned int num_analog;
+	int ret, i;
+
+	/* Four blocks of the third level. */
+	limit = 16 * 16 * 16 * 4;
+	sdi = srtest_demo_get(8, 1);
+	ret = sr_config_set(sdi, NULL, SR_CONF_LIMIT_SAMPLES,
+		g_variant_new_uint64(limit));
+	fail_unless(ret == SR_OK);
+
+	sr_session_new(srtest_ctx, &sess);
+	sr_session_dev_add(sess, sdi);
+	ret = sr_session_overview_enable(sess, 16);
+	fail_unless(ret == SR_OK);
+	ret = sr_session_datafeed_callback_remove_all(sess);
+	fail_unless(ret == SR_OK);
+	fail_unless(sr_session_overview_get(sess, sdi) == NULL);
+	ret = sr_session_overview_enable(sess, 16);
+	fail_unless(ret == SR_OK);
+
+	ret = sr_session_start(sess);
+	fail_unless(ret == SR_OK, "Cannot start session: %d.", ret);
+	ret = sr_session_run(sess);
+	fail_unless(ret == SR_OK, "Cannot run session: %d.", ret);
+
+	ov = sr_session_overview_get(sess, sdi);
+	fail_unless(ov != NULL, "No overview after re-enabling.");
+	ret = sr_overview_get_info(ov, NULL, NULL, &num_analog);
+	fail_unless(ret == SR_OK && num_analog == 1);
+	ret = sr_overview_get_num_samples(ov, SR_CHANNEL_LOGIC, 0, &count);
+	fail_unless(ret == SR_OK && count == limit,
+		"Logic overview has %" PRIu64 " samples.", count);
+	ret = sr_overview_get_num_samples(ov, SR_CHANNEL_ANALOG, 0, &count);
+	fail_unless(ret == SR_OK && count == limit,
+		"Analog overview has %" PRIu64 " samples.", count);
+
+	ret = sr_overview_logic_get(ov, 0, limit, 8,
+		bits_or, bits_and, bits_changed);
+	fail_unless(ret == SR_OK);
+	for (i = 0; i < 8; i++) {
+		fail_unless(bits_or[i] == 0xff && bits_and[i] == 0xff,
+			"Bin %d: OR 0x%02x, AND 0x%02x.", i, bits_or[i],
+			bits_and[i]);
+		fail_unless(bits_changed[i] == 0x00);
+	}
+
+	ret = sr_overview_analog_get(ov, 0, 100, limit - 200, 8, min, max);
+	fail_unless(ret == SR_OK);
+	for (i = 0; i < 8; i++) {
+		fail_unless(min[i] == -10.0f && max[i] == 10.0f,
+			"Bin %d: %f..%f.", i, min[i], max[i]);
+	}
+
+	sr_session_destroy(sess);
+	sr_dev_close(sdi);
+}
+END_TEST
+
+/*
+ * Capture file chunk sizes in bytes, for 16 channels. The 20 MiB chunk
+ * is above the session driver's streaming threshold. The small chunks
+ * around the large ones get decompressed by other read-ahead workers,
+ * and complete before the chunks which precede them.
+ */
+static const size_t load_chunks[] = {
+	8 * 1024 * 1024, 2, 20 * 1024 * 1024, 1024 * 1024,
+	4 * 1024 * 1024 + 2, 2,
+};
+
+static void load_cb(const struct sr_dev_inst *sdi,
+		const struct sr_datafeed_packet *packet, void *cb_data)
+{
+	const struct sr_datafeed_logic *logic;
+	GByteArray *received;
+
+	(void)sdi;
+
+	received = cb_data;
+	if (packet->type != SR_DF_LOGIC)
+		return;
+	logic = packet->payload;
+	fail_unless(logic->unitsize == 2);
+	g_byte_array_append(received, logic->data, logic->length);
+}
+
+/*
+ * Write the session file by hand, the srzip output module doesn't
+ * create chunks which are large enough to get streamed.
+ */
+static void load_write(const char *filename, const uint8_t *data)
+{
+	struct zip *archive;
+	struct zip_source *src;
+	GKeyFile *meta;
+	char *metabuf, *name, *key;
+	gsize metalen;
+	size_t idx, offset;
+	int ret;
+
+	g_unlink(filename);
+	archive = zip_open(filename, ZIP_CREATE, &ret);
+	fail_unless(archive != NULL, "Cannot create '%s': %d.", filename, ret);
+
+	src = zip_source_buffer(archive, "2", 1, 0);
+	fail_unless(zip_add(archive, "version", src) >= 0);
+
+	meta = g_key_file_new();
+	g_key_file_set_string(meta, "global", "sigrok version",
+		sr_package_version_string_get());
+	g_key_file_set_string(meta, "device 1", "capturefile", "logic-1");
+	g_key_file_set_integer(meta, "device 1", "total probes", 16);
+	g_key_file_set_string(meta, "device 1", "samplerate", "1 MHz");
+	g_key_file_set_integer(meta, "device 1", "total analog", 0);
+	for (idx = 0; idx < 16; idx++) {
+		key = g_strdup_printf("probe%zu", idx + 1);
+		name = g_strdup_printf("D%zu", idx);
+		g_key_file_set_string(meta, "device 1", key, name);
+		g_free(name);
+		g_free(key);
+	}
+	g_key_file_set_integer(meta, "device 1", "unitsize", 2);
+	metabuf = g_key_file_to_data(meta, &metalen, NULL);
+	src = zip_source_buffer(archive, metabuf, metalen, 0);
+	fail_unless(zip_add(archive, "metadata", src) >= 0);
+
+	offset = 0;
+	for (idx = 0; idx < G_N_ELEMENTS(load_chunks); idx++) {
+		name = g_strdup_printf("logic-1-%zu", idx + 1);
+		src = zip_source_buffer(archive, data + offset,
+			load_chunks[idx], 0);
+		fail_unless(zip_add(archive, name, src) >= 0);
+		g_free(name);
+		offset += load_chunks[idx];
+	}
+
+	fail_unless(zip_close(archive) == 0, "Cannot write '%s'.", filename);
+	g_free(metabuf);
+	g_key_file_free(meta);
+}
+
+/*
+ * Check that loading a session file of many chunks, with read-ahead
+ * and streamed chunks, replays exactly the data which was written.
+ */
+START_TEST(test_session_load_chunks)
+{
+	struct sr_session *sess;
+	GByteArray *received;
+	uint8_t *data;
+	uint32_t state;
+	size_t total, idx;
+	char *filename;
+	int ret;
+
+	total = 0;
+	for (idx = 0; idx < G_N_ELEMENTS(load_chunks); idx++)
+		total += load_chunks[idx];
+	data = g_malloc(total);
+	state = 1;
+	for (idx = 0; idx < total; idx++) {
+		state = state * 1664525 + 1013904223;
+		/* Compressible, but no chunk looks like another. */
+		data[idx] = (state >> 24) & 0x0f;
+	}
+
+	filename = g_build_filename(g_get_tmp_dir(),
+		"libsigrok-test-session-load.sr", NULL);
+	load_write(filename, data);
+
+	ret = sr_session_load(srtest_ctx, filename, &sess);
+	fail_unless(ret == SR_OK, "Cannot load '%s': %d.", filename, ret);
+	received = g_byte_array_sized_new(total);
+	sr_session_datafeed_callback_add(sess, load_cb, received);
+	ret = sr_session_start(sess);
+	fail_unless(ret == SR_OK, "Cannot start session: %d.", ret);
+	ret = sr_session_run(sess);
+	fail_unless(ret == SR_OK, "Cannot run session: %d.", ret);
+
+	fail_unless(received->len == total,
+		"Received %u of %zu bytes.", received->len, total);
+	for (idx = 0; idx < total; idx++) {
+		if (received->data[idx] != data[idx])
+			break;
+	}
+	fail_unless(idx == total, "Data differs at offset %zu.", idx);
+
+	sr_session_destroy(sess);
+	g_byte_array_free(received, TRUE);
+	g_unlink(filename);
+	g_free(filename);
+	g_free(data);
+}
+END_TEST
+
 Suite *suite_session(void)
 {
 	Suite *s;
@@ -209,5 +552,19 @@ Suite *suite_session(void)
 	tcase_add_test(tc, test_session_trigger_get_null);
 	suite_add_tcase(s, tc);
 
+	tc = tcase_create("datafeed");
+	tcase_add_checked_fixture(tc, srtest_setup, srtest_teardown);
+	tcase_add_test(tc, test_session_datafeed_threads);
+	tcase_add_test(tc, test_session_datafeed_queue_error);
+	tcase_add_test(tc, test_session_overview_enable);
+	tcase_add_test(tc, test_session_overview_run);
+	suite_add_tcase(s, tc);
+
+	tc = tcase_create("load");
+	tcase_set_timeout(tc, 0);
+	tcase_add_checked_fixture(tc, srtest_setup, srtest_teardown);
+	tcase_add_test(tc, test_session_load_chunks);
+	suite_add_tcase(s, tc);
+
 	return s;
 }
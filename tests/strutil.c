@@ -21,8 +21,10 @@
 #include <check.h>
 #include <errno.h>
 #include <locale.h>
+#include <string.h>
 #include <libsigrok/libsigrok.h>
 #include "lib.h"
+#include "libsigrok-internal.h"
 
 #if 0
 static void test_vsnprintf(const char *expected, char *format, ...)
@@ -430,6 +432,96 @@ START_TEST(test_exponent)
 }
 END_TEST
 
+static const char *atod_strings[] = {
+	/* 19 and 20 significant digits. */
+	"1234567890123456789", "12345678901234567890",
+	"0.001234567890123456789", "1234567890.123456789e-5",
+	"9999999999999999999", "99999999999999999999",
+	/* Mantissa 2^53 and 2^53 + 1. */
+	"9007199254740992", "9007199254740993",
+	"-9007199254740992e-22", "9007199254740993e-22",
+	"900719925474099.2", "900719925474099.3",
+	/* Powers of ten up to 22 are exact, 23 is not. */
+	"1e22", "1e23", "1e-22", "1e-23", "1E+22", "1E+23",
+	"4.5e22", "4.5e23", "123456789e-22", "123456789e-23",
+	"0.0000000000000000000001", "0.00000000000000000000001",
+	"1e308", "1e309", "1e-400", "-1e-400",
+	/* Signs, zero and incomplete numbers. */
+	"-0", "+0", "0", "-0.0", "-0e5", "1.", ".5", "-.5", "+.5", ".",
+	"-", "+", "", "1e", "1e+", "1e-", "e5", ".e5", "1.e5", "1e5.",
+	"--1", "+-1", "1..5", "0x10", "1,5", "inf", "nan",
+	/* Leading zeros. */
+	"007", "-00.25", "0000000000000000000000000001",
+	"0.00000000000000000000000000000000000001",
+	"00000000000000000000000000001234567890123456789",
+	/* Surrounding whitespace. */
+	" 1.5", "\t-2", "\n3e2", "1.5 ", "1.5\n", " 1.5 ", " ", "1 5",
+};
+
+static void test_atod_compare(const char *str)
+{
+	double value, expect;
+	char *end;
+	int ret, ok;
+
+	/* Strict conversion: all of the text, without range errors. */
+	errno = 0;
+	expect = g_ascii_strtod(str, &end);
+	ok = !*end && !errno;
+
+	value = 0.0;
+	ret = sr_atod_ascii(str, &value);
+	fail_unless((ret == SR_OK) == ok, "'%s': got %d, strtod %s.",
+		str, ret, ok ? "converts" : "fails");
+	if (ok)
+		fail_unless(memcmp(&value, &expect, sizeof(value)) == 0,
+			"'%s': got %.17g, strtod %.17g.", str, value, expect);
+}
+
+/*
+ * Check that the conversion matches g_ascii_strtod() bit for bit, at
+ * the limits of its fast path and for malformed input.
+ */
+START_TEST(test_atod_ascii)
+{
+	unsigned int i;
+
+	for (i = 0; i < ARRAY_SIZE(atod_strings); i++)
+		test_atod_compare(atod_strings[i]);
+}
+END_TEST
+
+/* Random decimals with up to 20 digits, and exponents around +-22. */
+START_TEST(test_atod_ascii_random)
+{
+	GRand *rand;
+	char str[64];
+	int i, d, num_digits, point;
+	size_t len;
+
+	rand = g_rand_new_with_seed(3);
+	for (i = 0; i < 200000; i++) {
+		len = 0;
+		if (g_rand_boolean(rand))
+			str[len++] = '-';
+		num_digits = g_rand_int_range(rand, 1, 21);
+		point = g_rand_int_range(rand, -1, num_digits + 1);
+		for (d = 0; d < num_digits; d++) {
+			if (d == point)
+				str[len++] = '.';
+			str[len++] = '0' + g_rand_int_range(rand, 0, 10);
+		}
+		if (g_rand_boolean(rand))
+			len += sprintf(str + len, "e%d",
+				g_rand_int_range(rand, -25, 26));
+		str[len] = '\0';
+		test_atod_compare(str);
+	}
+	g_rand_free(rand);
+}
+END_TEST
+
+
 START_TEST(test_text_line)
 {
 	/*
@@ -630,6 +722,11 @@ Suite *suite_strutil(void)
 	tcase_add_test(tc, test_exponent);
 	suite_add_tcase(s, tc);
 
+	tc = tcase_create("atod");
+	tcase_add_test(tc, test_atod_ascii);
+	tcase_add_test(tc, test_atod_ascii_random);
+	suite_add_tcase(s, tc);
+
 	tc = tcase_create("text");
 	tcase_add_test(tc, test_text_line);
 	tcase_add_test(tc, test_text_word);
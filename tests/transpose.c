@@ -0,0 +1,249 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * Copyright (C) 2026 The sigrok project developers
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+#include <check.h>
+#include <libsigrok/libsigrok.h>
+#include <string.h>
+#include "lib.h"
+#include "libsigrok-internal.h"
+#include "transpose.h"
+
+#define ROUNDS 1000
+
+/* Reproducible pseudo random input, independent of the C library. */
+static uint32_t rnd_state;
+
+static uint32_t rnd(void)
+{
+	rnd_state = rnd_state * 1664525 + 1013904223;
+	return rnd_state >> 8 ^ rnd_state << 8;
+}
+
+/* Each test runs against the selected code and the portable code. */
+static void (*const transpose_16x16[])(uint16_t *, const uint16_t *) = {
+	sr_transpose_16x16, sr_transpose_16x16_swar,
+};
+
+static void (*const transpose_32x16[])(uint32_t *, const uint16_t *) = {
+	sr_transpose_32x16, sr_transpose_32x16_halves, sr_transpose_32x16_swar,
+#if defined(SR_TRANSPOSE_AVX2)
+	sr_transpose_32x16_avx2,
+#endif
+};
+
+/* The number of 32x16 variants which the CPU can run, AVX2 is last. */
+static size_t transpose_32x16_count(void)
+{
+#if defined(SR_TRANSPOSE_AVX2)
+	if (!__builtin_cpu_supports("avx2"))
+		return ARRAY_SIZE(transpose_32x16) - 1;
+#endif
+	return ARRAY_SIZE(transpose_32x16);
+}
+
+static gboolean bit_at(const void *rows, size_t width, size_t row, size_t col)
+{
+	const uint8_t *p8 = rows;
+	const uint16_t *p16 = rows;
+	const uint32_t *p32 = rows;
+
+	if (width == 8)
+		return (p8[row] >> col) & 1;
+	if (width == 16)
+		return (p16[row] >> col) & 1;
+	return (p32[row] >> col) & 1;
+}
+
+START_TEST(test_transpose_8x8)
+{
+	uint8_t src[8], dst[8];
+	size_t r, i, j;
+
+	rnd_state = 1;
+	for (r = 0; r < ROUNDS; r++) {
+		for (i = 0; i < 8; i++)
+			src[i] = rnd();
+		sr_transpose_8x8(dst, src);
+		for (i = 0; i < 8; i++) {
+			for (j = 0; j < 8; j++)
+				fail_unless(bit_at(dst, 8, j, i) == bit_at(src, 8, i, j));
+		}
+		/* In place operation. */
+		sr_transpose_8x8(dst, dst);
+		fail_unless(memcmp(dst, src, sizeof(src)) == 0);
+	}
+}
+END_TEST
+
+START_TEST(test_transpose_16x16)
+{
+	uint16_t src[16], dst[16];
+	size_t f, r, i, j;
+
+	for (f = 0; f < ARRAY_SIZE(transpose_16x16); f++) {
+		rnd_state = 2;
+		for (r = 0; r < ROUNDS; r++) {
+			for (i = 0; i < 16; i++)
+				src[i] = rnd();
+			transpose_16x16[f](dst, src);
+			for (i = 0; i < 16; i++) {
+				for (j = 0; j < 16; j++)
+					fail_unless(bit_at(dst, 16, j, i) == bit_at(src, 16, i, j));
+			}
+			transpose_16x16[f](dst, dst);
+			fail_unless(memcmp(dst, src, sizeof(src)) == 0);
+		}
+	}
+}
+END_TEST
+
+START_TEST(test_transpose_32x16)
+{
+	uint16_t src[32];
+	uint32_t dst[16];
+	size_t f, r, i, j;
+
+	for (f = 0; f < transpose_32x16_count(); f++) {
+		rnd_state = 3;
+		for (r = 0; r < ROUNDS; r++) {
+			for (i = 0; i < 32; i++)
+				src[i] = rnd();
+			transpose_32x16[f](dst, src);
+			for (i = 0; i < 32; i++) {
+				for (j = 0; j < 16; j++)
+					fail_unless(bit_at(dst, 32, j, i) == bit_at(src, 16, i, j));
+			}
+		}
+	}
+}
+END_TEST
+
+/* The scalar code of the asix-sigma driver, which the helpers replace. */
+static uint16_t ref_deinterlace_2x8(uint16_t indata, int idx)
+{
+	uint16_t outdata;
+	int i;
+
+	indata >>= idx;
+	outdata = 0;
+	for (i = 0; i < 8; i++)
+		outdata |= (indata >> (i * 2 - i)) & (1 << i);
+	return outdata;
+}
+
+static uint16_t ref_deinterlace_4x4(uint16_t indata, int idx)
+{
+	uint16_t outdata;
+	int i;
+
+	indata >>= idx;
+	outdata = 0;
+	for (i = 0; i < 4; i++)
+		outdata |= (indata >> (i * 4 - i)) & (1 << i);
+	return outdata;
+}
+
+START_TEST(test_deinterleave)
+{
+	uint32_t word;
+	uint16_t samples;
+	int idx;
+
+	for (word = 0; word <= 0xffff; word++) {
+		samples = sr_deinterleave_2x8(word);
+		for (idx = 0; idx < 2; idx++) {
+			fail_unless(((samples >> (8 * idx)) & 0xff) ==
+				ref_deinterlace_2x8(word, idx));
+		}
+		samples = sr_deinterleave_4x4(word);
+		for (idx = 0; idx < 4; idx++) {
+			fail_unless(((samples >> (4 * idx)) & 0xf) ==
+				ref_deinterlace_4x4(word, idx));
+		}
+	}
+}
+END_TEST
+
+/*
+ * Channel-planar data the way kingst-la2016 and saleae-logic16 stream
+ * it: one 16bit word per enabled channel, which carries 16 samples.
+ * Compare the drivers' former scalar conversion against scattering
+ * the words to their channels' rows and transposing.
+ */
+START_TEST(test_planar_channels)
+{
+	uint32_t channel_masks[32], ref[16], samples[16];
+	uint16_t words[32], rows[32];
+	size_t channel_index[32];
+	size_t f, r, i, bit, count;
+	uint32_t enabled;
+
+	rnd_state = 4;
+	for (r = 0; r < ROUNDS; r++) {
+		enabled = rnd() | 1;
+		count = 0;
+		for (i = 0; i < 32; i++) {
+			if (!(enabled & (1UL << i)))
+				continue;
+			channel_masks[count] = 1UL << i;
+			channel_index[count++] = i;
+		}
+		for (i = 0; i < count; i++)
+			words[i] = rnd();
+
+		memset(ref, 0, sizeof(ref));
+		for (i = 0; i < count; i++) {
+			for (bit = 0; bit < 16; bit++) {
+				if (words[i] & (1UL << bit))
+					ref[bit] |= channel_masks[i];
+			}
+		}
+
+		memset(rows, 0, sizeof(rows));
+		for (i = 0; i < count; i++)
+			rows[channel_index[i]] = words[i];
+		for (f = 0; f < transpose_32x16_count(); f++) {
+			transpose_32x16[f](samples, rows);
+			fail_unless(memcmp(samples, ref, sizeof(ref)) == 0);
+		}
+	}
+}
+END_TEST
+
+Suite *suite_transpose(void)
+{
+	Suite *s;
+	TCase *tc;
+
+	s = suite_create("transpose");
+
+	tc = tcase_create("matrix");
+	tcase_add_test(tc, test_transpose_8x8);
+	tcase_add_test(tc, test_transpose_16x16);
+	tcase_add_test(tc, test_transpose_32x16);
+	suite_add_tcase(s, tc);
+
+	tc = tcase_create("samples");
+	tcase_add_test(tc, test_deinterleave);
+	tcase_add_test(tc, test_planar_channels);
+	suite_add_tcase(s, tc);
+
+	return s;
+}
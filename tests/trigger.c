@@ -20,9 +20,11 @@
 #include <config.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <check.h>
 #include <libsigrok/libsigrok.h>
 #include "lib.h"
+#include "libsigrok-internal.h"
 
 /* Test lots of triggers/stages/matches/channels */
 #define NUM_TRIGGERS 70
@@ -249,6 +251,595 @@ START_TEST(test_trigger_match_add_bogus)
 }
 END_TEST
 
+/* Reproducible pseudo random input, independent of the C library. */
+static uint32_t rnd_state;
+
+static uint32_t rnd(void)
+{
+	rnd_state = rnd_state * 1664525 + 1013904223;
+	return rnd_state >> 8 ^ rnd_state << 8;
+}
+
+/* Logic data and the position of the trigger marker in the datafeed. */
+struct trigger_feed {
+	GByteArray *data;
+	int64_t trigger_pos;
+};
+
+static void trigger_feed_cb(const struct sr_dev_inst *sdi,
+		const struct sr_datafeed_packet *packet, void *cb_data)
+{
+	struct trigger_feed *feed;
+	const struct sr_datafeed_logic *logic;
+
+	(void)sdi;
+
+	feed = cb_data;
+	if (packet->type == SR_DF_TRIGGER) {
+		feed->trigger_pos = feed->data->len;
+	} else if (packet->type == SR_DF_LOGIC) {
+		logic = packet->payload;
+		g_byte_array_append(feed->data, logic->data, logic->length);
+	}
+}
+
+static void trigger_feed_reset(struct trigger_feed *feed)
+{
+	g_byte_array_set_size(feed->data, 0);
+	feed->trigger_pos = -1;
+}
+
+static struct sr_dev_inst *rle_sdi(struct sr_session *sess)
+{
+	struct sr_dev_inst *sdi;
+	char name[4];
+	int i;
+
+	sdi = sr_dev_inst_user_new("Vendor", "Model", "Version");
+	for (i = 0; i < 8; i++) {
+		snprintf(name, sizeof(name), "D%d", i);
+		sr_dev_inst_channel_add(sdi, i, SR_CHANNEL_LOGIC, name);
+	}
+	sr_session_dev_add(sess, sdi);
+
+	return sdi;
+}
+
+static struct sr_trigger *rle_trigger(struct sr_dev_inst *sdi, int kind)
+{
+	struct sr_trigger *t;
+	struct sr_trigger_stage *stage;
+	struct sr_channel *ch[4];
+	GSList *l;
+	int i;
+
+	for (l = sdi->channels, i = 0; i < 4; l = l->next, i++)
+		ch[i] = l->data;
+
+	t = sr_trigger_new("RLE");
+	stage = sr_trigger_stage_add(t);
+	switch (kind) {
+	case 0:
+		sr_trigger_match_add(stage, ch[0], SR_TRIGGER_RISING, 0);
+		break;
+	case 1:
+		sr_trigger_match_add(stage, ch[2], SR_TRIGGER_ZERO, 0);
+		sr_trigger_match_add(stage, ch[3], SR_TRIGGER_ONE, 0);
+		break;
+	case 2:
+		sr_trigger_match_add(stage, ch[0], SR_TRIGGER_ONE, 0);
+		stage = sr_trigger_stage_add(t);
+		sr_trigger_match_add(stage, ch[1], SR_TRIGGER_FALLING, 0);
+		break;
+	default:
+		/* A partial match of three stages which can fail late. */
+		sr_trigger_match_add(stage, ch[0], SR_TRIGGER_ONE, 0);
+		stage = sr_trigger_stage_add(t);
+		sr_trigger_match_add(stage, ch[1], SR_TRIGGER_ONE, 0);
+		stage = sr_trigger_stage_add(t);
+		sr_trigger_match_add(stage, ch[2], SR_TRIGGER_EDGE, 0);
+		stage = sr_trigger_stage_add(t);
+		sr_trigger_match_add(stage, ch[3], SR_TRIGGER_ONE, 0);
+		break;
+	}
+
+	return t;
+}
+
+/* Runs which carry no match for the edge trigger, some span batches. */
+static const uint64_t quiet_runs[] = { 0, 10, 4095, 4097, 4500 };
+
+#define RLE_RUNS	5000
+#define RLE_PRE_TRIGGER	100
+
+/* Random runs, the first are quiet. Returns the number of samples. */
+static uint64_t rle_runs(uint8_t *values, uint64_t *lengths, uint8_t *data,
+		uint64_t quiet)
+{
+	uint64_t run, total, i, len;
+
+	total = 0;
+	for (run = 0; run < RLE_RUNS; run++) {
+		if (run < quiet)
+			values[run] = (run & 1) << 2;
+		else
+			values[run] = rnd() & 0x0f;
+		len = rnd() % 8 ? rnd() % 4 + 1 : rnd() % 60;
+		lengths[run] = len;
+		for (i = 0; i < len; i++)
+			data[total++] = values[run];
+	}
+
+	return total;
+}
+
+/*
+ * Check that the soft trigger finds the same position in run-length
+ * encoded data as in the expanded data, with runs longer than the
+ * stages, and matches in later batches of runs. Both checks must send
+ * the same pre-trigger data.
+ */
+START_TEST(test_soft_trigger_rle)
+{
+	struct sr_session *sess;
+	struct sr_dev_inst *sdi;
+	struct sr_trigger *t;
+	struct soft_trigger_logic *stl;
+	struct sr_datafeed_logic_rle rle;
+	struct trigger_feed ref_feed, rle_feed;
+	uint8_t *values, *data;
+	uint64_t *lengths, total;
+	int64_t offset;
+	int kind, ref, q, pre_ref, pre_rle;
+
+	sr_session_new(srtest_ctx, &sess);
+	sdi = rle_sdi(sess);
+	ref_feed.data = g_byte_array_new();
+	rle_feed.data = g_byte_array_new();
+
+	values = g_malloc(RLE_RUNS);
+	lengths = g_malloc(RLE_RUNS * sizeof(*lengths));
+	data = g_malloc(RLE_RUNS * 64);
+	rnd_state = 1;
+	for (kind = 0; kind < 4; kind++) {
+		for (q = 0; q < (int)ARRAY_SIZE(quiet_runs); q++) {
+			total = rle_runs(values, lengths, data, quiet_runs[q]);
+			t = rle_trigger(sdi, kind);
+
+			trigger_feed_reset(&ref_feed);
+			sr_session_datafeed_callback_add(sess,
+				trigger_feed_cb, &ref_feed);
+			stl = soft_trigger_logic_new(sdi, t, RLE_PRE_TRIGGER);
+			fail_unless(stl != NULL);
+			ref = soft_trigger_logic_check(stl, data, total,
+				&pre_ref);
+			soft_trigger_logic_free(stl);
+			sr_session_datafeed_callback_remove_all(sess);
+
+			trigger_feed_reset(&rle_feed);
+			sr_session_datafeed_callback_add(sess,
+				trigger_feed_cb, &rle_feed);
+			stl = soft_trigger_logic_new(sdi, t, RLE_PRE_TRIGGER);
+			rle.num_runs = RLE_RUNS;
+			rle.unitsize = 1;
+			rle.values = values;
+			rle.lengths = lengths;
+			offset = soft_trigger_logic_check_rle(stl, &rle,
+				&pre_rle);
+			soft_trigger_logic_free(stl);
+			sr_session_datafeed_callback_remove_all(sess);
+			sr_trigger_free(t);
+
+			fail_unless(offset == ref, "Trigger %d, %" PRIu64
+				" quiet runs: offset %" PRId64 ", not %d.",
+				kind, quiet_runs[q], offset, ref);
+			if (ref < 0)
+				continue;
+			fail_unless(pre_rle == pre_ref);
+			fail_unless(pre_ref == MIN(ref, RLE_PRE_TRIGGER));
+			fail_unless(rle_feed.trigger_pos == ref_feed.trigger_pos);
+			fail_unless(rle_feed.data->len == ref_feed.data->len);
+			fail_unless(memcmp(rle_feed.data->data,
+				data + ref - pre_ref, pre_ref) == 0,
+				"Trigger %d, %" PRIu64 " quiet runs: wrong"
+				" pre-trigger data.", kind, quiet_runs[q]);
+		}
+	}
+
+	g_free(data);
+	g_free(lengths);
+	g_free(values);
+	g_byte_array_free(rle_feed.data, TRUE);
+	g_byte_array_free(ref_feed.data, TRUE);
+	sr_session_destroy(sess);
+}
+END_TEST
+
+/*
+ * Check the soft trigger of a run-length encoded feed queue. Its runs
+ * get checked in several flushes, and the datafeed must carry the
+ * pre-trigger samples, the marker, and all samples from the trigger
+ * position on.
+ */
+START_TEST(test_soft_trigger_feed_queue)
+{
+	struct sr_session *sess;
+	struct sr_dev_inst *sdi;
+	struct sr_trigger *t;
+	struct soft_trigger_logic *stl;
+	struct feed_queue_logic *fq;
+	struct trigger_feed feed;
+	uint8_t *values, *data;
+	uint64_t *lengths, total, run;
+	int kind, ref, q, pre;
+	int ret;
+
+	sr_session_new(srtest_ctx, &sess);
+	sdi = rle_sdi(sess);
+	feed.data = g_byte_array_new();
+	sr_session_datafeed_callback_add(sess, trigger_feed_cb, &feed);
+
+	values = g_malloc(RLE_RUNS);
+	lengths = g_malloc(RLE_RUNS * sizeof(*lengths));
+	data = g_malloc(RLE_RUNS * 64);
+	rnd_state = 2;
+	for (kind = 0; kind < 4; kind++) {
+		for (q = 0; q < (int)ARRAY_SIZE(quiet_runs); q++) {
+			total = rle_runs(values, lengths, data, quiet_runs[q]);
+			t = rle_trigger(sdi, kind);
+			stl = soft_trigger_logic_new(sdi, t, 0);
+			ref = soft_trigger_logic_check(stl, data, total, NULL);
+			soft_trigger_logic_free(stl);
+
+			trigger_feed_reset(&feed);
+			stl = soft_trigger_logic_new(sdi, t, RLE_PRE_TRIGGER);
+			fq = feed_queue_logic_alloc(sdi, 1000, 1);
+			fail_unless(fq != NULL);
+			ret = feed_queue_logic_set_rle(fq, TRUE);
+			fail_unless(ret == SR_OK);
+			ret = feed_queue_logic_set_soft_trigger(fq, stl);
+			fail_unless(ret == SR_OK);
+			for (run = 0; run < RLE_RUNS; run++) {
+				ret = feed_queue_logic_submit_one(fq,
+					&values[run], lengths[run]);
+				fail_unless(ret == SR_OK);
+			}
+			ret = feed_queue_logic_flush(fq);
+			fail_unless(ret == SR_OK);
+			fail_unless(feed_queue_logic_triggered(fq) == (ref >= 0));
+			feed_queue_logic_free(fq);
+			soft_trigger_logic_free(stl);
+			sr_trigger_free(t);
+
+			if (ref < 0) {
+				fail_unless(feed.data->len == 0);
+				fail_unless(feed.trigger_pos == -1);
+				continue;
+			}
+			pre = MIN(ref, RLE_PRE_TRIGGER);
+			fail_unless(feed.trigger_pos == pre,
+				"Trigger %d, %" PRIu64 " quiet runs: marker"
+				" after %" PRId64 " samples, not %d.", kind,
+				quiet_runs[q], feed.trigger_pos, pre);
+			fail_unless(feed.data->len == total - ref + pre);
+			fail_unless(memcmp(feed.data->data, data + ref - pre,
+				feed.data->len) == 0,
+				"Trigger %d, %" PRIu64 " quiet runs: wrong data.",
+				kind, quiet_runs[q]);
+		}
+	}
+
+	g_free(data);
+	g_free(lengths);
+	g_free(values);
+	g_byte_array_free(feed.data, TRUE);
+	sr_session_destroy(sess);
+}
+END_TEST
+
+/* Bit of a channel in a sample. */
+static int sample_bit(const uint8_t *data, int unitsize, int64_t sample,
+		int channel)
+{
+	return (data[sample * unitsize + channel / 8] >> (channel % 8)) & 1;
+}
+
+/*
+ * The trigger semantics, spelled out: the last sample of the first
+ * window of consecutive samples, where each stage's conditions hold
+ * for the stage's sample. Edges need the sample before.
+ */
+static int64_t ref_trigger_offset(const struct sr_trigger *t,
+		const uint8_t *data, int unitsize, int64_t num_samples)
+{
+	const struct sr_trigger_stage *stage;
+	const struct sr_trigger_match *match;
+	const GSList *l, *m;
+	int64_t start, sample;
+	int num_stages, curr, prev, ok;
+
+	num_stages = g_slist_length(t->stages);
+	for (start = 0; start + num_stages <= num_samples; start++) {
+		ok = TRUE;
+		sample = start;
+		for (l = t->stages; l && ok; l = l->next, sample++) {
+			stage = l->data;
+			for (m = stage->matches; m && ok; m = m->next) {
+				match = m->data;
+				curr = sample_bit(data, unitsize, sample,
+					match->channel->index);
+				prev = sample ? sample_bit(data, unitsize,
+					sample - 1, match->channel->index) : -1;
+				switch (match->match) {
+				case SR_TRIGGER_ZERO:
+					ok = !curr;
+					break;
+				case SR_TRIGGER_ONE:
+					ok = curr;
+					break;
+				case SR_TRIGGER_RISING:
+					ok = prev == 0 && curr;
+					break;
+				case SR_TRIGGER_FALLING:
+					ok = prev == 1 && !curr;
+					break;
+				default:
+					ok = prev >= 0 && prev != curr;
+					break;
+				}
+			}
+		}
+		if (ok)
+			return start + num_stages - 1;
+	}
+
+	return -1;
+}
+
+/* A trigger of one to four stages, with up to three conditions each. */
+static struct sr_trigger *random_trigger(struct sr_dev_inst *sdi,
+		int num_channels)
+{
+	static const int matches[] = {
+		SR_TRIGGER_ZERO, SR_TRIGGER_ONE, SR_TRIGGER_RISING,
+		SR_TRIGGER_FALLING, SR_TRIGGER_EDGE,
+	};
+	struct sr_trigger *t;
+	struct sr_trigger_stage *stage;
+	int num_stages, num_matches, used[3], s, i, j, ch;
+
+	t = sr_trigger_new("Random");
+	num_stages = rnd() % 4 + 1;
+	for (s = 0; s < num_stages; s++) {
+		stage = sr_trigger_stage_add(t);
+		num_matches = rnd() % 3 + 1;
+		for (i = 0; i < num_matches; i++) {
+			/* Distinct channels, across the whole unit size. */
+			do {
+				ch = rnd() % num_channels;
+				for (j = 0; j < i && used[j] != ch; j++)
+					;
+			} while (j < i);
+			used[i] = ch;
+			sr_trigger_match_add(stage,
+				g_slist_nth_data(sdi->channels, ch),
+				matches[rnd() % ARRAY_SIZE(matches)], 0);
+		}
+	}
+
+	return t;
+}
+
+#define ENGINE_SAMPLES	4000
+#define ENGINE_ROUNDS	60
+
+/*
+ * Check the trigger engine against the spelled out semantics, for unit
+ * sizes of one to eight bytes and more than 64 channels. Random
+ * multi-stage triggers see partial matches which fail and fall back,
+ * and the data gets checked in buffers of random size, down to single
+ * samples, so stages and edges span buffer boundaries. The datafeed
+ * must carry the pre-trigger samples, and the trigger marker.
+ */
+START_TEST(test_soft_trigger_engine)
+{
+	static const int unitsizes[] = { 1, 2, 3, 4, 8, 9, 16 };
+	static const int pre_sizes[] = { 0, 1, 7, 300 };
+	struct sr_session *sess;
+	struct sr_dev_inst *sdi;
+	struct sr_trigger *t;
+	struct soft_trigger_logic *stl;
+	struct trigger_feed feed;
+	uint8_t *data;
+	int64_t ref, offset, pos, len;
+	int u, unitsize, round, i, pre, pre_samples, expect_pre;
+	char name[16];
+
+	data = g_malloc(ENGINE_SAMPLES * 16);
+	feed.data = g_byte_array_new();
+	rnd_state = 5;
+	for (u = 0; u < (int)ARRAY_SIZE(unitsizes); u++) {
+		unitsize = unitsizes[u];
+		sr_session_new(srtest_ctx, &sess);
+		sdi = sr_dev_inst_user_new("Vendor", "Model", "Version");
+		for (i = 0; i < unitsize * 8; i++) {
+			snprintf(name, sizeof(name), "D%d", i);
+			sr_dev_inst_channel_add(sdi, i, SR_CHANNEL_LOGIC, name);
+		}
+		sr_session_dev_add(sess, sdi);
+		sr_session_datafeed_callback_add(sess, trigger_feed_cb, &feed);
+
+		for (round = 0; round < ENGINE_ROUNDS; round++) {
+			for (i = 0; i < ENGINE_SAMPLES * unitsize; i++)
+				data[i] = rnd();
+			t = random_trigger(sdi, unitsize * 8);
+			ref = ref_trigger_offset(t, data, unitsize,
+				ENGINE_SAMPLES);
+
+			pre = pre_sizes[round % ARRAY_SIZE(pre_sizes)];
+			stl = soft_trigger_logic_new(sdi, t, pre);
+			fail_unless(stl != NULL);
+			trigger_feed_reset(&feed);
+			offset = -1;
+			pre_samples = -1;
+			for (pos = 0; pos < ENGINE_SAMPLES; pos += len) {
+				len = round % 2 ? rnd() % 500 + 1 : rnd() % 4 + 1;
+				len = MIN(len, ENGINE_SAMPLES - pos);
+				offset = soft_trigger_logic_check(stl,
+					data + pos * unitsize, len * unitsize,
+					&pre_samples);
+				fail_unless(offset >= -1);
+				if (offset >= 0) {
+					offset += pos;
+					break;
+				}
+			}
+			soft_trigger_logic_free(stl);
+			sr_trigger_free(t);
+
+			fail_unless(offset == ref, "Unit size %d, round %d:"
+				" offset %" PRId64 ", not %" PRId64 ".",
+				unitsize, round, offset, ref);
+			if (ref < 0) {
+				fail_unless(feed.data->len == 0);
+				fail_unless(feed.trigger_pos == -1);
+				continue;
+			}
+			expect_pre = MIN(ref, pre);
+			fail_unless(pre_samples == expect_pre);
+			fail_unless(feed.trigger_pos == expect_pre * unitsize);
+			fail_unless(feed.data->len == (guint)expect_pre * unitsize);
+			fail_unless(memcmp(feed.data->data,
+				data + (ref - expect_pre) * unitsize,
+				feed.data->len) == 0, "Unit size %d, round %d:"
+				" wrong pre-trigger data.", unitsize, round);
+		}
+
+		sr_session_destroy(sess);
+	}
+	g_byte_array_free(feed.data, TRUE);
+	g_free(data);
+}
+END_TEST
+
+/*
+ * Trigger stages of four channels each, and samples of four channels.
+ * Conditions: '0', '1', 'r'ising, 'f'alling, 'e'dge, 'x' don't care.
+ */
+static const struct {
+	const char *stages;
+	const char *samples;
+	int offset;
+} fallback_cases[] = {
+	{ "1xxx 1xxx 0xxx", "1110", 3 },
+	{ "1xxx 1xxx 1xxx 0xxx", "111110", 5 },
+	{ "rxxx 1xxx fxxx", "010110", 5 },
+	{ "x1xx 1exx", "2231", 3 },
+	{ "rxxx", "1", -1 },
+	{ "exxx", "01", 1 },
+	{ "1xxx 0xxx 1xxx 1xxx", "1010101011", 9 },
+};
+
+static struct sr_trigger *fallback_trigger(struct sr_dev_inst *sdi,
+		const char *spec)
+{
+	struct sr_trigger *t;
+	struct sr_trigger_stage *stage;
+	int ch, match;
+
+	t = sr_trigger_new("Fallback");
+	while (*spec) {
+		stage = sr_trigger_stage_add(t);
+		for (ch = 0; ch < 4; ch++, spec++) {
+			switch (*spec) {
+			case '0':
+				match = SR_TRIGGER_ZERO;
+				break;
+			case '1':
+				match = SR_TRIGGER_ONE;
+				break;
+			case 'r':
+				match = SR_TRIGGER_RISING;
+				break;
+			case 'f':
+				match = SR_TRIGGER_FALLING;
+				break;
+			case 'e':
+				match = SR_TRIGGER_EDGE;
+				break;
+			default:
+				continue;
+			}
+			sr_trigger_match_add(stage,
+				g_slist_nth_data(sdi->channels, ch), match, 0);
+		}
+		if (*spec == ' ')
+			spec++;
+	}
+
+	return t;
+}
+
+/* Check the trigger in two buffers, or in buffers of single samples. */
+static int fallback_check(struct sr_dev_inst *sdi, struct sr_trigger *t,
+		uint8_t *data, int num_samples, int split)
+{
+	struct soft_trigger_logic *stl;
+	int pos, len, offset;
+
+	stl = soft_trigger_logic_new(sdi, t, 0);
+	offset = -1;
+	for (pos = 0; pos < num_samples; pos += len) {
+		len = split ? (pos < split ? split : num_samples) - pos : 1;
+		offset = soft_trigger_logic_check(stl, data + pos, len, NULL);
+		if (offset >= 0) {
+			offset += pos;
+			break;
+		}
+	}
+	soft_trigger_logic_free(stl);
+
+	return offset;
+}
+
+/*
+ * Check that multi-stage triggers fall back to the sample after the
+ * start of a partial match, when it fails. Partial matches and edges
+ * span buffer boundaries at all positions.
+ */
+START_TEST(test_soft_trigger_fallback)
+{
+	struct sr_session *sess;
+	struct sr_dev_inst *sdi;
+	struct sr_trigger *t;
+	uint8_t data[16];
+	int c, i, n, split, offset;
+
+	sr_session_new(srtest_ctx, &sess);
+	sdi = rle_sdi(sess);
+
+	for (c = 0; c < (int)ARRAY_SIZE(fallback_cases); c++) {
+		n = strlen(fallback_cases[c].samples);
+		for (i = 0; i < n; i++)
+			data[i] = g_ascii_xdigit_value(fallback_cases[c].samples[i]);
+		t = fallback_trigger(sdi, fallback_cases[c].stages);
+		fail_unless(ref_trigger_offset(t, data, 1, n) ==
+			fallback_cases[c].offset);
+		for (split = 0; split < n; split++) {
+			offset = fallback_check(sdi, t, data, n, split);
+			fail_unless(offset == fallback_cases[c].offset,
+				"'%s' on '%s', split %d: offset %d, not %d.",
+				fallback_cases[c].stages,
+				fallback_cases[c].samples, split, offset,
+				fallback_cases[c].offset);
+		}
+		sr_trigger_free(t);
+	}
+
+	sr_session_destroy(sess);
+}
+END_TEST
+
 Suite *suite_trigger(void)
 {
 	Suite *s;
@@ -276,5 +867,18 @@ Suite *suite_trigger(void)
 	tcase_add_test(tc, test_trigger_match_add_bogus);
 	suite_add_tcase(s, tc);
 
+	tc = tcase_create("soft_trigger");
+	tcase_add_checked_fixture(tc, srtest_setup, srtest_teardown);
+	tcase_add_test(tc, test_soft_trigger_rle);
+	tcase_add_test(tc, test_soft_trigger_feed_queue);
+	tcase_add_test(tc, test_soft_trigger_fallback);
+	suite_add_tcase(s, tc);
+
+	tc = tcase_create("soft_trigger_engine");
+	tcase_set_timeout(tc, 0);
+	tcase_add_checked_fixture(tc, srtest_setup, srtest_teardown);
+	tcase_add_test(tc, test_soft_trigger_engine);
+	suite_add_tcase(s, tc);
+
 	return s;
 }
@@ -0,0 +1,355 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * Copyright (C) 2026 The sigrok project developers
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+#include <check.h>
+#include <libsigrok/libsigrok.h>
+#include "lib.h"
+#include "libsigrok-internal.h"
+
+#ifdef HAVE_LIBUSB_1_0
+
+/* 1 MB/s in transfers of 10 ms, 40 ms queued: 4 transfers of 10240 bytes. */
+#define TUNER_BYTES_PER_MS 1000
+#define TUNER_BLOCK_SIZE 512
+#define TUNER_SIZE 10240
+#define TUNER_DEPTH 4
+#define TUNER_MAX_DEPTH 16
+
+/* One adjustment per this many completions, see sr_usb_tuner_complete(). */
+#define TUNER_WINDOW 16
+
+static gint64 fake_now;
+
+static gint64 fake_clock(void)
+{
+	return fake_now;
+}
+
+struct tuner_sim {
+	struct sr_usb_tuner *tuner;
+	struct libusb_transfer *transfers[TUNER_MAX_DEPTH];
+	uint64_t completions;
+};
+
+static void tuner_sim_init(struct tuner_sim *sim)
+{
+	unsigned int i;
+
+	sim->tuner = sr_usb_tuner_new(TUNER_BYTES_PER_MS, TUNER_BLOCK_SIZE,
+		10, 40, TUNER_MAX_DEPTH / 2);
+	sim->tuner->clock = fake_clock;
+	for (i = 0; i < TUNER_MAX_DEPTH; i++)
+		sim->transfers[i] = libusb_alloc_transfer(0);
+	sim->completions = 0;
+
+	/* The time source must not start at 0, which means "unset". */
+	fake_now = 1000 * 1000;
+	for (i = 0; i < sim->tuner->depth; i++)
+		sr_usb_tuner_submit(sim->tuner, sim->transfers[i]);
+}
+
+static void tuner_sim_free(struct tuner_sim *sim)
+{
+	unsigned int i;
+
+	sr_usb_tuner_free(sim->tuner, NULL);
+	for (i = 0; i < TUNER_MAX_DEPTH; i++)
+		libusb_free_transfer(sim->transfers[i]);
+}
+
+/*
+ * Have a transfer complete every interval_us, like a device which
+ * streams at a steady rate, with the given backlog of data in the
+ * consumer. The host resubmits each transfer turnaround_us after it
+ * completed. Transfers beyond the tuner's depth get retired, like
+ * drivers do.
+ */
+static void tuner_sim_run(struct tuner_sim *sim, unsigned int windows,
+		gint64 interval_us, gint64 turnaround_us, size_t backlog)
+{
+	struct libusb_transfer *transfer;
+	unsigned int i, count;
+	gint64 complete_us;
+
+	count = windows * TUNER_WINDOW;
+	if (!sim->completions)
+		count++;
+	for (i = 0; i < count; i++) {
+		transfer = sim->transfers[sim->completions % sim->tuner->depth];
+		sim->completions++;
+		fake_now += interval_us;
+		complete_us = fake_now;
+		sr_usb_tuner_complete(sim->tuner, transfer, backlog);
+		fake_now = complete_us + turnaround_us;
+		sr_usb_tuner_submit(sim->tuner, transfer);
+		fake_now = complete_us;
+		fail_unless(transfer->length == (int)sim->tuner->size);
+		fail_unless(transfer->timeout ==
+			sr_usb_tuner_timeout(sim->tuner));
+	}
+	for (i = sim->tuner->depth; i < TUNER_MAX_DEPTH; i++)
+		sr_usb_tuner_remove(sim->tuner, sim->transfers[i]);
+}
+
+/* Check the initial sizing, limits and timeouts. */
+START_TEST(test_tuner_new)
+{
+	struct sr_usb_tuner *tuner;
+
+	tuner = sr_usb_tuner_new(TUNER_BYTES_PER_MS, TUNER_BLOCK_SIZE,
+		10, 40, TUNER_MAX_DEPTH / 2);
+	fail_unless(tuner->size == TUNER_SIZE);
+	fail_unless(tuner->min_size == 5 * TUNER_BLOCK_SIZE);
+	fail_unless(tuner->max_size == 2 * TUNER_SIZE);
+	fail_unless(tuner->depth == TUNER_DEPTH);
+	fail_unless(tuner->min_depth == TUNER_DEPTH);
+	fail_unless(tuner->max_depth == TUNER_MAX_DEPTH);
+	/* 40 ms of queued data, plus 25%. */
+	fail_unless(sr_usb_tuner_timeout(tuner) == 50);
+
+	sr_usb_tuner_limit(tuner, 1000, 2);
+	fail_unless(tuner->max_size == 2 * TUNER_BLOCK_SIZE);
+	fail_unless(tuner->size == tuner->max_size);
+	fail_unless(tuner->min_size <= tuner->size);
+	fail_unless(tuner->depth == 2 && tuner->min_depth == 2);
+	fail_unless(tuner->max_depth == 2);
+	/* Never without a timeout, libusb takes 0 as none. */
+	fail_unless(sr_usb_tuner_timeout(tuner) == 10);
+	sr_usb_tuner_free(tuner, NULL);
+
+	/* Queues of less than one transfer, slow devices. */
+	tuner = sr_usb_tuner_new(0, 0, 10, 0, 8);
+	fail_unless(tuner->size == 10 && tuner->depth == 1);
+	sr_usb_tuner_free(tuner, NULL);
+}
+END_TEST
+
+/* Check that transfers grow and shrink within their limits. */
+START_TEST(test_tuner_size)
+{
+	struct tuner_sim sim;
+	uint64_t sum;
+	unsigned int i;
+
+	tuner_sim_init(&sim);
+
+	/* A window within the bounds of the completion interval. */
+	tuner_sim_run(&sim, 1, 10 * 1000, 0, 0);
+	fail_unless(sim.tuner->size == TUNER_SIZE);
+	fail_unless(sim.tuner->adjustments == 0);
+
+	/* Frequent completions get larger transfers, up to the limit. */
+	tuner_sim_run(&sim, 1, 1000, 0, 0);
+	fail_unless(sim.tuner->size == 2 * TUNER_SIZE);
+	tuner_sim_run(&sim, 3, 1000, 0, 0);
+	fail_unless(sim.tuner->size == sim.tuner->max_size);
+
+	/* Rare completions get smaller transfers, down to the limit. */
+	tuner_sim_run(&sim, 1, 100 * 1000, 0, 0);
+	fail_unless(sim.tuner->size == TUNER_SIZE);
+	tuner_sim_run(&sim, 5, 100 * 1000, 0, 0);
+	fail_unless(sim.tuner->size == sim.tuner->min_size);
+	fail_unless(sim.tuner->size % TUNER_BLOCK_SIZE == 0);
+	fail_unless(sim.tuner->depth == TUNER_DEPTH);
+
+	/* Every completion of a submitted transfer was accounted for. */
+	sum = 0;
+	for (i = 0; i < SR_USB_LATENCY_BINS; i++)
+		sum += sim.tuner->latency_hist[i];
+	fail_unless(sum == sim.completions);
+
+	tuner_sim_free(&sim);
+}
+END_TEST
+
+/*
+ * Check that more transfers get in flight when the host or the consumer
+ * fall behind, and that they get retired once both keep up again.
+ */
+START_TEST(test_tuner_depth)
+{
+	struct tuner_sim sim;
+
+	tuner_sim_init(&sim);
+
+	/*
+	 * 30 ms until the host resubmits, at one completion every 10 ms.
+	 * Grows until the queue covers twice that.
+	 */
+	tuner_sim_run(&sim, 1, 10 * 1000, 30 * 1000, 0);
+	fail_unless(sim.tuner->depth == TUNER_DEPTH + 1);
+	tuner_sim_run(&sim, 4, 10 * 1000, 30 * 1000, 0);
+	fail_unless(sim.tuner->depth == 6, "Depth %u.", sim.tuner->depth);
+	fail_unless(sim.tuner->size == TUNER_SIZE);
+
+	/* Neither grows nor shrinks in between the thresholds. */
+	tuner_sim_run(&sim, 4, 10 * 1000, 10 * 1000, 0);
+	fail_unless(sim.tuner->depth == 6);
+
+	/*
+	 * Quick turnaround, shrinks back to the initial depth. The first
+	 * window still sees the resubmission of the previous one.
+	 */
+	tuner_sim_run(&sim, 2, 10 * 1000, 0, 0);
+	fail_unless(sim.tuner->depth == 5, "Depth %u.", sim.tuner->depth);
+	tuner_sim_run(&sim, 4, 10 * 1000, 0, 0);
+	fail_unless(sim.tuner->depth == TUNER_DEPTH);
+
+	/* A backlog in the consumer, grows up to the limit. */
+	tuner_sim_run(&sim, 4, 10 * 1000, 0, 3);
+	fail_unless(sim.tuner->depth == 6, "Depth %u.", sim.tuner->depth);
+	tuner_sim_run(&sim, 20, 10 * 1000, 0, 100);
+	fail_unless(sim.tuner->depth == TUNER_MAX_DEPTH);
+
+	/* Doesn't shrink while there is a backlog. */
+	tuner_sim_run(&sim, 4, 10 * 1000, 0, 1);
+	fail_unless(sim.tuner->depth == TUNER_MAX_DEPTH);
+	tuner_sim_run(&sim, 20, 10 * 1000, 0, 0);
+	fail_unless(sim.tuner->depth == TUNER_DEPTH);
+
+	tuner_sim_free(&sim);
+}
+END_TEST
+
+/* Starting points of the ring's counters, across their wrap-arounds. */
+static const gint ring_starts[] = { 0, G_MAXINT - 2, -3, -1000 };
+
+/*
+ * Check empty and full rings, and the order of items, with the
+ * counters wrapping around in between.
+ */
+START_TEST(test_ring_states)
+{
+	struct sr_usb_ring ring;
+	struct sr_usb_ring_item item;
+	uint8_t data[8];
+	unsigned int start, round, i;
+
+	for (start = 0; start < ARRAY_SIZE(ring_starts); start++) {
+		sr_usb_ring_init(&ring, 5);
+		fail_unless(ring.mask == 7);
+		ring.head = ring.tail = ring_starts[start];
+		for (round = 0; round < 3; round++) {
+			fail_unless(sr_usb_ring_count(&ring) == 0);
+			fail_unless(!sr_usb_ring_pop(&ring, &item));
+			for (i = 0; i < 8; i++) {
+				fail_unless(sr_usb_ring_push(&ring,
+					&data[i], round * 8 + i));
+				fail_unless(sr_usb_ring_count(&ring) == i + 1);
+			}
+			fail_unless(!sr_usb_ring_push(&ring, data, 0),
+				"Pushed to a full ring.");
+			fail_unless(sr_usb_ring_count(&ring) == 8);
+			for (i = 0; i < 8; i++) {
+				fail_unless(sr_usb_ring_pop(&ring, &item));
+				fail_unless(item.buf == &data[i]);
+				fail_unless(item.len == round * 8 + i);
+			}
+		}
+		/* Interleaved, one item in the ring at a time. */
+		for (i = 0; i < 20; i++) {
+			fail_unless(sr_usb_ring_push(&ring, data, i));
+			fail_unless(sr_usb_ring_pop(&ring, &item));
+			fail_unless(item.len == i);
+			fail_unless(!sr_usb_ring_pop(&ring, &item));
+		}
+		g_free(ring.items);
+	}
+}
+END_TEST
+
+#define RING_ITEMS (1000 * 1000)
+
+static gpointer ring_producer(gpointer data)
+{
+	struct sr_usb_ring *ring;
+	size_t i;
+
+	ring = data;
+	for (i = 0; i < RING_ITEMS; i++) {
+		while (!sr_usb_ring_push(ring, (uint8_t *)ring + (i & 0xff), i))
+			g_thread_yield();
+	}
+
+	return NULL;
+}
+
+/*
+ * Check that a consumer thread receives all of a producer thread's
+ * items in order, through a small ring which keeps getting full and
+ * empty.
+ */
+START_TEST(test_ring_threads)
+{
+	struct sr_usb_ring ring;
+	struct sr_usb_ring_item item;
+	GThread *thread;
+	unsigned int start;
+	size_t i;
+
+	for (start = 0; start < ARRAY_SIZE(ring_starts); start++) {
+		sr_usb_ring_init(&ring, 4);
+		ring.head = ring.tail = ring_starts[start];
+		thread = g_thread_new("ring-producer", ring_producer, &ring);
+		for (i = 0; i < RING_ITEMS; i++) {
+			while (!sr_usb_ring_pop(&ring, &item))
+				g_thread_yield();
+			fail_unless(sr_usb_ring_count(&ring) <= 4);
+			fail_unless(item.len == i,
+				"Item %zu received as %zu.", i, item.len);
+			fail_unless(item.buf == (uint8_t *)&ring + (i & 0xff));
+		}
+		g_thread_join(thread);
+		fail_unless(!sr_usb_ring_pop(&ring, &item));
+		fail_unless(sr_usb_ring_count(&ring) == 0);
+		fail_unless((guint)ring.head ==
+			(guint)ring_starts[start] + RING_ITEMS);
+		g_free(ring.items);
+	}
+}
+END_TEST
+
+#endif
+
+Suite *suite_usb(void)
+{
+	Suite *s;
+	TCase *tc;
+
+	s = suite_create("usb");
+
+	tc = tcase_create("tuner");
+#ifdef HAVE_LIBUSB_1_0
+	tcase_add_test(tc, test_tuner_new);
+	tcase_add_test(tc, test_tuner_size);
+	tcase_add_test(tc, test_tuner_depth);
+#endif
+	suite_add_tcase(s, tc);
+
+	tc = tcase_create("ring");
+	tcase_set_timeout(tc, 0);
+#ifdef HAVE_LIBUSB_1_0
+	tcase_add_test(tc, test_ring_states);
+	tcase_add_test(tc, test_ring_threads);
+#endif
+	suite_add_tcase(s, tc);
+
+	return s;
+}